@@ -5821,6 +5821,94 @@ test_utils_str_utf8safe (void)
 
 /*****************************************************************************/
 
+static void
+test_nm_mem_pool (void)
+{
+	NMMemPool pool;
+	NMMemPoolStats stats;
+	gpointer elts[20];
+	guint i;
+
+	nm_mem_pool_init (&pool, 3, 8);
+
+	for (i = 0; i < G_N_ELEMENTS (elts); i++) {
+		elts[i] = nm_mem_pool_alloc0 (&pool);
+		g_assert (elts[i]);
+		g_assert_cmpint (((guint8 *) elts[i])[0], ==, 0);
+		g_assert_cmpint (((guint8 *) elts[i])[2], ==, 0);
+		memset (elts[i], 0xFF, 3);
+		g_assert (((gsize) elts[i]) % sizeof (gpointer) == 0);
+	}
+
+	nm_mem_pool_get_stats (&pool, &stats);
+	g_assert_cmpint (stats.n_live, ==, 20);
+	g_assert_cmpint (stats.n_live_max, ==, 20);
+	g_assert_cmpint (stats.bytes_allocated, >=, stats.bytes_live);
+	if (pool.use_malloc)
+		g_assert_cmpint (stats.bytes_allocated, ==, stats.bytes_live);
+	else
+		g_assert_cmpint (stats.bytes_allocated, ==, 3 * 8 * (stats.bytes_live / 20));
+
+	for (i = 0; i < G_N_ELEMENTS (elts); i += 2)
+		nm_mem_pool_free (&pool, elts[i]);
+	nm_mem_pool_free (&pool, NULL);
+
+	nm_mem_pool_get_stats (&pool, &stats);
+	g_assert_cmpint (stats.n_live, ==, 10);
+	g_assert_cmpint (stats.n_live_max, ==, 20);
+
+	/* freed elements are reused and zeroed again. */
+	for (i = 0; i < G_N_ELEMENTS (elts); i += 2) {
+		elts[i] = nm_mem_pool_alloc0 (&pool);
+		g_assert_cmpint (((guint8 *) elts[i])[0], ==, 0);
+	}
+	nm_mem_pool_get_stats (&pool, &stats);
+	g_assert_cmpint (stats.n_live, ==, 20);
+	if (!pool.use_malloc)
+		g_assert_cmpint (stats.bytes_allocated, ==, 3 * 8 * (stats.bytes_live / 20));
+
+	for (i = 0; i < G_N_ELEMENTS (elts); i++)
+		nm_mem_pool_free (&pool, elts[i]);
+	nm_mem_pool_clear (&pool);
+
+	nm_mem_pool_get_stats (&pool, &stats);
+	g_assert_cmpint (stats.n_live, ==, 0);
+	g_assert_cmpint (stats.bytes_allocated, ==, 0);
+
+	/* the first two chunks become unused, the last one is still in use. */
+	nm_mem_pool_init (&pool, 3, 8);
+	for (i = 0; i < G_N_ELEMENTS (elts); i++)
+		elts[i] = nm_mem_pool_alloc0 (&pool);
+	for (i = 0; i < 16; i++)
+		nm_mem_pool_free (&pool, elts[i]);
+	nm_mem_pool_trim (&pool);
+
+	nm_mem_pool_get_stats (&pool, &stats);
+	g_assert_cmpint (stats.n_live, ==, 4);
+	if (pool.use_malloc)
+		g_assert_cmpint (stats.bytes_allocated, ==, stats.bytes_live);
+	else {
+		g_assert_cmpint (stats.bytes_allocated, ==, 8 * (stats.bytes_live / 4));
+		g_assert_cmpint (g_slist_length (pool.chunks), ==, 1);
+	}
+
+	/* the rest of the free list is still usable. */
+	for (i = 0; i < 16; i++)
+		elts[i] = nm_mem_pool_alloc0 (&pool);
+	nm_mem_pool_get_stats (&pool, &stats);
+	g_assert_cmpint (stats.n_live, ==, 20);
+	if (!pool.use_malloc)
+		g_assert_cmpint (stats.bytes_allocated, ==, 3 * 8 * (stats.bytes_live / 20));
+
+	for (i = 0; i < G_N_ELEMENTS (elts); i++)
+		nm_mem_pool_free (&pool, elts[i]);
+	nm_mem_pool_trim (&pool);
+	nm_mem_pool_get_stats (&pool, &stats);
+	g_assert_cmpint (stats.bytes_allocated, ==, 0);
+	g_assert (!pool.chunks);
+	nm_mem_pool_clear (&pool);
+}
+
 static int
 _test_nm_in_set_get (int *call_counter, gboolean allow_called, int value)
 {
@@ -6180,6 +6268,7 @@ int main (int argc, char **argv)
 	g_test_add_func ("/core/general/test_c_list_sort", test_c_list_sort);
 	g_test_add_func ("/core/general/test_dedup_multi", test_dedup_multi);
 	g_test_add_func ("/core/general/test_utils_str_utf8safe", test_utils_str_utf8safe);
+	g_test_add_func ("/core/general/test_nm_mem_pool", test_nm_mem_pool);
 	g_test_add_func ("/core/general/test_nm_in_set", test_nm_in_set);
 	g_test_add_func ("/core/general/test_nm_in_strset", test_nm_in_strset);
 	g_test_add_func ("/core/general/test_setting_vpn_items", test_setting_vpn_items);
@@ -43,6 +43,8 @@ struct _NMDedupMultiIndex {
 	int ref_count;
 	GHashTable *idx_entries;
 	GHashTable *idx_objs;
+	NMMemPool pool_entries;
+	NMMemPool pool_head_entries;
 };
 
 /*****************************************************************************/
@@ -338,7 +340,7 @@ _add (NMDedupMultiIndex *self,
 		head_entry = head_existing;
 
 	if (!head_entry) {
-		head_entry = g_slice_new0 (NMDedupMultiHeadEntry);
+		head_entry = nm_mem_pool_alloc0 (&self->pool_head_entries);
 		head_entry->is_head = TRUE;
 		head_entry->idx_type = idx_type;
 		c_list_init (&head_entry->lst_entries_head);
@@ -354,7 +356,7 @@ _add (NMDedupMultiIndex *self,
 		nm_assert (c_list_contains (&entry_order->lst_entries, &head_entry->lst_entries_head));
 	}
 
-	entry = g_slice_new0 (NMDedupMultiEntry);
+	entry = nm_mem_pool_alloc0 (&self->pool_entries);
 	entry->obj = obj_new;
 	entry->head = head_entry;
 
@@ -534,12 +536,12 @@ _remove_entry (NMDedupMultiIndex *self,
 		nm_assert_not_reached ();
 
 	c_list_unlink (&entry->lst_entries);
-	g_slice_free (NMDedupMultiEntry, entry);
+	nm_mem_pool_free (&self->pool_entries, entry);
 
 	if (head_entry) {
 		nm_assert (c_list_is_empty (&head_entry->lst_entries_head));
 		c_list_unlink (&head_entry->lst_idx);
-		g_slice_free (NMDedupMultiHeadEntry, head_entry);
+		nm_mem_pool_free (&self->pool_head_entries, head_entry);
 	}
 
 	nm_dedup_multi_obj_unref (obj);
@@ -996,6 +998,45 @@ nm_dedup_multi_objs_to_ptr_array_head (const NMDedupMultiHeadEntry *head_entry,
 
 /*****************************************************************************/
 
+/**
+ * nm_dedup_multi_index_get_pool_stats:
+ * @self: the #NMDedupMultiIndex
+ * @out_entries: (allow-none): (out): the allocation statistics of
+ *   the index entries.
+ * @out_head_entries: (allow-none): (out): the allocation statistics of
+ *   the head entries.
+ *
+ * For debugging, returns how many entries are allocated.
+ */
+void
+nm_dedup_multi_index_get_pool_stats (NMDedupMultiIndex *self,
+                                     NMMemPoolStats *out_entries,
+                                     NMMemPoolStats *out_head_entries)
+{
+	g_return_if_fail (self);
+
+	if (out_entries)
+		nm_mem_pool_get_stats (&self->pool_entries, out_entries);
+	if (out_head_entries)
+		nm_mem_pool_get_stats (&self->pool_head_entries, out_head_entries);
+}
+
+/**
+ * nm_dedup_multi_index_trim:
+ * @self: the #NMDedupMultiIndex
+ *
+ * Releases the memory of entries that were removed, as far as
+ * possible. See nm_mem_pool_trim().
+ */
+void
+nm_dedup_multi_index_trim (NMDedupMultiIndex *self)
+{
+	g_return_if_fail (self);
+
+	nm_mem_pool_trim (&self->pool_entries);
+	nm_mem_pool_trim (&self->pool_head_entries);
+}
+
 NMDedupMultiIndex *
 nm_dedup_multi_index_new (void)
 {
@@ -1005,6 +1046,8 @@ nm_dedup_multi_index_new (void)
 	self->ref_count = 1;
 	self->idx_entries = g_hash_table_new ((GHashFunc) _dict_idx_entries_hash, (GEqualFunc) _dict_idx_entries_equal);
 	self->idx_objs    = g_hash_table_new ((GHashFunc) _dict_idx_objs_hash,    (GEqualFunc) _dict_idx_objs_equal);
+	nm_mem_pool_init (&self->pool_entries, sizeof (NMDedupMultiEntry), 256);
+	nm_mem_pool_init (&self->pool_head_entries, sizeof (NMDedupMultiHeadEntry), 32);
 	return self;
 }
 
@@ -1055,6 +1098,9 @@ more:
 	g_hash_table_unref (self->idx_entries);
 	g_hash_table_unref (self->idx_objs);
 
+	nm_mem_pool_clear (&self->pool_entries);
+	nm_mem_pool_clear (&self->pool_head_entries);
+
 	g_slice_free (NMDedupMultiIndex, self);
 	return NULL;
 }
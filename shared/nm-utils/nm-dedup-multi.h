@@ -238,6 +238,11 @@ NMDedupMultiIndex *nm_dedup_multi_index_new (void);
 NMDedupMultiIndex *nm_dedup_multi_index_ref (NMDedupMultiIndex *self);
 NMDedupMultiIndex *nm_dedup_multi_index_unref (NMDedupMultiIndex *self);
 
+void nm_dedup_multi_index_get_pool_stats (NMDedupMultiIndex *self,
+                                          NMMemPoolStats *out_entries,
+                                          NMMemPoolStats *out_head_entries);
+void nm_dedup_multi_index_trim (NMDedupMultiIndex *self);
+
 static inline void
 _nm_auto_unref_dedup_multi_index (NMDedupMultiIndex **v)
 {
@@ -535,3 +535,218 @@ nm_utils_str_utf8safe_escape_take (char *str, NMUtilsStrUtf8SafeFlags flags)
 	}
 	return str;
 }
+
+/*****************************************************************************/
+
+#define NM_MEM_POOL_ALIGN (2 * sizeof (gpointer))
+
+static gboolean
+_mem_pool_use_malloc (void)
+{
+	static const GDebugKey keys[] = {
+		{ "always-malloc", 1 },
+	};
+	static int use_malloc = -1;
+
+	/* like g_slice, leave the allocations to malloc() when asked to.
+	 * tools/run-nm-test.sh does so for valgrind. */
+	if (G_UNLIKELY (use_malloc == -1))
+		use_malloc = g_parse_debug_string (g_getenv ("G_SLICE"), keys, G_N_ELEMENTS (keys));
+	return use_malloc;
+}
+
+/**
+ * nm_mem_pool_init:
+ * @pool: the pool to initialize
+ * @elt_size: the size of each element
+ * @chunk_len: how many elements to allocate at once
+ *
+ * Initializes a pool of @elt_size sized elements. This is for objects
+ * that are created in large numbers, where the per-allocation overhead
+ * of the generic allocators matters.
+ */
+void
+nm_mem_pool_init (NMMemPool *pool, gsize elt_size, gsize chunk_len)
+{
+	nm_assert (pool);
+	nm_assert (elt_size > 0);
+	nm_assert (chunk_len > 0);
+
+	memset (pool, 0, sizeof (*pool));
+	pool->elt_size = (MAX (elt_size, sizeof (gpointer)) + NM_MEM_POOL_ALIGN - 1) & ~(NM_MEM_POOL_ALIGN - 1);
+	pool->chunk_len = chunk_len;
+	pool->use_malloc = _mem_pool_use_malloc ();
+}
+
+/**
+ * nm_mem_pool_clear:
+ * @pool: the pool
+ *
+ * Releases all memory of the pool. There must be no elements
+ * in use anymore.
+ */
+void
+nm_mem_pool_clear (NMMemPool *pool)
+{
+	nm_assert (pool);
+	nm_assert (pool->n_live == 0);
+
+	g_slist_free_full (pool->chunks, g_free);
+	pool->chunks = NULL;
+	pool->free_list = NULL;
+	pool->n_allocated = 0;
+}
+
+static int
+_mem_pool_chunk_cmp (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+	guintptr pa = (guintptr) *((const char *const*) a);
+	guintptr pb = (guintptr) *((const char *const*) b);
+
+	return pa < pb ? -1 : (pa > pb ? 1 : 0);
+}
+
+/* the index of the chunk in the sorted @chunks that contains @mem. */
+static gsize
+_mem_pool_chunk_find (char *const*chunks, gsize n_chunks, gconstpointer mem)
+{
+	gsize lo = 0, hi = n_chunks;
+
+	while (hi - lo > 1) {
+		gsize mid = lo + (hi - lo) / 2;
+
+		if ((guintptr) chunks[mid] <= (guintptr) mem)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/**
+ * nm_mem_pool_trim:
+ * @pool: the pool
+ *
+ * Releases the chunks of which no element is in use. This takes time
+ * linear to the number of free elements, so call it after many
+ * elements were released at once.
+ */
+void
+nm_mem_pool_trim (NMMemPool *pool)
+{
+	gs_free char **chunks = NULL;
+	gs_free gsize *n_free = NULL;
+	gsize n_chunks, i;
+	gpointer mem, *p_next;
+	GSList *iter;
+
+	nm_assert (pool);
+
+	/* no chunk can be unused. */
+	if (pool->n_allocated - pool->n_live < pool->chunk_len)
+		return;
+
+	n_chunks = g_slist_length (pool->chunks);
+	chunks = g_new (char *, n_chunks);
+	for (i = 0, iter = pool->chunks; iter; iter = iter->next)
+		chunks[i++] = iter->data;
+	g_qsort_with_data (chunks, n_chunks, sizeof (chunks[0]), _mem_pool_chunk_cmp, NULL);
+
+	n_free = g_new0 (gsize, n_chunks);
+	for (mem = pool->free_list; mem; mem = *((gpointer *) mem))
+		n_free[_mem_pool_chunk_find (chunks, n_chunks, mem)]++;
+
+	/* drop the elements of the unused chunks from the free list... */
+	p_next = &pool->free_list;
+	while ((mem = *p_next)) {
+		if (n_free[_mem_pool_chunk_find (chunks, n_chunks, mem)] == pool->chunk_len)
+			*p_next = *((gpointer *) mem);
+		else
+			p_next = (gpointer *) mem;
+	}
+
+	/* ... and release them. */
+	g_slist_free (pool->chunks);
+	pool->chunks = NULL;
+	for (i = 0; i < n_chunks; i++) {
+		if (n_free[i] == pool->chunk_len) {
+			g_free (chunks[i]);
+			pool->n_allocated -= pool->chunk_len;
+		} else
+			pool->chunks = g_slist_prepend (pool->chunks, chunks[i]);
+	}
+}
+
+gpointer
+nm_mem_pool_alloc0 (NMMemPool *pool)
+{
+	gpointer mem;
+
+	nm_assert (pool);
+	nm_assert (pool->elt_size > 0);
+
+	if (pool->use_malloc) {
+		mem = g_malloc0 (pool->elt_size);
+		pool->n_allocated++;
+		goto out;
+	}
+
+	if (G_UNLIKELY (!pool->free_list)) {
+		char *chunk;
+		gsize i;
+
+		chunk = g_malloc (pool->elt_size * pool->chunk_len);
+		pool->chunks = g_slist_prepend (pool->chunks, chunk);
+		pool->n_allocated += pool->chunk_len;
+
+		for (i = pool->chunk_len; i > 0; i--) {
+			mem = &chunk[(i - 1) * pool->elt_size];
+			*((gpointer *) mem) = pool->free_list;
+			pool->free_list = mem;
+		}
+	}
+
+	mem = pool->free_list;
+	pool->free_list = *((gpointer *) mem);
+	memset (mem, 0, pool->elt_size);
+
+out:
+	pool->n_live++;
+	if (pool->n_live > pool->n_live_max)
+		pool->n_live_max = pool->n_live;
+	return mem;
+}
+
+void
+nm_mem_pool_free (NMMemPool *pool, gpointer mem)
+{
+	nm_assert (pool);
+
+	if (!mem)
+		return;
+
+	nm_assert (pool->n_live > 0);
+
+	pool->n_live--;
+
+	if (pool->use_malloc) {
+		g_free (mem);
+		pool->n_allocated--;
+		return;
+	}
+
+	*((gpointer *) mem) = pool->free_list;
+	pool->free_list = mem;
+}
+
+void
+nm_mem_pool_get_stats (const NMMemPool *pool, NMMemPoolStats *stats)
+{
+	nm_assert (pool);
+	nm_assert (stats);
+
+	stats->n_live = pool->n_live;
+	stats->n_live_max = pool->n_live_max;
+	stats->bytes_live = pool->n_live * pool->elt_size;
+	stats->bytes_allocated = pool->n_allocated * pool->elt_size;
+}
@@ -200,4 +200,42 @@ char *nm_utils_str_utf8safe_escape_take (char *str, NMUtilsStrUtf8SafeFlags flag
 
 /*****************************************************************************/
 
+typedef struct {
+	gsize n_live;
+	gsize n_live_max;
+	gsize bytes_live;
+	gsize bytes_allocated;
+} NMMemPoolStats;
+
+/* A pool of equally sized, zero-initialized elements. Elements are carved
+ * out of larger chunks and released elements are kept on a free list
+ * for reuse. Chunks are returned by nm_mem_pool_trim() once none of their
+ * elements is in use, and by nm_mem_pool_clear().
+ *
+ * With G_SLICE=always-malloc, each element is allocated on its own, so
+ * that memory checkers see every allocation.
+ *
+ * A pool is not thread-safe. */
+typedef struct {
+	gpointer free_list;
+	GSList *chunks;
+	gsize elt_size;
+	gsize chunk_len;
+	gsize n_live;
+	gsize n_live_max;
+	gsize n_allocated;
+	gboolean use_malloc;
+} NMMemPool;
+
+void nm_mem_pool_init (NMMemPool *pool, gsize elt_size, gsize chunk_len);
+void nm_mem_pool_clear (NMMemPool *pool);
+void nm_mem_pool_trim (NMMemPool *pool);
+
+gpointer nm_mem_pool_alloc0 (NMMemPool *pool);
+void nm_mem_pool_free (NMMemPool *pool, gpointer mem);
+
+void nm_mem_pool_get_stats (const NMMemPool *pool, NMMemPoolStats *stats);
+
+/*****************************************************************************/
+
 #endif /* __NM_SHARED_UTILS_H__ */
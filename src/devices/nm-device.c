@@ -472,7 +472,8 @@ typedef struct _NMDevicePrivate {
 	guint check_delete_unrealized_id;
 
 	struct {
-		guint timeout_id;
+		int watched_ifindex;
+		guint watched_rate_ms;
 		guint refresh_rate_ms;
 		guint64 tx_bytes;
 		guint64 rx_bytes;
@@ -531,6 +532,7 @@ static gboolean ip_config_valid (NMDeviceState state);
 static NMActStageReturn dhcp4_start (NMDevice *self, NMConnection *connection);
 static gboolean dhcp6_start (NMDevice *self, gboolean wait_for_ll);
 static void nm_device_start_ip_check (NMDevice *self);
+static void _stats_update_watch (NMDevice *self);
 static void realize_start_setup (NMDevice *self,
                                  const NMPlatformLink *plink,
                                  gboolean assume_state_guess_assume,
@@ -1158,6 +1160,8 @@ nm_device_set_ip_iface (NMDevice *self, const char *iface)
 	/* We don't care about any saved values from the old iface */
 	g_hash_table_remove_all (priv->ip6_saved_properties);
 
+	_stats_update_watch (self);
+
 	_notify (self, PROP_IP_IFACE);
 	return TRUE;
 }
@@ -1343,22 +1347,6 @@ _stats_update_counters_from_pllink (NMDevice *self, const NMPlatformLink *pllink
 	_stats_update_counters (self, pllink->tx_bytes, pllink->rx_bytes);
 }
 
-static gboolean
-_stats_timeout_cb (gpointer user_data)
-{
-	NMDevice *self = user_data;
-	int ifindex;
-
-	ifindex = nm_device_get_ip_ifindex (self);
-
-	_LOGT (LOGD_DEVICE, "stats: refresh %d", ifindex);
-
-	if (ifindex > 0)
-		nm_platform_link_refresh (nm_device_get_platform (self), ifindex);
-
-	return G_SOURCE_CONTINUE;
-}
-
 static guint
 _stats_refresh_rate_real (guint refresh_rate_ms)
 {
@@ -1376,6 +1364,42 @@ _stats_refresh_rate_real (guint refresh_rate_ms)
 	return refresh_rate_ms;
 }
 
+/* The statistics are reloaded by the platform, which serves all devices
+ * with the same refresh rate by one timer and one request. */
+static void
+_stats_update_watch (NMDevice *self)
+{
+	NMDevicePrivate *priv = NM_DEVICE_GET_PRIVATE (self);
+	int ifindex = 0;
+	guint rate_ms;
+
+	rate_ms = _stats_refresh_rate_real (priv->stats.refresh_rate_ms);
+	if (rate_ms)
+		ifindex = nm_device_get_ip_ifindex (self);
+	if (ifindex <= 0) {
+		ifindex = 0;
+		rate_ms = 0;
+	}
+
+	if (   priv->stats.watched_ifindex == ifindex
+	    && priv->stats.watched_rate_ms == rate_ms)
+		return;
+
+	if (priv->stats.watched_ifindex > 0) {
+		nm_platform_link_stats_unwatch (nm_device_get_platform (self),
+		                                priv->stats.watched_ifindex,
+		                                priv->stats.watched_rate_ms);
+	}
+
+	priv->stats.watched_ifindex = ifindex;
+	priv->stats.watched_rate_ms = rate_ms;
+
+	if (ifindex > 0) {
+		_LOGT (LOGD_DEVICE, "stats: watch %d every %u ms", ifindex, rate_ms);
+		nm_platform_link_stats_watch (nm_device_get_platform (self), ifindex, rate_ms);
+	}
+}
+
 static void
 _stats_set_refresh_rate (NMDevice *self, guint refresh_rate_ms)
 {
@@ -1401,7 +1425,7 @@ _stats_set_refresh_rate (NMDevice *self, guint refresh_rate_ms)
 	if (_stats_refresh_rate_real (old_rate) == refresh_rate_ms)
 		return;
 
-	nm_clear_g_source (&priv->stats.timeout_id);
+	_stats_update_watch (self);
 
 	if (!refresh_rate_ms)
 		return;
@@ -1412,8 +1436,6 @@ _stats_set_refresh_rate (NMDevice *self, guint refresh_rate_ms)
 	ifindex = nm_device_get_ip_ifindex (self);
 	if (ifindex > 0)
 		nm_platform_link_refresh (nm_device_get_platform (self), ifindex);
-
-	priv->stats.timeout_id = g_timeout_add (refresh_rate_ms, _stats_timeout_cb, self);
 }
 
 /*****************************************************************************/
@@ -3075,7 +3097,6 @@ realize_start_setup (NMDevice *self,
 	static guint32 id = 0;
 	NMDeviceCapabilities capabilities = 0;
 	NMConfig *config;
-	guint real_rate;
 	guint32 mtu;
 
 	g_return_if_fail (NM_IS_DEVICE (self));
@@ -3187,10 +3208,7 @@ realize_start_setup (NMDevice *self,
 
 	device_init_sriov_num_vfs (self);
 
-	nm_assert (!priv->stats.timeout_id);
-	real_rate = _stats_refresh_rate_real (priv->stats.refresh_rate_ms);
-	if (real_rate)
-		priv->stats.timeout_id = g_timeout_add (real_rate, _stats_timeout_cb, self);
+	_stats_update_watch (self);
 
 	nm_device_set_autoconnect_full (self, !!DEFAULT_AUTOCONNECT, TRUE);
 
@@ -3374,7 +3392,7 @@ nm_device_unrealize (NMDevice *self, gboolean remove_resources, GError **error)
 		_notify (self, PROP_PHYSICAL_PORT_ID);
 	}
 
-	nm_clear_g_source (&priv->stats.timeout_id);
+	_stats_update_watch (self);
 	_stats_update_counters (self, 0, 0);
 
 	priv->hw_addr_len_ = 0;
@@ -10978,59 +10996,82 @@ queued_ip6_config_change (gpointer user_data)
 }
 
 static void
-device_ipx_changed (NMPlatform *platform,
-                    int obj_type_i,
-                    int ifindex,
-                    gpointer platform_object,
-                    int change_type_i,
-                    NMDevice *self)
+_queue_ip4_config_change (NMDevice *self)
+{
+	NMDevicePrivate *priv = NM_DEVICE_GET_PRIVATE (self);
+
+	if (nm_device_get_unmanaged_flags (self, NM_UNMANAGED_PLATFORM_INIT)) {
+		priv->queued_ip4_config_pending = TRUE;
+		nm_assert_se (!nm_clear_g_source (&priv->queued_ip4_config_id));
+	} else if (!priv->queued_ip4_config_id) {
+		priv->queued_ip4_config_pending = FALSE;
+		priv->queued_ip4_config_id = g_idle_add (queued_ip4_config_change, self);
+		_LOGD (LOGD_DEVICE, "queued IP4 config change");
+	}
+}
+
+static void
+_queue_ip6_config_change (NMDevice *self)
+{
+	NMDevicePrivate *priv = NM_DEVICE_GET_PRIVATE (self);
+
+	if (nm_device_get_unmanaged_flags (self, NM_UNMANAGED_PLATFORM_INIT)) {
+		priv->queued_ip6_config_pending = TRUE;
+		nm_assert_se (!nm_clear_g_source (&priv->queued_ip6_config_id));
+	} else if (!priv->queued_ip6_config_id) {
+		priv->queued_ip6_config_pending = FALSE;
+		priv->queued_ip6_config_id = g_idle_add (queued_ip6_config_change, self);
+		_LOGD (LOGD_DEVICE, "queued IP6 config change");
+	}
+}
+
+static void
+device_ip6_address_changed (NMPlatform *platform,
+                            int obj_type_i,
+                            int ifindex,
+                            NMPlatformIP6Address *addr,
+                            int change_type_i,
+                            NMDevice *self)
 {
-	const NMPObjectType obj_type = obj_type_i;
 	const NMPlatformSignalChangeType change_type = change_type_i;
 	NMDevicePrivate *priv;
-	NMPlatformIP6Address *addr;
 
 	if (nm_device_get_ip_ifindex (self) != ifindex)
 		return;
 
 	priv = NM_DEVICE_GET_PRIVATE (self);
 
-	switch (obj_type) {
-	case NMP_OBJECT_TYPE_IP4_ADDRESS:
-	case NMP_OBJECT_TYPE_IP4_ROUTE:
-		if (nm_device_get_unmanaged_flags (self, NM_UNMANAGED_PLATFORM_INIT)) {
-			priv->queued_ip4_config_pending = TRUE;
-			nm_assert_se (!nm_clear_g_source (&priv->queued_ip4_config_id));
-		} else if (!priv->queued_ip4_config_id) {
-			priv->queued_ip4_config_pending = FALSE;
-			priv->queued_ip4_config_id = g_idle_add (queued_ip4_config_change, self);
-			_LOGD (LOGD_DEVICE, "queued IP4 config change");
-		}
-		break;
-	case NMP_OBJECT_TYPE_IP6_ADDRESS:
-		addr = platform_object;
-
-		if (   priv->state > NM_DEVICE_STATE_DISCONNECTED
-		    && priv->state < NM_DEVICE_STATE_DEACTIVATING
-		    && (   (change_type == NM_PLATFORM_SIGNAL_CHANGED && addr->n_ifa_flags & IFA_F_DADFAILED)
-		        || (change_type == NM_PLATFORM_SIGNAL_REMOVED && addr->n_ifa_flags & IFA_F_TENTATIVE))) {
-			priv->dad6_failed_addrs = g_slist_append (priv->dad6_failed_addrs,
-			                                          g_memdup (addr, sizeof (NMPlatformIP6Address)));
-		}
-		/* fall through */
-	case NMP_OBJECT_TYPE_IP6_ROUTE:
-		if (nm_device_get_unmanaged_flags (self, NM_UNMANAGED_PLATFORM_INIT)) {
-			priv->queued_ip6_config_pending = TRUE;
-			nm_assert_se (!nm_clear_g_source (&priv->queued_ip6_config_id));
-		} else if (!priv->queued_ip6_config_id) {
-			priv->queued_ip6_config_pending = FALSE;
-			priv->queued_ip6_config_id = g_idle_add (queued_ip6_config_change, self);
-			_LOGD (LOGD_DEVICE, "queued IP6 config change");
-		}
-		break;
-	default:
-		g_return_if_reached ();
+	if (   priv->state > NM_DEVICE_STATE_DISCONNECTED
+	    && priv->state < NM_DEVICE_STATE_DEACTIVATING
+	    && (   (change_type == NM_PLATFORM_SIGNAL_CHANGED && addr->n_ifa_flags & IFA_F_DADFAILED)
+	        || (change_type == NM_PLATFORM_SIGNAL_REMOVED && addr->n_ifa_flags & IFA_F_TENTATIVE))) {
+		priv->dad6_failed_addrs = g_slist_append (priv->dad6_failed_addrs,
+		                                          g_memdup (addr, sizeof (NMPlatformIP6Address)));
 	}
+
+	_queue_ip6_config_change (self);
+}
+
+/* Addresses and routes are only checked per interface, so we don't need to
+ * handle each change. Instead use the coalesced set of changes that the
+ * platform emits once after a burst of route updates. */
+static void
+device_ipx_changed_set (NMPlatform *platform,
+                        const NMPlatformChangedSet *set,
+                        NMDevice *self)
+{
+	int ifindex;
+
+	ifindex = nm_device_get_ip_ifindex (self);
+	if (ifindex <= 0)
+		return;
+
+	if (   nm_platform_changed_set_lookup (set, NMP_OBJECT_TYPE_IP4_ADDRESS, ifindex)
+	    || nm_platform_changed_set_lookup (set, NMP_OBJECT_TYPE_IP4_ROUTE, ifindex))
+		_queue_ip4_config_change (self);
+
+	if (nm_platform_changed_set_lookup (set, NMP_OBJECT_TYPE_IP6_ROUTE, ifindex))
+		_queue_ip6_config_change (self);
 }
 
 /*****************************************************************************/
@@ -13847,10 +13888,8 @@ constructed (GObject *object)
 
 	/* Watch for external IP config changes */
 	platform = nm_device_get_platform (self);
-	g_signal_connect (platform, NM_PLATFORM_SIGNAL_IP4_ADDRESS_CHANGED, G_CALLBACK (device_ipx_changed), self);
-	g_signal_connect (platform, NM_PLATFORM_SIGNAL_IP6_ADDRESS_CHANGED, G_CALLBACK (device_ipx_changed), self);
-	g_signal_connect (platform, NM_PLATFORM_SIGNAL_IP4_ROUTE_CHANGED, G_CALLBACK (device_ipx_changed), self);
-	g_signal_connect (platform, NM_PLATFORM_SIGNAL_IP6_ROUTE_CHANGED, G_CALLBACK (device_ipx_changed), self);
+	g_signal_connect (platform, NM_PLATFORM_SIGNAL_IP6_ADDRESS_CHANGED, G_CALLBACK (device_ip6_address_changed), self);
+	g_signal_connect (platform, NM_PLATFORM_SIGNAL_CHANGED_SET, G_CALLBACK (device_ipx_changed_set), self);
 	g_signal_connect (platform, NM_PLATFORM_SIGNAL_LINK_CHANGED, G_CALLBACK (link_changed_cb), self);
 
 	g_signal_connect (nm_netns_get_route_manager (priv->netns), NM_ROUTE_MANAGER_IP4_ROUTES_CHANGED,
@@ -13893,7 +13932,8 @@ dispose (GObject *object)
 	_parent_set_ifindex (self, 0, FALSE);
 
 	platform = nm_device_get_platform (self);
-	g_signal_handlers_disconnect_by_func (platform, G_CALLBACK (device_ipx_changed), self);
+	g_signal_handlers_disconnect_by_func (platform, G_CALLBACK (device_ip6_address_changed), self);
+	g_signal_handlers_disconnect_by_func (platform, G_CALLBACK (device_ipx_changed_set), self);
 	g_signal_handlers_disconnect_by_func (platform, G_CALLBACK (link_changed_cb), self);
 
 	g_signal_handlers_disconnect_by_func (nm_netns_get_route_manager (priv->netns),
@@ -13929,7 +13969,12 @@ dispose (GObject *object)
 
 	nm_clear_g_source (&priv->check_delete_unrealized_id);
 
-	nm_clear_g_source (&priv->stats.timeout_id);
+	if (priv->stats.watched_ifindex > 0) {
+		nm_platform_link_stats_unwatch (nm_device_get_platform (self),
+		                                priv->stats.watched_ifindex,
+		                                priv->stats.watched_rate_ms);
+		priv->stats.watched_ifindex = 0;
+	}
 
 	carrier_disconnected_action_cancel (self);
 
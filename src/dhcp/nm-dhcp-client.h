@@ -187,5 +187,6 @@ typedef struct {
 extern const NMDhcpClientFactory _nm_dhcp_client_factory_dhclient;
 extern const NMDhcpClientFactory _nm_dhcp_client_factory_dhcpcd;
 extern const NMDhcpClientFactory _nm_dhcp_client_factory_internal;
+extern const NMDhcpClientFactory _nm_dhcp_client_factory_internal_shared;
 
 #endif /* __NETWORKMANAGER_DHCP_CLIENT_H__ */
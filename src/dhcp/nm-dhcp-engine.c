@@ -0,0 +1,1545 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2017 Red Hat, Inc.
+ */
+
+/* A DHCPv4 client engine that serves any number of interfaces.
+ *
+ * Clients that have no address yet, or that broadcast to rebind their
+ * lease, share one AF_PACKET socket that is bound to all interfaces. A BPF
+ * filter lets only DHCP replies pass to user space. The socket is only
+ * open while at least one client is in such a state, as it sees the
+ * traffic of all interfaces. Clients with a lease renew it by unicast,
+ * over one UDP socket that is bound to the client port on all interfaces.
+ * The interface of a reply is taken from IP_PKTINFO.
+ *
+ * Either way, replies are handed to the client by the interface they
+ * arrived on and their transaction ID. Retransmissions and the lease
+ * timers (T1, T2 and expiry) are entries in the shared timer wheel.
+ * Hence, the number of file descriptors and main loop sources does not
+ * grow with the number of interfaces.
+ *
+ * Only Ethernet is supported. Replies are requested as broadcast, so
+ * that they reach the packet socket before the interface has an address. */
+
+#include "nm-default.h"
+
+#include "nm-dhcp-engine.h"
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <net/ethernet.h>
+#include <net/if_arp.h>
+#include <netinet/ip.h>
+#include <linux/filter.h>
+#include <linux/if_packet.h>
+
+#include "nm-core-utils.h"
+#include "nm-timer-wheel.h"
+
+#define DHCP_PORT_SERVER            67
+#define DHCP_PORT_CLIENT            68
+#define DHCP_MAGIC_COOKIE           0x63825363u
+
+#define BOOTREQUEST                 1
+#define BOOTREPLY                   2
+
+#define IP_HEADER_LEN               20
+#define UDP_HEADER_LEN              8
+
+/* the fixed part of a message, up to and including the magic cookie. */
+#define MSG_HEADER_LEN              240
+#define MSG_OFF_XID                 4
+#define MSG_OFF_SECS                8
+#define MSG_OFF_FLAGS               10
+#define MSG_OFF_CIADDR              12
+#define MSG_OFF_YIADDR              16
+#define MSG_OFF_CHADDR              28
+#define MSG_OFF_SNAME               44
+#define MSG_OFF_FILE                108
+#define MSG_OFF_MAGIC               236
+#define MSG_FLAG_BROADCAST          0x8000
+
+#define OPT_PAD                     0
+#define OPT_HOST_NAME               12
+#define OPT_REQUESTED_ADDRESS       50
+#define OPT_LEASE_TIME              51
+#define OPT_OVERLOAD                52
+#define OPT_MESSAGE_TYPE            53
+#define OPT_SERVER_ID               54
+#define OPT_PARAMETER_REQUEST_LIST  55
+#define OPT_RENEWAL_TIME            58
+#define OPT_REBINDING_TIME          59
+#define OPT_CLIENT_ID               61
+#define OPT_FQDN                    81
+#define OPT_END                     255
+
+#define OVERLOAD_FILE               1
+#define OVERLOAD_SNAME              2
+
+#define FQDN_FLAG_S                 0x01
+#define FQDN_FLAG_E                 0x04
+
+#define DHCPDISCOVER                1
+#define DHCPOFFER                   2
+#define DHCPREQUEST                 3
+#define DHCPACK                     5
+#define DHCPNAK                     6
+#define DHCPRELEASE                 7
+
+#define LEASE_INFINITE              0xFFFFFFFFu
+
+/* RFC 2131, section 4.1 */
+#define RETRANSMIT_MIN_MSEC         4000
+#define RETRANSMIT_MAX_MSEC         64000
+#define RETRANSMIT_JITTER_MSEC      1000
+#define RENEW_RETRANSMIT_MIN_MSEC   60000
+#define REQUEST_MAX_ATTEMPTS        4
+#define NAK_RESTART_MSEC            2000
+
+/* when the socket buffer is full, try again soon. */
+#define SEND_RETRY_MSEC             50
+
+#define PACKET_MAX                  65536
+#define MAX_READ_PER_DISPATCH       64
+#define SOCKET_BUF_SIZE             (1024 * 1024)
+
+/*****************************************************************************/
+
+typedef enum {
+	STATE_STOPPED,
+	STATE_SELECTING,
+	STATE_REQUESTING,
+	STATE_BOUND,
+	STATE_RENEWING,
+	STATE_REBINDING,
+} State;
+
+typedef struct {
+	int fd;
+	GIOChannel *channel;
+	guint watch_id;
+
+	bool in_receive:1;
+	bool close_pending:1;
+} EngineSocket;
+
+struct _NMDhcpEngine {
+	NMTimerWheel *wheel;
+
+	/* the clients by their key, see _client_set_xid(). */
+	GHashTable *clients;
+	guint n_clients;
+
+	/* the number of clients that need the packet socket,
+	 * see _state_needs_packet_socket(). */
+	guint n_packet_clients;
+
+	EngineSocket packet;
+	EngineSocket udp;
+
+	GRand *rand;
+	guint8 *buf;
+};
+
+struct _NMDhcpEngineClient {
+	NMDhcpEngine *engine;
+	NMTimerWheelEntry timer;
+
+	/* the interface index in the upper and the transaction ID in the
+	 * lower 32 bits. Replies are matched by it. */
+	gint64 key;
+	int ifindex;
+	guint32 xid;
+
+	State state;
+	guint n_attempts;
+	gint64 start_ms;
+
+	guint8 hwaddr[ETH_ALEN];
+	guint8 *client_id;
+	gsize client_id_len;
+	char *hostname;
+	guint8 *request_options;
+	gsize n_request_options;
+	in_addr_t request_address;
+
+	/* the offered or leased address */
+	in_addr_t address;
+	in_addr_t server_id;
+
+	/* zero for an infinite lease */
+	gint64 t1_ms;
+	gint64 t2_ms;
+	gint64 expiry_ms;
+
+	NMDhcpEngineClientFunc func;
+	gpointer user_data;
+
+	bool use_fqdn:1;
+};
+
+/*****************************************************************************/
+
+#define _NMLOG_DOMAIN      LOGD_DHCP4
+#define _NMLOG(level, ...) \
+    G_STMT_START { \
+        const NMDhcpEngineClient *const __self = (self); \
+        \
+        nm_log ((level), _NMLOG_DOMAIN, NULL, NULL, \
+                "dhcp4-engine[%d]: " _NM_UTILS_MACRO_FIRST (__VA_ARGS__), \
+                __self->ifindex \
+                _NM_UTILS_MACRO_REST (__VA_ARGS__)); \
+    } G_STMT_END
+
+#define _NMLOG2_DOMAIN     LOGD_DHCP4
+#define _NMLOG2(level, ...) __NMLOG_DEFAULT (level, _NMLOG2_DOMAIN, "dhcp4-engine", __VA_ARGS__)
+
+/*****************************************************************************/
+
+static gboolean _socket_open_packet (NMDhcpEngine *engine, GError **error);
+static void _socket_close (NMDhcpEngine *engine, EngineSocket *sock);
+
+/*****************************************************************************/
+
+static const guint8 hwaddr_broadcast[ETH_ALEN] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+
+/* Offsets are relative to the IP header, as the socket is of type
+ * SOCK_DGRAM. The jump offsets count the instructions to skip. */
+static const struct sock_filter filter[] = {
+	BPF_STMT (BPF_LD  + BPF_B   + BPF_ABS, SKF_AD_OFF + SKF_AD_PKTTYPE),           /* A <- packet type */
+	BPF_JUMP (BPF_JMP + BPF_JEQ + BPF_K,   PACKET_OUTGOING, 18, 0),                 /* our own packet? */
+	BPF_STMT (BPF_LD  + BPF_W   + BPF_LEN, 0),                                      /* A <- length */
+	BPF_JUMP (BPF_JMP + BPF_JGE + BPF_K,   IP_HEADER_LEN + UDP_HEADER_LEN + MSG_HEADER_LEN, 0, 16),
+	BPF_STMT (BPF_LD  + BPF_B   + BPF_ABS, 9),                                      /* A <- IP protocol */
+	BPF_JUMP (BPF_JMP + BPF_JEQ + BPF_K,   IPPROTO_UDP, 0, 14),
+	BPF_STMT (BPF_LD  + BPF_H   + BPF_ABS, 6),                                      /* A <- IP flags and fragment offset */
+	BPF_JUMP (BPF_JMP + BPF_JSET + BPF_K,  0x3FFF, 12, 0),                          /* a fragment? */
+	BPF_STMT (BPF_LDX + BPF_B   + BPF_MSH, 0),                                      /* X <- IP header length */
+	BPF_STMT (BPF_LD  + BPF_H   + BPF_IND, 2),                                      /* A <- UDP destination port */
+	BPF_JUMP (BPF_JMP + BPF_JEQ + BPF_K,   DHCP_PORT_CLIENT, 0, 9),
+	BPF_STMT (BPF_LD  + BPF_B   + BPF_IND, UDP_HEADER_LEN + 0),                     /* A <- op */
+	BPF_JUMP (BPF_JMP + BPF_JEQ + BPF_K,   BOOTREPLY, 0, 7),
+	BPF_STMT (BPF_LD  + BPF_B   + BPF_IND, UDP_HEADER_LEN + 1),                     /* A <- htype */
+	BPF_JUMP (BPF_JMP + BPF_JEQ + BPF_K,   ARPHRD_ETHER, 0, 5),
+	BPF_STMT (BPF_LD  + BPF_B   + BPF_IND, UDP_HEADER_LEN + 2),                     /* A <- hlen */
+	BPF_JUMP (BPF_JMP + BPF_JEQ + BPF_K,   ETH_ALEN, 0, 3),
+	BPF_STMT (BPF_LD  + BPF_W   + BPF_IND, UDP_HEADER_LEN + MSG_OFF_MAGIC),         /* A <- magic cookie */
+	BPF_JUMP (BPF_JMP + BPF_JEQ + BPF_K,   DHCP_MAGIC_COOKIE, 0, 1),
+	BPF_STMT (BPF_RET + BPF_K,             PACKET_MAX),                             /* accept */
+	BPF_STMT (BPF_RET + BPF_K,             0),                                      /* drop */
+};
+
+/*****************************************************************************/
+
+static inline guint16
+_get_u16 (const guint8 *p)
+{
+	return (((guint16) p[0]) << 8) | p[1];
+}
+
+static inline guint32
+_get_u32 (const guint8 *p)
+{
+	return (((guint32) p[0]) << 24) | (((guint32) p[1]) << 16) | (((guint32) p[2]) << 8) | p[3];
+}
+
+static inline void
+_put_u16 (guint8 *p, guint16 v)
+{
+	p[0] = v >> 8;
+	p[1] = v;
+}
+
+static inline void
+_put_u32 (guint8 *p, guint32 v)
+{
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+static guint32
+_checksum_add (guint32 sum, const guint8 *data, gsize len)
+{
+	gsize i;
+
+	for (i = 0; i + 1 < len; i += 2)
+		sum += _get_u16 (&data[i]);
+	if (len & 1)
+		sum += ((guint32) data[len - 1]) << 8;
+	return sum;
+}
+
+static guint16
+_checksum_finish (guint32 sum)
+{
+	while (sum >> 16)
+		sum = (sum & 0xFFFF) + (sum >> 16);
+	return ~sum;
+}
+
+/*****************************************************************************/
+
+static const guint8 *
+_option_find_in (const guint8 *data, gsize len, guint8 code, gsize *out_len)
+{
+	gsize i = 0;
+
+	while (i < len) {
+		guint8 c = data[i++];
+		gsize l;
+
+		if (c == OPT_PAD)
+			continue;
+		if (c == OPT_END || i >= len)
+			break;
+		l = data[i++];
+		if (i + l > len)
+			break;
+		if (c == code) {
+			*out_len = l;
+			return &data[i];
+		}
+		i += l;
+	}
+	return NULL;
+}
+
+static const guint8 *
+_option_find (const guint8 *msg, gsize msg_len, guint8 code, gsize *out_len)
+{
+	const guint8 *p;
+	gsize len;
+	guint8 overload = 0;
+
+	p = _option_find_in (&msg[MSG_HEADER_LEN], msg_len - MSG_HEADER_LEN, code, out_len);
+	if (p)
+		return p;
+
+	/* RFC 2132, section 9.3 */
+	p = _option_find_in (&msg[MSG_HEADER_LEN], msg_len - MSG_HEADER_LEN, OPT_OVERLOAD, &len);
+	if (p && len == 1)
+		overload = p[0];
+	if (overload & OVERLOAD_FILE) {
+		p = _option_find_in (&msg[MSG_OFF_FILE], MSG_OFF_MAGIC - MSG_OFF_FILE, code, out_len);
+		if (p)
+			return p;
+	}
+	if (overload & OVERLOAD_SNAME) {
+		p = _option_find_in (&msg[MSG_OFF_SNAME], MSG_OFF_FILE - MSG_OFF_SNAME, code, out_len);
+		if (p)
+			return p;
+	}
+	return NULL;
+}
+
+static gboolean
+_option_get_u32 (const guint8 *msg, gsize msg_len, guint8 code, guint32 *out_value)
+{
+	const guint8 *p;
+	gsize len;
+
+	p = _option_find (msg, msg_len, code, &len);
+	if (!p || len != 4)
+		return FALSE;
+	*out_value = _get_u32 (p);
+	return TRUE;
+}
+
+static gboolean
+_option_get_addr (const guint8 *msg, gsize msg_len, guint8 code, in_addr_t *out_addr)
+{
+	const guint8 *p;
+	gsize len;
+
+	p = _option_find (msg, msg_len, code, &len);
+	if (!p || len != 4)
+		return FALSE;
+	memcpy (out_addr, p, 4);
+	return TRUE;
+}
+
+static void
+_option_append (guint8 *msg, gsize *len, guint8 code, const void *data, gsize data_len)
+{
+	nm_assert (data_len <= 255);
+
+	msg[(*len)++] = code;
+	msg[(*len)++] = data_len;
+	memcpy (&msg[*len], data, data_len);
+	*len += data_len;
+}
+
+/* RFC 4702, with the name in the canonical wire format. */
+static void
+_option_append_fqdn (guint8 *msg, gsize *len, const char *fqdn)
+{
+	guint8 buf[3 + 255];
+	gsize n = 3;
+	const char *label = fqdn;
+
+	buf[0] = FQDN_FLAG_S | FQDN_FLAG_E;
+	buf[1] = 0;
+	buf[2] = 0;
+
+	while (*label) {
+		const char *dot = strchr (label, '.');
+		gsize l = dot ? (gsize) (dot - label) : strlen (label);
+
+		if (l == 0 || l > 63 || n + 1 + l + 1 > sizeof (buf))
+			return;
+		buf[n++] = l;
+		memcpy (&buf[n], label, l);
+		n += l;
+		if (!dot)
+			break;
+		label = dot + 1;
+	}
+	buf[n++] = 0;
+
+	_option_append (msg, len, OPT_FQDN, buf, n);
+}
+
+/*****************************************************************************/
+
+static gint64
+_now_ms (void)
+{
+	return nm_utils_get_monotonic_timestamp_ms ();
+}
+
+static void
+_client_schedule (NMDhcpEngineClient *self, gint64 expiry_ms)
+{
+	nm_timer_wheel_schedule (self->engine->wheel, &self->timer, expiry_ms);
+}
+
+static void
+_client_set_xid (NMDhcpEngineClient *self, guint32 xid)
+{
+	NMDhcpEngine *engine = self->engine;
+
+	if (self->key)
+		g_hash_table_remove (engine->clients, &self->key);
+
+	/* another client on the same interface may already use the ID. */
+	for (;;) {
+		self->xid = xid;
+		self->key = (((gint64) self->ifindex) << 32) | xid;
+		if (!g_hash_table_contains (engine->clients, &self->key))
+			break;
+		xid = g_rand_int (engine->rand);
+	}
+	g_hash_table_insert (engine->clients, &self->key, self);
+}
+
+static void
+_client_unlink (NMDhcpEngineClient *self)
+{
+	if (self->key) {
+		g_hash_table_remove (self->engine->clients, &self->key);
+		self->key = 0;
+	}
+}
+
+/*****************************************************************************/
+
+static gboolean
+_state_needs_packet_socket (State state)
+{
+	/* without an address, or when the lease could not be renewed
+	 * from the server that granted it. */
+	return NM_IN_SET (state, STATE_SELECTING, STATE_REQUESTING, STATE_REBINDING);
+}
+
+static void
+_client_set_state (NMDhcpEngineClient *self, State state)
+{
+	NMDhcpEngine *engine = self->engine;
+	gs_free_error GError *error = NULL;
+	gboolean needed, need;
+
+	needed = _state_needs_packet_socket (self->state);
+	need = _state_needs_packet_socket (state);
+	self->state = state;
+
+	if (needed == need)
+		return;
+
+	if (need) {
+		if (   engine->n_packet_clients++ == 0
+		    && !_socket_open_packet (engine, &error))
+			_LOGW ("%s", error->message);
+	} else {
+		nm_assert (engine->n_packet_clients > 0);
+		if (--engine->n_packet_clients == 0)
+			_socket_close (engine, &engine->packet);
+	}
+}
+
+/*****************************************************************************/
+
+/* messages to the broadcast address go out over the packet socket, as
+ * the interface may not have an address. */
+static int
+_send_packet (NMDhcpEngineClient *self,
+              guint8 *pkt,
+              gsize msg_len,
+              in_addr_t src)
+{
+	NMDhcpEngine *engine = self->engine;
+	gs_free_error GError *error = NULL;
+	guint8 *ip = pkt;
+	guint8 *udp = &pkt[IP_HEADER_LEN];
+	in_addr_t dst = htonl (INADDR_BROADCAST);
+	struct sockaddr_ll sll = { 0 };
+	gsize udp_len, ip_len;
+	guint32 sum;
+
+	/* opening it on the state change failed, try again. */
+	if (   engine->packet.fd < 0
+	    && !_socket_open_packet (engine, &error)) {
+		_LOGD ("%s", error->message);
+		return EBADF;
+	}
+
+	udp_len = UDP_HEADER_LEN + msg_len;
+	ip_len = IP_HEADER_LEN + udp_len;
+
+	_put_u16 (&udp[0], DHCP_PORT_CLIENT);
+	_put_u16 (&udp[2], DHCP_PORT_SERVER);
+	_put_u16 (&udp[4], udp_len);
+	_put_u16 (&udp[6], 0);
+
+	memset (ip, 0, IP_HEADER_LEN);
+	ip[0] = 0x45;
+	ip[1] = IPTOS_CLASS_CS6;
+	_put_u16 (&ip[2], ip_len);
+	ip[8] = IPDEFTTL;
+	ip[9] = IPPROTO_UDP;
+	memcpy (&ip[12], &src, 4);
+	memcpy (&ip[16], &dst, 4);
+
+	/* the UDP checksum covers a pseudo header of the addresses,
+	 * the protocol and the UDP length. */
+	sum = _checksum_add (0, &ip[12], 8);
+	sum += IPPROTO_UDP + udp_len;
+	sum = _checksum_add (sum, udp, udp_len);
+	_put_u16 (&udp[6], _checksum_finish (sum) ?: 0xFFFF);
+	_put_u16 (&ip[10], _checksum_finish (_checksum_add (0, ip, IP_HEADER_LEN)));
+
+	sll.sll_family = AF_PACKET;
+	sll.sll_protocol = htons (ETH_P_IP);
+	sll.sll_ifindex = self->ifindex;
+	sll.sll_halen = ETH_ALEN;
+	memcpy (sll.sll_addr, hwaddr_broadcast, ETH_ALEN);
+
+	if (sendto (engine->packet.fd, pkt, ip_len, 0, (struct sockaddr *) &sll, sizeof (sll)) < 0)
+		return errno;
+	return 0;
+}
+
+/* renewals and releases go to the server directly. The kernel resolves
+ * its link-layer address and picks the interface by IP_PKTINFO. */
+static int
+_send_udp (NMDhcpEngineClient *self,
+           const guint8 *msg,
+           gsize msg_len,
+           in_addr_t src,
+           in_addr_t dst)
+{
+	struct sockaddr_in sin = {
+		.sin_family = AF_INET,
+		.sin_port = htons (DHCP_PORT_SERVER),
+		.sin_addr.s_addr = dst,
+	};
+	union {
+		struct cmsghdr cmsg;
+		guint8 buf[CMSG_SPACE (sizeof (struct in_pktinfo))];
+	} control = { };
+	struct iovec iov = {
+		.iov_base = (guint8 *) msg,
+		.iov_len = msg_len,
+	};
+	struct msghdr mh = {
+		.msg_name = &sin,
+		.msg_namelen = sizeof (sin),
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = &control,
+		.msg_controllen = sizeof (control),
+	};
+	struct cmsghdr *cmsg;
+	struct in_pktinfo pktinfo = {
+		.ipi_ifindex = self->ifindex,
+		.ipi_spec_dst.s_addr = src,
+	};
+
+	cmsg = CMSG_FIRSTHDR (&mh);
+	cmsg->cmsg_level = IPPROTO_IP;
+	cmsg->cmsg_type = IP_PKTINFO;
+	cmsg->cmsg_len = CMSG_LEN (sizeof (pktinfo));
+	memcpy (CMSG_DATA (cmsg), &pktinfo, sizeof (pktinfo));
+
+	if (sendmsg (self->engine->udp.fd, &mh, 0) < 0)
+		return errno;
+	return 0;
+}
+
+static int
+_client_send (NMDhcpEngineClient *self, guint8 type)
+{
+	guint8 pkt[1500];
+	guint8 *msg = &pkt[IP_HEADER_LEN + UDP_HEADER_LEN];
+	gsize len = MSG_HEADER_LEN;
+	in_addr_t ciaddr = 0, src = htonl (INADDR_ANY), dst = htonl (INADDR_BROADCAST);
+	gint64 secs;
+	int errsv;
+
+	if (NM_IN_SET (self->state, STATE_BOUND, STATE_RENEWING, STATE_REBINDING)) {
+		ciaddr = self->address;
+		src = self->address;
+	}
+
+	if (   type == DHCPRELEASE
+	    || (type == DHCPREQUEST && self->state == STATE_RENEWING))
+		dst = self->server_id;
+
+	memset (msg, 0, MSG_HEADER_LEN);
+	msg[0] = BOOTREQUEST;
+	msg[1] = ARPHRD_ETHER;
+	msg[2] = ETH_ALEN;
+	_put_u32 (&msg[MSG_OFF_XID], self->xid);
+	secs = (_now_ms () - self->start_ms) / 1000;
+	_put_u16 (&msg[MSG_OFF_SECS], CLAMP (secs, 0, G_MAXUINT16));
+	if (!ciaddr)
+		_put_u16 (&msg[MSG_OFF_FLAGS], MSG_FLAG_BROADCAST);
+	memcpy (&msg[MSG_OFF_CIADDR], &ciaddr, 4);
+	memcpy (&msg[MSG_OFF_CHADDR], self->hwaddr, ETH_ALEN);
+	_put_u32 (&msg[MSG_OFF_MAGIC], DHCP_MAGIC_COOKIE);
+
+	_option_append (msg, &len, OPT_MESSAGE_TYPE, &type, 1);
+	if (self->client_id)
+		_option_append (msg, &len, OPT_CLIENT_ID, self->client_id, self->client_id_len);
+
+	if (type == DHCPDISCOVER && self->request_address)
+		_option_append (msg, &len, OPT_REQUESTED_ADDRESS, &self->request_address, 4);
+	if (type == DHCPREQUEST && self->state == STATE_REQUESTING) {
+		_option_append (msg, &len, OPT_REQUESTED_ADDRESS, &self->address, 4);
+		_option_append (msg, &len, OPT_SERVER_ID, &self->server_id, 4);
+	}
+	if (type == DHCPRELEASE)
+		_option_append (msg, &len, OPT_SERVER_ID, &self->server_id, 4);
+
+	if (type != DHCPRELEASE) {
+		if (self->hostname) {
+			if (self->use_fqdn)
+				_option_append_fqdn (msg, &len, self->hostname);
+			else
+				_option_append (msg, &len, OPT_HOST_NAME, self->hostname, strlen (self->hostname));
+		}
+		if (self->n_request_options) {
+			_option_append (msg, &len, OPT_PARAMETER_REQUEST_LIST,
+			                self->request_options, self->n_request_options);
+		}
+	}
+	msg[len++] = OPT_END;
+
+	nm_assert (IP_HEADER_LEN + UDP_HEADER_LEN + len <= sizeof (pkt));
+
+	if (dst == htonl (INADDR_BROADCAST))
+		errsv = _send_packet (self, pkt, len, src);
+	else
+		errsv = _send_udp (self, msg, len, src, dst);
+
+	if (errsv) {
+		_LOGD ("failed to send message type %u (xid 0x%08x): %s",
+		       type, self->xid, g_strerror (errsv));
+		return errsv;
+	}
+
+	_LOGT ("sent message type %u (xid 0x%08x)", type, self->xid);
+	return 0;
+}
+
+/*****************************************************************************/
+
+static gint64
+_client_backoff (NMDhcpEngineClient *self)
+{
+	gint64 delay;
+
+	nm_assert (self->n_attempts > 0);
+
+	delay = MIN (((gint64) RETRANSMIT_MIN_MSEC) << MIN (self->n_attempts - 1, 5),
+	             RETRANSMIT_MAX_MSEC);
+	return delay + g_rand_int_range (self->engine->rand,
+	                                 -RETRANSMIT_JITTER_MSEC,
+	                                 RETRANSMIT_JITTER_MSEC);
+}
+
+/* sends the message of the current state and arms the timer
+ * for the retransmission. */
+static void
+_client_transmit (NMDhcpEngineClient *self, gint64 now)
+{
+	gint64 next, end;
+	int errsv;
+
+	switch (self->state) {
+	case STATE_SELECTING:
+	case STATE_REQUESTING:
+		errsv = _client_send (self,
+		                      self->state == STATE_SELECTING
+		                        ? DHCPDISCOVER
+		                        : DHCPREQUEST);
+		if (NM_IN_SET (errsv, EAGAIN, EWOULDBLOCK, ENOBUFS)) {
+			/* not sent at all, that doesn't count as attempt. */
+			next = now + SEND_RETRY_MSEC;
+			break;
+		}
+		self->n_attempts++;
+		next = now + _client_backoff (self);
+		break;
+	case STATE_RENEWING:
+	case STATE_REBINDING:
+		/* RFC 2131, section 4.4.5 */
+		end = self->state == STATE_RENEWING ? self->t2_ms : self->expiry_ms;
+		_client_send (self, DHCPREQUEST);
+		self->n_attempts++;
+		next = now + MAX ((end - now) / 2, RENEW_RETRANSMIT_MIN_MSEC);
+		next = MIN (next, end);
+		break;
+	default:
+		g_return_if_reached ();
+	}
+
+	_client_schedule (self, next);
+}
+
+static void
+_client_start_discovery (NMDhcpEngineClient *self, gint64 now, gint64 delay)
+{
+	_client_set_state (self, STATE_SELECTING);
+	self->n_attempts = 0;
+	self->start_ms = now + delay;
+	self->address = 0;
+	self->server_id = 0;
+	self->t1_ms = 0;
+	self->t2_ms = 0;
+	self->expiry_ms = 0;
+	_client_set_xid (self, g_rand_int (self->engine->rand));
+
+	if (delay)
+		_client_schedule (self, now + delay);
+	else
+		_client_transmit (self, now);
+}
+
+static void
+_client_timer_cb (NMTimerWheelEntry *timer, gpointer user_data)
+{
+	NMDhcpEngineClient *self = user_data;
+	gint64 now = _now_ms ();
+
+	switch (self->state) {
+	case STATE_SELECTING:
+		_client_transmit (self, now);
+		break;
+	case STATE_REQUESTING:
+		if (self->n_attempts >= REQUEST_MAX_ATTEMPTS) {
+			_LOGD ("no reply to the request, restart");
+			_client_start_discovery (self, now, 0);
+			break;
+		}
+		_client_transmit (self, now);
+		break;
+	case STATE_BOUND:
+		_LOGD ("renewing the lease");
+		_client_set_state (self, STATE_RENEWING);
+		self->n_attempts = 0;
+		self->start_ms = now;
+		_client_set_xid (self, g_rand_int (self->engine->rand));
+		_client_transmit (self, now);
+		break;
+	case STATE_RENEWING:
+		if (now >= self->t2_ms) {
+			_LOGD ("rebinding the lease");
+			_client_set_state (self, STATE_REBINDING);
+			self->n_attempts = 0;
+		}
+		_client_transmit (self, now);
+		break;
+	case STATE_REBINDING:
+		if (now >= self->expiry_ms) {
+			_LOGD ("lease expired");
+			_client_start_discovery (self, now, 0);
+			self->func (self, NM_DHCP_ENGINE_EVENT_EXPIRED, NULL, 0, self->user_data);
+			return;
+		}
+		_client_transmit (self, now);
+		break;
+	default:
+		g_return_if_reached ();
+	}
+}
+
+/*****************************************************************************/
+
+static void
+_client_handle_ack (NMDhcpEngineClient *self,
+                    const guint8 *msg,
+                    gsize msg_len)
+{
+	in_addr_t address, server_id = 0;
+	guint32 lease, t1, t2;
+	gint64 now;
+	char buf[NM_UTILS_INET_ADDRSTRLEN];
+
+	memcpy (&address, &msg[MSG_OFF_YIADDR], 4);
+	if (   !address
+	    || !_option_get_u32 (msg, msg_len, OPT_LEASE_TIME, &lease)
+	    || !lease) {
+		_LOGD ("ACK lacks address or lease time, ignore");
+		return;
+	}
+
+	_option_get_addr (msg, msg_len, OPT_SERVER_ID, &server_id);
+	if (   self->state == STATE_REQUESTING
+	    && server_id
+	    && server_id != self->server_id)
+		return;
+
+	if (server_id)
+		self->server_id = server_id;
+
+	now = _now_ms ();
+	_client_set_state (self, STATE_BOUND);
+	self->n_attempts = 0;
+	self->address = address;
+
+	if (lease == LEASE_INFINITE) {
+		self->t1_ms = 0;
+		self->t2_ms = 0;
+		self->expiry_ms = 0;
+		nm_timer_wheel_cancel (self->engine->wheel, &self->timer);
+	} else {
+		/* RFC 2131, section 4.4.5 */
+		if (   !_option_get_u32 (msg, msg_len, OPT_RENEWAL_TIME, &t1)
+		    || !_option_get_u32 (msg, msg_len, OPT_REBINDING_TIME, &t2)
+		    || t1 >= t2
+		    || t2 >= lease) {
+			t1 = lease / 2;
+			t2 = ((guint64) lease) * 7 / 8;
+		}
+		self->t1_ms = now + ((gint64) t1) * 1000;
+		self->t2_ms = now + ((gint64) t2) * 1000;
+		self->expiry_ms = now + ((gint64) lease) * 1000;
+		_client_schedule (self, self->t1_ms);
+	}
+
+	_LOGD ("bound to %s for %u seconds (xid 0x%08x)",
+	       nm_utils_inet4_ntop (address, buf), lease, self->xid);
+
+	self->func (self, NM_DHCP_ENGINE_EVENT_BOUND, msg, msg_len, self->user_data);
+}
+
+static void
+_client_receive (NMDhcpEngineClient *self,
+                 const guint8 *msg,
+                 gsize msg_len)
+{
+	const guint8 *p;
+	gsize len;
+	in_addr_t server_id = 0;
+	gboolean was_bound;
+
+	p = _option_find (msg, msg_len, OPT_MESSAGE_TYPE, &len);
+	if (!p || len != 1)
+		return;
+
+	switch (p[0]) {
+	case DHCPOFFER:
+		if (self->state != STATE_SELECTING)
+			return;
+		memcpy (&self->address, &msg[MSG_OFF_YIADDR], 4);
+		if (   !self->address
+		    || !_option_get_addr (msg, msg_len, OPT_SERVER_ID, &self->server_id)
+		    || !self->server_id) {
+			self->address = 0;
+			self->server_id = 0;
+			return;
+		}
+		_LOGT ("offer received (xid 0x%08x)", self->xid);
+		_client_set_state (self, STATE_REQUESTING);
+		self->n_attempts = 0;
+		_client_transmit (self, _now_ms ());
+		return;
+	case DHCPACK:
+		if (!NM_IN_SET (self->state, STATE_REQUESTING, STATE_RENEWING, STATE_REBINDING))
+			return;
+		_client_handle_ack (self, msg, msg_len);
+		return;
+	case DHCPNAK:
+		if (!NM_IN_SET (self->state, STATE_REQUESTING, STATE_RENEWING, STATE_REBINDING))
+			return;
+		_option_get_addr (msg, msg_len, OPT_SERVER_ID, &server_id);
+		if (   self->state != STATE_REBINDING
+		    && server_id
+		    && server_id != self->server_id)
+			return;
+
+		_LOGD ("NAK received (xid 0x%08x), restart", self->xid);
+		was_bound = self->state != STATE_REQUESTING;
+		_client_start_discovery (self, _now_ms (), NAK_RESTART_MSEC);
+		if (was_bound)
+			self->func (self, NM_DHCP_ENGINE_EVENT_EXPIRED, NULL, 0, self->user_data);
+		return;
+	default:
+		return;
+	}
+}
+
+static void
+_engine_dispatch (NMDhcpEngine *engine,
+                  EngineSocket *sock,
+                  int ifindex,
+                  const guint8 *msg,
+                  gsize msg_len)
+{
+	NMDhcpEngineClient *client;
+	gint64 key;
+
+	/* for the packet socket, the filter checked that already. */
+	if (   msg_len < MSG_HEADER_LEN
+	    || msg[0] != BOOTREPLY
+	    || msg[1] != ARPHRD_ETHER
+	    || msg[2] != ETH_ALEN
+	    || _get_u32 (&msg[MSG_OFF_MAGIC]) != DHCP_MAGIC_COOKIE)
+		return;
+
+	key = (((gint64) ifindex) << 32) | _get_u32 (&msg[MSG_OFF_XID]);
+	client = g_hash_table_lookup (engine->clients, &key);
+	if (   !client
+	    || memcmp (&msg[MSG_OFF_CHADDR], client->hwaddr, ETH_ALEN) != 0)
+		return;
+
+	/* the UDP socket receives broadcast replies too, but the packet
+	 * socket serves all states but renewing. */
+	if (   sock == &engine->udp
+	    && client->state != STATE_RENEWING)
+		return;
+
+	_client_receive (client, msg, msg_len);
+}
+
+static void
+_engine_receive_packet (NMDhcpEngine *engine,
+                        const guint8 *pkt,
+                        gsize n,
+                        const struct sockaddr_ll *sll,
+                        gboolean checksum_ready)
+{
+	const guint8 *udp;
+	gsize ip_len, ihl, udp_len;
+	guint32 sum;
+
+	if (sll->sll_pkttype == PACKET_OUTGOING)
+		return;
+
+	/* the filter checked the protocols and the fixed fields of
+	 * the message, but not the lengths. */
+	if (n < IP_HEADER_LEN || (pkt[0] >> 4) != 4)
+		return;
+	ihl = (pkt[0] & 0x0F) * 4;
+	ip_len = _get_u16 (&pkt[2]);
+	if (   ihl < IP_HEADER_LEN
+	    || ip_len > n
+	    || ip_len < ihl + UDP_HEADER_LEN + MSG_HEADER_LEN)
+		return;
+	if (_checksum_finish (_checksum_add (0, pkt, ihl)) != 0)
+		return;
+
+	udp = &pkt[ihl];
+	udp_len = _get_u16 (&udp[4]);
+	if (   udp_len < UDP_HEADER_LEN + MSG_HEADER_LEN
+	    || ihl + udp_len > ip_len)
+		return;
+
+	/* a zero checksum means there is none. The checksum of packets that
+	 * were sent on this host may not have been filled in yet. */
+	if (   checksum_ready
+	    && _get_u16 (&udp[6]) != 0) {
+		sum = _checksum_add (0, &pkt[12], 8);
+		sum += IPPROTO_UDP + udp_len;
+		sum = _checksum_add (sum, udp, udp_len);
+		if (_checksum_finish (sum) != 0)
+			return;
+	}
+
+	_engine_dispatch (engine, &engine->packet, sll->sll_ifindex,
+	                  &udp[UDP_HEADER_LEN], udp_len - UDP_HEADER_LEN);
+}
+
+/*****************************************************************************/
+
+static void
+_socket_close (NMDhcpEngine *engine, EngineSocket *sock)
+{
+	if (sock->in_receive) {
+		/* closed once the receive loop is done. */
+		sock->close_pending = TRUE;
+		return;
+	}
+
+	sock->close_pending = FALSE;
+	if (sock->fd < 0)
+		return;
+
+	_LOG2D ("closing %s socket", sock == &engine->packet ? "packet" : "UDP");
+	nm_clear_g_source (&sock->watch_id);
+	g_clear_pointer (&sock->channel, g_io_channel_unref);
+	close (sock->fd);
+	sock->fd = -1;
+}
+
+static gssize
+_receive_packet (NMDhcpEngine *engine)
+{
+	struct sockaddr_ll sll;
+	union {
+		struct cmsghdr cmsg;
+		guint8 buf[CMSG_SPACE (sizeof (struct tpacket_auxdata))];
+	} control;
+	struct iovec iov = {
+		.iov_base = engine->buf,
+		.iov_len = PACKET_MAX,
+	};
+	struct msghdr mh = {
+		.msg_name = &sll,
+		.msg_namelen = sizeof (sll),
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = &control,
+		.msg_controllen = sizeof (control),
+	};
+	struct cmsghdr *cmsg;
+	gboolean checksum_ready = TRUE;
+	gssize n;
+
+	n = recvmsg (engine->packet.fd, &mh, MSG_DONTWAIT);
+	if (n < 0)
+		return n;
+
+	for (cmsg = CMSG_FIRSTHDR (&mh); cmsg; cmsg = CMSG_NXTHDR (&mh, cmsg)) {
+		struct tpacket_auxdata aux;
+
+		if (   cmsg->cmsg_level == SOL_PACKET
+		    && cmsg->cmsg_type == PACKET_AUXDATA
+		    && cmsg->cmsg_len == CMSG_LEN (sizeof (aux))) {
+			memcpy (&aux, CMSG_DATA (cmsg), sizeof (aux));
+			checksum_ready = !(aux.tp_status & TP_STATUS_CSUMNOTREADY);
+		}
+	}
+
+	_engine_receive_packet (engine, engine->buf, n, &sll, checksum_ready);
+	return n;
+}
+
+static gssize
+_receive_udp (NMDhcpEngine *engine)
+{
+	struct sockaddr_in sin;
+	union {
+		struct cmsghdr cmsg;
+		guint8 buf[CMSG_SPACE (sizeof (struct in_pktinfo))];
+	} control;
+	struct iovec iov = {
+		.iov_base = engine->buf,
+		.iov_len = PACKET_MAX,
+	};
+	struct msghdr mh = {
+		.msg_name = &sin,
+		.msg_namelen = sizeof (sin),
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = &control,
+		.msg_controllen = sizeof (control),
+	};
+	struct cmsghdr *cmsg;
+	int ifindex = 0;
+	gssize n;
+
+	n = recvmsg (engine->udp.fd, &mh, MSG_DONTWAIT);
+	if (n < 0)
+		return n;
+
+	for (cmsg = CMSG_FIRSTHDR (&mh); cmsg; cmsg = CMSG_NXTHDR (&mh, cmsg)) {
+		struct in_pktinfo pktinfo;
+
+		if (   cmsg->cmsg_level == IPPROTO_IP
+		    && cmsg->cmsg_type == IP_PKTINFO
+		    && cmsg->cmsg_len == CMSG_LEN (sizeof (pktinfo))) {
+			memcpy (&pktinfo, CMSG_DATA (cmsg), sizeof (pktinfo));
+			ifindex = pktinfo.ipi_ifindex;
+		}
+	}
+
+	if (   ifindex > 0
+	    && mh.msg_namelen == sizeof (sin)
+	    && sin.sin_port == htons (DHCP_PORT_SERVER))
+		_engine_dispatch (engine, &engine->udp, ifindex, engine->buf, n);
+	return n;
+}
+
+static gboolean
+_receive_cb (GIOChannel *source, GIOCondition condition, gpointer user_data)
+{
+	NMDhcpEngine *engine = user_data;
+	EngineSocket *sock;
+	gssize n;
+	guint i;
+
+	sock = source == engine->packet.channel ? &engine->packet : &engine->udp;
+	nm_assert (source == sock->channel);
+
+	sock->in_receive = TRUE;
+	for (i = 0; i < MAX_READ_PER_DISPATCH && !sock->close_pending; i++) {
+		n =   sock == &engine->packet
+		    ? _receive_packet (engine)
+		    : _receive_udp (engine);
+		if (n < 0) {
+			int errsv = errno;
+
+			if (!NM_IN_SET (errsv, EAGAIN, EWOULDBLOCK, EINTR))
+				_LOG2D ("failed to receive: %s", g_strerror (errsv));
+			break;
+		}
+	}
+	sock->in_receive = FALSE;
+
+	if (sock->close_pending) {
+		sock->watch_id = 0;
+		_socket_close (engine, sock);
+		return G_SOURCE_REMOVE;
+	}
+	return G_SOURCE_CONTINUE;
+}
+
+static void
+_socket_set_buf_size (int fd, int opt_force, int opt)
+{
+	int size = SOCKET_BUF_SIZE;
+
+	/* the forced variant ignores the system wide maximum, but requires
+	 * CAP_NET_ADMIN. */
+	if (setsockopt (fd, SOL_SOCKET, opt_force, &size, sizeof (size)) < 0)
+		(void) setsockopt (fd, SOL_SOCKET, opt, &size, sizeof (size));
+}
+
+static void
+_socket_watch (NMDhcpEngine *engine, EngineSocket *sock, int fd)
+{
+	if (!engine->buf)
+		engine->buf = g_malloc (PACKET_MAX);
+
+	sock->fd = fd;
+	sock->channel = g_io_channel_unix_new (fd);
+	sock->watch_id = g_io_add_watch (sock->channel, G_IO_IN, _receive_cb, engine);
+
+	_LOG2D ("opened %s socket", sock == &engine->packet ? "packet" : "UDP");
+}
+
+static gboolean
+_socket_open_packet (NMDhcpEngine *engine, GError **error)
+{
+	const struct sock_fprog fprog = {
+		.len = G_N_ELEMENTS (filter),
+		.filter = (struct sock_filter *) filter,
+	};
+	struct sockaddr_ll sll = {
+		.sll_family = AF_PACKET,
+		.sll_protocol = htons (ETH_P_IP),
+		/* all interfaces */
+		.sll_ifindex = 0,
+	};
+	int fd, errsv;
+	int on = 1;
+
+	if (engine->packet.fd >= 0) {
+		engine->packet.close_pending = FALSE;
+		return TRUE;
+	}
+
+	/* without a protocol, the socket receives nothing until it is bound.
+	 * So there is no window in which unfiltered packets get queued. */
+	fd = socket (AF_PACKET, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+	if (fd < 0) {
+		errsv = errno;
+		g_set_error (error, NM_UTILS_ERROR, NM_UTILS_ERROR_UNKNOWN,
+		             "failed to create packet socket: %s", g_strerror (errsv));
+		return FALSE;
+	}
+
+	if (setsockopt (fd, SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof (fprog)) < 0) {
+		errsv = errno;
+		close (fd);
+		g_set_error (error, NM_UTILS_ERROR, NM_UTILS_ERROR_UNKNOWN,
+		             "failed to attach filter: %s", g_strerror (errsv));
+		return FALSE;
+	}
+
+	/* tells whether the UDP checksum is filled in. */
+	if (setsockopt (fd, SOL_PACKET, PACKET_AUXDATA, &on, sizeof (on)) < 0) {
+		errsv = errno;
+		close (fd);
+		g_set_error (error, NM_UTILS_ERROR, NM_UTILS_ERROR_UNKNOWN,
+		             "failed to enable auxiliary data: %s", g_strerror (errsv));
+		return FALSE;
+	}
+
+	/* many clients start at the same time. */
+	_socket_set_buf_size (fd, SO_RCVBUFFORCE, SO_RCVBUF);
+	_socket_set_buf_size (fd, SO_SNDBUFFORCE, SO_SNDBUF);
+
+	if (bind (fd, (struct sockaddr *) &sll, sizeof (sll)) < 0) {
+		errsv = errno;
+		close (fd);
+		g_set_error (error, NM_UTILS_ERROR, NM_UTILS_ERROR_UNKNOWN,
+		             "failed to bind packet socket: %s", g_strerror (errsv));
+		return FALSE;
+	}
+
+	_socket_watch (engine, &engine->packet, fd);
+	return TRUE;
+}
+
+static gboolean
+_socket_open_udp (NMDhcpEngine *engine, GError **error)
+{
+	struct sockaddr_in sin = {
+		.sin_family = AF_INET,
+		.sin_port = htons (DHCP_PORT_CLIENT),
+		.sin_addr.s_addr = htonl (INADDR_ANY),
+	};
+	int fd, errsv;
+	int on = 1;
+	int tos = IPTOS_CLASS_CS6;
+
+	if (engine->udp.fd >= 0) {
+		engine->udp.close_pending = FALSE;
+		return TRUE;
+	}
+
+	fd = socket (AF_INET, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, IPPROTO_UDP);
+	if (fd < 0) {
+		errsv = errno;
+		g_set_error (error, NM_UTILS_ERROR, NM_UTILS_ERROR_UNKNOWN,
+		             "failed to create UDP socket: %s", g_strerror (errsv));
+		return FALSE;
+	}
+
+	/* other DHCP clients may have the port bound to single interfaces. */
+	if (   setsockopt (fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof (on)) < 0
+	    || setsockopt (fd, IPPROTO_IP, IP_PKTINFO, &on, sizeof (on)) < 0
+	    || setsockopt (fd, IPPROTO_IP, IP_TOS, &tos, sizeof (tos)) < 0) {
+		errsv = errno;
+		close (fd);
+		g_set_error (error, NM_UTILS_ERROR, NM_UTILS_ERROR_UNKNOWN,
+		             "failed to set UDP socket options: %s", g_strerror (errsv));
+		return FALSE;
+	}
+
+	_socket_set_buf_size (fd, SO_RCVBUFFORCE, SO_RCVBUF);
+	_socket_set_buf_size (fd, SO_SNDBUFFORCE, SO_SNDBUF);
+
+	if (bind (fd, (struct sockaddr *) &sin, sizeof (sin)) < 0) {
+		errsv = errno;
+		close (fd);
+		g_set_error (error, NM_UTILS_ERROR, NM_UTILS_ERROR_UNKNOWN,
+		             "failed to bind UDP socket: %s", g_strerror (errsv));
+		return FALSE;
+	}
+
+	_socket_watch (engine, &engine->udp, fd);
+	return TRUE;
+}
+
+/*****************************************************************************/
+
+/**
+ * nm_dhcp_engine_client_new:
+ * @engine: the #NMDhcpEngine
+ * @ifindex: the interface to run on
+ * @hwaddr: the Ethernet address of the client
+ * @func: called when the client acquired a lease or lost it
+ * @user_data: the data for @func
+ *
+ * Returns: a new client, which does nothing until
+ *   nm_dhcp_engine_client_start() is called.
+ */
+NMDhcpEngineClient *
+nm_dhcp_engine_client_new (NMDhcpEngine *engine,
+                           int ifindex,
+                           const guint8 *hwaddr,
+                           NMDhcpEngineClientFunc func,
+                           gpointer user_data)
+{
+	NMDhcpEngineClient *self;
+
+	g_return_val_if_fail (engine, NULL);
+	g_return_val_if_fail (ifindex > 0, NULL);
+	g_return_val_if_fail (hwaddr, NULL);
+	g_return_val_if_fail (func, NULL);
+
+	self = g_slice_new0 (NMDhcpEngineClient);
+	self->engine = engine;
+	self->ifindex = ifindex;
+	memcpy (self->hwaddr, hwaddr, ETH_ALEN);
+	self->func = func;
+	self->user_data = user_data;
+	nm_timer_wheel_entry_init (&self->timer, _client_timer_cb, self);
+	return self;
+}
+
+void
+nm_dhcp_engine_client_free (NMDhcpEngineClient *self)
+{
+	if (!self)
+		return;
+
+	nm_dhcp_engine_client_stop (self, FALSE);
+	g_free (self->client_id);
+	g_free (self->hostname);
+	g_free (self->request_options);
+	g_slice_free (NMDhcpEngineClient, self);
+}
+
+/**
+ * nm_dhcp_engine_client_set_client_id:
+ * @self: the client
+ * @client_id: the client identifier, starting with its type
+ * @len: the length of @client_id
+ */
+void
+nm_dhcp_engine_client_set_client_id (NMDhcpEngineClient *self,
+                                     const guint8 *client_id,
+                                     gsize len)
+{
+	g_return_if_fail (self);
+	g_return_if_fail (!client_id || (len >= 2 && len <= 255));
+
+	g_free (self->client_id);
+	self->client_id = client_id ? g_memdup (client_id, len) : NULL;
+	self->client_id_len = client_id ? len : 0;
+}
+
+void
+nm_dhcp_engine_client_set_hostname (NMDhcpEngineClient *self,
+                                    const char *hostname,
+                                    gboolean use_fqdn)
+{
+	g_return_if_fail (self);
+	g_return_if_fail (!hostname || (hostname[0] && strlen (hostname) <= 253));
+
+	g_free (self->hostname);
+	self->hostname = g_strdup (hostname);
+	self->use_fqdn = use_fqdn;
+}
+
+void
+nm_dhcp_engine_client_set_request_address (NMDhcpEngineClient *self,
+                                           in_addr_t address)
+{
+	g_return_if_fail (self);
+
+	self->request_address = address;
+}
+
+void
+nm_dhcp_engine_client_set_request_options (NMDhcpEngineClient *self,
+                                           const guint8 *options,
+                                           gsize n_options)
+{
+	g_return_if_fail (self);
+	g_return_if_fail (n_options <= 255);
+
+	g_free (self->request_options);
+	self->request_options = n_options ? g_memdup (options, n_options) : NULL;
+	self->n_request_options = n_options;
+}
+
+gboolean
+nm_dhcp_engine_client_start (NMDhcpEngineClient *self, GError **error)
+{
+	NMDhcpEngine *engine;
+
+	g_return_val_if_fail (self, FALSE);
+	g_return_val_if_fail (!error || !*error, FALSE);
+
+	if (self->state != STATE_STOPPED)
+		return TRUE;
+
+	engine = self->engine;
+
+	if (!_socket_open_udp (engine, error))
+		return FALSE;
+	if (!_socket_open_packet (engine, error)) {
+		if (engine->n_clients == 0)
+			_socket_close (engine, &engine->udp);
+		return FALSE;
+	}
+
+	engine->n_clients++;
+	_client_start_discovery (self, _now_ms (), 0);
+	return TRUE;
+}
+
+/**
+ * nm_dhcp_engine_client_stop:
+ * @self: the client
+ * @release: whether to release a lease to the server
+ *
+ * Stops the client. It can be started again later.
+ */
+void
+nm_dhcp_engine_client_stop (NMDhcpEngineClient *self, gboolean release)
+{
+	NMDhcpEngine *engine;
+
+	g_return_if_fail (self);
+
+	if (self->state == STATE_STOPPED)
+		return;
+
+	engine = self->engine;
+
+	if (   release
+	    && NM_IN_SET (self->state, STATE_BOUND, STATE_RENEWING, STATE_REBINDING))
+		_client_send (self, DHCPRELEASE);
+
+	nm_timer_wheel_cancel (engine->wheel, &self->timer);
+	_client_unlink (self);
+	_client_set_state (self, STATE_STOPPED);
+	self->address = 0;
+
+	nm_assert (engine->n_clients > 0);
+	if (--engine->n_clients == 0)
+		_socket_close (engine, &engine->udp);
+}
+
+/**
+ * nm_dhcp_engine_client_get_address:
+ * @self: the client
+ *
+ * Returns: the leased address, or zero if the client has no lease.
+ */
+in_addr_t
+nm_dhcp_engine_client_get_address (const NMDhcpEngineClient *self)
+{
+	g_return_val_if_fail (self, 0);
+
+	if (!NM_IN_SET (self->state, STATE_BOUND, STATE_RENEWING, STATE_REBINDING))
+		return 0;
+	return self->address;
+}
+
+/*****************************************************************************/
+
+guint
+nm_dhcp_engine_get_num_clients (const NMDhcpEngine *engine)
+{
+	g_return_val_if_fail (engine, 0);
+
+	return engine->n_clients;
+}
+
+/**
+ * nm_dhcp_engine_get_fd:
+ * @engine: the #NMDhcpEngine
+ *
+ * Returns: the packet socket that all clients share, or -1 if no
+ *   client is without a lease or rebinding it.
+ */
+int
+nm_dhcp_engine_get_fd (const NMDhcpEngine *engine)
+{
+	g_return_val_if_fail (engine, -1);
+
+	return engine->packet.close_pending ? -1 : engine->packet.fd;
+}
+
+NMDhcpEngine *
+nm_dhcp_engine_new (NMTimerWheel *wheel)
+{
+	NMDhcpEngine *engine;
+	guint32 seed[4];
+
+	g_return_val_if_fail (wheel, NULL);
+
+	engine = g_slice_new0 (NMDhcpEngine);
+	engine->wheel = wheel;
+	engine->clients = g_hash_table_new (g_int64_hash, g_int64_equal);
+	engine->packet.fd = -1;
+	engine->udp.fd = -1;
+
+	/* the transaction IDs must not be guessable. */
+	if (nm_utils_read_urandom (seed, sizeof (seed)) < 0) {
+		seed[0] = g_random_int ();
+		seed[1] = g_random_int ();
+		seed[2] = g_random_int ();
+		seed[3] = g_random_int ();
+	}
+	engine->rand = g_rand_new_with_seed_array (seed, G_N_ELEMENTS (seed));
+
+	return engine;
+}
+
+void
+nm_dhcp_engine_free (NMDhcpEngine *engine)
+{
+	if (!engine)
+		return;
+
+	g_return_if_fail (engine->n_clients == 0);
+	g_return_if_fail (!engine->packet.in_receive);
+	g_return_if_fail (!engine->udp.in_receive);
+
+	_socket_close (engine, &engine->packet);
+	_socket_close (engine, &engine->udp);
+	g_hash_table_unref (engine->clients);
+	g_rand_free (engine->rand);
+	g_free (engine->buf);
+	g_slice_free (NMDhcpEngine, engine);
+}
+
+/**
+ * nm_dhcp_engine_get:
+ *
+ * Returns: the engine that is shared by all clients on the main context.
+ */
+NMDhcpEngine *
+nm_dhcp_engine_get (void)
+{
+	static NMDhcpEngine *engine;
+
+	if (G_UNLIKELY (!engine))
+		engine = nm_dhcp_engine_new (nm_timer_wheel_get ());
+	return engine;
+}
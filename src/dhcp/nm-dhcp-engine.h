@@ -0,0 +1,75 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2017 Red Hat, Inc.
+ */
+
+#ifndef __NETWORKMANAGER_DHCP_ENGINE_H__
+#define __NETWORKMANAGER_DHCP_ENGINE_H__
+
+#include <netinet/in.h>
+
+struct _NMTimerWheel;
+
+typedef struct _NMDhcpEngine NMDhcpEngine;
+typedef struct _NMDhcpEngineClient NMDhcpEngineClient;
+
+typedef enum {
+	/* a lease was acquired or renewed. The message is the ACK. */
+	NM_DHCP_ENGINE_EVENT_BOUND,
+	/* the lease expired or the server declined to renew it. The
+	 * client starts over with a new discovery. */
+	NM_DHCP_ENGINE_EVENT_EXPIRED,
+} NMDhcpEngineEvent;
+
+typedef void (*NMDhcpEngineClientFunc) (NMDhcpEngineClient *client,
+                                        NMDhcpEngineEvent event,
+                                        const guint8 *message,
+                                        gsize message_len,
+                                        gpointer user_data);
+
+NMDhcpEngine *nm_dhcp_engine_get (void);
+
+NMDhcpEngine *nm_dhcp_engine_new (struct _NMTimerWheel *wheel);
+void nm_dhcp_engine_free (NMDhcpEngine *engine);
+
+guint nm_dhcp_engine_get_num_clients (const NMDhcpEngine *engine);
+int nm_dhcp_engine_get_fd (const NMDhcpEngine *engine);
+
+NMDhcpEngineClient *nm_dhcp_engine_client_new (NMDhcpEngine *engine,
+                                               int ifindex,
+                                               const guint8 *hwaddr,
+                                               NMDhcpEngineClientFunc func,
+                                               gpointer user_data);
+void nm_dhcp_engine_client_free (NMDhcpEngineClient *client);
+
+void nm_dhcp_engine_client_set_client_id (NMDhcpEngineClient *client,
+                                          const guint8 *client_id,
+                                          gsize len);
+void nm_dhcp_engine_client_set_hostname (NMDhcpEngineClient *client,
+                                         const char *hostname,
+                                         gboolean use_fqdn);
+void nm_dhcp_engine_client_set_request_address (NMDhcpEngineClient *client,
+                                                in_addr_t address);
+void nm_dhcp_engine_client_set_request_options (NMDhcpEngineClient *client,
+                                                const guint8 *options,
+                                                gsize n_options);
+
+gboolean nm_dhcp_engine_client_start (NMDhcpEngineClient *client, GError **error);
+void nm_dhcp_engine_client_stop (NMDhcpEngineClient *client, gboolean release);
+
+in_addr_t nm_dhcp_engine_client_get_address (const NMDhcpEngineClient *client);
+
+#endif /* __NETWORKMANAGER_DHCP_ENGINE_H__ */
@@ -35,6 +35,7 @@
 #include "NetworkManagerUtils.h"
 #include "platform/nm-platform.h"
 #include "nm-dhcp-client-logging.h"
+#include "nm-dhcp-engine.h"
 #include "systemd/nm-sd.h"
 
 /*****************************************************************************/
@@ -51,11 +52,19 @@ typedef struct _NMDhcpSystemdClass NMDhcpSystemdClass;
 
 static GType nm_dhcp_systemd_get_type (void);
 
+#define NM_TYPE_DHCP_SYSTEMD_SHARED     (nm_dhcp_systemd_shared_get_type ())
+
+typedef struct _NMDhcpSystemdShared NMDhcpSystemdShared;
+typedef struct _NMDhcpSystemdSharedClass NMDhcpSystemdSharedClass;
+
+static GType nm_dhcp_systemd_shared_get_type (void);
+
 /*****************************************************************************/
 
 typedef struct {
 	sd_dhcp_client *client4;
 	sd_dhcp6_client *client6;
+	NMDhcpEngineClient *engine4;
 	char *lease_file;
 
 	guint request_count;
@@ -490,22 +499,13 @@ _save_client_id (NMDhcpSystemd *self,
 }
 
 static void
-bound4_handle (NMDhcpSystemd *self)
+bound4_handle (NMDhcpSystemd *self, sd_dhcp_lease *lease)
 {
 	NMDhcpSystemdPrivate *priv = NM_DHCP_SYSTEMD_GET_PRIVATE (self);
 	const char *iface = nm_dhcp_client_get_iface (NM_DHCP_CLIENT (self));
-	sd_dhcp_lease *lease;
 	NMIP4Config *ip4_config;
 	GHashTable *options;
 	GError *error = NULL;
-	int r;
-
-	r = sd_dhcp_client_get_lease (priv->client4, &lease);
-	if (r < 0 || !lease) {
-		_LOGW ("no lease!");
-		nm_dhcp_client_set_state (NM_DHCP_CLIENT (self), NM_DHCP_STATE_FAIL, NULL, NULL);
-		return;
-	}
 
 	_LOGD ("lease available");
 
@@ -521,14 +521,14 @@ bound4_handle (NMDhcpSystemd *self)
 	if (ip4_config) {
 		const uint8_t *client_id = NULL;
 		size_t client_id_len = 0;
-		uint8_t type = 0;
 
 		add_requests_to_options (options, dhcp4_requests);
 		dhcp_lease_save (lease, priv->lease_file);
 
-		sd_dhcp_client_get_client_id(priv->client4, &type, &client_id, &client_id_len);
-		if (client_id)
-			_save_client_id (self, type, client_id, client_id_len);
+		/* the lease carries the client-id that was sent, starting with its type. */
+		if (   sd_dhcp_lease_get_client_id (lease, (const void **) &client_id, &client_id_len) == 0
+		    && client_id_len > 1)
+			_save_client_id (self, client_id[0], client_id + 1, client_id_len - 1);
 
 		nm_dhcp_client_set_state (NM_DHCP_CLIENT (self),
 		                          NM_DHCP_STATE_BOUND,
@@ -549,6 +549,8 @@ dhcp_event_cb (sd_dhcp_client *client, int event, gpointer user_data)
 {
 	NMDhcpSystemd *self = NM_DHCP_SYSTEMD (user_data);
 	NMDhcpSystemdPrivate *priv = NM_DHCP_SYSTEMD_GET_PRIVATE (self);
+	sd_dhcp_lease *lease = NULL;
+	int r;
 
 	g_assert (priv->client4 == client);
 
@@ -564,7 +566,13 @@ dhcp_event_cb (sd_dhcp_client *client, int event, gpointer user_data)
 	case SD_DHCP_CLIENT_EVENT_RENEW:
 	case SD_DHCP_CLIENT_EVENT_IP_CHANGE:
 	case SD_DHCP_CLIENT_EVENT_IP_ACQUIRE:
-		bound4_handle (self);
+		r = sd_dhcp_client_get_lease (priv->client4, &lease);
+		if (r < 0 || !lease) {
+			_LOGW ("no lease!");
+			nm_dhcp_client_set_state (NM_DHCP_CLIENT (self), NM_DHCP_STATE_FAIL, NULL, NULL);
+			break;
+		}
+		bound4_handle (self, lease);
 		break;
 	default:
 		_LOGW ("unhandled DHCP event %d", event);
@@ -1030,6 +1038,7 @@ dispose (GObject *object)
 	NMDhcpSystemdPrivate *priv = NM_DHCP_SYSTEMD_GET_PRIVATE ((NMDhcpSystemd *) object);
 
 	g_clear_pointer (&priv->lease_file, g_free);
+	g_clear_pointer (&priv->engine4, nm_dhcp_engine_client_free);
 
 	if (priv->client4) {
 		sd_dhcp_client_stop (priv->client4);
@@ -1065,3 +1074,185 @@ const NMDhcpClientFactory _nm_dhcp_client_factory_internal = {
 	.get_path = NULL,
 	.get_lease_ip_configs = nm_dhcp_systemd_get_lease_ip_configs,
 };
+
+/*****************************************************************************/
+
+/* Like the internal client, but DHCPv4 runs on the shared #NMDhcpEngine
+ * instead of a sd_dhcp_client with its own sockets and timers per
+ * interface. The leases are still parsed and stored by systemd's code,
+ * and DHCPv6 is unchanged. */
+
+struct _NMDhcpSystemdShared {
+	NMDhcpSystemd parent;
+};
+
+struct _NMDhcpSystemdSharedClass {
+	NMDhcpSystemdClass parent;
+};
+
+G_DEFINE_TYPE (NMDhcpSystemdShared, nm_dhcp_systemd_shared, NM_TYPE_DHCP_SYSTEMD)
+
+static void
+engine4_event_cb (NMDhcpEngineClient *client,
+                  NMDhcpEngineEvent event,
+                  const guint8 *message,
+                  gsize message_len,
+                  gpointer user_data)
+{
+	NMDhcpSystemd *self = NM_DHCP_SYSTEMD (user_data);
+	NMDhcpSystemdPrivate *priv = NM_DHCP_SYSTEMD_GET_PRIVATE (self);
+	sd_dhcp_lease *lease = NULL;
+	GBytes *client_id;
+	gconstpointer client_id_data = NULL;
+	gsize client_id_len = 0;
+	int r;
+
+	g_assert (priv->engine4 == client);
+
+	_LOGD ("engine event %d", (int) event);
+
+	switch (event) {
+	case NM_DHCP_ENGINE_EVENT_BOUND:
+		client_id = nm_dhcp_client_get_client_id (NM_DHCP_CLIENT (self));
+		if (client_id)
+			client_id_data = g_bytes_get_data (client_id, &client_id_len);
+
+		r = nm_sd_dhcp_lease_new_from_message (message, message_len,
+		                                       client_id_data, client_id_len,
+		                                       &lease);
+		if (r < 0) {
+			_LOGW ("invalid lease (%d)", r);
+			nm_dhcp_client_set_state (NM_DHCP_CLIENT (self), NM_DHCP_STATE_FAIL, NULL, NULL);
+			break;
+		}
+		bound4_handle (self, lease);
+		sd_dhcp_lease_unref (lease);
+		break;
+	case NM_DHCP_ENGINE_EVENT_EXPIRED:
+		nm_dhcp_client_set_state (NM_DHCP_CLIENT (self), NM_DHCP_STATE_EXPIRE, NULL, NULL);
+		break;
+	}
+}
+
+static gboolean
+ip4_start_shared (NMDhcpClient *client, const char *dhcp_anycast_addr, const char *last_ip4_address)
+{
+	NMDhcpSystemd *self = NM_DHCP_SYSTEMD (client);
+	NMDhcpSystemdPrivate *priv = NM_DHCP_SYSTEMD_GET_PRIVATE (self);
+	const char *iface = nm_dhcp_client_get_iface (client);
+	const GByteArray *hwaddr;
+	sd_dhcp_lease *lease = NULL;
+	GBytes *override_client_id;
+	const uint8_t *client_id = NULL;
+	size_t client_id_len = 0;
+	guint8 default_client_id[1 + ETH_ALEN];
+	struct in_addr last_addr = { 0 };
+	guint8 options[G_N_ELEMENTS (dhcp4_requests)];
+	gsize n_options = 0;
+	const char *hostname;
+	GError *error = NULL;
+	int i;
+
+	g_assert (priv->engine4 == NULL);
+	g_assert (priv->client6 == NULL);
+
+	hwaddr = nm_dhcp_client_get_hw_addr (client);
+	if (!hwaddr || hwaddr->len != ETH_ALEN) {
+		_LOGW ("the shared DHCP client requires an Ethernet address");
+		return FALSE;
+	}
+
+	g_free (priv->lease_file);
+	priv->lease_file = get_leasefile_path (iface, nm_dhcp_client_get_uuid (client), FALSE);
+
+	dhcp_lease_load (&lease, priv->lease_file);
+
+	if (last_ip4_address)
+		inet_pton (AF_INET, last_ip4_address, &last_addr);
+	else if (lease)
+		sd_dhcp_lease_get_address (lease, &last_addr);
+
+	/* the same client-id as sd_dhcp_client would send. */
+	override_client_id = nm_dhcp_client_get_client_id (client);
+	if (override_client_id)
+		client_id = g_bytes_get_data (override_client_id, &client_id_len);
+	else if (   !lease
+	         || sd_dhcp_lease_get_client_id (lease, (const void **) &client_id, &client_id_len) < 0
+	         || client_id_len < 2) {
+		default_client_id[0] = ARPHRD_ETHER;
+		memcpy (&default_client_id[1], hwaddr->data, ETH_ALEN);
+		client_id = default_client_id;
+		client_id_len = sizeof (default_client_id);
+	}
+	g_assert (client_id && client_id_len > 1);
+	_save_client_id (self, client_id[0], client_id + 1, client_id_len - 1);
+
+	priv->engine4 = nm_dhcp_engine_client_new (nm_dhcp_engine_get (),
+	                                           nm_dhcp_client_get_ifindex (client),
+	                                           hwaddr->data,
+	                                           engine4_event_cb,
+	                                           self);
+	nm_dhcp_engine_client_set_client_id (priv->engine4, client_id, client_id_len);
+	nm_dhcp_engine_client_set_request_address (priv->engine4, last_addr.s_addr);
+
+	sd_dhcp_lease_unref (lease);
+
+	for (i = 0; dhcp4_requests[i].name; i++) {
+		if (   dhcp4_requests[i].include
+		    && dhcp4_requests[i].num <= G_MAXUINT8)
+			options[n_options++] = dhcp4_requests[i].num;
+	}
+	nm_dhcp_engine_client_set_request_options (priv->engine4, options, n_options);
+
+	hostname = nm_dhcp_client_get_hostname (client);
+	if (hostname) {
+		nm_dhcp_engine_client_set_hostname (priv->engine4, hostname,
+		                                    nm_dhcp_client_get_use_fqdn (client));
+	}
+
+	if (!nm_dhcp_engine_client_start (priv->engine4, &error)) {
+		_LOGW ("failed to start client: %s", error->message);
+		g_clear_error (&error);
+		g_clear_pointer (&priv->engine4, nm_dhcp_engine_client_free);
+		return FALSE;
+	}
+
+	nm_dhcp_client_start_timeout (client);
+	return TRUE;
+}
+
+static void
+stop_shared (NMDhcpClient *client, gboolean release, const GByteArray *duid)
+{
+	NMDhcpSystemd *self = NM_DHCP_SYSTEMD (client);
+	NMDhcpSystemdPrivate *priv = NM_DHCP_SYSTEMD_GET_PRIVATE (self);
+
+	if (priv->engine4) {
+		_LOGT ("dhcp-client4: stop shared client");
+		nm_dhcp_engine_client_stop (priv->engine4, release);
+		return;
+	}
+
+	NM_DHCP_CLIENT_CLASS (nm_dhcp_systemd_shared_parent_class)->stop (client, release, duid);
+}
+
+static void
+nm_dhcp_systemd_shared_init (NMDhcpSystemdShared *self)
+{
+}
+
+static void
+nm_dhcp_systemd_shared_class_init (NMDhcpSystemdSharedClass *klass)
+{
+	NMDhcpClientClass *client_class = NM_DHCP_CLIENT_CLASS (klass);
+
+	client_class->ip4_start = ip4_start_shared;
+	client_class->stop = stop_shared;
+}
+
+const NMDhcpClientFactory _nm_dhcp_client_factory_internal_shared = {
+	.name = "internal-shared",
+	.get_type = nm_dhcp_systemd_shared_get_type,
+	.get_path = NULL,
+	.get_lease_ip_configs = nm_dhcp_systemd_get_lease_ip_configs,
+};
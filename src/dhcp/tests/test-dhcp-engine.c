@@ -0,0 +1,566 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2017 Red Hat, Inc.
+ *
+ */
+
+#include "nm-default.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <dirent.h>
+#include <sys/socket.h>
+#include <net/if.h>
+#include <netpacket/packet.h>
+#include <net/ethernet.h>
+#include <arpa/inet.h>
+
+#include "dhcp/nm-dhcp-engine.h"
+#include "nm-timer-wheel.h"
+#include "nm-core-utils.h"
+
+#include "nm-test-utils-core.h"
+
+#define N_LINKS            50
+#define N_CLIENTS_PER_LINK 20
+#define N_CLIENTS          (N_LINKS * N_CLIENTS_PER_LINK)
+
+/* short enough to see every client renew, T1 is after two seconds. */
+#define LEASE_TIME         4
+
+#define MSG_HEADER_LEN     240
+
+/*****************************************************************************/
+
+/* A stand-in for a DHCP server on the other end of each veth pair. It
+ * listens on one packet socket for all links and hands out the address
+ * 10.0.<link>.<10 + n> to the n-th client of a link. The addresses are
+ * configured on the client side from the start, so that unicast replies
+ * reach the UDP socket of the engine. */
+typedef struct {
+	int fd;
+	GIOChannel *channel;
+	guint id;
+	int ifindex[N_LINKS];
+	guint n_discover;
+	guint n_request;
+	guint n_renew;
+	guint n_rebind;
+	guint n_release;
+} Server;
+
+typedef struct {
+	NMDhcpEngineClient *client;
+	int link;
+	guint8 hwaddr[ETH_ALEN];
+	guint n_bound;
+	in_addr_t address;
+} Client;
+
+static in_addr_t
+_server_addr (int link)
+{
+	return htonl ((10u << 24) | (((guint) link) << 8) | 1);
+}
+
+static in_addr_t
+_client_addr (int idx)
+{
+	return htonl ((10u << 24) | (((guint) idx / N_CLIENTS_PER_LINK) << 8) | (10 + idx % N_CLIENTS_PER_LINK));
+}
+
+static const guint8 *
+_find_option (const guint8 *msg, gsize len, guint8 code)
+{
+	gsize i = MSG_HEADER_LEN;
+
+	while (i + 1 < len && msg[i] != 255) {
+		if (msg[i] == 0) {
+			i++;
+			continue;
+		}
+		if (msg[i] == code)
+			return &msg[i + 1];
+		i += 2 + msg[i + 1];
+	}
+	return NULL;
+}
+
+static guint32
+_checksum_add (guint32 sum, const guint8 *data, gsize len)
+{
+	gsize i;
+
+	for (i = 0; i < len; i += 2)
+		sum += (data[i] << 8) | data[i + 1];
+	return sum;
+}
+
+static guint16
+_checksum (guint32 sum)
+{
+	while (sum >> 16)
+		sum = (sum & 0xFFFF) + (sum >> 16);
+	return ~sum;
+}
+
+/* RFC 2131, section 4.1: a client that has an address gets the reply
+ * unicast, otherwise it asked for a broadcast. The clients of a link
+ * share it, so their made-up chaddr is not the address of the link
+ * and unicast frames go to where the request came from. With @corrupt,
+ * the offered address is changed after the UDP checksum was calculated. */
+static void
+_server_reply (Server *server,
+               const struct sockaddr_ll *from,
+               int link,
+               const guint8 *request,
+               guint8 type,
+               in_addr_t yiaddr,
+               gboolean corrupt)
+{
+	guint8 pkt[576] = { 0 };
+	guint8 *ip = pkt, *udp = &pkt[20], *msg = &pkt[28];
+	in_addr_t server_addr = _server_addr (link);
+	in_addr_t mask = htonl (0xFFFFFF00);
+	guint32 lease = htonl (LEASE_TIME);
+	struct sockaddr_ll sll = { 0 };
+	gsize len = MSG_HEADER_LEN;
+	in_addr_t ciaddr;
+	guint32 sum;
+	guint16 n;
+
+	memcpy (&ciaddr, &request[12], 4);
+
+	msg[0] = 2;
+	msg[1] = 1;
+	msg[2] = ETH_ALEN;
+	memcpy (&msg[4], &request[4], 4);
+	memcpy (&msg[16], &yiaddr, 4);
+	memcpy (&msg[28], &request[28], 16);
+	msg[236] = 0x63; msg[237] = 0x82; msg[238] = 0x53; msg[239] = 0x63;
+
+#define ADD_OPTION(code, data, data_len) \
+	G_STMT_START { \
+		msg[len++] = (code); \
+		msg[len++] = (data_len); \
+		memcpy (&msg[len], (data), (data_len)); \
+		len += (data_len); \
+	} G_STMT_END
+
+	ADD_OPTION (53, &type, 1);
+	ADD_OPTION (54, &server_addr, 4);
+	ADD_OPTION (51, &lease, 4);
+	ADD_OPTION (1, &mask, 4);
+	ADD_OPTION (3, &server_addr, 4);
+	ADD_OPTION (6, &server_addr, 4);
+	msg[len++] = 255;
+	len = MAX (len, (gsize) 300);
+
+	n = htons (8 + len);
+	memset (&udp[0], 0, 8);
+	udp[1] = 67;
+	udp[3] = 68;
+	memcpy (&udp[4], &n, 2);
+
+	ip[0] = 0x45;
+	n = htons (28 + len);
+	memcpy (&ip[2], &n, 2);
+	ip[8] = 64;
+	ip[9] = IPPROTO_UDP;
+	memcpy (&ip[12], &server_addr, 4);
+	if (ciaddr)
+		memcpy (&ip[16], &ciaddr, 4);
+	else
+		memset (&ip[16], 0xFF, 4);
+	n = htons (_checksum (_checksum_add (0, ip, 20)));
+	memcpy (&ip[10], &n, 2);
+
+	sum = _checksum_add (0, &ip[12], 8);
+	sum += IPPROTO_UDP + 8 + len;
+	n = htons (_checksum (_checksum_add (sum, udp, 8 + len)) ?: 0xFFFF);
+	memcpy (&udp[6], &n, 2);
+
+	if (corrupt)
+		msg[18] ^= 0x80;
+
+	sll.sll_family = AF_PACKET;
+	sll.sll_protocol = htons (ETH_P_IP);
+	sll.sll_ifindex = from->sll_ifindex;
+	sll.sll_halen = ETH_ALEN;
+	if (ciaddr)
+		memcpy (sll.sll_addr, from->sll_addr, ETH_ALEN);
+	else
+		memset (sll.sll_addr, 0xFF, ETH_ALEN);
+
+	g_assert_cmpint (sendto (server->fd, pkt, 28 + len, 0, (struct sockaddr *) &sll, sizeof (sll)),
+	                 ==, 28 + len);
+}
+
+static void
+_server_handle (Server *server, const guint8 *pkt, gsize n, const struct sockaddr_ll *from)
+{
+	const guint8 *msg, *opt;
+	in_addr_t ciaddr, requested, dst;
+	int link, idx;
+
+	if (   from->sll_pkttype == PACKET_OUTGOING
+	    || n < 28 + MSG_HEADER_LEN
+	    || pkt[0] != 0x45
+	    || pkt[9] != IPPROTO_UDP
+	    || pkt[22] != 0 || pkt[23] != 67)
+		return;
+
+	for (link = 0; link < N_LINKS; link++) {
+		if (server->ifindex[link] == from->sll_ifindex)
+			break;
+	}
+	if (link == N_LINKS)
+		return;
+
+	memcpy (&dst, &pkt[16], 4);
+	msg = &pkt[28];
+	n -= 28;
+	g_assert_cmpint (msg[0], ==, 1);
+	g_assert_cmpint (msg[28], ==, 0x02);
+
+	idx = (msg[32] << 8) | msg[33];
+	g_assert_cmpint (idx, <, N_CLIENTS);
+	g_assert_cmpint (idx / N_CLIENTS_PER_LINK, ==, link);
+
+	opt = _find_option (msg, n, 53);
+	g_assert (opt && opt[0] == 1);
+
+	/* type 1 and the hardware address, as set by the test. */
+	opt = _find_option (msg, n, 61);
+	g_assert (opt && opt[0] == 7 && opt[1] == 1);
+	g_assert (memcmp (&opt[2], &msg[28], ETH_ALEN) == 0);
+
+	memcpy (&ciaddr, &msg[12], 4);
+
+	switch (_find_option (msg, n, 53)[1]) {
+	case 1:
+		server->n_discover++;
+		g_assert_cmpint (ciaddr, ==, 0);
+		g_assert_cmpint (dst, ==, htonl (INADDR_BROADCAST));
+		/* the client must drop the offer with the bad checksum,
+		 * or it would request the wrong address. Only the first client
+		 * of a link gets one, to not overflow the socket buffers. */
+		if (idx % N_CLIENTS_PER_LINK == 0)
+			_server_reply (server, from, link, msg, 2, _client_addr (idx), TRUE);
+		_server_reply (server, from, link, msg, 2, _client_addr (idx), FALSE);
+		break;
+	case 3:
+		if (ciaddr) {
+			/* renewing unicast to us, or rebinding by broadcast. */
+			if (dst == htonl (INADDR_BROADCAST))
+				server->n_rebind++;
+			else {
+				g_assert_cmpint (dst, ==, _server_addr (link));
+				server->n_renew++;
+			}
+			g_assert_cmpint (ciaddr, ==, _client_addr (idx));
+			g_assert (!_find_option (msg, n, 54));
+		} else {
+			server->n_request++;
+			opt = _find_option (msg, n, 50);
+			g_assert (opt && opt[0] == 4);
+			memcpy (&requested, &opt[1], 4);
+			g_assert_cmpint (requested, ==, _client_addr (idx));
+			opt = _find_option (msg, n, 54);
+			g_assert (opt && opt[0] == 4);
+		}
+		_server_reply (server, from, link, msg, 5, _client_addr (idx), FALSE);
+		break;
+	case 7:
+		server->n_release++;
+		g_assert_cmpint (dst, ==, _server_addr (link));
+		g_assert_cmpint (ciaddr, ==, _client_addr (idx));
+		g_assert (_find_option (msg, n, 54));
+		break;
+	default:
+		g_assert_not_reached ();
+	}
+}
+
+static gboolean
+_server_cb (GIOChannel *source, GIOCondition condition, gpointer user_data)
+{
+	Server *server = user_data;
+	guint8 buf[1500];
+	struct sockaddr_ll from;
+	socklen_t from_len;
+	gssize n;
+
+	for (;;) {
+		from_len = sizeof (from);
+		n = recvfrom (server->fd, buf, sizeof (buf), MSG_DONTWAIT,
+		              (struct sockaddr *) &from, &from_len);
+		if (n < 0) {
+			g_assert (NM_IN_SET (errno, EAGAIN, EWOULDBLOCK));
+			break;
+		}
+		_server_handle (server, buf, n, &from);
+	}
+	return G_SOURCE_CONTINUE;
+}
+
+static void
+_server_start (Server *server)
+{
+	struct sockaddr_ll sll = {
+		.sll_family = AF_PACKET,
+		.sll_protocol = htons (ETH_P_IP),
+	};
+	int size = 4 * 1024 * 1024;
+
+	server->fd = socket (AF_PACKET, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, htons (ETH_P_IP));
+	g_assert_cmpint (server->fd, >=, 0);
+	g_assert_cmpint (setsockopt (server->fd, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof (size)), ==, 0);
+	g_assert_cmpint (bind (server->fd, (struct sockaddr *) &sll, sizeof (sll)), ==, 0);
+
+	server->channel = g_io_channel_unix_new (server->fd);
+	server->id = g_io_add_watch (server->channel, G_IO_IN, _server_cb, server);
+}
+
+static void
+_server_stop (Server *server)
+{
+	nm_clear_g_source (&server->id);
+	g_io_channel_unref (server->channel);
+	close (server->fd);
+}
+
+/*****************************************************************************/
+
+static gboolean
+_setup_links (Server *server, int *client_ifindex)
+{
+	gs_free char *batch = NULL;
+	gs_free char *path = NULL;
+	GString *str;
+	int fd, status, i;
+	char ifname[IFNAMSIZ];
+
+	if (geteuid () != 0 || unshare (CLONE_NEWNET) != 0)
+		return FALSE;
+
+	str = g_string_new ("link set lo up\n");
+	for (i = 0; i < N_LINKS; i++) {
+		g_string_append_printf (str, "link add dc%d type veth peer name ds%d\n", i, i);
+		g_string_append_printf (str, "link set ds%d address 02:00:00:01:00:%02x\n", i, i);
+	}
+	for (i = 0; i < N_LINKS; i++)
+		g_string_append_printf (str, "link set dc%d up\nlink set ds%d up\n", i, i);
+
+	/* the server has no address and doesn't answer ARP. */
+	for (i = 0; i < N_CLIENTS; i++) {
+		g_string_append_printf (str, "address add 10.0.%d.%d/24 dev dc%d\n",
+		                        i / N_CLIENTS_PER_LINK, 10 + i % N_CLIENTS_PER_LINK,
+		                        i / N_CLIENTS_PER_LINK);
+	}
+	for (i = 0; i < N_LINKS; i++) {
+		g_string_append_printf (str, "neighbor add 10.0.%d.1 lladdr 02:00:00:01:00:%02x "
+		                             "dev dc%d nud permanent\n", i, i, i);
+	}
+	batch = g_string_free (str, FALSE);
+
+	fd = g_file_open_tmp ("test-dhcp-engine-XXXXXX", &path, NULL);
+	g_assert_cmpint (fd, >=, 0);
+	close (fd);
+	g_assert (g_file_set_contents (path, batch, -1, NULL));
+
+	if (!g_spawn_sync (NULL, (char *[]) { "ip", "-batch", path, NULL }, NULL,
+	                   G_SPAWN_SEARCH_PATH | G_SPAWN_STDOUT_TO_DEV_NULL,
+	                   NULL, NULL, NULL, NULL, &status, NULL)
+	    || status != 0) {
+		unlink (path);
+		return FALSE;
+	}
+	unlink (path);
+
+	for (i = 0; i < N_LINKS; i++) {
+		nm_sprintf_buf (ifname, "dc%d", i);
+		client_ifindex[i] = if_nametoindex (ifname);
+		g_assert_cmpint (client_ifindex[i], >, 0);
+		nm_sprintf_buf (ifname, "ds%d", i);
+		server->ifindex[i] = if_nametoindex (ifname);
+		g_assert_cmpint (server->ifindex[i], >, 0);
+	}
+	return TRUE;
+}
+
+static guint
+_count_fds (void)
+{
+	DIR *dir;
+	guint n = 0;
+
+	dir = opendir ("/proc/self/fd");
+	g_assert (dir);
+	while (readdir (dir))
+		n++;
+	closedir (dir);
+	return n;
+}
+
+static void
+_client_cb (NMDhcpEngineClient *client,
+            NMDhcpEngineEvent event,
+            const guint8 *message,
+            gsize message_len,
+            gpointer user_data)
+{
+	Client *c = user_data;
+
+	g_assert (c->client == client);
+	g_assert_cmpint (event, ==, NM_DHCP_ENGINE_EVENT_BOUND);
+	g_assert (message);
+	g_assert_cmpint (message_len, >=, MSG_HEADER_LEN);
+
+	c->n_bound++;
+	c->address = nm_dhcp_engine_client_get_address (client);
+}
+
+static gboolean
+_timeout_cb (gpointer user_data)
+{
+	g_assert_not_reached ();
+	return G_SOURCE_REMOVE;
+}
+
+static void
+_run_until_bound (Client *clients, guint n_bound, guint timeout_sec)
+{
+	guint timeout_id;
+	guint i = 0;
+
+	timeout_id = g_timeout_add_seconds (timeout_sec, _timeout_cb, NULL);
+	while (i < N_CLIENTS) {
+		if (clients[i].n_bound >= n_bound)
+			i++;
+		else
+			g_main_context_iteration (NULL, TRUE);
+	}
+	g_source_remove (timeout_id);
+}
+
+static void
+test_many (void)
+{
+	Server server = { 0 };
+	int client_ifindex[N_LINKS];
+	gs_free Client *clients = NULL;
+	NMTimerWheel *wheel;
+	NMDhcpEngine *engine;
+	guint n_fds, timeout_id;
+	gint64 start;
+	guint i;
+
+	if (!_setup_links (&server, client_ifindex)) {
+		g_test_skip ("Unable to create veth pairs in a network namespace");
+		return;
+	}
+
+	_server_start (&server);
+
+	wheel = nm_timer_wheel_new (nm_utils_get_monotonic_timestamp_ms (), TRUE);
+	engine = nm_dhcp_engine_new (wheel);
+	g_assert_cmpint (nm_dhcp_engine_get_fd (engine), ==, -1);
+
+	n_fds = _count_fds ();
+	clients = g_new0 (Client, N_CLIENTS);
+	for (i = 0; i < N_CLIENTS; i++) {
+		Client *c = &clients[i];
+		guint8 client_id[1 + ETH_ALEN];
+		const guint8 options[] = { 1, 3, 6, 15 };
+		gs_free_error GError *error = NULL;
+
+		c->link = i / N_CLIENTS_PER_LINK;
+		c->hwaddr[0] = 0x02;
+		c->hwaddr[4] = i >> 8;
+		c->hwaddr[5] = i & 0xFF;
+		client_id[0] = 1;
+		memcpy (&client_id[1], c->hwaddr, ETH_ALEN);
+
+		c->client = nm_dhcp_engine_client_new (engine, client_ifindex[c->link],
+		                                       c->hwaddr, _client_cb, c);
+		nm_dhcp_engine_client_set_client_id (c->client, client_id, sizeof (client_id));
+		nm_dhcp_engine_client_set_request_options (c->client, options, sizeof (options));
+		g_assert (nm_dhcp_engine_client_start (c->client, &error));
+		g_assert_no_error (error);
+	}
+	g_assert_cmpint (nm_dhcp_engine_get_num_clients (engine), ==, N_CLIENTS);
+
+	/* all clients share the packet and the UDP socket. */
+	g_assert_cmpint (nm_dhcp_engine_get_fd (engine), >=, 0);
+	g_assert_cmpint (_count_fds (), ==, n_fds + 2);
+
+	start = nm_utils_get_monotonic_timestamp_ms ();
+	_run_until_bound (clients, 1, 30);
+	g_test_message ("%d clients bound after %" G_GINT64_FORMAT " msec "
+	                "(%u discover, %u request)",
+	                N_CLIENTS, nm_utils_get_monotonic_timestamp_ms () - start,
+	                server.n_discover, server.n_request);
+
+	for (i = 0; i < N_CLIENTS; i++)
+		g_assert_cmpint (clients[i].address, ==, _client_addr (i));
+
+	/* with a lease, only the UDP socket is left. */
+	g_assert_cmpint (nm_dhcp_engine_get_fd (engine), ==, -1);
+	g_assert_cmpint (_count_fds (), ==, n_fds + 1);
+
+	/* every client renews its lease at T1, by unicast. */
+	_run_until_bound (clients, 2, 30);
+	g_assert_cmpint (server.n_renew, >=, N_CLIENTS);
+	g_assert_cmpint (server.n_rebind, ==, 0);
+	for (i = 0; i < N_CLIENTS; i++)
+		g_assert_cmpint (clients[i].address, ==, _client_addr (i));
+	g_assert_cmpint (nm_dhcp_engine_get_fd (engine), ==, -1);
+
+	for (i = 0; i < N_CLIENTS; i++)
+		nm_dhcp_engine_client_stop (clients[i].client, TRUE);
+	g_assert_cmpint (nm_dhcp_engine_get_num_clients (engine), ==, 0);
+	g_assert_cmpint (nm_dhcp_engine_get_fd (engine), ==, -1);
+	g_assert_cmpint (_count_fds (), ==, n_fds);
+
+	timeout_id = g_timeout_add_seconds (5, _timeout_cb, NULL);
+	while (server.n_release < N_CLIENTS)
+		g_main_context_iteration (NULL, TRUE);
+	g_source_remove (timeout_id);
+
+	for (i = 0; i < N_CLIENTS; i++)
+		nm_dhcp_engine_client_free (clients[i].client);
+	nm_dhcp_engine_free (engine);
+	nm_timer_wheel_free (wheel);
+	_server_stop (&server);
+}
+
+/*****************************************************************************/
+
+NMTST_DEFINE ();
+
+int
+main (int argc, char **argv)
+{
+	nmtst_init_with_logging (&argc, &argv, NULL, "ALL");
+
+	g_test_add_func ("/dhcp/engine/many", test_many);
+
+	return g_test_run ();
+}
@@ -44,6 +44,9 @@
 #define DNSMASQ_DBUS_SERVICE "org.freedesktop.NetworkManager.dnsmasq"
 #define DNSMASQ_DBUS_PATH "/uk/org/thekelleys/dnsmasq"
 
+/* minimal interval between two SetServersEx calls. */
+#define UPDATE_RATELIMIT_MSEC 500
+
 /*****************************************************************************/
 
 typedef struct {
@@ -52,7 +55,13 @@ typedef struct {
 	GCancellable *update_cancellable;
 	gboolean running;
 
+	/* the arguments for the next update */
 	GVariant *set_server_ex_args;
+	/* the arguments last sent to dnsmasq */
+	GVariant *set_server_ex_args_sent;
+
+	gint64 update_last_ms;
+	guint update_ratelimit_id;
 } NMDnsDnsmasqPrivate;
 
 struct _NMDnsDnsmasq {
@@ -374,37 +383,84 @@ dnsmasq_update_done (GDBusProxy *proxy, GAsyncResult *res, gpointer user_data)
 	self = NM_DNS_DNSMASQ (user_data);
 	priv = NM_DNS_DNSMASQ_GET_PRIVATE (self);
 
-	if (!response)
+	if (!response) {
 		_LOGW ("dnsmasq update failed: %s", error->message);
-	else
+		/* we don't know what dnsmasq has now. Don't skip the next update. */
+		g_clear_pointer (&priv->set_server_ex_args_sent, g_variant_unref);
+	} else
 		_LOGD ("dnsmasq update successful");
 }
 
+static gboolean update_ratelimit_cb (gpointer user_data);
+
 static void
 send_dnsmasq_update (NMDnsDnsmasq *self)
 {
 	NMDnsDnsmasqPrivate *priv = NM_DNS_DNSMASQ_GET_PRIVATE (self);
+	gint64 now;
 
 	if (!priv->set_server_ex_args)
 		return;
 
-	if (priv->running) {
-		_LOGD ("trying to update dnsmasq nameservers");
-
-		nm_clear_g_cancellable (&priv->update_cancellable);
-		priv->update_cancellable = g_cancellable_new ();
-
-		g_dbus_proxy_call (priv->dnsmasq,
-		                   "SetServersEx",
-		                   priv->set_server_ex_args,
-		                   G_DBUS_CALL_FLAGS_NONE,
-		                   -1,
-		                   priv->update_cancellable,
-		                   (GAsyncReadyCallback) dnsmasq_update_done,
-		                   self);
-		g_clear_pointer (&priv->set_server_ex_args, g_variant_unref);
-	} else
+	if (!priv->running) {
 		_LOGD ("dnsmasq not found on the bus. The nameserver update will be sent when dnsmasq appears");
+		return;
+	}
+
+	/* SetServersEx always replaces the full list of servers, and dnsmasq
+	 * clears its cache each time. Don't bother it, if nothing changed. */
+	if (   priv->set_server_ex_args_sent
+	    && g_variant_equal (priv->set_server_ex_args, priv->set_server_ex_args_sent)) {
+		_LOGD ("dnsmasq nameservers unchanged");
+		g_clear_pointer (&priv->set_server_ex_args, g_variant_unref);
+		nm_clear_g_source (&priv->update_ratelimit_id);
+		return;
+	}
+
+	if (priv->update_ratelimit_id)
+		return;
+
+	/* During bursts of changes, only send the latest arguments from time
+	 * to time. Changes that revert each other in the meantime are not
+	 * sent at all. */
+	now = nm_utils_get_monotonic_timestamp_ms ();
+	if (   priv->update_last_ms
+	    && now < priv->update_last_ms + UPDATE_RATELIMIT_MSEC) {
+		_LOGD ("rate-limit dnsmasq update");
+		priv->update_ratelimit_id = g_timeout_add (priv->update_last_ms + UPDATE_RATELIMIT_MSEC - now,
+		                                           update_ratelimit_cb,
+		                                           self);
+		return;
+	}
+	priv->update_last_ms = now;
+
+	_LOGD ("trying to update dnsmasq nameservers");
+
+	nm_clear_g_cancellable (&priv->update_cancellable);
+	priv->update_cancellable = g_cancellable_new ();
+
+	g_clear_pointer (&priv->set_server_ex_args_sent, g_variant_unref);
+	priv->set_server_ex_args_sent = g_steal_pointer (&priv->set_server_ex_args);
+
+	g_dbus_proxy_call (priv->dnsmasq,
+	                   "SetServersEx",
+	                   priv->set_server_ex_args_sent,
+	                   G_DBUS_CALL_FLAGS_NONE,
+	                   -1,
+	                   priv->update_cancellable,
+	                   (GAsyncReadyCallback) dnsmasq_update_done,
+	                   self);
+}
+
+static gboolean
+update_ratelimit_cb (gpointer user_data)
+{
+	NMDnsDnsmasq *self = user_data;
+	NMDnsDnsmasqPrivate *priv = NM_DNS_DNSMASQ_GET_PRIVATE (self);
+
+	priv->update_ratelimit_id = 0;
+	send_dnsmasq_update (self);
+	return G_SOURCE_REMOVE;
 }
 
 static void
@@ -420,6 +476,11 @@ name_owner_changed (GObject    *object,
 	if (owner) {
 		_LOGI ("dnsmasq appeared as %s", owner);
 		priv->running = TRUE;
+		/* a new dnsmasq instance has no servers. Send the last ones again,
+		 * unless there are newer. */
+		if (!priv->set_server_ex_args)
+			priv->set_server_ex_args = g_steal_pointer (&priv->set_server_ex_args_sent);
+		g_clear_pointer (&priv->set_server_ex_args_sent, g_variant_unref);
 		send_dnsmasq_update (self);
 	} else {
 		_LOGI ("dnsmasq disappeared");
@@ -650,7 +711,9 @@ dispose (GObject *object)
 
 	g_clear_object (&priv->dnsmasq);
 
+	nm_clear_g_source (&priv->update_ratelimit_id);
 	g_clear_pointer (&priv->set_server_ex_args, g_variant_unref);
+	g_clear_pointer (&priv->set_server_ex_args_sent, g_variant_unref);
 
 	G_OBJECT_CLASS (nm_dns_dnsmasq_parent_class)->dispose (object);
 }
@@ -0,0 +1,570 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/* NetworkManager -- Network link manager
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright 2017 Red Hat, Inc.
+ */
+
+#include "nm-default.h"
+
+#include "nm-dns-helper.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+/*****************************************************************************/
+
+/* Runs helpers like resolvconf and netconfig in the background, so that
+ * updating DNS never blocks the mainloop. At most one helper runs at a
+ * time. While it runs, further jobs only replace the pending job, so that
+ * after a burst of changes just the newest configuration is committed.
+ *
+ * The input is written as the pipe accepts it. The helper is always
+ * reaped by its child watch, also when flushing synchronously: GLib may
+ * have reaped the child already, so waiting for it directly fails.
+ *
+ * All sources of the helpers are attached to a private main context,
+ * which is iterated from the default one by a ContextSource. Flushing
+ * iterates only the private context, so that no unrelated sources are
+ * dispatched while NetworkManager shuts down. */
+
+/* how long nm_dns_helper_flush_sync() waits before killing a helper,
+ * and then for the killed helper. */
+#define FLUSH_TIMEOUT_MSEC 1000
+
+typedef struct {
+	GSource source;
+	GMainContext *context;
+	GPollFD *fds;
+	gint n_fds_alloc;
+	gint n_fds;
+	gint max_priority;
+} ContextSource;
+
+typedef struct {
+	/* %NULL once the helper was freed while the job still ran. */
+	NMDnsHelper *helper;
+	/* keeps the private context iterated until an orphaned job is
+	 * reaped. */
+	GSource *context_source;
+
+	const char *name;
+	char **argv;
+	char *input;
+	gsize input_written;
+
+	GPid pid;
+	GSource *watch_source;
+
+	int stdin_fd;
+	GIOChannel *stdin_channel;
+	GSource *stdin_source;
+} HelperJob;
+
+struct _NMDnsHelper {
+	NMDnsHelperFunc func;
+	gpointer user_data;
+
+	HelperJob *running;
+	HelperJob *pending;
+
+	GMainContext *context;
+	GSource *context_source;
+
+	/* counts the spawned jobs, to tell them apart. */
+	guint64 n_spawned;
+};
+
+/*****************************************************************************/
+
+#define _NMLOG_DOMAIN      LOGD_DNS
+#define _NMLOG(level, ...) __NMLOG_DEFAULT (level, _NMLOG_DOMAIN, "dns-helper", __VA_ARGS__)
+
+/*****************************************************************************/
+
+static gboolean
+_context_source_prepare (GSource *source, gint *timeout)
+{
+	ContextSource *s = (ContextSource *) source;
+	gboolean ready;
+	gint i;
+
+	for (i = 0; i < s->n_fds; i++)
+		g_source_remove_poll (source, &s->fds[i]);
+
+	ready = g_main_context_prepare (s->context, &s->max_priority);
+	for (;;) {
+		s->n_fds = g_main_context_query (s->context, s->max_priority, timeout,
+		                                 s->fds, s->n_fds_alloc);
+		if (s->n_fds <= s->n_fds_alloc)
+			break;
+		s->n_fds_alloc = s->n_fds;
+		s->fds = g_renew (GPollFD, s->fds, s->n_fds_alloc);
+	}
+
+	for (i = 0; i < s->n_fds; i++)
+		g_source_add_poll (source, &s->fds[i]);
+	return ready;
+}
+
+static gboolean
+_context_source_check (GSource *source)
+{
+	ContextSource *s = (ContextSource *) source;
+
+	return g_main_context_check (s->context, s->max_priority, s->fds, s->n_fds);
+}
+
+static gboolean
+_context_source_dispatch (GSource *source, GSourceFunc callback, gpointer user_data)
+{
+	ContextSource *s = (ContextSource *) source;
+
+	g_main_context_dispatch (s->context);
+	return G_SOURCE_CONTINUE;
+}
+
+static void
+_context_source_finalize (GSource *source)
+{
+	ContextSource *s = (ContextSource *) source;
+
+	g_free (s->fds);
+	g_main_context_release (s->context);
+	g_main_context_unref (s->context);
+}
+
+static GSourceFuncs context_source_funcs = {
+	.prepare = _context_source_prepare,
+	.check = _context_source_check,
+	.dispatch = _context_source_dispatch,
+	.finalize = _context_source_finalize,
+};
+
+/* Returns a source for the default context, that dispatches the sources
+ * of @context. */
+static GSource *
+_context_source_new (GMainContext *context)
+{
+	ContextSource *s;
+
+	s = (ContextSource *) g_source_new (&context_source_funcs, sizeof (ContextSource));
+	s->context = g_main_context_ref (context);
+	/* the default context iterates it from now on. */
+	if (!g_main_context_acquire (context))
+		g_return_val_if_reached (NULL);
+	return (GSource *) s;
+}
+
+static GSource *
+_source_attach (GSource *source, GMainContext *context, GSourceFunc func, gpointer user_data)
+{
+	g_source_set_callback (source, func, user_data, NULL);
+	g_source_attach (source, context);
+	return source;
+}
+
+static void
+_source_clear (GSource **p_source)
+{
+	if (*p_source) {
+		g_source_destroy (*p_source);
+		g_source_unref (*p_source);
+		*p_source = NULL;
+	}
+}
+
+/*****************************************************************************/
+
+static HelperJob *
+_job_new (NMDnsHelper *helper, const char *name, char **argv, char *input)
+{
+	HelperJob *job;
+
+	job = g_slice_new0 (HelperJob);
+	job->helper = helper;
+	job->name = name;
+	job->argv = argv;
+	job->input = input;
+	job->stdin_fd = -1;
+	return job;
+}
+
+static void
+_job_close_stdin (HelperJob *job)
+{
+	_source_clear (&job->stdin_source);
+	g_clear_pointer (&job->stdin_channel, g_io_channel_unref);
+	if (job->stdin_fd >= 0) {
+		close (job->stdin_fd);
+		job->stdin_fd = -1;
+	}
+}
+
+static void
+_job_free (HelperJob *job)
+{
+	if (!job)
+		return;
+
+	nm_assert (!job->watch_source);
+
+	_job_close_stdin (job);
+	g_strfreev (job->argv);
+	g_free (job->input);
+	g_slice_free (HelperJob, job);
+}
+
+/* Returns: %TRUE if all input was written, or writing it failed. */
+static gboolean
+_job_write_input (HelperJob *job)
+{
+	gsize len = strlen (job->input);
+
+	while (job->input_written < len) {
+		gssize n;
+
+		n = write (job->stdin_fd, &job->input[job->input_written], len - job->input_written);
+		if (n < 0) {
+			int errsv = errno;
+
+			if (errsv == EINTR)
+				continue;
+			if (NM_IN_SET (errsv, EAGAIN, EWOULDBLOCK))
+				return FALSE;
+			_LOGW ("failed to write to %s: %s", job->name, g_strerror (errsv));
+			break;
+		}
+		job->input_written += n;
+	}
+
+	_job_close_stdin (job);
+	return TRUE;
+}
+
+static gboolean
+_job_stdin_cb (GIOChannel *source, GIOCondition condition, gpointer user_data)
+{
+	HelperJob *job = user_data;
+	GSource *stdin_source = g_steal_pointer (&job->stdin_source);
+
+	if (!_job_write_input (job)) {
+		job->stdin_source = stdin_source;
+		return G_SOURCE_CONTINUE;
+	}
+	g_source_unref (stdin_source);
+	return G_SOURCE_REMOVE;
+}
+
+static gboolean
+_job_check_status (HelperJob *job, int status, GError **error)
+{
+	if (!WIFEXITED (status) || WEXITSTATUS (status) != EXIT_SUCCESS) {
+		g_set_error (error, NM_MANAGER_ERROR, NM_MANAGER_ERROR_FAILED,
+		             "Error calling %s: %s %d",
+		             job->name,
+		             WIFEXITED (status) ? "exited with status" : (WIFSIGNALED (status) ? "exited with signal" : "exited with unknown reason"),
+		             WIFEXITED (status) ? WEXITSTATUS (status) : (WIFSIGNALED (status) ? WTERMSIG (status) : status));
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static void _start_pending (NMDnsHelper *helper);
+
+static void
+_job_watch_cb (GPid pid, gint status, gpointer user_data)
+{
+	HelperJob *job = user_data;
+	NMDnsHelper *helper = job->helper;
+	GError *error = NULL;
+
+	nm_assert (job->pid == pid);
+
+	g_clear_pointer (&job->watch_source, g_source_unref);
+	g_spawn_close_pid (pid);
+	_job_close_stdin (job);
+
+	if (!helper) {
+		_LOGD ("%s exited after the helper was freed", job->name);
+		/* the private context isn't needed anymore. */
+		_source_clear (&job->context_source);
+		_job_free (job);
+		return;
+	}
+
+	nm_assert (helper->running == job);
+	helper->running = NULL;
+
+	if (_job_check_status (job, status, &error))
+		_LOGD ("%s finished", job->name);
+	helper->func (helper, job->name, error, helper->user_data);
+	g_clear_error (&error);
+	_job_free (job);
+
+	_start_pending (helper);
+}
+
+static gboolean
+_job_spawn (NMDnsHelper *helper, HelperJob *job, GError **error)
+{
+	gs_free char *cmd = NULL;
+	int fd = -1;
+
+	nm_assert (!helper->running);
+
+	_LOGD ("spawning '%s'",
+	       (cmd = g_strjoinv (" ", job->argv)));
+
+	if (!g_spawn_async_with_pipes (NULL, job->argv, NULL, G_SPAWN_DO_NOT_REAP_CHILD,
+	                               NULL, NULL, &job->pid,
+	                               job->input ? &fd : NULL, NULL, NULL, error))
+		return FALSE;
+
+	helper->running = job;
+	helper->n_spawned++;
+	job->watch_source = _source_attach (g_child_watch_source_new (job->pid), helper->context,
+	                                    (GSourceFunc) _job_watch_cb, job);
+
+	if (fd >= 0) {
+		job->stdin_fd = fd;
+		if (fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) | O_NONBLOCK) < 0) {
+			int errsv = errno;
+
+			_LOGW ("failed to write to %s: %s", job->name, g_strerror (errsv));
+			_job_close_stdin (job);
+		} else if (!_job_write_input (job)) {
+			/* the helper didn't read all input yet, don't wait for it. */
+			job->stdin_channel = g_io_channel_unix_new (fd);
+			job->stdin_source = _source_attach (g_io_create_watch (job->stdin_channel,
+			                                                       G_IO_OUT | G_IO_ERR | G_IO_HUP),
+			                                    helper->context,
+			                                    (GSourceFunc) _job_stdin_cb, job);
+		}
+	}
+
+	return TRUE;
+}
+
+static void
+_start_pending (NMDnsHelper *helper)
+{
+	HelperJob *job;
+	GError *error = NULL;
+
+	job = g_steal_pointer (&helper->pending);
+	if (!job)
+		return;
+
+	if (!_job_spawn (helper, job, &error)) {
+		helper->func (helper, job->name, error, helper->user_data);
+		g_clear_error (&error);
+		_job_free (job);
+	}
+}
+
+/*****************************************************************************/
+
+/**
+ * nm_dns_helper_queue:
+ * @helper: the #NMDnsHelper
+ * @name: the name of the job, for logging. It must stay valid.
+ * @argv: (transfer full): the command line
+ * @input: (transfer full) (allow-none): what to write to the helper's
+ *   standard input
+ * @error: the error when spawning fails
+ *
+ * Spawns the helper, or if one is still running, replaces the pending job.
+ *
+ * Returns: %TRUE if the job was started or queued. The result is passed
+ *   to the #NMDnsHelperFunc of @helper. On failure, @argv and @input
+ *   are freed.
+ */
+gboolean
+nm_dns_helper_queue (NMDnsHelper *helper,
+                     const char *name,
+                     char **argv,
+                     char *input,
+                     GError **error)
+{
+	HelperJob *job;
+
+	g_return_val_if_fail (helper, FALSE);
+	g_return_val_if_fail (name, FALSE);
+	g_return_val_if_fail (argv && argv[0], FALSE);
+
+	job = _job_new (helper, name, argv, input);
+
+	if (helper->running) {
+		if (helper->pending)
+			_LOGD ("%s still running, replace pending job", helper->running->name);
+		else
+			_LOGD ("%s still running, queue job", helper->running->name);
+		_job_free (helper->pending);
+		helper->pending = job;
+		return TRUE;
+	}
+
+	if (!_job_spawn (helper, job, error)) {
+		_job_free (job);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+gboolean
+nm_dns_helper_is_running (const NMDnsHelper *helper)
+{
+	g_return_val_if_fail (helper, FALSE);
+
+	return !!helper->running;
+}
+
+gboolean
+nm_dns_helper_has_pending (const NMDnsHelper *helper)
+{
+	g_return_val_if_fail (helper, FALSE);
+
+	return !!helper->pending;
+}
+
+/**
+ * nm_dns_helper_clear_pending:
+ * @helper: the #NMDnsHelper
+ *
+ * Drops the job that waits for the running helper. For example,
+ * because it is for a different helper than configured now.
+ */
+void
+nm_dns_helper_clear_pending (NMDnsHelper *helper)
+{
+	g_return_if_fail (helper);
+
+	if (helper->pending) {
+		_LOGD ("drop pending %s job", helper->pending->name);
+		g_clear_pointer (&helper->pending, _job_free);
+	}
+}
+
+static gboolean
+_flush_timeout_cb (gpointer user_data)
+{
+	*((gboolean *) user_data) = TRUE;
+	return G_SOURCE_REMOVE;
+}
+
+/* Iterates the private context until the running job exits, at most for
+ * FLUSH_TIMEOUT_MSEC. Returns %FALSE on timeout. */
+static gboolean
+_flush_wait (NMDnsHelper *helper)
+{
+	guint64 n_spawned = helper->n_spawned;
+	gboolean timed_out = FALSE;
+	GSource *timeout_source;
+
+	timeout_source = _source_attach (g_timeout_source_new (FLUSH_TIMEOUT_MSEC), helper->context,
+	                                 _flush_timeout_cb, &timed_out);
+	while (   helper->running
+	       && helper->n_spawned == n_spawned
+	       && !timed_out)
+		g_main_context_iteration (helper->context, TRUE);
+	_source_clear (&timeout_source);
+
+	return !timed_out;
+}
+
+/**
+ * nm_dns_helper_flush_sync:
+ * @helper: the #NMDnsHelper
+ *
+ * Waits for the running helper and the pending job. Used on shutdown,
+ * where the mainloop no longer runs. Only the private context of @helper
+ * is iterated, the child watch still reaps the helpers. Helpers that take
+ * too long are killed, and given up on if they don't exit after that.
+ */
+void
+nm_dns_helper_flush_sync (NMDnsHelper *helper)
+{
+	g_return_if_fail (helper);
+
+	while (helper->running) {
+		HelperJob *job = helper->running;
+
+		if (_flush_wait (helper))
+			continue;
+
+		_LOGW ("%s did not exit in time, kill it", job->name);
+		kill (job->pid, SIGKILL);
+		if (_flush_wait (helper))
+			continue;
+
+		_LOGW ("%s did not exit after being killed, give up", job->name);
+		g_clear_pointer (&helper->pending, _job_free);
+		break;
+	}
+}
+
+/*****************************************************************************/
+
+NMDnsHelper *
+nm_dns_helper_new (NMDnsHelperFunc func, gpointer user_data)
+{
+	NMDnsHelper *helper;
+
+	g_return_val_if_fail (func, NULL);
+
+	helper = g_slice_new0 (NMDnsHelper);
+	helper->func = func;
+	helper->user_data = user_data;
+	helper->context = g_main_context_new ();
+	helper->context_source = _context_source_new (helper->context);
+	g_source_attach (helper->context_source, NULL);
+	return helper;
+}
+
+/**
+ * nm_dns_helper_free:
+ * @helper: the #NMDnsHelper
+ *
+ * Drops the pending job and terminates the running helper. It is
+ * reaped in the background.
+ */
+void
+nm_dns_helper_free (NMDnsHelper *helper)
+{
+	HelperJob *job;
+
+	if (!helper)
+		return;
+
+	g_clear_pointer (&helper->pending, _job_free);
+
+	job = g_steal_pointer (&helper->running);
+	if (job) {
+		_LOGD ("terminate %s", job->name);
+		job->helper = NULL;
+		job->context_source = g_steal_pointer (&helper->context_source);
+		_job_close_stdin (job);
+		kill (job->pid, SIGTERM);
+	}
+
+	_source_clear (&helper->context_source);
+	g_main_context_unref (helper->context);
+	g_slice_free (NMDnsHelper, helper);
+}
@@ -0,0 +1,50 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/* NetworkManager -- Network link manager
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright 2017 Red Hat, Inc.
+ */
+
+#ifndef __NM_DNS_HELPER_H__
+#define __NM_DNS_HELPER_H__
+
+/*****************************************************************************/
+
+typedef struct _NMDnsHelper NMDnsHelper;
+
+/* called once a job is done. @error is %NULL if the helper exited
+ * successfully. */
+typedef void (*NMDnsHelperFunc) (NMDnsHelper *helper,
+                                 const char *name,
+                                 GError *error,
+                                 gpointer user_data);
+
+NMDnsHelper *nm_dns_helper_new (NMDnsHelperFunc func, gpointer user_data);
+void nm_dns_helper_free (NMDnsHelper *helper);
+
+gboolean nm_dns_helper_queue (NMDnsHelper *helper,
+                              const char *name,
+                              char **argv,
+                              char *input,
+                              GError **error);
+
+gboolean nm_dns_helper_is_running (const NMDnsHelper *helper);
+gboolean nm_dns_helper_has_pending (const NMDnsHelper *helper);
+
+void nm_dns_helper_clear_pending (NMDnsHelper *helper);
+void nm_dns_helper_flush_sync (NMDnsHelper *helper);
+
+#endif /* __NM_DNS_HELPER_H__ */
@@ -53,6 +53,8 @@
 #include "nm-dns-dnsmasq.h"
 #include "nm-dns-systemd-resolved.h"
 #include "nm-dns-unbound.h"
+#include "nm-dns-stub.h"
+#include "nm-dns-helper.h"
 
 #include "introspection/org.freedesktop.NetworkManager.DnsManager.h"
 
@@ -80,6 +82,7 @@ NM_GOBJECT_PROPERTIES_DEFINE (NMDnsManager,
 	PROP_MODE,
 	PROP_RC_MANAGER,
 	PROP_CONFIGURATION,
+	PROP_COLLAPSED_UPDATES,
 );
 
 static guint signals[LAST_SIGNAL] = { 0 };
@@ -87,7 +90,11 @@ static guint signals[LAST_SIGNAL] = { 0 };
 typedef enum {
 	SR_SUCCESS,
 	SR_NOTFOUND,
-	SR_ERROR
+	SR_ERROR,
+
+	/* the helper was started (or queued) in the background. The
+	 * result is only known once it exits. */
+	SR_PENDING,
 } SpawnResult;
 
 NM_DEFINE_SINGLETON_GETTER (NMDnsManager, nm_dns_manager_get, NM_TYPE_DNS_MANAGER);
@@ -117,11 +124,14 @@ NM_DEFINE_SINGLETON_GETTER (NMDnsManager, nm_dns_manager_get, NM_TYPE_DNS_MANAGE
 /*****************************************************************************/
 
 typedef struct {
+	/* the configurations, kept sorted by ip_config_data_compare(). */
 	GPtrArray *configs;
+	/* index of @configs by their NMIP4Config/NMIP6Config. */
+	GHashTable *configs_idx;
+	guint64 configs_seq;
 	GVariant *config_variant;
 	NMDnsIPConfigData *best_conf4, *best_conf6;
 
-	bool need_sort:1;
 	bool dns_touched:1;
 	bool is_stopped:1;
 
@@ -142,6 +152,22 @@ typedef struct {
 		guint num_restarts;
 		guint timer;
 	} plugin_ratelimit;
+
+	struct {
+		/* the configured window and upper bound, in msec. */
+		guint window;
+		guint max;
+		guint timer;
+		/* timestamp of the first change not yet committed. */
+		gint64 first_ts;
+		/* the number of changes that were merged into a
+		 * following update. */
+		guint64 num_collapsed;
+		guint64 num_collapsed_notified;
+	} debounce;
+
+	/* runs resolvconf and netconfig. */
+	NMDnsHelper *helper;
 } NMDnsManagerPrivate;
 
 struct _NMDnsManager {
@@ -177,6 +203,15 @@ typedef struct {
 	GPtrArray *options;
 	const char *nis_domain;
 	GPtrArray *nis_servers;
+
+	/* the items of the arrays above, to skip duplicates without
+	 * scanning the arrays. The strings are owned by the arrays. */
+	GHashTable *nameservers_idx;
+	GHashTable *searches_idx;
+	GHashTable *options_idx;
+	GHashTable *nis_servers_idx;
+	/* the names of the options added via add_dns_option_item(). */
+	GHashTable *option_names_idx;
 } NMResolvConfData;
 
 NM_UTILS_LOOKUP_STR_DEFINE_STATIC (_rc_manager_to_string, NMDnsManagerResolvConfManager,
@@ -239,15 +274,10 @@ ip_config_data_destroy (gpointer ptr)
 static gint
 ip_config_data_compare (const NMDnsIPConfigData *a, const NMDnsIPConfigData *b)
 {
-	int a_prio, b_prio;
-
-	a_prio = nm_dns_ip_config_data_get_dns_priority (a);
-	b_prio = nm_dns_ip_config_data_get_dns_priority (b);
-
 	/* Configurations with lower priority value first */
-	if (a_prio < b_prio)
+	if (a->_priority < b->_priority)
 		return -1;
-	else if (a_prio > b_prio)
+	else if (a->_priority > b->_priority)
 		return 1;
 
 	/* Sort also according to type */
@@ -256,42 +286,91 @@ ip_config_data_compare (const NMDnsIPConfigData *a, const NMDnsIPConfigData *b)
 	else if (a->type < b->type)
 		return 1;
 
+	/* Otherwise, in the order they were added. This makes the order
+	 * total, so that every entry can be found by bisection. */
+	if (a->_seq < b->_seq)
+		return -1;
+	else if (a->_seq > b->_seq)
+		return 1;
+
 	return 0;
 }
 
-static gint
-ip_config_data_ptr_compare (gconstpointer a, gconstpointer b)
+static guint
+_configs_bisect (const GPtrArray *configs, const NMDnsIPConfigData *data)
 {
-	const NMDnsIPConfigData *const *ptr_a = a, *const *ptr_b = b;
+	guint lo = 0, hi = configs->len;
 
-	return ip_config_data_compare (*ptr_a, *ptr_b);
+	while (lo < hi) {
+		guint mid = lo + (hi - lo) / 2;
+
+		if (ip_config_data_compare (configs->pdata[mid], data) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
 }
 
 static void
-add_string_item (GPtrArray *array, const char *str)
+_configs_link (GPtrArray *configs, NMDnsIPConfigData *data)
 {
-	int i;
+	guint idx;
+
+	data->_priority = nm_dns_ip_config_data_get_dns_priority (data);
+
+	idx = _configs_bisect (configs, data);
+	g_ptr_array_add (configs, data);
+	memmove (&configs->pdata[idx + 1],
+	         &configs->pdata[idx],
+	         (configs->len - 1 - idx) * sizeof (gpointer));
+	configs->pdata[idx] = data;
+}
+
+static void
+_configs_unlink (GPtrArray *configs, NMDnsIPConfigData *data)
+{
+	guint idx;
+
+	/* this relies on the sort key being unchanged since _configs_link(). */
+	idx = _configs_bisect (configs, data);
+	g_return_if_fail (idx < configs->len && configs->pdata[idx] == data);
+	g_ptr_array_remove_index (configs, idx);
+}
+
+static void
+add_string_item (GPtrArray *array, GHashTable *idx, const char *str)
+{
+	char *item;
 
 	g_return_if_fail (array != NULL);
 	g_return_if_fail (str != NULL);
 
 	/* Check for dupes before adding */
-	for (i = 0; i < array->len; i++) {
-		const char *candidate = g_ptr_array_index (array, i);
-
-		if (candidate && !strcmp (candidate, str))
-			return;
-	}
+	if (g_hash_table_contains (idx, str))
+		return;
 
 	/* No dupes, add the new item */
-	g_ptr_array_add (array, g_strdup (str));
+	item = g_strdup (str);
+	g_ptr_array_add (array, item);
+	g_hash_table_add (idx, item);
 }
 
 static void
-add_dns_option_item (GPtrArray *array, const char *str, gboolean ipv6)
+add_dns_option_item (NMResolvConfData *rc, const char *str, gboolean ipv6)
 {
-	if (_nm_utils_dns_option_find_idx (array, str) < 0)
-		g_ptr_array_add (array, g_strdup (str));
+	char *name;
+
+	/* like _nm_utils_dns_option_find_idx(), options are compared by
+	 * their name only. Invalid options never match. */
+	if (_nm_utils_dns_option_validate (str, &name, NULL, FALSE, NULL)) {
+		if (g_hash_table_contains (rc->option_names_idx, name)) {
+			g_free (name);
+			return;
+		}
+		g_hash_table_add (rc->option_names_idx, name);
+	}
+	g_ptr_array_add (rc->options, g_strdup (str));
 }
 
 static void
@@ -301,7 +380,7 @@ merge_one_ip4_config (NMResolvConfData *rc, NMIP4Config *src)
 
 	num = nm_ip4_config_get_num_nameservers (src);
 	for (i = 0; i < num; i++) {
-		add_string_item (rc->nameservers,
+		add_string_item (rc->nameservers, rc->nameservers_idx,
 		                 nm_utils_inet4_ntop (nm_ip4_config_get_nameserver (src, i), NULL));
 	}
 
@@ -314,7 +393,7 @@ merge_one_ip4_config (NMResolvConfData *rc, NMIP4Config *src)
 		search = nm_ip4_config_get_search (src, i);
 		if (!domain_is_valid (search, FALSE))
 			continue;
-		add_string_item (rc->searches, search);
+		add_string_item (rc->searches, rc->searches_idx, search);
 	}
 
 	if (num_domains > 1 || !num_searches) {
@@ -324,7 +403,7 @@ merge_one_ip4_config (NMResolvConfData *rc, NMIP4Config *src)
 			domain = nm_ip4_config_get_domain (src, i);
 			if (!domain_is_valid (domain, FALSE))
 				continue;
-			add_string_item (rc->searches, domain);
+			add_string_item (rc->searches, rc->searches_idx, domain);
 		}
 	}
 
@@ -333,13 +412,13 @@ merge_one_ip4_config (NMResolvConfData *rc, NMIP4Config *src)
 		const char *option;
 
 		option = nm_ip4_config_get_dns_option (src, i);
-		add_dns_option_item (rc->options, option, FALSE);
+		add_dns_option_item (rc, option, FALSE);
 	}
 
 	/* NIS stuff */
 	num = nm_ip4_config_get_num_nis_servers (src);
 	for (i = 0; i < num; i++) {
-		add_string_item (rc->nis_servers,
+		add_string_item (rc->nis_servers, rc->nis_servers_idx,
 		                 nm_utils_inet4_ntop (nm_ip4_config_get_nis_server (src, i), NULL));
 	}
 
@@ -372,7 +451,7 @@ merge_one_ip6_config (NMResolvConfData *rc, NMIP6Config *src, const char *iface)
 				g_strlcat (buf, iface, sizeof (buf));
 			}
 		}
-		add_string_item (rc->nameservers, buf);
+		add_string_item (rc->nameservers, rc->nameservers_idx, buf);
 	}
 
 	num_domains = nm_ip6_config_get_num_domains (src);
@@ -384,7 +463,7 @@ merge_one_ip6_config (NMResolvConfData *rc, NMIP6Config *src, const char *iface)
 		search = nm_ip6_config_get_search (src, i);
 		if (!domain_is_valid (search, FALSE))
 			continue;
-		add_string_item (rc->searches, search);
+		add_string_item (rc->searches, rc->searches_idx, search);
 	}
 
 	if (num_domains > 1 || !num_searches) {
@@ -394,7 +473,7 @@ merge_one_ip6_config (NMResolvConfData *rc, NMIP6Config *src, const char *iface)
 			domain = nm_ip6_config_get_domain (src, i);
 			if (!domain_is_valid (domain, FALSE))
 				continue;
-			add_string_item (rc->searches, domain);
+			add_string_item (rc->searches, rc->searches_idx, domain);
 		}
 	}
 
@@ -403,7 +482,7 @@ merge_one_ip6_config (NMResolvConfData *rc, NMIP6Config *src, const char *iface)
 		const char *option;
 
 		option = nm_ip6_config_get_dns_option (src, i);
-		add_dns_option_item (rc->options, option, TRUE);
+		add_dns_option_item (rc, option, TRUE);
 	}
 }
 
@@ -419,105 +498,6 @@ merge_one_ip_config_data (NMResolvConfData *rc,
 		g_return_if_reached ();
 }
 
-static GPid
-run_netconfig (NMDnsManager *self, GError **error, gint *stdin_fd)
-{
-	char *argv[5];
-	gs_free char *tmp = NULL;
-	GPid pid = -1;
-
-	argv[0] = NETCONFIG_PATH;
-	argv[1] = "modify";
-	argv[2] = "--service";
-	argv[3] = "NetworkManager";
-	argv[4] = NULL;
-
-	_LOGD ("spawning '%s'",
-	       (tmp = g_strjoinv (" ", argv)));
-
-	if (!g_spawn_async_with_pipes (NULL, argv, NULL, G_SPAWN_DO_NOT_REAP_CHILD, NULL,
-	                               NULL, &pid, stdin_fd, NULL, NULL, error))
-		return -1;
-
-	return pid;
-}
-
-static void
-write_to_netconfig (NMDnsManager *self, gint fd, const char *key, const char *value)
-{
-	char *str;
-	int x;
-
-	str = g_strdup_printf ("%s='%s'\n", key, value);
-	_LOGD ("writing to netconfig: %s", str);
-	x = write (fd, str, strlen (str));
-	g_free (str);
-}
-
-static SpawnResult
-dispatch_netconfig (NMDnsManager *self,
-                    char **searches,
-                    char **nameservers,
-                    const char *nis_domain,
-                    char **nis_servers,
-                    GError **error)
-{
-	char *str;
-	GPid pid;
-	gint fd;
-	int status;
-
-	pid = run_netconfig (self, error, &fd);
-	if (pid <= 0)
-		return SR_NOTFOUND;
-
-	/* NM is writing already-merged DNS information to netconfig, so it
-	 * does not apply to a specific network interface.
-	 */
-	write_to_netconfig (self, fd, "INTERFACE", "NetworkManager");
-
-	if (searches) {
-		str = g_strjoinv (" ", searches);
-		write_to_netconfig (self, fd, "DNSSEARCH", str);
-		g_free (str);
-	}
-
-	if (nameservers) {
-		str = g_strjoinv (" ", nameservers);
-		write_to_netconfig (self, fd, "DNSSERVERS", str);
-		g_free (str);
-	}
-
-	if (nis_domain)
-		write_to_netconfig (self, fd, "NISDOMAIN", nis_domain);
-
-	if (nis_servers) {
-		str = g_strjoinv (" ", nis_servers);
-		write_to_netconfig (self, fd, "NISSERVERS", str);
-		g_free (str);
-	}
-
-	close (fd);
-
-	/* Wait until the process exits */
-	if (!nm_utils_kill_child_sync (pid, 0, LOGD_DNS, "netconfig", &status, 1000, 0)) {
-		int errsv = errno;
-
-		g_set_error (error, NM_MANAGER_ERROR, NM_MANAGER_ERROR_FAILED,
-		             "Error waiting for netconfig to exit: %s",
-		             strerror (errsv));
-		return SR_ERROR;
-	}
-	if (!WIFEXITED (status) || WEXITSTATUS (status) != EXIT_SUCCESS) {
-		g_set_error (error, NM_MANAGER_ERROR, NM_MANAGER_ERROR_FAILED,
-		             "Error calling netconfig: %s %d",
-		             WIFEXITED (status) ? "exited with status" : (WIFSIGNALED (status) ? "exited with signal" : "exited with unknown reason"),
-		             WIFEXITED (status) ? WEXITSTATUS (status) : (WIFSIGNALED (status) ? WTERMSIG (status) : status));
-		return SR_ERROR;
-	}
-	return SR_SUCCESS;
-}
-
 static char *
 create_resolv_conf (char **searches,
                     char **nameservers,
@@ -589,17 +569,104 @@ write_resolv_conf_contents (FILE *f,
 	return TRUE;
 }
 
-static gboolean
-write_resolv_conf (FILE *f,
-                   char **searches,
-                   char **nameservers,
-                   char **options,
-                   GError **error)
+/*****************************************************************************/
+
+/* resolvconf and netconfig are spawned in the background, see
+ * nm-dns-helper.c. */
+static void
+_helper_done_cb (NMDnsHelper *helper,
+                 const char *name,
+                 GError *error,
+                 gpointer user_data)
 {
-	gs_free char *content = NULL;
+	NMDnsManager *self = user_data;
 
-	content = create_resolv_conf (searches, nameservers, options);
-	return write_resolv_conf_contents (f, content, error);
+	if (error) {
+		_LOGW ("could not commit DNS changes: %s", error->message);
+		return;
+	}
+
+	/* a newer configuration is already waiting. Only signal once it
+	 * was committed too. */
+	if (!nm_dns_helper_has_pending (helper))
+		g_signal_emit (self, signals[CONFIG_CHANGED], 0);
+}
+
+static SpawnResult
+_helper_queue (NMDnsManager *self, const char *name, char **argv, char *input, GError **error)
+{
+	NMDnsManagerPrivate *priv = NM_DNS_MANAGER_GET_PRIVATE (self);
+
+	if (!priv->helper)
+		priv->helper = nm_dns_helper_new (_helper_done_cb, self);
+
+	if (!nm_dns_helper_queue (priv->helper, name, argv, input, error))
+		return SR_ERROR;
+	return SR_PENDING;
+}
+
+static void
+_helper_netconfig_append (NMDnsManager *self, GString *str, const char *key, const char *value)
+{
+	_LOGD ("writing to netconfig: %s='%s'", key, value);
+	g_string_append_printf (str, "%s='%s'\n", key, value);
+}
+
+static SpawnResult
+dispatch_netconfig (NMDnsManager *self,
+                    char **searches,
+                    char **nameservers,
+                    const char *nis_domain,
+                    char **nis_servers,
+                    GError **error)
+{
+	GString *str;
+	char **argv;
+
+	if (!g_file_test (NETCONFIG_PATH, G_FILE_TEST_IS_EXECUTABLE)) {
+		g_set_error_literal (error,
+		                     NM_MANAGER_ERROR,
+		                     NM_MANAGER_ERROR_FAILED,
+		                     NETCONFIG_PATH " is not executable");
+		return SR_NOTFOUND;
+	}
+
+	str = g_string_new (NULL);
+
+	/* NM is writing already-merged DNS information to netconfig, so it
+	 * does not apply to a specific network interface.
+	 */
+	_helper_netconfig_append (self, str, "INTERFACE", "NetworkManager");
+
+	if (searches) {
+		gs_free char *tmp = g_strjoinv (" ", searches);
+
+		_helper_netconfig_append (self, str, "DNSSEARCH", tmp);
+	}
+
+	if (nameservers) {
+		gs_free char *tmp = g_strjoinv (" ", nameservers);
+
+		_helper_netconfig_append (self, str, "DNSSERVERS", tmp);
+	}
+
+	if (nis_domain)
+		_helper_netconfig_append (self, str, "NISDOMAIN", nis_domain);
+
+	if (nis_servers) {
+		gs_free char *tmp = g_strjoinv (" ", nis_servers);
+
+		_helper_netconfig_append (self, str, "NISSERVERS", tmp);
+	}
+
+	argv = g_new (char *, 5);
+	argv[0] = g_strdup (NETCONFIG_PATH);
+	argv[1] = g_strdup ("modify");
+	argv[2] = g_strdup ("--service");
+	argv[3] = g_strdup ("NetworkManager");
+	argv[4] = NULL;
+
+	return _helper_queue (self, "netconfig", argv, g_string_free (str, FALSE), error);
 }
 
 static SpawnResult
@@ -609,12 +676,8 @@ dispatch_resolvconf (NMDnsManager *self,
                      char **options,
                      GError **error)
 {
-	gs_free char *cmd = NULL;
-	FILE *f;
-	gboolean success = FALSE;
-	int errnosv, err;
-	char *argv[] = { RESOLVCONF_PATH, "-d", "NetworkManager", NULL };
-	int status;
+	char **argv;
+	char *input = NULL;
 
 	if (!g_file_test (RESOLVCONF_PATH, G_FILE_TEST_IS_EXECUTABLE)) {
 		g_set_error_literal (error,
@@ -624,54 +687,21 @@ dispatch_resolvconf (NMDnsManager *self,
 		return SR_NOTFOUND;
 	}
 
+	argv = g_new (char *, 4);
+	argv[0] = g_strdup (RESOLVCONF_PATH);
+	argv[2] = g_strdup ("NetworkManager");
+	argv[3] = NULL;
+
 	if (!searches && !nameservers) {
 		_LOGI ("Removing DNS information from %s", RESOLVCONF_PATH);
-
-		if (!g_spawn_sync ("/", argv, NULL, 0, NULL, NULL, NULL, NULL, &status, error))
-			return SR_ERROR;
-
-		if (status != 0) {
-			g_set_error (error,
-			             NM_MANAGER_ERROR,
-			             NM_MANAGER_ERROR_FAILED,
-			             "%s returned error code",
-			             RESOLVCONF_PATH);
-			return SR_ERROR;
-		}
-
-		return SR_SUCCESS;
-	}
-
-	_LOGI ("Writing DNS information to %s", RESOLVCONF_PATH);
-
-	cmd = g_strconcat (RESOLVCONF_PATH, " -a ", "NetworkManager", NULL);
-	if ((f = popen (cmd, "w")) == NULL) {
-		g_set_error (error,
-		             NM_MANAGER_ERROR,
-		             NM_MANAGER_ERROR_FAILED,
-		             "Could not write to %s: %s",
-		             RESOLVCONF_PATH,
-		             g_strerror (errno));
-		return SR_ERROR;
-	}
-
-	success = write_resolv_conf (f, searches, nameservers, options, error);
-	err = pclose (f);
-	if (err < 0) {
-		errnosv = errno;
-		g_clear_error (error);
-		g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errnosv),
-		             "Failed to close pipe to resolvconf: %d", errnosv);
-		return SR_ERROR;
-	} else if (err > 0) {
-		_LOGW ("resolvconf failed with status %d", err);
-		g_clear_error (error);
-		g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
-		             "resolvconf failed with status %d", err);
-		return SR_ERROR;
+		argv[1] = g_strdup ("-d");
+	} else {
+		_LOGI ("Writing DNS information to %s", RESOLVCONF_PATH);
+		argv[1] = g_strdup ("-a");
+		input = create_resolv_conf (searches, nameservers, options);
 	}
 
-	return success ? SR_SUCCESS : SR_ERROR;
+	return _helper_queue (self, "resolvconf", argv, input, error);
 }
 
 static const char *
@@ -924,17 +954,17 @@ merge_global_dns_config (NMResolvConfData *rc, NMGlobalDnsConfig *global_conf)
 
 	for (i = 0; searches && searches[i]; i++) {
 		if (domain_is_valid (searches[i], FALSE))
-			add_string_item (rc->searches, searches[i]);
+			add_string_item (rc->searches, rc->searches_idx, searches[i]);
 	}
 
 	for (i = 0; options && options[i]; i++)
-		add_string_item (rc->options, options[i]);
+		add_string_item (rc->options, rc->options_idx, options[i]);
 
 	default_domain = nm_global_dns_config_lookup_domain (global_conf, "*");
 	g_assert (default_domain);
 	servers = nm_global_dns_domain_get_servers (default_domain);
 	for (i = 0; servers && servers[i]; i++)
-		add_string_item (rc->nameservers, servers[i]);
+		add_string_item (rc->nameservers, rc->nameservers_idx, servers[i]);
 
 	return TRUE;
 }
@@ -1003,6 +1033,11 @@ _collect_resolv_conf_data (NMDnsManager *self, /* only for logging context, no o
 		.options = g_ptr_array_new (),
 		.nis_domain = NULL,
 		.nis_servers = g_ptr_array_new (),
+		.nameservers_idx = g_hash_table_new (g_str_hash, g_str_equal),
+		.searches_idx = g_hash_table_new (g_str_hash, g_str_equal),
+		.options_idx = g_hash_table_new (g_str_hash, g_str_equal),
+		.nis_servers_idx = g_hash_table_new (g_str_hash, g_str_equal),
+		.option_names_idx = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL),
 	};
 
 	if (global_config)
@@ -1056,9 +1091,9 @@ _collect_resolv_conf_data (NMDnsManager *self, /* only for logging context, no o
 		    && !nm_utils_ipaddr_valid (AF_UNSPEC, hostname)) {
 			hostdomain++;
 			if (domain_is_valid (hostdomain, TRUE))
-				add_string_item (rc.searches, hostdomain);
+				add_string_item (rc.searches, rc.searches_idx, hostdomain);
 			else if (domain_is_valid (hostname, TRUE))
-				add_string_item (rc.searches, hostname);
+				add_string_item (rc.searches, rc.searches_idx, hostname);
 		}
 	}
 
@@ -1073,6 +1108,12 @@ _collect_resolv_conf_data (NMDnsManager *self, /* only for logging context, no o
 	}
 	g_ptr_array_set_size (rc.searches, i);
 
+	g_hash_table_unref (rc.nameservers_idx);
+	g_hash_table_unref (rc.searches_idx);
+	g_hash_table_unref (rc.options_idx);
+	g_hash_table_unref (rc.nis_servers_idx);
+	g_hash_table_unref (rc.option_names_idx);
+
 	*out_searches = _ptrarray_to_strv (rc.searches);
 	*out_options = _ptrarray_to_strv (rc.options);
 	*out_nameservers = _ptrarray_to_strv (rc.nameservers);
@@ -1108,6 +1149,10 @@ update_dns (NMDnsManager *self,
 
 	nm_clear_g_source (&priv->plugin_ratelimit.timer);
 
+	/* this update also commits any change that is still being debounced. */
+	nm_clear_g_source (&priv->debounce.timer);
+	priv->debounce.first_ts = 0;
+
 	if (NM_IN_SET (priv->rc_manager, NM_DNS_MANAGER_RESOLV_CONF_MAN_UNMANAGED,
 	                                 NM_DNS_MANAGER_RESOLV_CONF_MAN_IMMUTABLE)) {
 		update = FALSE;
@@ -1120,11 +1165,6 @@ update_dns (NMDnsManager *self,
 	data = nm_config_get_data (priv->config);
 	global_config = nm_config_data_get_global_dns_config (data);
 
-	if (priv->need_sort) {
-		g_ptr_array_sort (priv->configs, ip_config_data_ptr_compare);
-		priv->need_sort = FALSE;
-	}
-
 	/* Update hash with config we're applying */
 	compute_hash (self, global_config, priv->hash);
 
@@ -1207,14 +1247,21 @@ update_dns (NMDnsManager *self,
 	if (!resolv_conf_updated)
 		update_resolv_conf (self, searches, nameservers, options, NULL, NM_DNS_MANAGER_RESOLV_CONF_MAN_UNMANAGED);
 
-	/* signal that resolv.conf was changed */
+	/* signal that resolv.conf was changed. For helpers that still run
+	 * in the background, this happens once they exit. */
 	if (update && result == SR_SUCCESS)
 		g_signal_emit (self, signals[CONFIG_CHANGED], 0);
 
 	g_clear_pointer (&priv->config_variant, g_variant_unref);
 	_notify (self, PROP_CONFIGURATION);
 
-	return !update || result == SR_SUCCESS;
+	/* notify once per update, not for every collapsed change. */
+	if (priv->debounce.num_collapsed_notified != priv->debounce.num_collapsed) {
+		priv->debounce.num_collapsed_notified = priv->debounce.num_collapsed;
+		_notify (self, PROP_COLLAPSED_UPDATES);
+	}
+
+	return !update || NM_IN_SET (result, SR_SUCCESS, SR_PENDING);
 }
 
 static void
@@ -1282,7 +1329,79 @@ ip_config_dns_priority_changed (gpointer config,
                                 GParamSpec *pspec,
                                 NMDnsManager *self)
 {
-	NM_DNS_MANAGER_GET_PRIVATE (self)->need_sort = TRUE;
+	NMDnsManagerPrivate *priv = NM_DNS_MANAGER_GET_PRIVATE (self);
+	NMDnsIPConfigData *data;
+
+	data = g_hash_table_lookup (priv->configs_idx, config);
+	if (   !data
+	    || data->_priority == nm_dns_ip_config_data_get_dns_priority (data))
+		return;
+
+	_configs_unlink (priv->configs, data);
+	_configs_link (priv->configs, data);
+}
+
+static gboolean
+_debounce_cb (gpointer user_data)
+{
+	NMDnsManager *self = user_data;
+	NMDnsManagerPrivate *priv = NM_DNS_MANAGER_GET_PRIVATE (self);
+	GError *error = NULL;
+
+	priv->debounce.timer = 0;
+
+	_LOGD ("update-dns: committing changes after %lld msec (%llu changes collapsed so far)",
+	       (long long) (nm_utils_get_monotonic_timestamp_ms () - priv->debounce.first_ts),
+	       (unsigned long long) priv->debounce.num_collapsed);
+
+	if (!update_dns (self, FALSE, &error)) {
+		_LOGW ("could not commit DNS changes: %s", error->message);
+		g_clear_error (&error);
+	}
+	return G_SOURCE_REMOVE;
+}
+
+static void
+_update_dns_schedule (NMDnsManager *self)
+{
+	NMDnsManagerPrivate *priv = NM_DNS_MANAGER_GET_PRIVATE (self);
+	GError *error = NULL;
+	gint64 now, deadline;
+
+	/* a batch commits its changes in end_updates(). */
+	if (priv->updates_queue)
+		return;
+
+	if (!priv->debounce.window) {
+		if (!update_dns (self, FALSE, &error)) {
+			_LOGW ("could not commit DNS changes: %s", error->message);
+			g_clear_error (&error);
+		}
+		return;
+	}
+
+	now = nm_utils_get_monotonic_timestamp_ms ();
+	if (!priv->debounce.first_ts)
+		priv->debounce.first_ts = now;
+	else
+		priv->debounce.num_collapsed++;
+
+	/* every change restarts the window, but the first pending change
+	 * is never delayed by more than the configured maximum. */
+	deadline = MIN (now + priv->debounce.window,
+	                priv->debounce.first_ts + priv->debounce.max);
+
+	nm_clear_g_source (&priv->debounce.timer);
+	priv->debounce.timer = g_timeout_add (MAX (deadline - now, 0), _debounce_cb, self);
+}
+
+static void
+_debounce_init (NMDnsManager *self, NMConfigData *config_data)
+{
+	NMDnsManagerPrivate *priv = NM_DNS_MANAGER_GET_PRIVATE (self);
+
+	priv->debounce.window = nm_config_data_get_dns_debounce (config_data);
+	priv->debounce.max = nm_config_data_get_dns_debounce_max (config_data);
 }
 
 static void
@@ -1305,10 +1424,8 @@ nm_dns_manager_add_ip_config (NMDnsManager *self,
                               NMDnsIPConfigType cfg_type)
 {
 	NMDnsManagerPrivate *priv;
-	GError *error = NULL;
 	NMDnsIPConfigData *data;
 	gboolean v4 = NM_IS_IP4_CONFIG (config);
-	guint i;
 
 	g_return_val_if_fail (NM_IS_DNS_MANAGER (self), FALSE);
 	g_return_val_if_fail (config, FALSE);
@@ -1316,46 +1433,42 @@ nm_dns_manager_add_ip_config (NMDnsManager *self,
 
 	priv = NM_DNS_MANAGER_GET_PRIVATE (self);
 
-	for (i = 0; i < priv->configs->len; i++) {
-		data = priv->configs->pdata[i];
-		if (data->config == config) {
-			if (   nm_streq (data->iface, iface)
-			    && data->type == cfg_type)
-				return FALSE;
-			else {
-				forget_data (self, data);
-				g_ptr_array_remove_index_fast (priv->configs, i);
-				break;
-			}
-		}
+	data = g_hash_table_lookup (priv->configs_idx, config);
+	if (data) {
+		if (   nm_streq (data->iface, iface)
+		    && data->type == cfg_type)
+			return FALSE;
+
+		forget_data (self, data);
+		_configs_unlink (priv->configs, data);
+		g_hash_table_remove (priv->configs_idx, config);
+		ip_config_data_destroy (data);
 	}
 
 	data = ip_config_data_new (config, cfg_type, iface);
-	g_ptr_array_add (priv->configs, data);
+	data->_seq = ++priv->configs_seq;
+	_configs_link (priv->configs, data);
+	g_hash_table_insert (priv->configs_idx, config, data);
 	g_signal_connect (config,
 	                  v4 ?
 	                    "notify::" NM_IP4_CONFIG_DNS_PRIORITY :
 	                    "notify::" NM_IP6_CONFIG_DNS_PRIORITY,
 	                  (GCallback) ip_config_dns_priority_changed, self);
-	priv->need_sort = TRUE;
 
 	if (cfg_type == NM_DNS_IP_CONFIG_TYPE_BEST_DEVICE) {
+		NMDnsIPConfigData **best = v4 ? &priv->best_conf4 : &priv->best_conf6;
+
 		/* Only one best-device per IP version is allowed */
-		if (v4) {
-			if (priv->best_conf4)
-				priv->best_conf4->type = NM_DNS_IP_CONFIG_TYPE_DEFAULT;
-			priv->best_conf4 = data;
-		} else {
-			if (priv->best_conf6)
-				priv->best_conf6->type = NM_DNS_IP_CONFIG_TYPE_DEFAULT;
-			priv->best_conf6 = data;
+		if (*best) {
+			/* the type is part of the sort key. */
+			_configs_unlink (priv->configs, *best);
+			(*best)->type = NM_DNS_IP_CONFIG_TYPE_DEFAULT;
+			_configs_link (priv->configs, *best);
 		}
+		*best = data;
 	}
 
-	if (!priv->updates_queue && !update_dns (self, FALSE, &error)) {
-		_LOGW ("could not commit DNS changes: %s", error->message);
-		g_clear_error (&error);
-	}
+	_update_dns_schedule (self);
 
 	return TRUE;
 }
@@ -1382,31 +1495,25 @@ static gboolean
 nm_dns_manager_remove_ip_config (NMDnsManager *self, gpointer config)
 {
 	NMDnsManagerPrivate *priv;
-	GError *error = NULL;
 	NMDnsIPConfigData *data;
-	guint i;
 
 	g_return_val_if_fail (NM_IS_DNS_MANAGER (self), FALSE);
 	g_return_val_if_fail (config, FALSE);
 
 	priv = NM_DNS_MANAGER_GET_PRIVATE (self);
 
-	for (i = 0; i < priv->configs->len; i++) {
-		data = priv->configs->pdata[i];
+	data = g_hash_table_lookup (priv->configs_idx, config);
+	if (!data)
+		return FALSE;
 
-		if (data->config == config) {
-			forget_data (self, data);
-			g_ptr_array_remove_index (priv->configs, i);
+	forget_data (self, data);
+	_configs_unlink (priv->configs, data);
+	g_hash_table_remove (priv->configs_idx, config);
+	ip_config_data_destroy (data);
 
-			if (!priv->updates_queue && !update_dns (self, FALSE, &error)) {
-				_LOGW ("could not commit DNS changes: %s", error->message);
-				g_clear_error (&error);
-			}
+	_update_dns_schedule (self);
 
-			return TRUE;
-		}
-	}
-	return FALSE;
+	return TRUE;
 }
 
 gboolean
@@ -1463,6 +1570,22 @@ nm_dns_manager_set_hostname (NMDnsManager *self,
 	}
 }
 
+/**
+ * nm_dns_manager_get_num_collapsed_updates:
+ * @self: the #NMDnsManager
+ *
+ * Returns: the number of IP configuration changes that did not cause
+ *   an update of their own because they were merged into a following
+ *   one by the "dns-debounce" setting.
+ */
+guint64
+nm_dns_manager_get_num_collapsed_updates (NMDnsManager *self)
+{
+	g_return_val_if_fail (NM_IS_DNS_MANAGER (self), 0);
+
+	return NM_DNS_MANAGER_GET_PRIVATE (self)->debounce.num_collapsed;
+}
+
 gboolean
 nm_dns_manager_get_resolv_conf_explicit (NMDnsManager *self)
 {
@@ -1510,11 +1633,6 @@ nm_dns_manager_end_updates (NMDnsManager *self, const char *func)
 	priv = NM_DNS_MANAGER_GET_PRIVATE (self);
 	g_return_if_fail (priv->updates_queue > 0);
 
-	if (priv->need_sort) {
-		g_ptr_array_sort (priv->configs, ip_config_data_ptr_compare);
-		priv->need_sort = FALSE;
-	}
-
 	compute_hash (self, nm_config_data_get_global_dns_config (nm_config_get_data (priv->config)), new);
 	changed = (memcmp (new, priv->prev_hash, sizeof (new)) != 0) ? TRUE : FALSE;
 	_LOGD ("(%s): DNS configuration %s", func, changed ? "changed" : "did not change");
@@ -1561,6 +1679,10 @@ nm_dns_manager_stop (NMDnsManager *self)
 		priv->dns_touched = FALSE;
 	}
 
+	nm_clear_g_source (&priv->debounce.timer);
+	if (priv->helper)
+		nm_dns_helper_flush_sync (priv->helper);
+
 	priv->is_stopped = TRUE;
 }
 
@@ -1765,6 +1887,12 @@ again:
 			priv->plugin = nm_dns_unbound_new ();
 			plugin_changed = TRUE;
 		}
+	} else if (nm_streq0 (mode, "stub")) {
+		if (force_reload_plugin || !NM_IS_DNS_STUB (priv->plugin)) {
+			_clear_plugin (self);
+			priv->plugin = nm_dns_stub_new ();
+			plugin_changed = TRUE;
+		}
 	} else {
 		if (!NM_IN_STRSET (mode, "none", "default")) {
 			if (mode)
@@ -1790,6 +1918,10 @@ again:
 	}
 
 	if (priv->rc_manager != rc_manager) {
+		/* a queued job is for the old manager. The next update
+		 * commits the configuration with the new one. */
+		if (priv->helper)
+			nm_dns_helper_clear_pending (priv->helper);
 		priv->rc_manager = rc_manager;
 		param_changed = TRUE;
 		_notify (self, PROP_RC_MANAGER);
@@ -1814,6 +1946,8 @@ config_changed_cb (NMConfig *config,
 {
 	GError *error = NULL;
 
+	_debounce_init (self, config_data);
+
 	if (NM_FLAGS_ANY (changes, NM_CONFIG_CHANGE_DNS_MODE |
 	                           NM_CONFIG_CHANGE_RC_MANAGER |
 	                           NM_CONFIG_CHANGE_CAUSE_SIGHUP |
@@ -2050,6 +2184,9 @@ get_property (GObject *object, guint prop_id,
 	case PROP_CONFIGURATION:
 		g_value_set_variant (value, _get_config_variant (self));
 		break;
+	case PROP_COLLAPSED_UPDATES:
+		g_value_set_uint64 (value, priv->debounce.num_collapsed);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -2064,7 +2201,8 @@ nm_dns_manager_init (NMDnsManager *self)
 	_LOGT ("creating...");
 
 	priv->config = g_object_ref (nm_config_get ());
-	priv->configs = g_ptr_array_new_full (8, ip_config_data_destroy);
+	priv->configs = g_ptr_array_new ();
+	priv->configs_idx = g_hash_table_new (g_direct_hash, g_direct_equal);
 
 	/* Set the initial hash */
 	compute_hash (self, NULL, NM_DNS_MANAGER_GET_PRIVATE (self)->hash);
@@ -2073,6 +2211,7 @@ nm_dns_manager_init (NMDnsManager *self)
 	                  NM_CONFIG_SIGNAL_CONFIG_CHANGED,
 	                  G_CALLBACK (config_changed_cb),
 	                  self);
+	_debounce_init (self, nm_config_get_data (priv->config));
 	init_resolv_conf_mode (self, TRUE);
 }
 
@@ -2100,12 +2239,17 @@ dispose (GObject *object)
 		for (i = 0; i < priv->configs->len; i++) {
 			data = priv->configs->pdata[i];
 			forget_data (self, data);
+			ip_config_data_destroy (data);
 		}
 		g_ptr_array_free (priv->configs, TRUE);
 		priv->configs = NULL;
 	}
+	g_clear_pointer (&priv->configs_idx, g_hash_table_unref);
 
 	nm_clear_g_source (&priv->plugin_ratelimit.timer);
+	nm_clear_g_source (&priv->debounce.timer);
+
+	g_clear_pointer (&priv->helper, nm_dns_helper_free);
 
 	G_OBJECT_CLASS (nm_dns_manager_parent_class)->dispose (object);
 }
@@ -2154,6 +2298,12 @@ nm_dns_manager_class_init (NMDnsManagerClass *klass)
 	                          G_PARAM_READABLE |
 	                          G_PARAM_STATIC_STRINGS);
 
+	obj_properties[PROP_COLLAPSED_UPDATES] =
+	    g_param_spec_uint64 (NM_DNS_MANAGER_COLLAPSED_UPDATES, "", "",
+	                         0, G_MAXUINT64, 0,
+	                         G_PARAM_READABLE |
+	                         G_PARAM_STATIC_STRINGS);
+
 	g_object_class_install_properties (object_class, _PROPERTY_ENUMS_LAST, obj_properties);
 
 	signals[CONFIG_CHANGED] =
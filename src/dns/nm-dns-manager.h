@@ -42,6 +42,10 @@ typedef struct {
 	gpointer config;
 	NMDnsIPConfigType type;
 	char *iface;
+
+	/* private to NMDnsManager: the sort key of the entry. */
+	int _priority;
+	guint64 _seq;
 } NMDnsIPConfigData;
 
 int nm_dns_ip_config_data_get_dns_priority (const NMDnsIPConfigData *config);
@@ -57,6 +61,7 @@ int nm_dns_ip_config_data_get_dns_priority (const NMDnsIPConfigData *config);
 #define NM_DNS_MANAGER_MODE "mode"
 #define NM_DNS_MANAGER_RC_MANAGER "rc-manager"
 #define NM_DNS_MANAGER_CONFIGURATION "configuration"
+#define NM_DNS_MANAGER_COLLAPSED_UPDATES "collapsed-updates"
 
 /* internal signals */
 #define NM_DNS_MANAGER_CONFIG_CHANGED "config-changed"
@@ -123,6 +128,8 @@ typedef enum {
 
 gboolean nm_dns_manager_get_resolv_conf_explicit (NMDnsManager *self);
 
+guint64 nm_dns_manager_get_num_collapsed_updates (NMDnsManager *self);
+
 void nm_dns_manager_stop (NMDnsManager *self);
 
 #endif /* __NETWORKMANAGER_DNS_MANAGER_H__ */
@@ -0,0 +1,2085 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2017 Red Hat, Inc.
+ */
+
+/* A minimal caching DNS forwarder running inside NetworkManager.
+ *
+ * It listens for UDP and TCP queries on the loopback address and forwards
+ * them to the upstream servers of the configuration whose domain is the
+ * longest suffix of the queried name ("split DNS"). Answers are cached for
+ * their TTL, negative answers according to RFC 2308. Reconfiguration swaps
+ * the routing table at once, without restarting anything.
+ *
+ * Every forwarded query has its own socket, bound to a random port and
+ * connected to the server, so that an off-path attacker has to guess the
+ * port in addition to the ID to spoof an answer. Truncated answers are
+ * fetched again over TCP and never cached. */
+
+#include "nm-default.h"
+
+#include "nm-dns-stub.h"
+
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+#include "nm-utils/c-list.h"
+#include "nm-core-internal.h"
+#include "nm-ip4-config.h"
+#include "nm-ip6-config.h"
+#include "nm-timer-wheel.h"
+#include "NetworkManagerUtils.h"
+
+#define STUB_DEFAULT_ADDRESS    htonl (INADDR_LOOPBACK)
+#define DNS_PORT                53
+
+#define QUERY_TIMEOUT_MSEC      2000
+/* like "--dns-forward-max" of dnsmasq. Each query in flight needs a socket. */
+#define MAX_IN_FLIGHT           150
+#define MAX_READ_PER_DISPATCH   64
+
+/* source ports of forwarded queries are picked from this range. */
+#define QUERY_PORT_MIN          1024
+#define QUERY_PORT_TRIES        10
+
+#define TCP_MAX_CONNECTIONS     32
+#define TCP_IDLE_TIMEOUT_MSEC   10000
+/* a client that doesn't read its answers is disconnected. */
+#define TCP_MAX_OUTPUT          (256 * 1024)
+
+/* like "--cache-size" of the dnsmasq plugin. */
+#define CACHE_SIZE              400
+#define CACHE_MAX_TTL           (24 * 3600)
+/* RFC 2308, section 5 */
+#define CACHE_MAX_NEGATIVE_TTL  (3 * 3600)
+
+#define DNS_HEADER_SIZE         12
+#define DNS_NAME_MAX            255
+#define DNS_UDP_SIZE_DEFAULT    512
+#define DNS_PACKET_MAX          65536
+
+#define DNS_FLAG_QR             0x8000
+#define DNS_FLAG_TC             0x0200
+#define DNS_FLAG_RD             0x0100
+#define DNS_FLAG_RA             0x0080
+#define DNS_FLAG_CD             0x0010
+#define DNS_OPCODE(flags)       (((flags) >> 11) & 0xF)
+#define DNS_RCODE(flags)        ((flags) & 0xF)
+
+#define DNS_RCODE_NOERROR       0
+#define DNS_RCODE_FORMERR       1
+#define DNS_RCODE_SERVFAIL      2
+#define DNS_RCODE_NXDOMAIN      3
+#define DNS_RCODE_NOTIMP        4
+#define DNS_RCODE_REFUSED       5
+
+#define DNS_TYPE_SOA            6
+#define DNS_TYPE_OPT            41
+
+/*****************************************************************************/
+
+typedef union {
+	struct sockaddr sa;
+	struct sockaddr_in in;
+	struct sockaddr_in6 in6;
+} SockAddr;
+
+typedef struct {
+	SockAddr addr;
+	socklen_t addr_len;
+} Server;
+
+typedef struct {
+	char *domain;
+	GArray *servers;
+} Route;
+
+/* The routing table is immutable. Reconfiguring replaces it as a whole,
+ * queries in flight keep a reference to the one they were started with. */
+typedef struct {
+	int ref_count;
+	/* domain -> Route. The default servers have the empty domain "". */
+	GHashTable *routes;
+} Routes;
+
+typedef struct {
+	CList lru_lst;
+	char *key;
+	guint8 *data;
+	gsize len;
+	/* offset after the question section */
+	gsize question_end;
+	/* offsets of the TTL fields, adjusted when answering from the cache */
+	guint16 *ttl_offsets;
+	guint n_ttl_offsets;
+	gint64 stored_ms;
+	gint64 expiry_ms;
+} CacheEntry;
+
+/* A DNS message over TCP, with its two octet length prefix (RFC 1035,
+ * section 4.2.2). */
+typedef struct {
+	guint8 len_buf[2];
+	/* the octets of the prefix and message read so far. */
+	gsize n_read;
+	guint8 *data;
+} TcpMsg;
+
+typedef struct {
+	CList conns_lst;
+	NMTimerWheelEntry idle;
+	NMDnsStub *self;
+	int ref_count;
+	/* -1 once closed. Queries in flight keep a reference. */
+	int fd;
+	GIOChannel *channel;
+	guint id;
+	GIOCondition condition;
+	TcpMsg in;
+	GByteArray *out;
+	guint n_queries;
+	bool read_closed:1;
+} TcpConn;
+
+typedef struct {
+	SockAddr addr;
+	socklen_t addr_len;
+	/* %NULL for clients using UDP. */
+	TcpConn *conn;
+} Client;
+
+typedef struct {
+	CList queries_lst;
+	NMTimerWheelEntry timeout;
+	NMDnsStub *self;
+	Routes *routes;
+	const Route *route;
+	guint server_idx;
+	guint16 id;
+	guint16 client_id;
+	Client client;
+	/* the largest answer the client accepts. */
+	gsize max_len;
+	char *key;
+	guint8 *packet;
+	gsize len;
+	gsize question_end;
+
+	/* the socket to the current server. */
+	int fd;
+	GIOChannel *channel;
+	guint fd_id;
+	/* over TCP, the query still to write and the answer. */
+	GByteArray *tcp_out;
+	TcpMsg tcp_in;
+
+	bool cacheable:1;
+	bool use_tcp:1;
+} Query;
+
+/*****************************************************************************/
+
+NM_GOBJECT_PROPERTIES_DEFINE_BASE (
+	PROP_LISTEN_ADDRESS,
+	PROP_LISTEN_PORT,
+);
+
+typedef struct {
+	in_addr_t listen_address;
+	guint16 listen_port;
+
+	int listen_fd;
+	GIOChannel *listen_channel;
+	guint listen_id;
+
+	int tcp_listen_fd;
+	GIOChannel *tcp_listen_channel;
+	guint tcp_listen_id;
+
+	CList conns_lst_head;
+	guint n_conns;
+
+	Routes *routes;
+
+	CList queries_lst_head;
+	guint n_queries;
+
+	GHashTable *cache;
+	CList cache_lru_lst_head;
+
+	/* for the IDs and source ports of forwarded queries. */
+	GRand *rand;
+	/* receive buffer for queries */
+	guint8 *query_buf;
+	/* receive buffer for answers, and to assemble answers for clients */
+	guint8 *buf;
+
+	NMDnsStubStats stats;
+} NMDnsStubPrivate;
+
+struct _NMDnsStub {
+	NMDnsPlugin parent;
+	NMDnsStubPrivate _priv;
+};
+
+struct _NMDnsStubClass {
+	NMDnsPluginClass parent;
+};
+
+G_DEFINE_TYPE (NMDnsStub, nm_dns_stub, NM_TYPE_DNS_PLUGIN)
+
+#define NM_DNS_STUB_GET_PRIVATE(self) _NM_GET_PRIVATE (self, NMDnsStub, NM_IS_DNS_STUB)
+
+/*****************************************************************************/
+
+#define _NMLOG_DOMAIN         LOGD_DNS
+#define _NMLOG(level, ...) __NMLOG_DEFAULT_WITH_ADDR (level, _NMLOG_DOMAIN, "dns-stub", __VA_ARGS__)
+
+/*****************************************************************************/
+
+static inline guint16
+_get_u16 (const guint8 *p)
+{
+	return (((guint16) p[0]) << 8) | p[1];
+}
+
+static inline guint32
+_get_u32 (const guint8 *p)
+{
+	return (((guint32) p[0]) << 24) | (((guint32) p[1]) << 16) | (((guint32) p[2]) << 8) | p[3];
+}
+
+static inline void
+_put_u16 (guint8 *p, guint16 v)
+{
+	p[0] = v >> 8;
+	p[1] = v;
+}
+
+static inline void
+_put_u32 (guint8 *p, guint32 v)
+{
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+/* Returns the offset after the (possibly compressed) name at @offset,
+ * or zero if the packet is malformed. */
+static gsize
+_dns_name_skip (const guint8 *data, gsize len, gsize offset)
+{
+	while (offset < len) {
+		guint8 l = data[offset];
+
+		if (l == 0)
+			return offset + 1;
+		if ((l & 0xC0) == 0xC0)
+			return offset + 2 <= len ? offset + 2 : 0;
+		if (l & 0xC0)
+			return 0;
+		offset += 1 + l;
+	}
+	return 0;
+}
+
+/* Parses the single question of @data into the dotted, lower-case @name
+ * (without trailing dot), a buffer of DNS_NAME_MAX + 1 bytes. Returns the
+ * offset after the question or zero if it cannot be parsed. */
+static gsize
+_dns_parse_question (const guint8 *data,
+                     gsize len,
+                     char *name,
+                     guint16 *out_qtype,
+                     guint16 *out_qclass)
+{
+	gsize offset = DNS_HEADER_SIZE;
+	gsize n = 0;
+	guint i;
+
+	for (;;) {
+		guint8 l;
+
+		if (offset >= len)
+			return 0;
+		l = data[offset++];
+		if (l == 0)
+			break;
+		if (   l > 63
+		    || offset + l > len
+		    || n + l + 1 > DNS_NAME_MAX)
+			return 0;
+		if (n > 0)
+			name[n++] = '.';
+		for (i = 0; i < l; i++) {
+			char c = data[offset + i];
+
+			/* such names would be ambiguous in the dotted form. */
+			if (NM_IN_SET (c, '.', '\0'))
+				return 0;
+			name[n++] = g_ascii_tolower (c);
+		}
+		offset += l;
+	}
+	name[n] = '\0';
+
+	if (offset + 4 > len)
+		return 0;
+	*out_qtype = _get_u16 (&data[offset]);
+	*out_qclass = _get_u16 (&data[offset + 2]);
+	return offset + 4;
+}
+
+static gboolean
+_dns_question_equal (const guint8 *a, const guint8 *b, gsize question_end)
+{
+	gsize i;
+
+	/* the length octets are below 64, and unaffected by the case. */
+	for (i = DNS_HEADER_SIZE; i < question_end; i++) {
+		if (g_ascii_tolower (a[i]) != g_ascii_tolower (b[i]))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+typedef gboolean (*DnsRRFunc) (const guint8 *data, gsize len, guint section,
+                               gsize rr_offset, guint16 type, gsize ttl_offset,
+                               gsize rdata_offset, guint16 rdlen, gpointer user_data);
+
+/* Iterates over the resource records following the question. Returns
+ * FALSE if the packet is malformed or @func aborted. */
+static gboolean
+_dns_foreach_rr (const guint8 *data, gsize len, gsize offset, DnsRRFunc func, gpointer user_data)
+{
+	guint section, i;
+
+	for (section = 0; section < 3; section++) {
+		guint count = _get_u16 (&data[6 + 2 * section]);
+
+		for (i = 0; i < count; i++) {
+			gsize rr_offset = offset;
+			guint16 rdlen;
+
+			offset = _dns_name_skip (data, len, offset);
+			if (!offset || offset + 10 > len)
+				return FALSE;
+			rdlen = _get_u16 (&data[offset + 8]);
+			if (offset + 10 + rdlen > len)
+				return FALSE;
+			if (!func (data, len, section, rr_offset, _get_u16 (&data[offset]),
+			           offset + 4, offset + 10, rdlen, user_data))
+				return FALSE;
+			offset += 10 + rdlen;
+		}
+	}
+	return TRUE;
+}
+
+typedef struct {
+	guint16 udp_size;
+	bool edns:1;
+	bool dnssec_ok:1;
+} QueryEdns;
+
+static gboolean
+_query_edns_cb (const guint8 *data, gsize len, guint section,
+                gsize rr_offset, guint16 type, gsize ttl_offset,
+                gsize rdata_offset, guint16 rdlen, gpointer user_data)
+{
+	QueryEdns *edns = user_data;
+
+	if (section == 2 && type == DNS_TYPE_OPT) {
+		edns->edns = TRUE;
+		edns->udp_size = MAX (_get_u16 (&data[ttl_offset - 2]), DNS_UDP_SIZE_DEFAULT);
+		edns->dnssec_ok = !!(data[ttl_offset + 2] & 0x80);
+	}
+	return TRUE;
+}
+
+typedef struct {
+	GArray *ttl_offsets;
+	guint32 min_ttl;
+	guint32 negative_ttl;
+	bool has_answer:1;
+	bool has_soa:1;
+} ResponseTtl;
+
+static gboolean
+_response_ttl_cb (const guint8 *data, gsize len, guint section,
+                  gsize rr_offset, guint16 type, gsize ttl_offset,
+                  gsize rdata_offset, guint16 rdlen, gpointer user_data)
+{
+	ResponseTtl *r = user_data;
+	guint32 ttl;
+	guint16 offset;
+
+	if (type == DNS_TYPE_OPT)
+		return TRUE;
+
+	if (ttl_offset > G_MAXUINT16)
+		return FALSE;
+	offset = ttl_offset;
+	g_array_append_val (r->ttl_offsets, offset);
+
+	ttl = _get_u32 (&data[ttl_offset]);
+	if (section == 0) {
+		r->min_ttl = r->has_answer ? MIN (r->min_ttl, ttl) : ttl;
+		r->has_answer = TRUE;
+	} else if (   section == 1
+	           && type == DNS_TYPE_SOA
+	           && rdlen >= 20) {
+		/* RFC 2308, section 5: the minimum of the SOA record's TTL
+		 * and its MINIMUM field. */
+		r->negative_ttl = MIN (ttl, _get_u32 (&data[rdata_offset + rdlen - 4]));
+		r->has_soa = TRUE;
+	}
+	return TRUE;
+}
+
+/*****************************************************************************/
+
+static void
+_route_free (gpointer data)
+{
+	Route *route = data;
+
+	g_free (route->domain);
+	g_array_unref (route->servers);
+	g_slice_free (Route, route);
+}
+
+static Routes *
+_routes_new (void)
+{
+	Routes *routes;
+
+	routes = g_slice_new (Routes);
+	routes->ref_count = 1;
+	routes->routes = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, _route_free);
+	return routes;
+}
+
+static Routes *
+_routes_ref (Routes *routes)
+{
+	nm_assert (routes && routes->ref_count > 0);
+
+	routes->ref_count++;
+	return routes;
+}
+
+static void
+_routes_unref (Routes *routes)
+{
+	nm_assert (routes && routes->ref_count > 0);
+
+	if (--routes->ref_count == 0) {
+		g_hash_table_unref (routes->routes);
+		g_slice_free (Routes, routes);
+	}
+}
+
+static void
+_routes_add (Routes *routes, const char *domain, const Server *server)
+{
+	gs_free char *domain_lower = NULL;
+	Route *route;
+	guint i;
+
+	if (!domain || nm_streq (domain, "*"))
+		domain = "";
+	else {
+		gsize l;
+
+		domain_lower = g_ascii_strdown (domain, -1);
+		l = strlen (domain_lower);
+		if (l > 0 && domain_lower[l - 1] == '.')
+			domain_lower[l - 1] = '\0';
+		domain = domain_lower;
+	}
+
+	route = g_hash_table_lookup (routes->routes, domain);
+	if (!route) {
+		route = g_slice_new (Route);
+		route->domain = g_strdup (domain);
+		route->servers = g_array_new (FALSE, FALSE, sizeof (Server));
+		g_hash_table_insert (routes->routes, route->domain, route);
+	}
+
+	for (i = 0; i < route->servers->len; i++) {
+		const Server *s = &g_array_index (route->servers, Server, i);
+
+		if (   s->addr_len == server->addr_len
+		    && memcmp (&s->addr, &server->addr, s->addr_len) == 0)
+			return;
+	}
+	g_array_append_val (route->servers, *server);
+}
+
+static gboolean
+_routes_equal (const Routes *a, const Routes *b)
+{
+	GHashTableIter iter;
+	const Route *route_a, *route_b;
+
+	if (!a || !b)
+		return a == b;
+
+	if (g_hash_table_size (a->routes) != g_hash_table_size (b->routes))
+		return FALSE;
+
+	g_hash_table_iter_init (&iter, a->routes);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &route_a)) {
+		route_b = g_hash_table_lookup (b->routes, route_a->domain);
+		if (   !route_b
+		    || route_a->servers->len != route_b->servers->len
+		    || memcmp (route_a->servers->data,
+		               route_b->servers->data,
+		               sizeof (Server) * route_a->servers->len) != 0)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* Finds the route whose domain is the longest suffix of @name. */
+static const Route *
+_routes_lookup (const Routes *routes, const char *name)
+{
+	const Route *route;
+	const char *dot;
+
+	if (!routes)
+		return NULL;
+
+	for (;;) {
+		route = g_hash_table_lookup (routes->routes, name);
+		if (route)
+			return route;
+		if (!name[0])
+			return NULL;
+		dot = strchr (name, '.');
+		name = dot ? &dot[1] : "";
+	}
+}
+
+static gboolean
+_server_from_stub_server (Server *server, const NMDnsStubServer *s)
+{
+	memset (server, 0, sizeof (*server));
+
+	switch (s->addr_family) {
+	case AF_INET:
+		server->addr.in.sin_family = AF_INET;
+		server->addr.in.sin_port = htons (s->port ?: DNS_PORT);
+		server->addr.in.sin_addr.s_addr = s->addr.addr4;
+		server->addr_len = sizeof (struct sockaddr_in);
+		return TRUE;
+	case AF_INET6:
+		if (IN6_IS_ADDR_V4MAPPED (&s->addr.addr6)) {
+			server->addr.in.sin_family = AF_INET;
+			server->addr.in.sin_port = htons (s->port ?: DNS_PORT);
+			server->addr.in.sin_addr.s_addr = s->addr.addr6.s6_addr32[3];
+			server->addr_len = sizeof (struct sockaddr_in);
+			return TRUE;
+		}
+		server->addr.in6.sin6_family = AF_INET6;
+		server->addr.in6.sin6_port = htons (s->port ?: DNS_PORT);
+		server->addr.in6.sin6_addr = s->addr.addr6;
+		if (IN6_IS_ADDR_LINKLOCAL (&s->addr.addr6))
+			server->addr.in6.sin6_scope_id = s->ifindex;
+		server->addr_len = sizeof (struct sockaddr_in6);
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+static const char *
+_sockaddr_to_string (const SockAddr *addr, char *buf, gsize len)
+{
+	char s_addr[NM_UTILS_INET_ADDRSTRLEN];
+
+	if (addr->sa.sa_family == AF_INET) {
+		g_snprintf (buf, len, "%s:%u",
+		            nm_utils_inet4_ntop (addr->in.sin_addr.s_addr, s_addr),
+		            ntohs (addr->in.sin_port));
+	} else {
+		g_snprintf (buf, len, "[%s%%%u]:%u",
+		            nm_utils_inet6_ntop (&addr->in6.sin6_addr, s_addr),
+		            (guint) addr->in6.sin6_scope_id,
+		            ntohs (addr->in6.sin6_port));
+	}
+	return buf;
+}
+
+/*****************************************************************************/
+
+static void
+_cache_entry_free (gpointer data)
+{
+	CacheEntry *entry = data;
+
+	c_list_unlink (&entry->lru_lst);
+	g_free (entry->key);
+	g_free (entry->data);
+	g_free (entry->ttl_offsets);
+	g_slice_free (CacheEntry, entry);
+}
+
+void
+nm_dns_stub_flush_cache (NMDnsStub *self)
+{
+	NMDnsStubPrivate *priv;
+
+	g_return_if_fail (NM_IS_DNS_STUB (self));
+
+	priv = NM_DNS_STUB_GET_PRIVATE (self);
+	if (g_hash_table_size (priv->cache) > 0) {
+		_LOGD ("flush cache with %u entries", g_hash_table_size (priv->cache));
+		g_hash_table_remove_all (priv->cache);
+	}
+}
+
+static void
+_cache_add (NMDnsStub *self, const Query *query, const guint8 *data, gsize len)
+{
+	NMDnsStubPrivate *priv = NM_DNS_STUB_GET_PRIVATE (self);
+	ResponseTtl r = { 0 };
+	guint16 flags = _get_u16 (&data[2]);
+	guint32 ttl;
+	CacheEntry *entry;
+
+	if (   !query->cacheable
+	    || (flags & DNS_FLAG_TC))
+		return;
+
+	r.ttl_offsets = g_array_new (FALSE, FALSE, sizeof (guint16));
+	if (!_dns_foreach_rr (data, len, query->question_end, _response_ttl_cb, &r))
+		goto out;
+
+	switch (DNS_RCODE (flags)) {
+	case DNS_RCODE_NOERROR:
+		if (r.has_answer) {
+			ttl = MIN (r.min_ttl, CACHE_MAX_TTL);
+			break;
+		}
+		/* fall through. NODATA is a negative answer too. */
+	case DNS_RCODE_NXDOMAIN:
+		if (!r.has_soa)
+			goto out;
+		ttl = MIN (r.negative_ttl, CACHE_MAX_NEGATIVE_TTL);
+		break;
+	default:
+		goto out;
+	}
+
+	if (ttl == 0)
+		goto out;
+
+	entry = g_slice_new0 (CacheEntry);
+	c_list_init (&entry->lru_lst);
+	entry->key = g_strdup (query->key);
+	entry->data = g_memdup (data, len);
+	entry->len = len;
+	entry->question_end = query->question_end;
+	entry->n_ttl_offsets = r.ttl_offsets->len;
+	entry->ttl_offsets = (guint16 *) g_array_free (r.ttl_offsets, FALSE);
+	r.ttl_offsets = NULL;
+	entry->stored_ms = nm_utils_get_monotonic_timestamp_ms ();
+	entry->expiry_ms = entry->stored_ms + ((gint64) ttl) * 1000;
+
+	g_hash_table_replace (priv->cache, entry->key, entry);
+	c_list_link_tail (&priv->cache_lru_lst_head, &entry->lru_lst);
+
+	while (g_hash_table_size (priv->cache) > CACHE_SIZE) {
+		CacheEntry *oldest = c_list_first_entry (&priv->cache_lru_lst_head, CacheEntry, lru_lst);
+
+		g_hash_table_remove (priv->cache, oldest->key);
+	}
+
+out:
+	if (r.ttl_offsets)
+		g_array_free (r.ttl_offsets, TRUE);
+}
+
+/* Looks up @key and writes the answer into priv->buf, with the ID, question
+ * and TTLs of the cached answer adjusted for the client. Returns the length
+ * of the answer or zero. */
+static gsize
+_cache_lookup (NMDnsStub *self,
+               const char *key,
+               const guint8 *query,
+               gsize question_end,
+               gsize max_len)
+{
+	NMDnsStubPrivate *priv = NM_DNS_STUB_GET_PRIVATE (self);
+	CacheEntry *entry;
+	gint64 now_ms;
+	guint32 elapsed;
+	guint8 *buf = priv->buf;
+	guint i;
+
+	entry = g_hash_table_lookup (priv->cache, key);
+	if (!entry)
+		return 0;
+
+	now_ms = nm_utils_get_monotonic_timestamp_ms ();
+	if (now_ms >= entry->expiry_ms) {
+		g_hash_table_remove (priv->cache, key);
+		return 0;
+	}
+
+	if (   entry->len > max_len
+	    || entry->question_end != question_end)
+		return 0;
+
+	/* most recently used entries go last. */
+	c_list_unlink (&entry->lru_lst);
+	c_list_link_tail (&priv->cache_lru_lst_head, &entry->lru_lst);
+
+	memcpy (buf, entry->data, entry->len);
+
+	/* The ID, the RD flag and the spelling of the question are the ones
+	 * of the client. */
+	memcpy (buf, query, 2);
+	buf[2] = (buf[2] & ~(DNS_FLAG_RD >> 8)) | (query[2] & (DNS_FLAG_RD >> 8));
+	memcpy (&buf[DNS_HEADER_SIZE], &query[DNS_HEADER_SIZE], question_end - DNS_HEADER_SIZE);
+
+	elapsed = (now_ms - entry->stored_ms) / 1000;
+	for (i = 0; i < entry->n_ttl_offsets; i++) {
+		guint8 *p = &buf[entry->ttl_offsets[i]];
+		guint32 ttl = _get_u32 (p);
+
+		_put_u32 (p, ttl > elapsed ? ttl - elapsed : 0);
+	}
+
+	return entry->len;
+}
+
+/*****************************************************************************/
+
+static void
+_tcp_msg_clear (TcpMsg *msg)
+{
+	g_clear_pointer (&msg->data, g_free);
+	msg->n_read = 0;
+}
+
+static inline gsize
+_tcp_msg_len (const TcpMsg *msg)
+{
+	return _get_u16 (msg->len_buf);
+}
+
+/* Reads from the non-blocking @fd into @msg. Returns 1 once the message is
+ * complete, 0 if more data is needed, or a negative errno. The end of the
+ * stream is -ECONNRESET. */
+static int
+_tcp_msg_read (int fd, TcpMsg *msg)
+{
+	for (;;) {
+		guint8 *p;
+		gsize n_want;
+		gssize n;
+
+		if (msg->n_read < 2) {
+			p = &msg->len_buf[msg->n_read];
+			n_want = 2 - msg->n_read;
+		} else {
+			if (!msg->data) {
+				if (_tcp_msg_len (msg) == 0)
+					return -EBADMSG;
+				msg->data = g_malloc (_tcp_msg_len (msg));
+			}
+			p = &msg->data[msg->n_read - 2];
+			n_want = _tcp_msg_len (msg) - (msg->n_read - 2);
+			if (n_want == 0)
+				return 1;
+		}
+
+		n = recv (fd, p, n_want, MSG_DONTWAIT);
+		if (n < 0) {
+			int errsv = errno;
+
+			if (errsv == EINTR)
+				continue;
+			if (NM_IN_SET (errsv, EAGAIN, EWOULDBLOCK))
+				return 0;
+			return -errsv;
+		}
+		if (n == 0)
+			return -ECONNRESET;
+		msg->n_read += n;
+	}
+}
+
+static void
+_tcp_msg_append (GByteArray *out, const guint8 *data, gsize len)
+{
+	guint8 len_buf[2];
+
+	nm_assert (len <= G_MAXUINT16);
+
+	_put_u16 (len_buf, len);
+	g_byte_array_append (out, len_buf, 2);
+	g_byte_array_append (out, data, len);
+}
+
+/* Writes as much of @out as the socket accepts. Returns a negative errno
+ * on failure. */
+static int
+_tcp_write (int fd, GByteArray *out)
+{
+	while (out->len > 0) {
+		gssize n;
+
+		n = send (fd, out->data, out->len, MSG_NOSIGNAL | MSG_DONTWAIT);
+		if (n < 0) {
+			int errsv = errno;
+
+			if (errsv == EINTR)
+				continue;
+			if (NM_IN_SET (errsv, EAGAIN, EWOULDBLOCK))
+				return 0;
+			return -errsv;
+		}
+		g_byte_array_remove_range (out, 0, n);
+	}
+	return 0;
+}
+
+/*****************************************************************************/
+
+static void
+_tcp_conn_unref (TcpConn *conn)
+{
+	nm_assert (conn && conn->ref_count > 0);
+
+	if (--conn->ref_count == 0) {
+		nm_assert (conn->fd < 0);
+
+		_tcp_msg_clear (&conn->in);
+		g_byte_array_unref (conn->out);
+		g_slice_free (TcpConn, conn);
+	}
+}
+
+static void
+_tcp_conn_close (TcpConn *conn)
+{
+	NMDnsStubPrivate *priv = NM_DNS_STUB_GET_PRIVATE (conn->self);
+
+	if (conn->fd < 0)
+		return;
+
+	nm_clear_g_source (&conn->id);
+	nm_timer_wheel_cancel (nm_timer_wheel_get (), &conn->idle);
+	g_clear_pointer (&conn->channel, g_io_channel_unref);
+	close (conn->fd);
+	conn->fd = -1;
+
+	c_list_unlink (&conn->conns_lst);
+	priv->n_conns--;
+	_tcp_conn_unref (conn);
+}
+
+static gboolean _tcp_conn_cb (GIOChannel *source, GIOCondition condition, gpointer user_data);
+
+/* Watches for what the connection waits for, or closes it once a client
+ * that stopped sending got all its answers. */
+static void
+_tcp_conn_update (TcpConn *conn)
+{
+	GIOCondition condition = 0;
+
+	if (conn->fd < 0)
+		return;
+
+	if (   conn->read_closed
+	    && conn->n_queries == 0
+	    && conn->out->len == 0) {
+		_tcp_conn_close (conn);
+		return;
+	}
+
+	if (!conn->read_closed)
+		condition |= G_IO_IN;
+	if (conn->out->len > 0)
+		condition |= G_IO_OUT;
+
+	if (conn->id && conn->condition == condition)
+		return;
+
+	nm_clear_g_source (&conn->id);
+	conn->condition = condition;
+	if (condition)
+		conn->id = g_io_add_watch (conn->channel, condition, _tcp_conn_cb, conn);
+}
+
+static void
+_tcp_conn_send (TcpConn *conn, const guint8 *data, gsize len)
+{
+	NMDnsStub *self = conn->self;
+	int r;
+
+	if (conn->fd < 0)
+		return;
+
+	if (conn->out->len + 2 + len > TCP_MAX_OUTPUT) {
+		_LOGT ("TCP client doesn't read its answers, disconnect");
+		_tcp_conn_close (conn);
+		return;
+	}
+
+	_tcp_msg_append (conn->out, data, len);
+	r = _tcp_write (conn->fd, conn->out);
+	if (r < 0) {
+		_LOGT ("failed to send answer: %s", g_strerror (-r));
+		_tcp_conn_close (conn);
+		return;
+	}
+	_tcp_conn_update (conn);
+}
+
+static void
+_tcp_conn_idle_cb (NMTimerWheelEntry *idle, gpointer user_data)
+{
+	TcpConn *conn = user_data;
+
+	if (   conn->n_queries > 0
+	    || conn->out->len > 0) {
+		nm_timer_wheel_schedule (nm_timer_wheel_get (), &conn->idle,
+		                         nm_utils_get_monotonic_timestamp_ms () + TCP_IDLE_TIMEOUT_MSEC);
+		return;
+	}
+	_tcp_conn_close (conn);
+}
+
+/*****************************************************************************/
+
+static void
+_client_send (NMDnsStub *self,
+              const Client *client,
+              const guint8 *data,
+              gsize len)
+{
+	NMDnsStubPrivate *priv = NM_DNS_STUB_GET_PRIVATE (self);
+
+	if (client->conn) {
+		_tcp_conn_send (client->conn, data, len);
+		return;
+	}
+
+	if (sendto (priv->listen_fd, data, len, MSG_NOSIGNAL, &client->addr.sa, client->addr_len) < 0) {
+		int errsv = errno;
+
+		_LOGT ("failed to send answer: %s", g_strerror (errsv));
+	}
+}
+
+static void
+_client_send_error (NMDnsStub *self,
+                    const Client *client,
+                    const guint8 *query,
+                    gsize question_end,
+                    guint rcode)
+{
+	guint8 *buf = NM_DNS_STUB_GET_PRIVATE (self)->buf;
+	guint16 flags;
+
+	nm_assert (question_end == 0 || question_end >= DNS_HEADER_SIZE);
+
+	flags = _get_u16 (&query[2]);
+	flags = DNS_FLAG_QR | (flags & (0xF << 11)) | (flags & DNS_FLAG_RD) | DNS_FLAG_RA | rcode;
+
+	memset (buf, 0, DNS_HEADER_SIZE);
+	memcpy (buf, query, 2);
+	_put_u16 (&buf[2], flags);
+	if (question_end) {
+		_put_u16 (&buf[4], 1);
+		memcpy (&buf[DNS_HEADER_SIZE], &query[DNS_HEADER_SIZE], question_end - DNS_HEADER_SIZE);
+	} else
+		question_end = DNS_HEADER_SIZE;
+
+	_client_send (self, client, buf, question_end);
+}
+
+/*****************************************************************************/
+
+static void
+_query_close_upstream (Query *query)
+{
+	nm_clear_g_source (&query->fd_id);
+	g_clear_pointer (&query->channel, g_io_channel_unref);
+	if (query->fd >= 0) {
+		close (query->fd);
+		query->fd = -1;
+	}
+	g_clear_pointer (&query->tcp_out, g_byte_array_unref);
+	_tcp_msg_clear (&query->tcp_in);
+}
+
+static void
+_query_free (Query *query)
+{
+	NMDnsStubPrivate *priv = NM_DNS_STUB_GET_PRIVATE (query->self);
+	TcpConn *conn = query->client.conn;
+
+	c_list_unlink (&query->queries_lst);
+	priv->n_queries--;
+	nm_timer_wheel_cancel (nm_timer_wheel_get (), &query->timeout);
+	_query_close_upstream (query);
+	_routes_unref (query->routes);
+	g_free (query->key);
+	g_free (query->packet);
+	g_slice_free (Query, query);
+
+	if (conn) {
+		conn->n_queries--;
+		_tcp_conn_update (conn);
+		_tcp_conn_unref (conn);
+	}
+}
+
+static gboolean _upstream_udp_cb (GIOChannel *source, GIOCondition condition, gpointer user_data);
+static gboolean _upstream_tcp_cb (GIOChannel *source, GIOCondition condition, gpointer user_data);
+
+/* Binds @fd to a random port, so that the port of every query is as hard
+ * to guess as its ID. */
+static void
+_upstream_bind_random_port (NMDnsStub *self, int fd, int addr_family)
+{
+	NMDnsStubPrivate *priv = NM_DNS_STUB_GET_PRIVATE (self);
+	SockAddr addr;
+	socklen_t addr_len;
+	guint i;
+
+	memset (&addr, 0, sizeof (addr));
+	if (addr_family == AF_INET) {
+		addr.in.sin_family = AF_INET;
+		addr_len = sizeof (struct sockaddr_in);
+	} else {
+		addr.in6.sin6_family = AF_INET6;
+		addr_len = sizeof (struct sockaddr_in6);
+	}
+
+	for (i = 0; i < QUERY_PORT_TRIES; i++) {
+		guint16 port = g_rand_int_range (priv->rand, QUERY_PORT_MIN, G_MAXUINT16 + 1);
+
+		if (addr_family == AF_INET)
+			addr.in.sin_port = htons (port);
+		else
+			addr.in6.sin6_port = htons (port);
+		if (bind (fd, &addr.sa, addr_len) == 0)
+			return;
+		if (errno != EADDRINUSE)
+			break;
+	}
+
+	/* connect() binds to a port from the ephemeral range instead, which
+	 * the kernel randomizes too. */
+}
+
+/* Opens a socket connected to @server, for UDP bound to a random port.
+ * For TCP the connection may still be in progress. */
+static int
+_upstream_socket_new (NMDnsStub *self, const Server *server, int type)
+{
+	int fd;
+
+	fd = socket (server->addr.sa.sa_family, type | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+		return -1;
+
+	if (type == SOCK_DGRAM)
+		_upstream_bind_random_port (self, fd, server->addr.sa.sa_family);
+
+	if (   connect (fd, &server->addr.sa, server->addr_len) < 0
+	    && (type == SOCK_DGRAM || errno != EINPROGRESS)) {
+		int errsv = errno;
+
+		close (fd);
+		errno = errsv;
+		return -1;
+	}
+	return fd;
+}
+
+static gboolean
+_query_send_to (Query *query, const Server *server)
+{
+	NMDnsStub *self = query->self;
+
+	nm_assert (query->fd < 0);
+
+	query->fd = _upstream_socket_new (self, server, query->use_tcp ? SOCK_STREAM : SOCK_DGRAM);
+	if (query->fd < 0)
+		return FALSE;
+	query->channel = g_io_channel_unix_new (query->fd);
+
+	if (query->use_tcp) {
+		/* the query is written once connected. */
+		query->tcp_out = g_byte_array_sized_new (2 + query->len);
+		_tcp_msg_append (query->tcp_out, query->packet, query->len);
+		query->fd_id = g_io_add_watch (query->channel, G_IO_OUT, _upstream_tcp_cb, query);
+		return TRUE;
+	}
+
+	if (send (query->fd, query->packet, query->len, MSG_NOSIGNAL) < 0)
+		return FALSE;
+	query->fd_id = g_io_add_watch (query->channel, G_IO_IN, _upstream_udp_cb, query);
+	return TRUE;
+}
+
+static gboolean
+_query_send (Query *query)
+{
+	NMDnsStub *self = query->self;
+	const Server *server;
+	char buf[100];
+
+	while (query->server_idx < query->route->servers->len) {
+		server = &g_array_index (query->route->servers, Server, query->server_idx);
+
+		if (_query_send_to (query, server)) {
+			_LOGT ("query %s: forward to %s%s", query->key,
+			       _sockaddr_to_string (&server->addr, buf, sizeof (buf)),
+			       query->use_tcp ? " over TCP" : "");
+			nm_timer_wheel_schedule (nm_timer_wheel_get (), &query->timeout,
+			                         nm_utils_get_monotonic_timestamp_ms () + QUERY_TIMEOUT_MSEC);
+			return TRUE;
+		}
+		_LOGT ("query %s: cannot forward to %s", query->key,
+		       _sockaddr_to_string (&server->addr, buf, sizeof (buf)));
+		_query_close_upstream (query);
+		query->server_idx++;
+	}
+	return FALSE;
+}
+
+static void
+_query_fail (Query *query)
+{
+	_client_send_error (query->self, &query->client,
+	                    query->packet, query->question_end, DNS_RCODE_SERVFAIL);
+	_query_free (query);
+}
+
+/* Retries the query with the next server, or fails it. */
+static void
+_query_next_server (Query *query)
+{
+	_query_close_upstream (query);
+	query->server_idx++;
+	if (!_query_send (query))
+		_query_fail (query);
+}
+
+static void
+_query_timeout_cb (NMTimerWheelEntry *timeout, gpointer user_data)
+{
+	Query *query = user_data;
+	NMDnsStub *self = query->self;
+	NMDnsStubPrivate *priv = NM_DNS_STUB_GET_PRIVATE (self);
+
+	priv->stats.timeouts++;
+	_LOGT ("query %s: timeout", query->key);
+
+	_query_next_server (query);
+}
+
+static void
+_query_start (NMDnsStub *self,
+              const guint8 *data,
+              gsize len,
+              gsize question_end,
+              const char *key,
+              gboolean cacheable,
+              const Route *route,
+              const Client *client,
+              gsize max_len)
+{
+	NMDnsStubPrivate *priv = NM_DNS_STUB_GET_PRIVATE (self);
+	Query *query;
+
+	if (priv->n_queries >= MAX_IN_FLIGHT) {
+		_LOGT ("query %s: too many queries in flight", key);
+		_client_send_error (self, client, data, question_end, DNS_RCODE_SERVFAIL);
+		return;
+	}
+
+	query = g_slice_new0 (Query);
+	query->self = self;
+	query->routes = _routes_ref (priv->routes);
+	query->route = route;
+	query->id = g_rand_int_range (priv->rand, 0, G_MAXUINT16 + 1);
+	query->client_id = _get_u16 (data);
+	query->client = *client;
+	query->max_len = max_len;
+	query->key = g_strdup (key);
+	query->packet = g_memdup (data, len);
+	query->len = len;
+	query->question_end = question_end;
+	query->cacheable = cacheable;
+	query->fd = -1;
+	_put_u16 (query->packet, query->id);
+	nm_timer_wheel_entry_init (&query->timeout, _query_timeout_cb, query);
+
+	if (client->conn) {
+		client->conn->ref_count++;
+		client->conn->n_queries++;
+	}
+
+	c_list_link_tail (&priv->queries_lst_head, &query->queries_lst);
+	priv->n_queries++;
+
+	priv->stats.forwarded++;
+	if (!_query_send (query))
+		_query_fail (query);
+}
+
+/*****************************************************************************/
+
+static void
+_handle_query (NMDnsStub *self,
+               const guint8 *data,
+               gsize len,
+               const Client *client)
+{
+	NMDnsStubPrivate *priv = NM_DNS_STUB_GET_PRIVATE (self);
+	char name[DNS_NAME_MAX + 1];
+	char key[DNS_NAME_MAX + 30];
+	QueryEdns edns = { .udp_size = DNS_UDP_SIZE_DEFAULT };
+	guint16 flags, qtype, qclass;
+	gsize question_end;
+	gsize max_len;
+	const Route *route;
+	gsize n;
+
+	if (len < DNS_HEADER_SIZE)
+		return;
+
+	flags = _get_u16 (&data[2]);
+	if (flags & DNS_FLAG_QR)
+		return;
+
+	priv->stats.queries++;
+
+	if (DNS_OPCODE (flags) != 0) {
+		_client_send_error (self, client, data, 0, DNS_RCODE_NOTIMP);
+		return;
+	}
+
+	if (   _get_u16 (&data[4]) != 1
+	    || !(question_end = _dns_parse_question (data, len, name, &qtype, &qclass))
+	    || !_dns_foreach_rr (data, len, question_end, _query_edns_cb, &edns)) {
+		_client_send_error (self, client, data, 0, DNS_RCODE_FORMERR);
+		return;
+	}
+
+	/* answers differ depending on whether the client speaks EDNS and
+	 * wants DNSSEC records. */
+	nm_sprintf_buf (key, "%s/%u/%u/%c", name, qtype, qclass,
+	                edns.dnssec_ok ? 'd' : (edns.edns ? 'e' : 'n'));
+
+	max_len = client->conn ? G_MAXUINT16 : edns.udp_size;
+
+	if (!(flags & DNS_FLAG_CD)) {
+		n = _cache_lookup (self, key, data, question_end, max_len);
+		if (n) {
+			priv->stats.cache_hits++;
+			_LOGT ("query %s: answer from cache", key);
+			_client_send (self, client, priv->buf, n);
+			return;
+		}
+	}
+
+	route = _routes_lookup (priv->routes, name);
+	if (!route) {
+		_LOGT ("query %s: no server", key);
+		_client_send_error (self, client, data, question_end, DNS_RCODE_SERVFAIL);
+		return;
+	}
+
+	_query_start (self, data, len, question_end, key,
+	              !(flags & DNS_FLAG_CD),
+	              route, client, max_len);
+}
+
+static gboolean
+_listen_cb (GIOChannel *source, GIOCondition condition, gpointer user_data)
+{
+	NMDnsStub *self = user_data;
+	NMDnsStubPrivate *priv = NM_DNS_STUB_GET_PRIVATE (self);
+	Client client = { 0 };
+	gssize n;
+	guint i;
+
+	for (i = 0; i < MAX_READ_PER_DISPATCH; i++) {
+		client.addr_len = sizeof (client.addr);
+		n = recvfrom (priv->listen_fd, priv->query_buf, DNS_PACKET_MAX, MSG_DONTWAIT,
+		              &client.addr.sa, &client.addr_len);
+		if (n < 0) {
+			int errsv = errno;
+
+			if (!NM_IN_SET (errsv, EAGAIN, EWOULDBLOCK, EINTR))
+				_LOGD ("failed to receive query: %s", g_strerror (errsv));
+			break;
+		}
+		_handle_query (self, priv->query_buf, n, &client);
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+_tcp_conn_cb (GIOChannel *source, GIOCondition condition, gpointer user_data)
+{
+	TcpConn *conn = user_data;
+	NMDnsStub *self = conn->self;
+	int r;
+
+	if (condition & G_IO_OUT) {
+		r = _tcp_write (conn->fd, conn->out);
+		if (r < 0) {
+			_LOGT ("failed to send answer: %s", g_strerror (-r));
+			_tcp_conn_close (conn);
+			return G_SOURCE_REMOVE;
+		}
+	}
+
+	if (   !conn->read_closed
+	    && (condition & (G_IO_IN | G_IO_ERR | G_IO_HUP))) {
+		Client client = {
+			.conn = conn,
+		};
+		guint i;
+
+		/* answers from the cache are sent right away and might close
+		 * the connection. */
+		conn->ref_count++;
+		for (i = 0; conn->fd >= 0 && i < MAX_READ_PER_DISPATCH; i++) {
+			r = _tcp_msg_read (conn->fd, &conn->in);
+			if (r == 0)
+				break;
+			if (r < 0) {
+				if (r != -ECONNRESET)
+					_LOGT ("failed to receive query: %s", g_strerror (-r));
+				/* answer the queries in flight, then close. */
+				conn->read_closed = TRUE;
+				break;
+			}
+
+			nm_timer_wheel_schedule (nm_timer_wheel_get (), &conn->idle,
+			                         nm_utils_get_monotonic_timestamp_ms () + TCP_IDLE_TIMEOUT_MSEC);
+			_handle_query (self, conn->in.data, _tcp_msg_len (&conn->in), &client);
+			_tcp_msg_clear (&conn->in);
+		}
+		_tcp_conn_update (conn);
+		_tcp_conn_unref (conn);
+		return G_SOURCE_CONTINUE;
+	}
+
+	if (condition & (G_IO_ERR | G_IO_HUP)) {
+		_tcp_conn_close (conn);
+		return G_SOURCE_REMOVE;
+	}
+
+	_tcp_conn_update (conn);
+	return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+_tcp_listen_cb (GIOChannel *source, GIOCondition condition, gpointer user_data)
+{
+	NMDnsStub *self = user_data;
+	NMDnsStubPrivate *priv = NM_DNS_STUB_GET_PRIVATE (self);
+	TcpConn *conn;
+	guint i;
+	int fd;
+
+	for (i = 0; i < MAX_READ_PER_DISPATCH; i++) {
+		fd = accept4 (priv->tcp_listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (fd < 0) {
+			int errsv = errno;
+
+			if (!NM_IN_SET (errsv, EAGAIN, EWOULDBLOCK, EINTR))
+				_LOGD ("failed to accept TCP client: %s", g_strerror (errsv));
+			break;
+		}
+
+		if (priv->n_conns >= TCP_MAX_CONNECTIONS) {
+			_LOGT ("too many TCP clients");
+			close (fd);
+			continue;
+		}
+
+		conn = g_slice_new0 (TcpConn);
+		conn->self = self;
+		conn->ref_count = 1;
+		conn->fd = fd;
+		conn->channel = g_io_channel_unix_new (fd);
+		conn->out = g_byte_array_new ();
+		nm_timer_wheel_entry_init (&conn->idle, _tcp_conn_idle_cb, conn);
+		nm_timer_wheel_schedule (nm_timer_wheel_get (), &conn->idle,
+		                         nm_utils_get_monotonic_timestamp_ms () + TCP_IDLE_TIMEOUT_MSEC);
+		c_list_link_tail (&priv->conns_lst_head, &conn->conns_lst);
+		priv->n_conns++;
+		_tcp_conn_update (conn);
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+/*****************************************************************************/
+
+/* Handles the answer of the current server. Returns %FALSE if it doesn't
+ * answer the query. */
+static gboolean
+_handle_reply (NMDnsStub *self, Query *query, guint8 *data, gsize len)
+{
+	NMDnsStubPrivate *priv = NM_DNS_STUB_GET_PRIVATE (self);
+	char name[DNS_NAME_MAX + 1];
+	guint16 flags, qtype, qclass;
+	gsize question_end;
+
+	if (len < DNS_HEADER_SIZE)
+		return FALSE;
+
+	/* ignore answers that don't match what we asked. */
+	flags = _get_u16 (&data[2]);
+	if (   !(flags & DNS_FLAG_QR)
+	    || _get_u16 (data) != query->id
+	    || _get_u16 (&data[4]) != 1
+	    || !(question_end = _dns_parse_question (data, len, name, &qtype, &qclass))
+	    || question_end != query->question_end
+	    || !_dns_question_equal (data, query->packet, question_end))
+		return FALSE;
+
+	if (   (flags & DNS_FLAG_TC)
+	    && !query->use_tcp) {
+		_LOGT ("query %s: answer truncated, retry over TCP", query->key);
+		priv->stats.tcp_retries++;
+		_query_close_upstream (query);
+		query->use_tcp = TRUE;
+		if (!_query_send (query))
+			_query_fail (query);
+		return TRUE;
+	}
+
+	if (   NM_IN_SET (DNS_RCODE (flags), DNS_RCODE_SERVFAIL, DNS_RCODE_REFUSED)
+	    && query->server_idx + 1 < query->route->servers->len) {
+		_LOGT ("query %s: server failed with rcode %u, try next", query->key, DNS_RCODE (flags));
+		_query_next_server (query);
+		return TRUE;
+	}
+
+	_cache_add (self, query, data, len);
+
+	_put_u16 (data, query->client_id);
+	memcpy (&data[DNS_HEADER_SIZE], &query->packet[DNS_HEADER_SIZE], question_end - DNS_HEADER_SIZE);
+
+	if (len > query->max_len) {
+		/* an answer fetched over TCP for a UDP client. Let the client
+		 * ask again over TCP, then it's answered from the cache. */
+		data[2] |= DNS_FLAG_TC >> 8;
+		memset (&data[6], 0, 6);
+		len = question_end;
+	}
+
+	_client_send (self, &query->client, data, len);
+	_query_free (query);
+	return TRUE;
+}
+
+static gboolean
+_upstream_udp_cb (GIOChannel *source, GIOCondition condition, gpointer user_data)
+{
+	Query *query = user_data;
+	NMDnsStub *self = query->self;
+	NMDnsStubPrivate *priv = NM_DNS_STUB_GET_PRIVATE (self);
+	const Server *server = &g_array_index (query->route->servers, Server, query->server_idx);
+	SockAddr addr;
+	socklen_t addr_len;
+	gssize n;
+	guint i;
+
+	for (i = 0; i < MAX_READ_PER_DISPATCH; i++) {
+		addr_len = sizeof (addr);
+		n = recvfrom (query->fd, priv->buf, DNS_PACKET_MAX, MSG_DONTWAIT, &addr.sa, &addr_len);
+		if (n < 0) {
+			int errsv = errno;
+
+			if (errsv == EINTR)
+				continue;
+			if (NM_IN_SET (errsv, EAGAIN, EWOULDBLOCK))
+				break;
+
+			/* for example ECONNREFUSED, if nothing listens on the server. */
+			_LOGT ("query %s: failed to receive answer: %s", query->key, g_strerror (errsv));
+			_query_next_server (query);
+			return G_SOURCE_REMOVE;
+		}
+
+		/* the socket is connected, the kernel already dropped datagrams
+		 * from elsewhere. */
+		if (   addr_len != server->addr_len
+		    || memcmp (&addr, &server->addr, addr_len) != 0)
+			continue;
+
+		if (_handle_reply (self, query, priv->buf, n))
+			return G_SOURCE_REMOVE;
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+_upstream_tcp_cb (GIOChannel *source, GIOCondition condition, gpointer user_data)
+{
+	Query *query = user_data;
+	NMDnsStub *self = query->self;
+	int r;
+
+	if (query->tcp_out) {
+		r = _tcp_write (query->fd, query->tcp_out);
+		if (r < 0)
+			goto fail;
+		if (query->tcp_out->len > 0)
+			return G_SOURCE_CONTINUE;
+
+		g_clear_pointer (&query->tcp_out, g_byte_array_unref);
+		query->fd_id = g_io_add_watch (query->channel, G_IO_IN, _upstream_tcp_cb, query);
+		return G_SOURCE_REMOVE;
+	}
+
+	r = _tcp_msg_read (query->fd, &query->tcp_in);
+	if (r == 0)
+		return G_SOURCE_CONTINUE;
+	if (r > 0) {
+		if (_handle_reply (self, query, query->tcp_in.data, _tcp_msg_len (&query->tcp_in)))
+			return G_SOURCE_REMOVE;
+		r = -EBADMSG;
+	}
+
+fail:
+	_LOGT ("query %s: TCP connection failed: %s", query->key, g_strerror (-r));
+	_query_next_server (query);
+	return G_SOURCE_REMOVE;
+}
+
+/*****************************************************************************/
+
+static int
+_listen_socket_new (NMDnsStub *self, int type, GError **error)
+{
+	NMDnsStubPrivate *priv = NM_DNS_STUB_GET_PRIVATE (self);
+	struct sockaddr_in addr = { 0 };
+	int errsv;
+	int fd;
+
+	fd = socket (AF_INET, type | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		errsv = errno;
+		g_set_error (error, NM_UTILS_ERROR, NM_UTILS_ERROR_UNKNOWN,
+		             "failed to create socket: %s", g_strerror (errsv));
+		return -1;
+	}
+
+	if (type == SOCK_STREAM) {
+		int on = 1;
+
+		/* don't wait for connections of a previous instance to time out. */
+		setsockopt (fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof (on));
+	}
+
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = priv->listen_address;
+	addr.sin_port = htons (priv->listen_port);
+	if (   bind (fd, (struct sockaddr *) &addr, sizeof (addr)) < 0
+	    || (type == SOCK_STREAM && listen (fd, SOMAXCONN) < 0)) {
+		char buf[NM_UTILS_INET_ADDRSTRLEN];
+
+		errsv = errno;
+		close (fd);
+		g_set_error (error, NM_UTILS_ERROR, NM_UTILS_ERROR_UNKNOWN,
+		             "failed to listen on %s:%u%s: %s",
+		             nm_utils_inet4_ntop (priv->listen_address, buf),
+		             priv->listen_port,
+		             type == SOCK_STREAM ? " (TCP)" : "",
+		             g_strerror (errsv));
+		return -1;
+	}
+
+	return fd;
+}
+
+gboolean
+nm_dns_stub_start (NMDnsStub *self, GError **error)
+{
+	NMDnsStubPrivate *priv;
+	struct sockaddr_in addr = { 0 };
+	socklen_t addr_len;
+	guint32 seed[4];
+	int fd, tcp_fd;
+
+	g_return_val_if_fail (NM_IS_DNS_STUB (self), FALSE);
+	g_return_val_if_fail (!error || !*error, FALSE);
+
+	priv = NM_DNS_STUB_GET_PRIVATE (self);
+
+	if (priv->listen_fd >= 0)
+		return TRUE;
+
+	fd = _listen_socket_new (self, SOCK_DGRAM, error);
+	if (fd < 0)
+		return FALSE;
+
+	/* with port zero, TCP listens on the port that UDP got. */
+	addr_len = sizeof (addr);
+	if (getsockname (fd, (struct sockaddr *) &addr, &addr_len) == 0)
+		priv->listen_port = ntohs (addr.sin_port);
+
+	tcp_fd = _listen_socket_new (self, SOCK_STREAM, error);
+	if (tcp_fd < 0) {
+		close (fd);
+		return FALSE;
+	}
+
+	/* the IDs and ports of forwarded queries must not be guessable. */
+	if (nm_utils_read_urandom (seed, sizeof (seed)) < 0) {
+		seed[0] = g_random_int ();
+		seed[1] = g_random_int ();
+		seed[2] = g_random_int ();
+		seed[3] = g_random_int ();
+	}
+	if (priv->rand)
+		g_rand_free (priv->rand);
+	priv->rand = g_rand_new_with_seed_array (seed, G_N_ELEMENTS (seed));
+
+	if (!priv->buf) {
+		priv->query_buf = g_malloc (DNS_PACKET_MAX);
+		priv->buf = g_malloc (DNS_PACKET_MAX);
+	}
+
+	priv->listen_fd = fd;
+	priv->listen_channel = g_io_channel_unix_new (fd);
+	priv->listen_id = g_io_add_watch (priv->listen_channel, G_IO_IN, _listen_cb, self);
+
+	priv->tcp_listen_fd = tcp_fd;
+	priv->tcp_listen_channel = g_io_channel_unix_new (tcp_fd);
+	priv->tcp_listen_id = g_io_add_watch (priv->tcp_listen_channel, G_IO_IN, _tcp_listen_cb, self);
+
+	_LOGI ("listening on port %u", priv->listen_port);
+	return TRUE;
+}
+
+guint16
+nm_dns_stub_get_port (NMDnsStub *self)
+{
+	g_return_val_if_fail (NM_IS_DNS_STUB (self), 0);
+
+	return NM_DNS_STUB_GET_PRIVATE (self)->listen_port;
+}
+
+void
+nm_dns_stub_get_stats (NMDnsStub *self, NMDnsStubStats *stats)
+{
+	NMDnsStubPrivate *priv;
+
+	g_return_if_fail (NM_IS_DNS_STUB (self));
+	g_return_if_fail (stats);
+
+	priv = NM_DNS_STUB_GET_PRIVATE (self);
+	*stats = priv->stats;
+	stats->cache_size = g_hash_table_size (priv->cache);
+	stats->in_flight = priv->n_queries;
+}
+
+void
+nm_dns_stub_set_servers (NMDnsStub *self,
+                         const NMDnsStubServer *servers,
+                         guint n_servers)
+{
+	NMDnsStubPrivate *priv;
+	Routes *routes;
+	guint i;
+
+	g_return_if_fail (NM_IS_DNS_STUB (self));
+	g_return_if_fail (servers || !n_servers);
+
+	priv = NM_DNS_STUB_GET_PRIVATE (self);
+
+	routes = _routes_new ();
+	for (i = 0; i < n_servers; i++) {
+		Server server;
+
+		if (!_server_from_stub_server (&server, &servers[i]))
+			g_return_if_reached ();
+
+		if (_LOGT_ENABLED ()) {
+			char buf[100];
+
+			_LOGT ("server %s%s%s%s",
+			       _sockaddr_to_string (&server.addr, buf, sizeof (buf)),
+			       NM_PRINT_FMT_QUOTED (servers[i].domain, " for domain \"", servers[i].domain, "\"", ""));
+		}
+		_routes_add (routes, servers[i].domain, &server);
+	}
+
+	if (_routes_equal (priv->routes, routes)) {
+		_routes_unref (routes);
+		return;
+	}
+
+	_LOGD ("update servers (%u domains)", g_hash_table_size (routes->routes));
+
+	/* queries in flight continue with the servers they started with,
+	 * new queries use the new configuration right away. */
+	if (priv->routes)
+		_routes_unref (priv->routes);
+	priv->routes = routes;
+
+	/* answers from the previous servers might not be valid anymore. */
+	nm_dns_stub_flush_cache (self);
+}
+
+/*****************************************************************************/
+
+static void
+_add_server (GArray *servers,
+             const char *domain,
+             int addr_family,
+             gconstpointer addr,
+             int ifindex)
+{
+	NMDnsStubServer *s;
+
+	g_array_set_size (servers, servers->len + 1);
+	s = &g_array_index (servers, NMDnsStubServer, servers->len - 1);
+	s->domain = domain;
+	s->addr_family = addr_family;
+	if (addr_family == AF_INET)
+		s->addr.addr4 = *((const in_addr_t *) addr);
+	else
+		s->addr.addr6 = *((const struct in6_addr *) addr);
+	s->ifindex = ifindex;
+}
+
+static void
+add_ip_config_data (GArray *servers, GPtrArray *strings, const NMDnsIPConfigData *data)
+{
+	const int IS_IPv4 = NM_IS_IP4_CONFIG (data->config);
+	NMIP4Config *ip4 = IS_IPv4 ? (NMIP4Config *) data->config : NULL;
+	NMIP6Config *ip6 = IS_IPv4 ? NULL : (NMIP6Config *) data->config;
+	NMDedupMultiIter ipconf_iter;
+	gs_unref_ptrarray GPtrArray *domains = NULL;
+	guint n_nameservers, i, j;
+	int ifindex;
+
+	n_nameservers = IS_IPv4
+	                ? nm_ip4_config_get_num_nameservers (ip4)
+	                : nm_ip6_config_get_num_nameservers (ip6);
+	if (n_nameservers == 0)
+		return;
+
+	ifindex = IS_IPv4
+	          ? nm_ip4_config_get_ifindex (ip4)
+	          : nm_ip6_config_get_ifindex (ip6);
+
+	/* route the search domains (or the domains, if there are no searches)
+	 * and the reverse domains of the configuration to its nameservers. */
+	domains = g_ptr_array_new ();
+	if (IS_IPv4) {
+		const NMPlatformIP4Address *address;
+		const NMPlatformIP4Route *route;
+		guint n;
+
+		n = nm_ip4_config_get_num_searches (ip4);
+		for (i = 0; i < n; i++)
+			g_ptr_array_add (domains, (gpointer) nm_ip4_config_get_search (ip4, i));
+		if (n == 0) {
+			n = nm_ip4_config_get_num_domains (ip4);
+			for (i = 0; i < n; i++)
+				g_ptr_array_add (domains, (gpointer) nm_ip4_config_get_domain (ip4, i));
+		}
+
+		j = strings->len;
+		nm_ip_config_iter_ip4_address_for_each (&ipconf_iter, ip4, &address)
+			nm_utils_get_reverse_dns_domains_ip4 (address->address, address->plen, strings);
+		nm_ip_config_iter_ip4_route_for_each (&ipconf_iter, ip4, &route)
+			nm_utils_get_reverse_dns_domains_ip4 (route->network, route->plen, strings);
+		for (; j < strings->len; j++)
+			g_ptr_array_add (domains, strings->pdata[j]);
+	} else {
+		const NMPlatformIP6Address *address;
+		const NMPlatformIP6Route *route;
+		guint n;
+
+		n = nm_ip6_config_get_num_searches (ip6);
+		for (i = 0; i < n; i++)
+			g_ptr_array_add (domains, (gpointer) nm_ip6_config_get_search (ip6, i));
+		if (n == 0) {
+			n = nm_ip6_config_get_num_domains (ip6);
+			for (i = 0; i < n; i++)
+				g_ptr_array_add (domains, (gpointer) nm_ip6_config_get_domain (ip6, i));
+		}
+
+		j = strings->len;
+		nm_ip_config_iter_ip6_address_for_each (&ipconf_iter, ip6, &address)
+			nm_utils_get_reverse_dns_domains_ip6 (&address->address, address->plen, strings);
+		nm_ip_config_iter_ip6_route_for_each (&ipconf_iter, ip6, &route)
+			nm_utils_get_reverse_dns_domains_ip6 (&route->network, route->plen, strings);
+		for (; j < strings->len; j++)
+			g_ptr_array_add (domains, strings->pdata[j]);
+	}
+
+	for (i = 0; i < n_nameservers; i++) {
+		int addr_family = IS_IPv4 ? AF_INET : AF_INET6;
+		NMIPAddr addr;
+
+		if (IS_IPv4)
+			addr.addr4 = nm_ip4_config_get_nameserver (ip4, i);
+		else
+			addr.addr6 = *nm_ip6_config_get_nameserver (ip6, i);
+
+		for (j = 0; j < domains->len; j++)
+			_add_server (servers, domains->pdata[j], addr_family, &addr, ifindex);
+
+		/* like the dnsmasq plugin, VPN nameservers are only used for
+		 * the VPN's domains, if it has any. */
+		if (   data->type != NM_DNS_IP_CONFIG_TYPE_VPN
+		    || domains->len == 0)
+			_add_server (servers, NULL, addr_family, &addr, ifindex);
+	}
+}
+
+static void
+add_global_config (GArray *servers, const NMGlobalDnsConfig *config)
+{
+	guint i, j;
+
+	for (i = 0; i < nm_global_dns_config_get_num_domains (config); i++) {
+		NMGlobalDnsDomain *domain = nm_global_dns_config_get_domain (config, i);
+		const char *const *domain_servers = nm_global_dns_domain_get_servers (domain);
+		const char *name = nm_global_dns_domain_get_name (domain);
+
+		for (j = 0; domain_servers && domain_servers[j]; j++) {
+			NMIPAddr addr;
+			int addr_family;
+
+			if (inet_pton (AF_INET, domain_servers[j], &addr.addr4) == 1)
+				addr_family = AF_INET;
+			else if (inet_pton (AF_INET6, domain_servers[j], &addr.addr6) == 1)
+				addr_family = AF_INET6;
+			else
+				continue;
+
+			_add_server (servers,
+			             nm_streq (name, "*") ? NULL : name,
+			             addr_family,
+			             &addr,
+			             0);
+		}
+	}
+}
+
+static gboolean
+update (NMDnsPlugin *plugin,
+        const GPtrArray *configs,
+        const NMGlobalDnsConfig *global_config,
+        const char *hostname)
+{
+	NMDnsStub *self = NM_DNS_STUB (plugin);
+	gs_unref_array GArray *servers = NULL;
+	gs_unref_ptrarray GPtrArray *strings = NULL;
+	gs_free_error GError *error = NULL;
+	guint i;
+	int prio, first_prio = 0;
+
+	if (!nm_dns_stub_start (self, &error)) {
+		_LOGW ("%s", error->message);
+		return FALSE;
+	}
+
+	servers = g_array_new (FALSE, TRUE, sizeof (NMDnsStubServer));
+	strings = g_ptr_array_new_with_free_func (g_free);
+
+	if (global_config)
+		add_global_config (servers, global_config);
+	else {
+		for (i = 0; i < configs->len; i++) {
+			prio = nm_dns_ip_config_data_get_dns_priority (configs->pdata[i]);
+			if (i == 0)
+				first_prio = prio;
+			else if (first_prio < 0 && first_prio != prio)
+				break;
+			add_ip_config_data (servers, strings, configs->pdata[i]);
+		}
+	}
+
+	nm_dns_stub_set_servers (self, (NMDnsStubServer *) servers->data, servers->len);
+	return TRUE;
+}
+
+static gboolean
+is_caching (NMDnsPlugin *plugin)
+{
+	return TRUE;
+}
+
+static const char *
+get_name (NMDnsPlugin *plugin)
+{
+	return "stub";
+}
+
+/*****************************************************************************/
+
+static void
+set_property (GObject *object, guint prop_id, const GValue *value, GParamSpec *pspec)
+{
+	NMDnsStubPrivate *priv = NM_DNS_STUB_GET_PRIVATE ((NMDnsStub *) object);
+
+	switch (prop_id) {
+	case PROP_LISTEN_ADDRESS:
+		/* construct-only */
+		priv->listen_address = g_value_get_uint (value);
+		break;
+	case PROP_LISTEN_PORT:
+		/* construct-only */
+		priv->listen_port = g_value_get_uint (value);
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+		break;
+	}
+}
+
+/*****************************************************************************/
+
+static void
+nm_dns_stub_init (NMDnsStub *self)
+{
+	NMDnsStubPrivate *priv = NM_DNS_STUB_GET_PRIVATE (self);
+
+	priv->listen_fd = -1;
+	priv->tcp_listen_fd = -1;
+	c_list_init (&priv->conns_lst_head);
+	c_list_init (&priv->queries_lst_head);
+	priv->cache = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, _cache_entry_free);
+	c_list_init (&priv->cache_lru_lst_head);
+}
+
+NMDnsPlugin *
+nm_dns_stub_new (void)
+{
+	return nm_dns_stub_new_for_address (STUB_DEFAULT_ADDRESS, DNS_PORT);
+}
+
+NMDnsPlugin *
+nm_dns_stub_new_for_address (in_addr_t listen_address, guint16 listen_port)
+{
+	return g_object_new (NM_TYPE_DNS_STUB,
+	                     NM_DNS_STUB_LISTEN_ADDRESS, (guint) listen_address,
+	                     NM_DNS_STUB_LISTEN_PORT, (guint) listen_port,
+	                     NULL);
+}
+
+static void
+dispose (GObject *object)
+{
+	NMDnsStub *self = NM_DNS_STUB (object);
+	NMDnsStubPrivate *priv = NM_DNS_STUB_GET_PRIVATE (self);
+	Query *query, *query_safe;
+	TcpConn *conn, *conn_safe;
+
+	c_list_for_each_entry_safe (query, query_safe, &priv->queries_lst_head, queries_lst)
+		_query_free (query);
+
+	c_list_for_each_entry_safe (conn, conn_safe, &priv->conns_lst_head, conns_lst)
+		_tcp_conn_close (conn);
+
+	nm_clear_g_source (&priv->listen_id);
+	g_clear_pointer (&priv->listen_channel, g_io_channel_unref);
+	if (priv->listen_fd >= 0) {
+		close (priv->listen_fd);
+		priv->listen_fd = -1;
+	}
+
+	nm_clear_g_source (&priv->tcp_listen_id);
+	g_clear_pointer (&priv->tcp_listen_channel, g_io_channel_unref);
+	if (priv->tcp_listen_fd >= 0) {
+		close (priv->tcp_listen_fd);
+		priv->tcp_listen_fd = -1;
+	}
+
+	g_hash_table_remove_all (priv->cache);
+	g_clear_pointer (&priv->routes, _routes_unref);
+
+	G_OBJECT_CLASS (nm_dns_stub_parent_class)->dispose (object);
+}
+
+static void
+finalize (GObject *object)
+{
+	NMDnsStubPrivate *priv = NM_DNS_STUB_GET_PRIVATE ((NMDnsStub *) object);
+
+	g_hash_table_unref (priv->cache);
+	if (priv->rand)
+		g_rand_free (priv->rand);
+	g_free (priv->query_buf);
+	g_free (priv->buf);
+
+	G_OBJECT_CLASS (nm_dns_stub_parent_class)->finalize (object);
+}
+
+static void
+nm_dns_stub_class_init (NMDnsStubClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	NMDnsPluginClass *plugin_class = NM_DNS_PLUGIN_CLASS (klass);
+
+	object_class->set_property = set_property;
+	object_class->dispose = dispose;
+	object_class->finalize = finalize;
+
+	plugin_class->update = update;
+	plugin_class->is_caching = is_caching;
+	plugin_class->get_name = get_name;
+
+	obj_properties[PROP_LISTEN_ADDRESS] =
+	     g_param_spec_uint (NM_DNS_STUB_LISTEN_ADDRESS, "", "",
+	                        0, G_MAXUINT32, 0,
+	                        G_PARAM_WRITABLE |
+	                        G_PARAM_CONSTRUCT_ONLY |
+	                        G_PARAM_STATIC_STRINGS);
+
+	obj_properties[PROP_LISTEN_PORT] =
+	     g_param_spec_uint (NM_DNS_STUB_LISTEN_PORT, "", "",
+	                        0, G_MAXUINT16, DNS_PORT,
+	                        G_PARAM_WRITABLE |
+	                        G_PARAM_CONSTRUCT_ONLY |
+	                        G_PARAM_STATIC_STRINGS);
+
+	g_object_class_install_properties (object_class, _PROPERTY_ENUMS_LAST, obj_properties);
+}
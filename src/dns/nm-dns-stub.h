@@ -0,0 +1,78 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2017 Red Hat, Inc.
+ */
+
+#ifndef __NETWORKMANAGER_DNS_STUB_H__
+#define __NETWORKMANAGER_DNS_STUB_H__
+
+#include "nm-dns-plugin.h"
+
+#define NM_TYPE_DNS_STUB            (nm_dns_stub_get_type ())
+#define NM_DNS_STUB(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), NM_TYPE_DNS_STUB, NMDnsStub))
+#define NM_DNS_STUB_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), NM_TYPE_DNS_STUB, NMDnsStubClass))
+#define NM_IS_DNS_STUB(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), NM_TYPE_DNS_STUB))
+#define NM_IS_DNS_STUB_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), NM_TYPE_DNS_STUB))
+#define NM_DNS_STUB_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), NM_TYPE_DNS_STUB, NMDnsStubClass))
+
+#define NM_DNS_STUB_LISTEN_ADDRESS  "listen-address"
+#define NM_DNS_STUB_LISTEN_PORT     "listen-port"
+
+typedef struct _NMDnsStub NMDnsStub;
+typedef struct _NMDnsStubClass NMDnsStubClass;
+
+typedef struct {
+	/* the domain for which the server is used, or %NULL for
+	 * the default servers. */
+	const char *domain;
+	int addr_family;
+	NMIPAddr addr;
+	/* zero for the default port 53. */
+	guint16 port;
+	/* the scope of IPv6 link-local servers. */
+	int ifindex;
+} NMDnsStubServer;
+
+typedef struct {
+	guint64 queries;
+	guint64 cache_hits;
+	guint64 forwarded;
+	guint64 timeouts;
+	/* truncated answers fetched again over TCP. */
+	guint64 tcp_retries;
+	guint cache_size;
+	guint in_flight;
+} NMDnsStubStats;
+
+GType nm_dns_stub_get_type (void);
+
+NMDnsPlugin *nm_dns_stub_new (void);
+
+NMDnsPlugin *nm_dns_stub_new_for_address (in_addr_t listen_address, guint16 listen_port);
+
+gboolean nm_dns_stub_start (NMDnsStub *self, GError **error);
+
+guint16 nm_dns_stub_get_port (NMDnsStub *self);
+
+void nm_dns_stub_set_servers (NMDnsStub *self,
+                              const NMDnsStubServer *servers,
+                              guint n_servers);
+
+void nm_dns_stub_flush_cache (NMDnsStub *self);
+
+void nm_dns_stub_get_stats (NMDnsStub *self, NMDnsStubStats *stats);
+
+#endif /* __NETWORKMANAGER_DNS_STUB_H__ */
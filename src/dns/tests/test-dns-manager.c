@@ -0,0 +1,483 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2017 Red Hat, Inc.
+ *
+ */
+
+#include "nm-default.h"
+
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <net/if.h>
+
+#include "dns/nm-dns-manager.h"
+#include "dns/nm-dns-helper.h"
+#include "nm-config.h"
+#include "nm-bus-manager.h"
+#include "nm-exported-object.h"
+#include "nm-ip4-config.h"
+
+#include "nm-test-utils-core.h"
+
+/*****************************************************************************/
+
+static char *gl_conf;
+
+#define CONF_MAIN \
+	"[main]\n" \
+	"dns=default\n" \
+	"rc-manager=unmanaged\n"
+
+/* rewrites the configuration file and reloads it, like on SIGHUP. */
+static void
+_reload_config (const char *extra)
+{
+	gs_free char *contents = NULL;
+	GError *error = NULL;
+
+	contents = g_strconcat (CONF_MAIN, extra, NULL);
+	g_file_set_contents (gl_conf, contents, -1, &error);
+	g_assert_no_error (error);
+	nm_config_reload (nm_config_get (), NM_CONFIG_CHANGE_CAUSE_SIGHUP);
+}
+
+static NMDnsManager *
+_dns_manager_new (void)
+{
+	return g_object_new (NM_TYPE_DNS_MANAGER, NULL);
+}
+
+static void
+_dns_manager_free (NMDnsManager *dns)
+{
+	nm_exported_object_unexport (NM_EXPORTED_OBJECT (dns));
+	g_object_unref (dns);
+}
+
+static NMIP4Config *
+_ip4_config_new (int ifindex, const char *nameserver, int dns_priority)
+{
+	NMIP4Config *config;
+
+	config = nmtst_ip4_config_new (ifindex);
+	nm_ip4_config_add_nameserver (config, nmtst_inet4_from_string (nameserver));
+	nm_ip4_config_set_dns_priority (config, dns_priority);
+	return config;
+}
+
+/* asserts the order of the configurations, as exposed by the
+ * "configuration" property. */
+static void
+_assert_order (NMDnsManager *dns, const char *const*ifaces)
+{
+	gs_unref_variant GVariant *v = NULL;
+	GVariantIter iter;
+	GVariant *entry;
+	guint i = 0;
+
+	g_object_get (dns, NM_DNS_MANAGER_CONFIGURATION, &v, NULL);
+	g_assert (v);
+
+	g_variant_iter_init (&iter, v);
+	while ((entry = g_variant_iter_next_value (&iter))) {
+		const char *iface = NULL;
+
+		g_assert (g_variant_lookup (entry, "interface", "&s", &iface));
+		g_assert (ifaces[i]);
+		g_assert_cmpstr (iface, ==, ifaces[i]);
+		g_variant_unref (entry);
+		i++;
+	}
+	g_assert (!ifaces[i]);
+}
+
+#define assert_order(dns, ...) _assert_order ((dns), (const char *const[]) { __VA_ARGS__, NULL })
+
+/* a DNS priority change alone doesn't update resolv.conf, the caller
+ * batches it with other changes. */
+static void
+_set_dns_priority (NMDnsManager *dns, NMIP4Config *config, int dns_priority)
+{
+	nm_dns_manager_begin_updates (dns, __func__);
+	nm_ip4_config_set_dns_priority (config, dns_priority);
+	nm_dns_manager_end_updates (dns, __func__);
+}
+
+static void
+test_sorted_configs (void)
+{
+	NMDnsManager *dns = _dns_manager_new ();
+	gs_unref_object NMIP4Config *a = _ip4_config_new (1, "192.0.2.1", 100);
+	gs_unref_object NMIP4Config *b = _ip4_config_new (2, "192.0.2.2", 100);
+	gs_unref_object NMIP4Config *c = _ip4_config_new (3, "192.0.2.3", 100);
+	gs_unref_object NMIP4Config *d = _ip4_config_new (4, "192.0.2.4", 100);
+	gs_unref_object NMIP4Config *e = _ip4_config_new (5, "192.0.2.5", 100);
+
+	/* with equal priority and type, the configurations are in the
+	 * order they were added. */
+	g_assert (nm_dns_manager_add_ip4_config (dns, "eth0", a, NM_DNS_IP_CONFIG_TYPE_DEFAULT));
+	g_assert (nm_dns_manager_add_ip4_config (dns, "eth1", b, NM_DNS_IP_CONFIG_TYPE_DEFAULT));
+	g_assert (nm_dns_manager_add_ip4_config (dns, "eth2", c, NM_DNS_IP_CONFIG_TYPE_DEFAULT));
+	assert_order (dns, "eth0", "eth1", "eth2");
+
+	/* the entry moves on the priority notification... */
+	_set_dns_priority (dns, b, 10);
+	assert_order (dns, "eth1", "eth0", "eth2");
+
+	/* ... and can still be found by bisection afterwards. */
+	_set_dns_priority (dns, b, 200);
+	assert_order (dns, "eth0", "eth2", "eth1");
+
+	/* the best device goes first among entries of the same priority. */
+	g_assert (nm_dns_manager_add_ip4_config (dns, "eth3", d, NM_DNS_IP_CONFIG_TYPE_BEST_DEVICE));
+	assert_order (dns, "eth3", "eth0", "eth2", "eth1");
+
+	/* a new best device demotes the previous one, which moves back
+	 * to its position among the default entries. */
+	g_assert (nm_dns_manager_add_ip4_config (dns, "eth4", e, NM_DNS_IP_CONFIG_TYPE_BEST_DEVICE));
+	assert_order (dns, "eth4", "eth0", "eth2", "eth3", "eth1");
+
+	/* the demoted entry is found both on priority change and on removal. */
+	_set_dns_priority (dns, d, 5);
+	assert_order (dns, "eth3", "eth4", "eth0", "eth2", "eth1");
+
+	g_assert (nm_dns_manager_remove_ip4_config (dns, d));
+	assert_order (dns, "eth4", "eth0", "eth2", "eth1");
+	g_assert (!nm_dns_manager_remove_ip4_config (dns, d));
+
+	g_assert (nm_dns_manager_remove_ip4_config (dns, b));
+	g_assert (nm_dns_manager_remove_ip4_config (dns, e));
+	assert_order (dns, "eth0", "eth2");
+	g_assert (nm_dns_manager_remove_ip4_config (dns, a));
+	g_assert (nm_dns_manager_remove_ip4_config (dns, c));
+	assert_order (dns, NULL);
+
+	_dns_manager_free (dns);
+}
+
+/*****************************************************************************/
+
+static void
+_count_cb (GObject *object, GParamSpec *pspec, gpointer user_data)
+{
+	(*((guint *) user_data))++;
+}
+
+static void
+_wait_for_update (NMDnsManager *dns)
+{
+	GMainLoop *loop;
+	gulong id;
+
+	loop = g_main_loop_new (NULL, FALSE);
+	id = g_signal_connect (dns, "notify::" NM_DNS_MANAGER_CONFIGURATION,
+	                       nmtst_main_loop_quit_on_notify, loop);
+	g_assert (nmtst_main_loop_run (loop, 5000));
+	g_signal_handler_disconnect (dns, id);
+	g_main_loop_unref (loop);
+}
+
+static void
+test_debounce (void)
+{
+	NMDnsManager *dns;
+	NMIP4Config *configs[5];
+	char ifname[IFNAMSIZ];
+	guint n_updates = 0;
+	guint n_collapsed_notify = 0;
+	guint64 n_collapsed = 0;
+	guint i;
+
+	_reload_config ("dns-debounce=100\n"
+	                "dns-debounce-max=10000\n");
+
+	dns = _dns_manager_new ();
+	g_signal_connect (dns, "notify::" NM_DNS_MANAGER_CONFIGURATION,
+	                  G_CALLBACK (_count_cb), &n_updates);
+	g_signal_connect (dns, "notify::" NM_DNS_MANAGER_COLLAPSED_UPDATES,
+	                  G_CALLBACK (_count_cb), &n_collapsed_notify);
+
+	/* all changes within the window result in a single update. */
+	for (i = 0; i < G_N_ELEMENTS (configs); i++) {
+		gs_free char *ns = g_strdup_printf ("192.0.2.%u", i + 1);
+
+		configs[i] = _ip4_config_new (i + 1, ns, 100);
+		nm_sprintf_buf (ifname, "eth%u", i);
+		g_assert (nm_dns_manager_add_ip4_config (dns, ifname, configs[i], NM_DNS_IP_CONFIG_TYPE_DEFAULT));
+	}
+	g_assert_cmpint (n_updates, ==, 0);
+	g_assert_cmpint (nm_dns_manager_get_num_collapsed_updates (dns), ==, 4);
+
+	_wait_for_update (dns);
+	g_assert_cmpint (n_updates, ==, 1);
+	g_assert_cmpint (n_collapsed_notify, ==, 1);
+	g_object_get (dns, NM_DNS_MANAGER_COLLAPSED_UPDATES, &n_collapsed, NULL);
+	g_assert_cmpint (n_collapsed, ==, 4);
+	assert_order (dns, "eth0", "eth1", "eth2", "eth3", "eth4");
+
+	/* the same for removals. */
+	for (i = 0; i < G_N_ELEMENTS (configs); i++) {
+		g_assert (nm_dns_manager_remove_ip4_config (dns, configs[i]));
+		g_object_unref (configs[i]);
+	}
+	g_assert_cmpint (n_updates, ==, 1);
+
+	_wait_for_update (dns);
+	g_assert_cmpint (n_updates, ==, 2);
+	g_assert_cmpint (n_collapsed_notify, ==, 2);
+	g_assert_cmpint (nm_dns_manager_get_num_collapsed_updates (dns), ==, 8);
+	assert_order (dns, NULL);
+
+	g_signal_handlers_disconnect_by_func (dns, G_CALLBACK (_count_cb), &n_updates);
+	g_signal_handlers_disconnect_by_func (dns, G_CALLBACK (_count_cb), &n_collapsed_notify);
+	_dns_manager_free (dns);
+
+	_reload_config ("");
+}
+
+/*****************************************************************************/
+
+/* records the finished jobs as "name:ok" or "name:<error>". */
+static void
+_helper_done_cb (NMDnsHelper *helper, const char *name, GError *error, gpointer user_data)
+{
+	GPtrArray *results = user_data;
+
+	g_ptr_array_add (results, g_strdup_printf ("%s:%s", name, error ? error->message : "ok"));
+}
+
+static gboolean
+_helper_queue (NMDnsHelper *helper, const char *name, const char *script, char *input)
+{
+	const char *argv[] = { "/bin/sh", "-c", script, NULL };
+	GError *error = NULL;
+	gboolean success;
+
+	success = nm_dns_helper_queue (helper, name, g_strdupv ((char **) argv), input, &error);
+	g_assert_no_error (error);
+	return success;
+}
+
+static gboolean
+_helper_wait_timeout_cb (gpointer user_data)
+{
+	g_assert_not_reached ();
+	return G_SOURCE_REMOVE;
+}
+
+/* iterates the mainloop until all jobs are done. */
+static void
+_helper_wait (NMDnsHelper *helper)
+{
+	guint id;
+
+	id = g_timeout_add (5000, _helper_wait_timeout_cb, NULL);
+	while (nm_dns_helper_is_running (helper) || nm_dns_helper_has_pending (helper))
+		g_main_context_iteration (NULL, TRUE);
+	g_source_remove (id);
+}
+
+#define assert_results(results, ...) \
+	G_STMT_START { \
+		const char *const _expected[] = { __VA_ARGS__ }; \
+		guint _i; \
+		\
+		g_assert_cmpint ((results)->len, ==, G_N_ELEMENTS (_expected)); \
+		for (_i = 0; _i < G_N_ELEMENTS (_expected); _i++) \
+			g_assert_cmpstr ((results)->pdata[_i], ==, _expected[_i]); \
+		g_ptr_array_set_size ((results), 0); \
+	} G_STMT_END
+
+static void
+test_helper_input (void)
+{
+	gs_unref_ptrarray GPtrArray *results = g_ptr_array_new_with_free_func (g_free);
+	NMDnsHelper *helper;
+	gs_free char *script = NULL;
+	const gsize len = 1024 * 1024;
+	char *input;
+
+	helper = nm_dns_helper_new (_helper_done_cb, results);
+
+	/* the input is larger than the pipe buffer. Queueing returns while
+	 * the helper doesn't read yet, the rest is written from the
+	 * mainloop. */
+	input = g_malloc (len + 1);
+	memset (input, 'x', len);
+	input[len] = '\0';
+	script = g_strdup_printf ("sleep 0.2; test \"$(wc -c)\" -eq %" G_GSIZE_FORMAT, len);
+	g_assert (_helper_queue (helper, "input", script, input));
+	g_assert (nm_dns_helper_is_running (helper));
+
+	_helper_wait (helper);
+	assert_results (results, "input:ok");
+
+	/* a helper that exits without reading its input. */
+	g_assert (_helper_queue (helper, "unread", "exit 0", g_strnfill (len, 'x')));
+	_helper_wait (helper);
+	assert_results (results, "unread:ok");
+
+	nm_dns_helper_free (helper);
+}
+
+static void
+test_helper_pending (void)
+{
+	gs_unref_ptrarray GPtrArray *results = g_ptr_array_new_with_free_func (g_free);
+	NMDnsHelper *helper;
+
+	helper = nm_dns_helper_new (_helper_done_cb, results);
+
+	/* only the newest job runs after the current one. */
+	g_assert (_helper_queue (helper, "a", "sleep 0.1", NULL));
+	g_assert (_helper_queue (helper, "b", "exit 2", NULL));
+	g_assert (nm_dns_helper_has_pending (helper));
+	g_assert (_helper_queue (helper, "c", "exit 3", NULL));
+	_helper_wait (helper);
+	assert_results (results, "a:ok", "c:Error calling c: exited with status 3");
+
+	/* a cleared job doesn't run at all. */
+	g_assert (_helper_queue (helper, "a", "sleep 0.1", NULL));
+	g_assert (_helper_queue (helper, "b", "exit 0", NULL));
+	nm_dns_helper_clear_pending (helper);
+	g_assert (!nm_dns_helper_has_pending (helper));
+	_helper_wait (helper);
+	assert_results (results, "a:ok");
+
+	nm_dns_helper_free (helper);
+}
+
+static gboolean
+_helper_flush_idle_cb (gpointer user_data)
+{
+	*((gboolean *) user_data) = TRUE;
+	return G_SOURCE_CONTINUE;
+}
+
+static void
+test_helper_flush (void)
+{
+	gs_unref_ptrarray GPtrArray *results = g_ptr_array_new_with_free_func (g_free);
+	NMDnsHelper *helper;
+	gboolean idle_dispatched = FALSE;
+	guint idle_id;
+
+	helper = nm_dns_helper_new (_helper_done_cb, results);
+
+	/* flushing waits for the running and the pending job, and still
+	 * sees their exit status. */
+	g_assert (_helper_queue (helper, "a", "sleep 0.1; exit 4", NULL));
+	g_assert (_helper_queue (helper, "b", "exit 0", NULL));
+	nm_dns_helper_flush_sync (helper);
+	g_assert (!nm_dns_helper_is_running (helper));
+	g_assert (!nm_dns_helper_has_pending (helper));
+	assert_results (results, "a:Error calling a: exited with status 4", "b:ok");
+
+	/* a helper that hangs is killed. */
+	g_assert (_helper_queue (helper, "hang", "exec sleep 10", NULL));
+	nm_dns_helper_flush_sync (helper);
+	assert_results (results, "hang:Error calling hang: exited with signal 9");
+
+	/* flushing doesn't dispatch unrelated sources of the default
+	 * context, as NetworkManager is already shutting down. */
+	idle_id = g_idle_add (_helper_flush_idle_cb, &idle_dispatched);
+	g_assert (_helper_queue (helper, "c", "sleep 0.1", g_strdup ("input")));
+	nm_dns_helper_flush_sync (helper);
+	assert_results (results, "c:ok");
+	g_assert (!idle_dispatched);
+	g_source_remove (idle_id);
+
+	nm_dns_helper_free (helper);
+}
+
+static void
+test_helper_free (void)
+{
+	gs_unref_ptrarray GPtrArray *results = g_ptr_array_new_with_free_func (g_free);
+	NMDnsHelper *helper;
+	GMainLoop *loop;
+
+	helper = nm_dns_helper_new (_helper_done_cb, results);
+
+	/* the running helper is terminated, and the callback is no longer
+	 * invoked for it. */
+	g_assert (_helper_queue (helper, "a", "exec sleep 10", g_strdup ("input")));
+	g_assert (_helper_queue (helper, "b", "exit 0", NULL));
+	nm_dns_helper_free (helper);
+
+	loop = g_main_loop_new (NULL, FALSE);
+	g_assert (!nmtst_main_loop_run (loop, 200));
+	g_main_loop_unref (loop);
+	g_assert_cmpint (results->len, ==, 0);
+}
+
+/*****************************************************************************/
+
+NMTST_DEFINE ();
+
+int
+main (int argc, char **argv)
+{
+	gs_free char *tmpdir = NULL;
+	const char *args[] = { "test-dns-manager", "--config", NULL, "--config-dir", "/no/such/dir",
+	                       "--intern-config", "", "--system-config-dir", "", NULL };
+	char **argv_cfg = (char **) args;
+	int argc_cfg = G_N_ELEMENTS (args) - 1;
+	NMConfigCmdLineOptions *cli;
+	GOptionContext *context;
+	GError *error = NULL;
+	int r;
+
+	nmtst_init_with_logging (&argc, &argv, NULL, "ALL");
+
+	/* like NetworkManager itself, for helpers that don't read their input. */
+	signal (SIGPIPE, SIG_IGN);
+
+	/* don't connect to D-Bus, see test-config.c. */
+	nm_bus_manager_setup (g_object_new (NM_TYPE_BUS_MANAGER, NULL));
+
+	tmpdir = g_dir_make_tmp ("test-dns-manager-XXXXXX", &error);
+	g_assert_no_error (error);
+	gl_conf = g_build_filename (tmpdir, "NetworkManager.conf", NULL);
+	g_file_set_contents (gl_conf, CONF_MAIN, -1, &error);
+	g_assert_no_error (error);
+	args[2] = gl_conf;
+
+	cli = nm_config_cmd_line_options_new (FALSE);
+	context = g_option_context_new (NULL);
+	nm_config_cmd_line_options_add_to_entries (cli, context);
+	g_assert (g_option_context_parse (context, &argc_cfg, &argv_cfg, NULL));
+	g_option_context_free (context);
+	nm_config_setup (cli, NULL, &error);
+	g_assert_no_error (error);
+	nm_config_cmd_line_options_free (cli);
+
+	g_test_add_func ("/dns-manager/sorted-configs", test_sorted_configs);
+	g_test_add_func ("/dns-manager/debounce", test_debounce);
+	g_test_add_func ("/dns-manager/helper/input", test_helper_input);
+	g_test_add_func ("/dns-manager/helper/pending", test_helper_pending);
+	g_test_add_func ("/dns-manager/helper/flush", test_helper_flush);
+	g_test_add_func ("/dns-manager/helper/free", test_helper_free);
+
+	r = g_test_run ();
+
+	unlink (gl_conf);
+	g_free (gl_conf);
+	rmdir (tmpdir);
+	return r;
+}
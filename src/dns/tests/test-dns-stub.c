@@ -0,0 +1,815 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2017 Red Hat, Inc.
+ *
+ */
+
+#include "nm-default.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+#include "dns/nm-dns-stub.h"
+
+#include "nm-test-utils-core.h"
+
+#define LOOPBACK htonl (INADDR_LOOPBACK)
+
+/*****************************************************************************/
+
+/* A stand-in for an upstream nameserver. It answers every query with
+ * n_records A records, or with NXDOMAIN for names starting with "nx.".
+ * Over UDP it can send truncated answers, which it then answers over TCP. */
+typedef struct {
+	int fd;
+	int tcp_fd;
+	guint16 port;
+	GIOChannel *channel;
+	GIOChannel *tcp_channel;
+	guint id;
+	guint tcp_id;
+	guint n_queries;
+	guint n_tcp_queries;
+	in_addr_t answer;
+	guint32 ttl;
+	guint rcode;
+	guint n_records;
+	gboolean truncate;
+	/* sends a forged answer from another port before the real one. */
+	gboolean spoof;
+	/* the source ports of the queries. */
+	GArray *ports;
+} Upstream;
+
+/* Turns the query in @buf into the answer. Returns its length. */
+static gsize
+_upstream_answer (Upstream *u, guint8 *buf, gsize n, gboolean truncate)
+{
+	gsize offset;
+	gboolean nx;
+	guint i;
+
+	/* skip the name of the question. */
+	for (offset = 12; offset < n && buf[offset]; offset += buf[offset] + 1)
+		;
+	offset += 1 + 4;
+	g_assert_cmpint (offset, <=, n);
+
+	nx = buf[12] == 2 && g_ascii_strncasecmp ((char *) &buf[13], "nx", 2) == 0;
+
+	buf[2] = 0x80 | (buf[2] & 0x01) | (truncate ? 0x02 : 0);
+	buf[3] = 0x80 | (u->rcode ?: (nx ? 3 : 0));
+	buf[6] = buf[7] = buf[8] = buf[9] = buf[10] = buf[11] = 0;
+
+	if (u->rcode || truncate) {
+		/* no records */
+	} else if (nx) {
+		static const guint8 soa[] = {
+			0xC0, 0x0C, 0, 6, 0, 1, 0, 0, 0x0E, 0x10, 0, 22,
+			0, 0,
+			0, 0, 0, 1,  0, 0, 0, 1,  0, 0, 0, 1,  0, 0, 0, 1,
+		};
+
+		buf[9] = 1;
+		memcpy (&buf[offset], soa, sizeof (soa));
+		/* the MINIMUM field */
+		buf[offset + sizeof (soa)] = u->ttl >> 24;
+		buf[offset + sizeof (soa) + 1] = u->ttl >> 16;
+		buf[offset + sizeof (soa) + 2] = u->ttl >> 8;
+		buf[offset + sizeof (soa) + 3] = u->ttl;
+		offset += sizeof (soa) + 4;
+	} else {
+		static const guint8 a[] = { 0xC0, 0x0C, 0, 1, 0, 1 };
+
+		buf[7] = u->n_records;
+		for (i = 0; i < u->n_records; i++) {
+			memcpy (&buf[offset], a, sizeof (a));
+			offset += sizeof (a);
+			buf[offset++] = u->ttl >> 24;
+			buf[offset++] = u->ttl >> 16;
+			buf[offset++] = u->ttl >> 8;
+			buf[offset++] = u->ttl;
+			buf[offset++] = 0;
+			buf[offset++] = 4;
+			memcpy (&buf[offset], &u->answer, 4);
+			offset += 4;
+		}
+	}
+
+	return offset;
+}
+
+static gboolean
+_upstream_cb (GIOChannel *source, GIOCondition condition, gpointer user_data)
+{
+	Upstream *u = user_data;
+	guint8 buf[4096];
+	struct sockaddr_in addr;
+	socklen_t addr_len = sizeof (addr);
+	guint16 port;
+	gssize n;
+	gsize len;
+
+	n = recvfrom (u->fd, buf, 512, MSG_DONTWAIT, (struct sockaddr *) &addr, &addr_len);
+	if (n < 12)
+		return G_SOURCE_CONTINUE;
+
+	u->n_queries++;
+	port = ntohs (addr.sin_port);
+	g_array_append_val (u->ports, port);
+
+	if (u->spoof) {
+		guint8 forged[4096];
+		int fd;
+
+		memcpy (forged, buf, n);
+		len = _upstream_answer (u, forged, n, FALSE);
+		/* a different address in the answer. */
+		forged[len - 1] ^= 0xFF;
+		fd = socket (AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+		g_assert (fd >= 0);
+		g_assert_cmpint (sendto (fd, forged, len, 0, (struct sockaddr *) &addr, addr_len), ==, len);
+		close (fd);
+	}
+
+	len = _upstream_answer (u, buf, n, u->truncate);
+	g_assert_cmpint (sendto (u->fd, buf, len, 0, (struct sockaddr *) &addr, addr_len), ==, len);
+	return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+_upstream_tcp_conn_cb (GIOChannel *source, GIOCondition condition, gpointer user_data)
+{
+	Upstream *u = user_data;
+	int fd = g_io_channel_unix_get_fd (source);
+	guint8 buf[4096];
+	gssize n;
+	gsize len;
+
+	/* the stub writes the query at once, it's read completely. */
+	n = recv (fd, buf, sizeof (buf), 0);
+	if (n <= 0) {
+		close (fd);
+		return G_SOURCE_REMOVE;
+	}
+	g_assert_cmpint (n, >=, 2 + 12);
+	g_assert_cmpint ((buf[0] << 8) | buf[1], ==, n - 2);
+
+	u->n_tcp_queries++;
+
+	len = _upstream_answer (u, &buf[2], n - 2, FALSE);
+	buf[0] = len >> 8;
+	buf[1] = len;
+	g_assert_cmpint (send (fd, buf, 2 + len, MSG_NOSIGNAL), ==, 2 + len);
+	return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+_upstream_tcp_cb (GIOChannel *source, GIOCondition condition, gpointer user_data)
+{
+	Upstream *u = user_data;
+	GIOChannel *channel;
+	int fd;
+
+	fd = accept4 (u->tcp_fd, NULL, NULL, SOCK_CLOEXEC);
+	g_assert (fd >= 0);
+	channel = g_io_channel_unix_new (fd);
+	g_io_add_watch (channel, G_IO_IN | G_IO_HUP, _upstream_tcp_conn_cb, u);
+	g_io_channel_unref (channel);
+	return G_SOURCE_CONTINUE;
+}
+
+static void
+_upstream_init (Upstream *u, const char *answer)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_addr.s_addr = LOOPBACK,
+	};
+	socklen_t addr_len = sizeof (addr);
+
+	memset (u, 0, sizeof (*u));
+	u->fd = socket (AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	g_assert (u->fd >= 0);
+	g_assert_cmpint (bind (u->fd, (struct sockaddr *) &addr, sizeof (addr)), ==, 0);
+	g_assert_cmpint (getsockname (u->fd, (struct sockaddr *) &addr, &addr_len), ==, 0);
+	u->port = ntohs (addr.sin_port);
+	u->answer = nmtst_inet4_from_string (answer);
+	u->ttl = 300;
+	u->n_records = 1;
+	u->ports = g_array_new (FALSE, FALSE, sizeof (guint16));
+	u->channel = g_io_channel_unix_new (u->fd);
+	u->id = g_io_add_watch (u->channel, G_IO_IN, _upstream_cb, u);
+
+	u->tcp_fd = socket (AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	g_assert (u->tcp_fd >= 0);
+	g_assert_cmpint (bind (u->tcp_fd, (struct sockaddr *) &addr, sizeof (addr)), ==, 0);
+	g_assert_cmpint (listen (u->tcp_fd, 5), ==, 0);
+	u->tcp_channel = g_io_channel_unix_new (u->tcp_fd);
+	u->tcp_id = g_io_add_watch (u->tcp_channel, G_IO_IN, _upstream_tcp_cb, u);
+}
+
+static void
+_upstream_clear (Upstream *u)
+{
+	nm_clear_g_source (&u->id);
+	nm_clear_g_source (&u->tcp_id);
+	g_io_channel_unref (u->channel);
+	g_io_channel_unref (u->tcp_channel);
+	close (u->fd);
+	close (u->tcp_fd);
+	g_array_unref (u->ports);
+}
+
+static NMDnsStubServer
+_server (const Upstream *u, const char *domain)
+{
+	NMDnsStubServer s = {
+		.domain = domain,
+		.addr_family = AF_INET,
+		.addr.addr4 = LOOPBACK,
+		.port = u->port,
+	};
+
+	return s;
+}
+
+/*****************************************************************************/
+
+static NMDnsStub *
+_stub_new (void)
+{
+	NMDnsStub *stub;
+	GError *error = NULL;
+
+	stub = NM_DNS_STUB (nm_dns_stub_new_for_address (LOOPBACK, 0));
+	g_assert (nm_dns_stub_start (stub, &error));
+	g_assert_no_error (error);
+	g_assert_cmpint (nm_dns_stub_get_port (stub), !=, 0);
+	return stub;
+}
+
+static int
+_client_new (NMDnsStub *stub)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_addr.s_addr = LOOPBACK,
+		.sin_port = htons (nm_dns_stub_get_port (stub)),
+	};
+	int fd;
+
+	fd = socket (AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	g_assert (fd >= 0);
+	g_assert_cmpint (connect (fd, (struct sockaddr *) &addr, sizeof (addr)), ==, 0);
+	return fd;
+}
+
+static gsize
+_query_build (guint8 *buf, guint16 id, const char *name)
+{
+	gsize len = 12;
+	gs_strfreev char **labels = g_strsplit (name, ".", -1);
+	guint i;
+
+	memset (buf, 0, 12);
+	buf[0] = id >> 8;
+	buf[1] = id;
+	buf[2] = 0x01;
+	buf[5] = 1;
+	for (i = 0; labels[i]; i++) {
+		gsize l = strlen (labels[i]);
+
+		buf[len++] = l;
+		memcpy (&buf[len], labels[i], l);
+		len += l;
+	}
+	buf[len++] = 0;
+	buf[len++] = 0;
+	buf[len++] = 1;
+	buf[len++] = 0;
+	buf[len++] = 1;
+	return len;
+}
+
+static void
+_client_send (int fd, guint16 id, const char *name)
+{
+	guint8 buf[300];
+	gsize len;
+
+	len = _query_build (buf, id, name);
+	g_assert_cmpint (send (fd, buf, len, 0), ==, len);
+}
+
+static gboolean
+_timeout_cb (gpointer user_data)
+{
+	g_assert_not_reached ();
+	return G_SOURCE_REMOVE;
+}
+
+/* Runs the mainloop until the answer arrives. Returns its length. */
+static gsize
+_client_recv (int fd, guint8 *buf, gsize len)
+{
+	guint timeout_id;
+	gssize n;
+
+	timeout_id = g_timeout_add_seconds (5, _timeout_cb, NULL);
+	while ((n = recv (fd, buf, len, MSG_DONTWAIT)) < 0) {
+		g_assert (NM_IN_SET (errno, EAGAIN, EWOULDBLOCK));
+		g_main_context_iteration (NULL, TRUE);
+	}
+	g_source_remove (timeout_id);
+
+	g_assert_cmpint (n, >=, 12);
+	return n;
+}
+
+static int
+_tcp_client_new (NMDnsStub *stub)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_addr.s_addr = LOOPBACK,
+		.sin_port = htons (nm_dns_stub_get_port (stub)),
+	};
+	int fd;
+
+	fd = socket (AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	g_assert (fd >= 0);
+	g_assert_cmpint (connect (fd, (struct sockaddr *) &addr, sizeof (addr)), ==, 0);
+	return fd;
+}
+
+static void
+_tcp_client_send (int fd, guint16 id, const char *name)
+{
+	guint8 buf[302];
+	gsize len;
+
+	len = _query_build (&buf[2], id, name);
+	buf[0] = len >> 8;
+	buf[1] = len;
+	g_assert_cmpint (send (fd, buf, 2 + len, MSG_NOSIGNAL), ==, 2 + len);
+}
+
+/* Runs the mainloop until an answer arrives. Returns its length, or zero
+ * once the stub closed the connection. */
+static gsize
+_tcp_client_recv (int fd, guint8 *buf, gsize len)
+{
+	guint8 len_buf[2];
+	guint timeout_id;
+	gssize n;
+
+	timeout_id = g_timeout_add_seconds (5, _timeout_cb, NULL);
+	while ((n = recv (fd, len_buf, 2, MSG_DONTWAIT | MSG_PEEK)) < 2) {
+		if (n == 0)
+			break;
+		g_assert (n > 0 || NM_IN_SET (errno, EAGAIN, EWOULDBLOCK));
+		g_main_context_iteration (NULL, TRUE);
+	}
+	g_source_remove (timeout_id);
+
+	if (n == 0)
+		return 0;
+
+	/* the stub writes each answer at once. */
+	g_assert_cmpint (recv (fd, len_buf, 2, MSG_WAITALL), ==, 2);
+	n = (len_buf[0] << 8) | len_buf[1];
+	g_assert_cmpint (n, <=, len);
+	g_assert_cmpint (recv (fd, buf, n, MSG_WAITALL), ==, n);
+	g_assert_cmpint (n, >=, 12);
+	return n;
+}
+
+typedef struct {
+	guint16 id;
+	guint rcode;
+	guint n_answers;
+	in_addr_t addr;
+	guint32 ttl;
+	char qname0;
+	gboolean truncated;
+} Answer;
+
+static Answer
+_answer_parse (const guint8 *buf, gsize n)
+{
+	Answer a = { 0 };
+	gsize offset;
+
+	a.id = (buf[0] << 8) | buf[1];
+	g_assert (buf[2] & 0x80);
+	a.truncated = !!(buf[2] & 0x02);
+	a.rcode = buf[3] & 0xF;
+	a.n_answers = (buf[6] << 8) | buf[7];
+	a.qname0 = buf[13];
+
+	if (a.n_answers) {
+		for (offset = 12; buf[offset]; offset += buf[offset] + 1)
+			;
+		offset += 1 + 4;
+		g_assert_cmpint (offset + 16 * a.n_answers, <=, n);
+		g_assert_cmpint (buf[offset], ==, 0xC0);
+		a.ttl = (buf[offset + 6] << 24) | (buf[offset + 7] << 16) | (buf[offset + 8] << 8) | buf[offset + 9];
+		memcpy (&a.addr, &buf[offset + 12], 4);
+	}
+	return a;
+}
+
+static Answer
+_client_query (int fd, guint16 id, const char *name)
+{
+	guint8 buf[512];
+	gsize n;
+
+	_client_send (fd, id, name);
+	n = _client_recv (fd, buf, sizeof (buf));
+	return _answer_parse (buf, n);
+}
+
+static Answer
+_tcp_client_query (int fd, guint16 id, const char *name)
+{
+	guint8 buf[4096];
+	gsize n;
+
+	_tcp_client_send (fd, id, name);
+	n = _tcp_client_recv (fd, buf, sizeof (buf));
+	g_assert_cmpint (n, >, 0);
+	return _answer_parse (buf, n);
+}
+
+/*****************************************************************************/
+
+static void
+test_cache (void)
+{
+	gs_unref_object NMDnsStub *stub = _stub_new ();
+	NMDnsStubServer servers[1];
+	NMDnsStubStats stats;
+	Upstream u;
+	Answer a;
+	int fd;
+
+	_upstream_init (&u, "192.0.2.1");
+	servers[0] = _server (&u, NULL);
+	nm_dns_stub_set_servers (stub, servers, G_N_ELEMENTS (servers));
+	fd = _client_new (stub);
+
+	a = _client_query (fd, 1, "www.example.com");
+	g_assert_cmpint (a.id, ==, 1);
+	g_assert_cmpint (a.rcode, ==, 0);
+	g_assert_cmpint (a.n_answers, ==, 1);
+	g_assert_cmpint (a.addr, ==, nmtst_inet4_from_string ("192.0.2.1"));
+	g_assert_cmpint (u.n_queries, ==, 1);
+
+	/* answered from the cache, with the ID and spelling of the client. */
+	a = _client_query (fd, 2, "WWW.example.COM");
+	g_assert_cmpint (a.id, ==, 2);
+	g_assert_cmpint (a.qname0, ==, 'W');
+	g_assert_cmpint (a.n_answers, ==, 1);
+	g_assert_cmpint (a.addr, ==, nmtst_inet4_from_string ("192.0.2.1"));
+	g_assert_cmpint (a.ttl, <=, 300);
+	g_assert_cmpint (u.n_queries, ==, 1);
+
+	/* negative answers are cached too. */
+	a = _client_query (fd, 3, "nx.example.com");
+	g_assert_cmpint (a.rcode, ==, 3);
+	a = _client_query (fd, 4, "nx.example.com");
+	g_assert_cmpint (a.rcode, ==, 3);
+	g_assert_cmpint (u.n_queries, ==, 2);
+
+	/* an answer with zero TTL is not. */
+	u.ttl = 0;
+	a = _client_query (fd, 5, "zero.example.com");
+	a = _client_query (fd, 6, "zero.example.com");
+	g_assert_cmpint (a.n_answers, ==, 1);
+	g_assert_cmpint (u.n_queries, ==, 4);
+
+	nm_dns_stub_get_stats (stub, &stats);
+	g_assert_cmpint (stats.queries, ==, 6);
+	g_assert_cmpint (stats.cache_hits, ==, 2);
+	g_assert_cmpint (stats.forwarded, ==, 4);
+	g_assert_cmpint (stats.cache_size, ==, 2);
+	g_assert_cmpint (stats.in_flight, ==, 0);
+
+	close (fd);
+	_upstream_clear (&u);
+}
+
+/*****************************************************************************/
+
+static void
+test_split (void)
+{
+	gs_unref_object NMDnsStub *stub = _stub_new ();
+	NMDnsStubServer servers[3];
+	NMDnsStubStats stats;
+	Upstream u_default, u_corp, u_fail;
+	Answer a;
+	int fd;
+
+	_upstream_init (&u_default, "192.0.2.1");
+	_upstream_init (&u_corp, "192.0.2.2");
+	_upstream_init (&u_fail, "192.0.2.3");
+	u_fail.rcode = 2;
+
+	servers[0] = _server (&u_default, NULL);
+	servers[1] = _server (&u_fail, "corp.example");
+	servers[2] = _server (&u_corp, "Corp.Example.");
+	nm_dns_stub_set_servers (stub, servers, G_N_ELEMENTS (servers));
+	fd = _client_new (stub);
+
+	/* the longest matching domain wins. A server failing with SERVFAIL
+	 * makes the stub try the next one. */
+	a = _client_query (fd, 1, "host.corp.example");
+	g_assert_cmpint (a.addr, ==, nmtst_inet4_from_string ("192.0.2.2"));
+	g_assert_cmpint (u_fail.n_queries, ==, 1);
+	g_assert_cmpint (u_corp.n_queries, ==, 1);
+
+	a = _client_query (fd, 2, "corp.example");
+	g_assert_cmpint (a.addr, ==, nmtst_inet4_from_string ("192.0.2.2"));
+
+	a = _client_query (fd, 3, "host.othercorp.example");
+	g_assert_cmpint (a.addr, ==, nmtst_inet4_from_string ("192.0.2.1"));
+	g_assert_cmpint (u_default.n_queries, ==, 1);
+
+	/* setting the same configuration again keeps the cache. */
+	nm_dns_stub_set_servers (stub, servers, G_N_ELEMENTS (servers));
+	nm_dns_stub_get_stats (stub, &stats);
+	g_assert_cmpint (stats.cache_size, ==, 3);
+
+	/* a new configuration takes effect at once and drops the cache. */
+	servers[0] = _server (&u_corp, NULL);
+	nm_dns_stub_set_servers (stub, servers, 1);
+	nm_dns_stub_get_stats (stub, &stats);
+	g_assert_cmpint (stats.cache_size, ==, 0);
+
+	a = _client_query (fd, 4, "host.othercorp.example");
+	g_assert_cmpint (a.addr, ==, nmtst_inet4_from_string ("192.0.2.2"));
+
+	/* without servers, queries fail. */
+	nm_dns_stub_set_servers (stub, NULL, 0);
+	a = _client_query (fd, 5, "host.othercorp.example");
+	g_assert_cmpint (a.rcode, ==, 2);
+
+	close (fd);
+	_upstream_clear (&u_default);
+	_upstream_clear (&u_corp);
+	_upstream_clear (&u_fail);
+}
+
+/*****************************************************************************/
+
+static void
+test_tcp (void)
+{
+	gs_unref_object NMDnsStub *stub = _stub_new ();
+	NMDnsStubServer servers[1];
+	NMDnsStubStats stats;
+	Upstream u;
+	guint8 buf[512];
+	guint16 ids = 0;
+	Answer a;
+	guint i;
+	int fd;
+
+	_upstream_init (&u, "192.0.2.1");
+	servers[0] = _server (&u, NULL);
+	nm_dns_stub_set_servers (stub, servers, G_N_ELEMENTS (servers));
+	fd = _tcp_client_new (stub);
+
+	a = _tcp_client_query (fd, 1, "www.example.com");
+	g_assert_cmpint (a.id, ==, 1);
+	g_assert_cmpint (a.n_answers, ==, 1);
+	g_assert_cmpint (a.addr, ==, nmtst_inet4_from_string ("192.0.2.1"));
+	g_assert_cmpint (u.n_queries, ==, 1);
+
+	/* TCP and UDP clients share the cache. */
+	a = _tcp_client_query (fd, 2, "www.example.com");
+	g_assert_cmpint (a.id, ==, 2);
+	g_assert_cmpint (a.n_answers, ==, 1);
+	g_assert_cmpint (u.n_queries, ==, 1);
+
+	/* several queries on one connection are answered as they complete. */
+	_tcp_client_send (fd, 3, "a.example.com");
+	_tcp_client_send (fd, 4, "b.example.com");
+	for (i = 0; i < 2; i++) {
+		a = _answer_parse (buf, _tcp_client_recv (fd, buf, sizeof (buf)));
+		g_assert (NM_IN_SET (a.id, 3, 4));
+		ids |= 1 << a.id;
+	}
+	g_assert_cmpint (ids, ==, (1 << 3) | (1 << 4));
+
+	/* a client that stops sending still gets its answer, then the stub
+	 * closes the connection. */
+	_tcp_client_send (fd, 5, "c.example.com");
+	g_assert_cmpint (shutdown (fd, SHUT_WR), ==, 0);
+	a = _answer_parse (buf, _tcp_client_recv (fd, buf, sizeof (buf)));
+	g_assert_cmpint (a.id, ==, 5);
+	g_assert_cmpint (_tcp_client_recv (fd, buf, sizeof (buf)), ==, 0);
+
+	nm_dns_stub_get_stats (stub, &stats);
+	g_assert_cmpint (stats.queries, ==, 5);
+	g_assert_cmpint (stats.in_flight, ==, 0);
+
+	close (fd);
+	_upstream_clear (&u);
+}
+
+static void
+test_truncated (void)
+{
+	gs_unref_object NMDnsStub *stub = _stub_new ();
+	NMDnsStubServer servers[1];
+	NMDnsStubStats stats;
+	Upstream u;
+	Answer a;
+	int fd, tcp_fd;
+
+	_upstream_init (&u, "192.0.2.1");
+	u.truncate = TRUE;
+	servers[0] = _server (&u, NULL);
+	nm_dns_stub_set_servers (stub, servers, G_N_ELEMENTS (servers));
+	fd = _client_new (stub);
+
+	/* a truncated answer is fetched again over TCP. */
+	a = _client_query (fd, 1, "www.example.com");
+	g_assert (!a.truncated);
+	g_assert_cmpint (a.n_answers, ==, 1);
+	g_assert_cmpint (a.addr, ==, nmtst_inet4_from_string ("192.0.2.1"));
+	g_assert_cmpint (u.n_queries, ==, 1);
+	g_assert_cmpint (u.n_tcp_queries, ==, 1);
+
+	/* if the full answer is too large for the client, it is told to
+	 * ask again over TCP... */
+	u.n_records = 40;
+	a = _client_query (fd, 2, "big.example.com");
+	g_assert (a.truncated);
+	g_assert_cmpint (a.n_answers, ==, 0);
+	g_assert_cmpint (u.n_tcp_queries, ==, 2);
+
+	/* ... and then gets it from the cache. */
+	tcp_fd = _tcp_client_new (stub);
+	a = _tcp_client_query (tcp_fd, 3, "big.example.com");
+	g_assert (!a.truncated);
+	g_assert_cmpint (a.n_answers, ==, 40);
+	g_assert_cmpint (u.n_queries, ==, 2);
+	g_assert_cmpint (u.n_tcp_queries, ==, 2);
+
+	nm_dns_stub_get_stats (stub, &stats);
+	g_assert_cmpint (stats.tcp_retries, ==, 2);
+	g_assert_cmpint (stats.cache_hits, ==, 1);
+
+	close (tcp_fd);
+	close (fd);
+	_upstream_clear (&u);
+}
+
+static void
+test_ports (void)
+{
+	gs_unref_object NMDnsStub *stub = _stub_new ();
+	NMDnsStubServer servers[1];
+	Upstream u;
+	Answer a;
+	guint i, j, n_distinct = 0;
+	int fd;
+
+	_upstream_init (&u, "192.0.2.1");
+	u.spoof = TRUE;
+	servers[0] = _server (&u, NULL);
+	nm_dns_stub_set_servers (stub, servers, G_N_ELEMENTS (servers));
+	fd = _client_new (stub);
+
+	/* answers from another port than the server's are ignored, even with
+	 * the right ID. */
+	for (i = 0; i < 10; i++) {
+		gs_free char *name = g_strdup_printf ("host%u.example.com", i);
+
+		a = _client_query (fd, i, name);
+		g_assert_cmpint (a.n_answers, ==, 1);
+		g_assert_cmpint (a.addr, ==, nmtst_inet4_from_string ("192.0.2.1"));
+	}
+
+	/* every query comes from its own random port. */
+	g_assert_cmpint (u.ports->len, ==, 10);
+	for (i = 0; i < u.ports->len; i++) {
+		for (j = 0; j < i; j++) {
+			if (g_array_index (u.ports, guint16, i) == g_array_index (u.ports, guint16, j))
+				break;
+		}
+		if (j == i)
+			n_distinct++;
+	}
+	g_assert_cmpint (n_distinct, >=, 8);
+
+	close (fd);
+	_upstream_clear (&u);
+}
+
+/*****************************************************************************/
+
+static void
+test_benchmark (void)
+{
+	const guint n = nmtst_test_quick () ? 200 : 5000;
+	const guint window = 32;
+	gs_unref_object NMDnsStub *stub = _stub_new ();
+	NMDnsStubServer servers[1];
+	Upstream u;
+	guint8 buf[512];
+	gint64 t_start, t_miss, t_hit, t_qps;
+	guint i, sent, received;
+	int fd;
+
+	_upstream_init (&u, "192.0.2.1");
+	servers[0] = _server (&u, NULL);
+	nm_dns_stub_set_servers (stub, servers, G_N_ELEMENTS (servers));
+	fd = _client_new (stub);
+
+	/* latency of queries going upstream. */
+	t_start = g_get_monotonic_time ();
+	for (i = 0; i < 100; i++) {
+		gs_free char *name = g_strdup_printf ("miss%u.example.com", i);
+
+		_client_send (fd, i, name);
+		_client_recv (fd, buf, sizeof (buf));
+	}
+	t_miss = (g_get_monotonic_time () - t_start) / 100;
+
+	/* latency of answers from the cache. */
+	t_start = g_get_monotonic_time ();
+	for (i = 0; i < 100; i++) {
+		gs_free char *name = g_strdup_printf ("miss%u.example.com", i);
+
+		_client_send (fd, i, name);
+		_client_recv (fd, buf, sizeof (buf));
+	}
+	t_hit = (g_get_monotonic_time () - t_start) / 100;
+	g_assert_cmpint (u.n_queries, ==, 100);
+
+	/* throughput with several queries in flight, half of them hits. */
+	t_start = g_get_monotonic_time ();
+	for (sent = 0, received = 0; received < n; ) {
+		while (sent < n && sent - received < window) {
+			gs_free char *name = g_strdup_printf ("%s%u.example.com",
+			                                      sent % 2 ? "miss" : "qps",
+			                                      sent % 2 ? sent % 100 : sent);
+
+			_client_send (fd, sent, name);
+			sent++;
+		}
+		_client_recv (fd, buf, sizeof (buf));
+		received++;
+	}
+	t_qps = g_get_monotonic_time () - t_start;
+
+	g_test_message ("latency: %"G_GINT64_FORMAT" usec upstream, %"G_GINT64_FORMAT" usec cached",
+	                t_miss, t_hit);
+	g_test_message ("throughput: %u queries in %"G_GINT64_FORMAT" usec (%.0f queries/sec)",
+	                n, t_qps, n * 1e6 / MAX (t_qps, 1));
+
+	close (fd);
+	_upstream_clear (&u);
+}
+
+/*****************************************************************************/
+
+NMTST_DEFINE ();
+
+int
+main (int argc, char **argv)
+{
+	nmtst_init_with_logging (&argc, &argv, NULL, "ALL");
+
+	g_test_add_func ("/dns-stub/cache", test_cache);
+	g_test_add_func ("/dns-stub/split", test_split);
+	g_test_add_func ("/dns-stub/tcp", test_tcp);
+	g_test_add_func ("/dns-stub/truncated", test_truncated);
+	g_test_add_func ("/dns-stub/ports", test_ports);
+	g_test_add_func ("/dns-stub/benchmark", test_benchmark);
+
+	return g_test_run ();
+}
@@ -32,6 +32,7 @@
 #include "nm-utils.h"
 #include "platform/nm-platform.h"
 #include "platform/nmp-netns.h"
+#include "nm-timer-wheel.h"
 
 #define _NMLOG_PREFIX_NAME                "ndisc"
 
@@ -54,7 +55,7 @@ struct _NMNDiscPrivate {
 		gint32 last_ra;
 	};
 	guint ra_timeout_id;  /* first RA timeout */
-	guint timeout_id;   /* prefix/dns/etc lifetime timeout */
+	NMTimerWheelEntry timeout;   /* prefix/dns/etc lifetime timeout */
 	char *last_error;
 	NMUtilsIPv6IfaceId iid;
 
@@ -948,8 +949,6 @@ clean_dns_domains (NMNDisc *ndisc, guint32 now, NMNDiscConfigMap *changed, guint
 	}
 }
 
-static gboolean timeout_cb (gpointer user_data);
-
 static void
 check_timestamps (NMNDisc *ndisc, guint32 now, NMNDiscConfigMap changed)
 {
@@ -958,7 +957,7 @@ check_timestamps (NMNDisc *ndisc, guint32 now, NMNDiscConfigMap changed)
 	guint32 never = G_MAXINT32;
 	guint32 nextevent = never;
 
-	nm_clear_g_source (&priv->timeout_id);
+	nm_timer_wheel_cancel (nm_timer_wheel_get (), &priv->timeout);
 
 	clean_gateways (ndisc, now, &changed, &nextevent);
 	clean_addresses (ndisc, now, &changed, &nextevent);
@@ -973,18 +972,16 @@ check_timestamps (NMNDisc *ndisc, guint32 now, NMNDiscConfigMap changed)
 		g_return_if_fail (nextevent > now);
 		_LOGD ("scheduling next now/lifetime check: %u seconds",
 		       nextevent - now);
-		priv->timeout_id = g_timeout_add_seconds (nextevent - now, timeout_cb, ndisc);
+		nm_timer_wheel_schedule (nm_timer_wheel_get (), &priv->timeout, ((gint64) nextevent) * 1000);
 	}
 }
 
-static gboolean
-timeout_cb (gpointer user_data)
+static void
+timeout_cb (NMTimerWheelEntry *timeout, gpointer user_data)
 {
 	NMNDisc *self = user_data;
 
-	NM_NDISC_GET_PRIVATE (self)->timeout_id = 0;
 	check_timestamps (self, nm_utils_get_monotonic_timestamp_s (), 0);
-	return G_SOURCE_REMOVE;
 }
 
 void
@@ -1101,6 +1098,8 @@ nm_ndisc_init (NMNDisc *ndisc)
 	g_array_set_clear_func (rdata->dns_domains, dns_domain_free);
 	priv->rdata.public.hop_limit = 64;
 
+	nm_timer_wheel_entry_init (&priv->timeout, timeout_cb, ndisc);
+
 	/* Start at very low number so that last_rs - router_solicitation_interval
 	 * is much lower than nm_utils_get_monotonic_timestamp_s() at startup.
 	 */
@@ -1118,7 +1117,7 @@ dispose (GObject *object)
 	nm_clear_g_source (&priv->send_ra_id);
 	g_clear_pointer (&priv->last_error, g_free);
 
-	nm_clear_g_source (&priv->timeout_id);
+	nm_timer_wheel_cancel (nm_timer_wheel_get (), &priv->timeout);
 
 	G_OBJECT_CLASS (nm_ndisc_parent_class)->dispose (object);
 }
@@ -105,6 +105,11 @@ typedef struct {
 	char *dns_mode;
 	char *rc_manager;
 
+	struct {
+		guint window;
+		guint max;
+	} dns_debounce;
+
 	NMGlobalDnsConfig *global_dns;
 
 	/* mutable field */
@@ -299,6 +304,22 @@ nm_config_data_get_rc_manager (const NMConfigData *self)
 	return NM_CONFIG_DATA_GET_PRIVATE (self)->rc_manager;
 }
 
+guint
+nm_config_data_get_dns_debounce (const NMConfigData *self)
+{
+	g_return_val_if_fail (self, 0);
+
+	return NM_CONFIG_DATA_GET_PRIVATE (self)->dns_debounce.window;
+}
+
+guint
+nm_config_data_get_dns_debounce_max (const NMConfigData *self)
+{
+	g_return_val_if_fail (self, 0);
+
+	return NM_CONFIG_DATA_GET_PRIVATE (self)->dns_debounce.max;
+}
+
 gboolean
 nm_config_data_get_ignore_carrier (const NMConfigData *self, NMDevice *device)
 {
@@ -1531,6 +1552,16 @@ constructed (GObject *object)
 	priv->dns_mode = nm_strstrip (g_key_file_get_string (priv->keyfile, NM_CONFIG_KEYFILE_GROUP_MAIN, "dns", NULL));
 	priv->rc_manager = nm_strstrip (g_key_file_get_string (priv->keyfile, NM_CONFIG_KEYFILE_GROUP_MAIN, "rc-manager", NULL));
 
+	/* On missing or invalid values, don't delay DNS updates and fallback
+	 * to the default maximum. The maximum is never shorter than the window. */
+	interval = g_key_file_get_string (priv->keyfile, NM_CONFIG_KEYFILE_GROUP_MAIN, NM_CONFIG_KEYFILE_KEY_MAIN_DNS_DEBOUNCE, NULL);
+	priv->dns_debounce.window = _nm_utils_ascii_str_to_int64 (interval, 10, 0, 60000, 0);
+	g_free (interval);
+	interval = g_key_file_get_string (priv->keyfile, NM_CONFIG_KEYFILE_GROUP_MAIN, NM_CONFIG_KEYFILE_KEY_MAIN_DNS_DEBOUNCE_MAX, NULL);
+	priv->dns_debounce.max = _nm_utils_ascii_str_to_int64 (interval, 10, 0, 600000, NM_CONFIG_DEFAULT_DNS_DEBOUNCE_MAX);
+	priv->dns_debounce.max = MAX (priv->dns_debounce.max, priv->dns_debounce.window);
+	g_free (interval);
+
 	priv->ignore_carrier = nm_config_get_match_spec (priv->keyfile, NM_CONFIG_KEYFILE_GROUP_MAIN, "ignore-carrier", NULL);
 	priv->assume_ipv6ll_only = nm_config_get_match_spec (priv->keyfile, NM_CONFIG_KEYFILE_GROUP_MAIN, "assume-ipv6ll-only", NULL);
 
@@ -169,6 +169,9 @@ gboolean          nm_config_data_get_no_auto_default_for_device (const NMConfigD
 const char *nm_config_data_get_dns_mode (const NMConfigData *self);
 const char *nm_config_data_get_rc_manager (const NMConfigData *self);
 
+guint nm_config_data_get_dns_debounce (const NMConfigData *self);
+guint nm_config_data_get_dns_debounce_max (const NMConfigData *self);
+
 gboolean nm_config_data_get_ignore_carrier (const NMConfigData *self, NMDevice *device);
 gboolean nm_config_data_get_assume_ipv6ll_only (const NMConfigData *self, NMDevice *device);
 int      nm_config_data_get_sriov_num_vfs (const NMConfigData *self, NMDevice *device);
@@ -41,6 +41,8 @@
 #define NM_CONFIG_DEFAULT_CONNECTIVITY_INTERVAL 300
 #define NM_CONFIG_DEFAULT_CONNECTIVITY_RESPONSE "NetworkManager is online" /* NOT LOCALIZED */
 
+#define NM_CONFIG_DEFAULT_DNS_DEBOUNCE_MAX 1000
+
 #define NM_CONFIG_KEYFILE_LIST_SEPARATOR ','
 
 #define NM_CONFIG_KEYFILE_GROUPPREFIX_INTERN                ".intern."
@@ -61,6 +63,8 @@
 
 #define NM_CONFIG_KEYFILE_KEY_MAIN_AUTH_POLKIT              "auth-polkit"
 #define NM_CONFIG_KEYFILE_KEY_MAIN_DHCP                     "dhcp"
+#define NM_CONFIG_KEYFILE_KEY_MAIN_DNS_DEBOUNCE             "dns-debounce"
+#define NM_CONFIG_KEYFILE_KEY_MAIN_DNS_DEBOUNCE_MAX         "dns-debounce-max"
 #define NM_CONFIG_KEYFILE_KEY_MAIN_DEBUG                    "debug"
 #define NM_CONFIG_KEYFILE_KEY_MAIN_HOSTNAME_MODE            "hostname-mode"
 #define NM_CONFIG_KEYFILE_KEY_MAIN_SLAVES_ORDER             "slaves-order"
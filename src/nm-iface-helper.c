@@ -133,9 +133,7 @@ dhcp4_state_changed (NMDhcpClient *client,
 
 		if (last_config)
 			g_object_unref (last_config);
-		last_config = nm_ip4_config_new (nm_platform_get_multi_idx (NM_PLATFORM_GET),
-		                                 nm_dhcp_client_get_ifindex (client));
-		nm_ip4_config_replace (last_config, ip4_config, NULL);
+		last_config = nm_ip4_config_get_snapshot (ip4_config);
 		break;
 	case NM_DHCP_STATE_TIMEOUT:
 	case NM_DHCP_STATE_DONE:
@@ -557,7 +555,7 @@ main (int argc, char *argv[])
 
 /*****************************************************************************/
 
-const NMDhcpClientFactory *const _nm_dhcp_manager_factories[3] = {
+const NMDhcpClientFactory *const _nm_dhcp_manager_factories[4] = {
 	&_nm_dhcp_client_factory_internal,
 };
 
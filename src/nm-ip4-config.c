@@ -273,6 +273,218 @@ _nm_ip_config_add_obj (NMDedupMultiIndex *multi_idx,
 
 /*****************************************************************************/
 
+/* The DNS related lists of an IP config are arrays without duplicates, whose
+ * order matters. Merging or subtracting them element-wise is quadratic, which
+ * matters for long lists. Beyond this many comparisons, the functions below
+ * look up the elements in a hash set instead. */
+#define _IP_CONFIG_ARRAY_LINEAR_MAX 64
+
+static gboolean
+_garray_contains (const GArray *arr, guint len, gconstpointer elt, GEqualFunc equal_func)
+{
+	const guint elt_size = g_array_get_element_size ((GArray *) arr);
+	guint i;
+
+	for (i = 0; i < len; i++) {
+		if (equal_func (&arr->data[i * elt_size], elt))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/**
+ * _nm_ip_config_garray_merge:
+ * @dst: the array to extend
+ * @src: the array with the elements to add
+ * @hash_func: hash function for a pointer to an element
+ * @equal_func: equal function for pointers to elements
+ *
+ * Appends the elements of @src that are not yet in @dst, in their
+ * order. Both arrays must not contain duplicates.
+ *
+ * Returns: whether @dst changed.
+ */
+gboolean
+_nm_ip_config_garray_merge (GArray *dst, const GArray *src, GHashFunc hash_func, GEqualFunc equal_func)
+{
+	const guint elt_size = g_array_get_element_size (dst);
+	gs_free guint *idx_add = NULL;
+	GHashTable *set = NULL;
+	guint i, n_add = 0, dst_len = dst->len;
+
+	nm_assert (elt_size == g_array_get_element_size ((GArray *) src));
+
+	if (src->len == 0)
+		return FALSE;
+
+	if (dst_len == 0) {
+		g_array_append_vals (dst, src->data, src->len);
+		return TRUE;
+	}
+
+	if ((gsize) dst_len * src->len > _IP_CONFIG_ARRAY_LINEAR_MAX) {
+		set = g_hash_table_new (hash_func, equal_func);
+		for (i = 0; i < dst_len; i++)
+			g_hash_table_add (set, &dst->data[i * elt_size]);
+	}
+
+	idx_add = g_new (guint, src->len);
+	for (i = 0; i < src->len; i++) {
+		gconstpointer elt = &src->data[i * elt_size];
+
+		if (  set
+		    ? g_hash_table_contains (set, elt)
+		    : _garray_contains (dst, dst_len, elt, equal_func))
+			continue;
+		idx_add[n_add++] = i;
+	}
+
+	/* the set refers to the elements of @dst, drop it before growing @dst. */
+	if (set)
+		g_hash_table_unref (set);
+
+	for (i = 0; i < n_add; i++)
+		g_array_append_vals (dst, &src->data[idx_add[i] * elt_size], 1);
+	return n_add > 0;
+}
+
+/**
+ * _nm_ip_config_garray_subtract:
+ * @dst: the array to remove elements from
+ * @src: the elements to remove
+ * @hash_func: hash function for a pointer to an element
+ * @equal_func: equal function for pointers to elements
+ *
+ * Removes all elements of @src from @dst, preserving the order of
+ * the remaining elements.
+ *
+ * Returns: whether @dst changed.
+ */
+gboolean
+_nm_ip_config_garray_subtract (GArray *dst, const GArray *src, GHashFunc hash_func, GEqualFunc equal_func)
+{
+	const guint elt_size = g_array_get_element_size (dst);
+	gs_unref_hashtable GHashTable *set = NULL;
+	guint i, j;
+
+	nm_assert (elt_size == g_array_get_element_size ((GArray *) src));
+
+	if (src->len == 0 || dst->len == 0)
+		return FALSE;
+
+	if ((gsize) dst->len * src->len > _IP_CONFIG_ARRAY_LINEAR_MAX) {
+		set = g_hash_table_new (hash_func, equal_func);
+		for (i = 0; i < src->len; i++)
+			g_hash_table_add (set, &src->data[i * elt_size]);
+	}
+
+	for (i = 0, j = 0; i < dst->len; i++) {
+		gconstpointer elt = &dst->data[i * elt_size];
+
+		if (  set
+		    ? g_hash_table_contains (set, elt)
+		    : _garray_contains (src, src->len, elt, equal_func))
+			continue;
+		if (i != j)
+			memcpy (&dst->data[j * elt_size], elt, elt_size);
+		j++;
+	}
+
+	if (j == dst->len)
+		return FALSE;
+	g_array_set_size (dst, j);
+	return TRUE;
+}
+
+/**
+ * _nm_ip_config_strarray_merge:
+ * @dst: the array of strings to extend. The array must own its
+ *   strings, freeing them with g_free().
+ * @src: the strings to add
+ *
+ * Like _nm_ip_config_garray_merge(), for arrays of strings.
+ *
+ * Returns: whether @dst changed.
+ */
+gboolean
+_nm_ip_config_strarray_merge (GPtrArray *dst, const GPtrArray *src)
+{
+	gs_unref_hashtable GHashTable *set = NULL;
+	guint i, dst_len = dst->len;
+	gboolean changed = FALSE;
+
+	if (src->len == 0)
+		return FALSE;
+
+	if ((gsize) dst_len * src->len > _IP_CONFIG_ARRAY_LINEAR_MAX) {
+		set = g_hash_table_new (g_str_hash, g_str_equal);
+		for (i = 0; i < dst_len; i++)
+			g_hash_table_add (set, dst->pdata[i]);
+	}
+
+	for (i = 0; i < src->len; i++) {
+		const char *str = src->pdata[i];
+
+		if (  set
+		    ? g_hash_table_contains (set, str)
+		    : nm_utils_strv_find_first ((char **) dst->pdata, dst_len, str) >= 0)
+			continue;
+		g_ptr_array_add (dst, g_strdup (str));
+		changed = TRUE;
+	}
+	return changed;
+}
+
+/**
+ * _nm_ip_config_strarray_subtract:
+ * @dst: the array of strings to remove from. The array must own its
+ *   strings, freeing them with g_free().
+ * @src: the strings to remove
+ *
+ * Like _nm_ip_config_garray_subtract(), for arrays of strings.
+ *
+ * Returns: whether @dst changed.
+ */
+gboolean
+_nm_ip_config_strarray_subtract (GPtrArray *dst, const GPtrArray *src)
+{
+	gs_unref_hashtable GHashTable *set = NULL;
+	guint i, j, len;
+
+	if (src->len == 0 || dst->len == 0)
+		return FALSE;
+
+	if ((gsize) dst->len * src->len > _IP_CONFIG_ARRAY_LINEAR_MAX) {
+		set = g_hash_table_new (g_str_hash, g_str_equal);
+		for (i = 0; i < src->len; i++)
+			g_hash_table_add (set, src->pdata[i]);
+	}
+
+	len = dst->len;
+	for (i = 0, j = 0; i < len; i++) {
+		char *str = dst->pdata[i];
+
+		if (  set
+		    ? g_hash_table_contains (set, str)
+		    : nm_utils_strv_find_first ((char **) src->pdata, src->len, str) >= 0) {
+			g_free (str);
+			continue;
+		}
+		dst->pdata[j++] = str;
+	}
+
+	if (j == len)
+		return FALSE;
+
+	/* the tail was moved or freed already, don't let the array free it again. */
+	for (i = j; i < len; i++)
+		dst->pdata[i] = NULL;
+	g_ptr_array_set_size (dst, j);
+	return TRUE;
+}
+
+/*****************************************************************************/
+
 NM_GOBJECT_PROPERTIES_DEFINE (NMIP4Config,
 	PROP_MULTI_IDX,
 	PROP_IFINDEX,
@@ -291,6 +503,9 @@ NM_GOBJECT_PROPERTIES_DEFINE (NMIP4Config,
 
 typedef struct {
 	bool never_default:1;
+	bool sealed:1;
+	bool notify_addresses_pending:1;
+	bool notify_routes_pending:1;
 	bool metered:1;
 	bool has_gateway:1;
 	guint32 gateway;
@@ -312,6 +527,8 @@ typedef struct {
 	GVariant *route_data_variant;
 	GVariant *routes_variant;
 	NMDedupMultiIndex *multi_idx;
+	NMIP4Config *snapshot;
+	guint notify_idle_id;
 	union {
 		NMIPConfigDedupMultiIdxType idx_ip4_addresses_;
 		NMDedupMultiIdxType idx_ip4_addresses;
@@ -337,6 +554,20 @@ G_DEFINE_TYPE (NMIP4Config, nm_ip4_config, NM_TYPE_EXPORTED_OBJECT)
 
 /*****************************************************************************/
 
+static void
+_snapshot_drop (NMIP4Config *self)
+{
+	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
+
+	/* a snapshot is immutable. Modifying it would also modify
+	 * the configuration that every other holder of the snapshot sees. */
+	nm_assert (!priv->sealed);
+
+	g_clear_object (&priv->snapshot);
+}
+
+/*****************************************************************************/
+
 static void _add_address (NMIP4Config *self, const NMPObject *obj_new, const NMPlatformIP4Address *new);
 static void _add_route (NMIP4Config *self, const NMPObject *obj_new, const NMPlatformIP4Route *new);
 
@@ -403,6 +634,51 @@ nm_ip_config_iter_ip4_route_init (NMDedupMultiIter *ipconf_iter, const NMIP4Conf
 
 /*****************************************************************************/
 
+static gboolean
+_notify_idle_cb (gpointer user_data)
+{
+	NMIP4Config *self = user_data;
+	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
+
+	priv->notify_idle_id = 0;
+
+	g_object_freeze_notify (G_OBJECT (self));
+	if (priv->notify_addresses_pending) {
+		priv->notify_addresses_pending = FALSE;
+		_notify (self, PROP_ADDRESS_DATA);
+		_notify (self, PROP_ADDRESSES);
+	}
+	if (priv->notify_routes_pending) {
+		priv->notify_routes_pending = FALSE;
+		_notify (self, PROP_ROUTE_DATA);
+		_notify (self, PROP_ROUTES);
+	}
+	g_object_thaw_notify (G_OBJECT (self));
+	return G_SOURCE_REMOVE;
+}
+
+static gboolean
+_notify_schedule (NMIP4Config *self)
+{
+	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
+
+	/* Reading the address and route properties serializes the entire
+	 * list. Once exported, every notification makes the D-Bus skeleton
+	 * read the property right away, so adding many addresses or routes one
+	 * by one would serialize the list again and again. The changes are
+	 * only announced on D-Bus from an idle handler anyway, so just
+	 * collect them and notify once.
+	 *
+	 * Unexported configurations have no such listeners and notify
+	 * synchronously. */
+	if (!nm_exported_object_is_exported ((NMExportedObject *) self))
+		return FALSE;
+
+	if (!priv->notify_idle_id)
+		priv->notify_idle_id = g_idle_add (_notify_idle_cb, self);
+	return TRUE;
+}
+
 static void
 _notify_addresses (NMIP4Config *self)
 {
@@ -410,6 +686,12 @@ _notify_addresses (NMIP4Config *self)
 
 	nm_clear_g_variant (&priv->address_data_variant);
 	nm_clear_g_variant (&priv->addresses_variant);
+	_snapshot_drop (self);
+
+	if (_notify_schedule (self)) {
+		priv->notify_addresses_pending = TRUE;
+		return;
+	}
 	_notify (self, PROP_ADDRESS_DATA);
 	_notify (self, PROP_ADDRESSES);
 }
@@ -421,6 +703,12 @@ _notify_routes (NMIP4Config *self)
 
 	nm_clear_g_variant (&priv->route_data_variant);
 	nm_clear_g_variant (&priv->routes_variant);
+	_snapshot_drop (self);
+
+	if (_notify_schedule (self)) {
+		priv->notify_routes_pending = TRUE;
+		return;
+	}
 	_notify (self, PROP_ROUTE_DATA);
 	_notify (self, PROP_ROUTES);
 }
@@ -788,10 +1076,12 @@ nm_ip4_config_merge_setting (NMIP4Config *self, NMSettingIPConfig *setting, guin
 		return;
 
 	g_return_if_fail (NM_IS_SETTING_IP4_CONFIG (setting));
+	g_return_if_fail (!NM_IP4_CONFIG_GET_PRIVATE (self)->sealed);
 
 	priv = NM_IP4_CONFIG_GET_PRIVATE (self);
 
 	g_object_freeze_notify (G_OBJECT (self));
+	_snapshot_drop (self);
 
 	naddresses = nm_setting_ip_config_get_num_addresses (setting);
 	nroutes = nm_setting_ip_config_get_num_routes (setting);
@@ -1011,17 +1301,18 @@ nm_ip4_config_merge (NMIP4Config *dst, const NMIP4Config *src, NMIPConfigMergeFl
 {
 	NMIP4ConfigPrivate *dst_priv;
 	const NMIP4ConfigPrivate *src_priv;
-	guint32 i;
 	NMDedupMultiIter ipconf_iter;
 	const NMPlatformIP4Address *address = NULL;
 
 	g_return_if_fail (src != NULL);
 	g_return_if_fail (dst != NULL);
+	g_return_if_fail (!NM_IP4_CONFIG_GET_PRIVATE (dst)->sealed);
 
 	dst_priv = NM_IP4_CONFIG_GET_PRIVATE (dst);
 	src_priv = NM_IP4_CONFIG_GET_PRIVATE (src);
 
 	g_object_freeze_notify (G_OBJECT (dst));
+	_snapshot_drop (dst);
 
 	/* addresses */
 	nm_ip_config_iter_ip4_address_for_each (&ipconf_iter, src, &address)
@@ -1029,8 +1320,8 @@ nm_ip4_config_merge (NMIP4Config *dst, const NMIP4Config *src, NMIPConfigMergeFl
 
 	/* nameservers */
 	if (!NM_FLAGS_HAS (merge_flags, NM_IP_CONFIG_MERGE_NO_DNS)) {
-		for (i = 0; i < nm_ip4_config_get_num_nameservers (src); i++)
-			nm_ip4_config_add_nameserver (dst, nm_ip4_config_get_nameserver (src, i));
+		if (_nm_ip_config_garray_merge (dst_priv->nameservers, src_priv->nameservers, g_int_hash, g_int_equal))
+			_notify (dst, PROP_NAMESERVERS);
 	}
 
 	/* default gateway */
@@ -1052,20 +1343,20 @@ nm_ip4_config_merge (NMIP4Config *dst, const NMIP4Config *src, NMIPConfigMergeFl
 
 	/* domains */
 	if (!NM_FLAGS_HAS (merge_flags, NM_IP_CONFIG_MERGE_NO_DNS)) {
-		for (i = 0; i < nm_ip4_config_get_num_domains (src); i++)
-			nm_ip4_config_add_domain (dst, nm_ip4_config_get_domain (src, i));
+		if (_nm_ip_config_strarray_merge (dst_priv->domains, src_priv->domains))
+			_notify (dst, PROP_DOMAINS);
 	}
 
 	/* dns searches */
 	if (!NM_FLAGS_HAS (merge_flags, NM_IP_CONFIG_MERGE_NO_DNS)) {
-		for (i = 0; i < nm_ip4_config_get_num_searches (src); i++)
-			nm_ip4_config_add_search (dst, nm_ip4_config_get_search (src, i));
+		if (_nm_ip_config_strarray_merge (dst_priv->searches, src_priv->searches))
+			_notify (dst, PROP_SEARCHES);
 	}
 
 	/* dns options */
 	if (!NM_FLAGS_HAS (merge_flags, NM_IP_CONFIG_MERGE_NO_DNS)) {
-		for (i = 0; i < nm_ip4_config_get_num_dns_options (src); i++)
-			nm_ip4_config_add_dns_option (dst, nm_ip4_config_get_dns_option (src, i));
+		if (_nm_ip_config_strarray_merge (dst_priv->dns_options, src_priv->dns_options))
+			_notify (dst, PROP_DNS_OPTIONS);
 	}
 
 	/* MSS */
@@ -1081,8 +1372,7 @@ nm_ip4_config_merge (NMIP4Config *dst, const NMIP4Config *src, NMIPConfigMergeFl
 
 	/* NIS */
 	if (!NM_FLAGS_HAS (merge_flags, NM_IP_CONFIG_MERGE_NO_DNS)) {
-		for (i = 0; i < nm_ip4_config_get_num_nis_servers (src); i++)
-			nm_ip4_config_add_nis_server (dst, nm_ip4_config_get_nis_server (src, i));
+		_nm_ip_config_garray_merge (dst_priv->nis, src_priv->nis, g_int_hash, g_int_equal);
 
 		if (nm_ip4_config_get_nis_domain (src))
 			nm_ip4_config_set_nis_domain (dst, nm_ip4_config_get_nis_domain (src));
@@ -1090,8 +1380,8 @@ nm_ip4_config_merge (NMIP4Config *dst, const NMIP4Config *src, NMIPConfigMergeFl
 
 	/* WINS */
 	if (!NM_FLAGS_HAS (merge_flags, NM_IP_CONFIG_MERGE_NO_DNS)) {
-		for (i = 0; i < nm_ip4_config_get_num_wins (src); i++)
-			nm_ip4_config_add_wins (dst, nm_ip4_config_get_wins (src, i));
+		if (_nm_ip_config_garray_merge (dst_priv->wins, src_priv->wins, g_int_hash, g_int_equal))
+			_notify (dst, PROP_WINS_SERVERS);
 	}
 
 	/* metered flag */
@@ -1107,98 +1397,6 @@ nm_ip4_config_merge (NMIP4Config *dst, const NMIP4Config *src, NMIPConfigMergeFl
 
 /*****************************************************************************/
 
-static int
-_nameservers_get_index (const NMIP4Config *self, guint32 ns)
-{
-	const NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
-	guint i;
-
-	for (i = 0; i < priv->nameservers->len; i++) {
-		guint32 n = g_array_index (priv->nameservers, guint32, i);
-
-		if (ns == n)
-			return (int) i;
-	}
-	return -1;
-}
-
-static int
-_domains_get_index (const NMIP4Config *self, const char *domain)
-{
-	const NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
-	guint i;
-
-	for (i = 0; i < priv->domains->len; i++) {
-		const char *d = g_ptr_array_index (priv->domains, i);
-
-		if (g_strcmp0 (domain, d) == 0)
-			return (int) i;
-	}
-	return -1;
-}
-
-static int
-_searches_get_index (const NMIP4Config *self, const char *search)
-{
-	const NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
-	guint i;
-
-	for (i = 0; i < priv->searches->len; i++) {
-		const char *s = g_ptr_array_index (priv->searches, i);
-
-		if (g_strcmp0 (search, s) == 0)
-			return (int) i;
-	}
-	return -1;
-}
-
-static int
-_dns_options_get_index (const NMIP4Config *self, const char *option)
-{
-	const NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
-	guint i;
-
-	for (i = 0; i < priv->dns_options->len; i++) {
-		const char *s = g_ptr_array_index (priv->dns_options, i);
-
-		if (g_strcmp0 (option, s) == 0)
-			return (int) i;
-	}
-	return -1;
-}
-
-static int
-_nis_servers_get_index (const NMIP4Config *self, guint32 nis_server)
-{
-	const NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
-	guint i;
-
-	for (i = 0; i < priv->nis->len; i++) {
-		guint32 n = g_array_index (priv->nis, guint32, i);
-
-		if (n == nis_server)
-			return (int) i;
-	}
-	return -1;
-}
-
-static int
-_wins_get_index (const NMIP4Config *self, guint32 wins_server)
-{
-	const NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
-	guint i;
-
-	for (i = 0; i < priv->wins->len; i++) {
-		guint32 n = g_array_index (priv->wins, guint32, i);
-
-		if (n == wins_server)
-			return (int) i;
-	}
-	return -1;
-}
-
-/*****************************************************************************/
-
 /**
  * nm_ip4_config_subtract:
  * @dst: config from which to remove everything in @src
@@ -1210,8 +1408,7 @@ void
 nm_ip4_config_subtract (NMIP4Config *dst, const NMIP4Config *src)
 {
 	NMIP4ConfigPrivate *priv_dst;
-	guint i;
-	gint idx;
+	const NMIP4ConfigPrivate *priv_src;
 	const NMPlatformIP4Address *a;
 	const NMPlatformIP4Route *r;
 	NMDedupMultiIter ipconf_iter;
@@ -1219,10 +1416,13 @@ nm_ip4_config_subtract (NMIP4Config *dst, const NMIP4Config *src)
 
 	g_return_if_fail (src != NULL);
 	g_return_if_fail (dst != NULL);
+	g_return_if_fail (!NM_IP4_CONFIG_GET_PRIVATE (dst)->sealed);
 
 	priv_dst = NM_IP4_CONFIG_GET_PRIVATE (dst);
+	priv_src = NM_IP4_CONFIG_GET_PRIVATE (src);
 
 	g_object_freeze_notify (G_OBJECT (dst));
+	_snapshot_drop (dst);
 
 	/* addresses */
 	changed = FALSE;
@@ -1236,11 +1436,8 @@ nm_ip4_config_subtract (NMIP4Config *dst, const NMIP4Config *src)
 		_notify_addresses (dst);
 
 	/* nameservers */
-	for (i = 0; i < nm_ip4_config_get_num_nameservers (src); i++) {
-		idx = _nameservers_get_index (dst, nm_ip4_config_get_nameserver (src, i));
-		if (idx >= 0)
-			nm_ip4_config_del_nameserver (dst, idx);
-	}
+	if (_nm_ip_config_garray_subtract (priv_dst->nameservers, priv_src->nameservers, g_int_hash, g_int_equal))
+		_notify (dst, PROP_NAMESERVERS);
 
 	/* default gateway */
 	if (   (nm_ip4_config_has_gateway (src) == nm_ip4_config_has_gateway (dst))
@@ -1264,25 +1461,16 @@ nm_ip4_config_subtract (NMIP4Config *dst, const NMIP4Config *src)
 		_notify_routes (dst);
 
 	/* domains */
-	for (i = 0; i < nm_ip4_config_get_num_domains (src); i++) {
-		idx = _domains_get_index (dst, nm_ip4_config_get_domain (src, i));
-		if (idx >= 0)
-			nm_ip4_config_del_domain (dst, idx);
-	}
+	if (_nm_ip_config_strarray_subtract (priv_dst->domains, priv_src->domains))
+		_notify (dst, PROP_DOMAINS);
 
 	/* dns searches */
-	for (i = 0; i < nm_ip4_config_get_num_searches (src); i++) {
-		idx = _searches_get_index (dst, nm_ip4_config_get_search (src, i));
-		if (idx >= 0)
-			nm_ip4_config_del_search (dst, idx);
-	}
+	if (_nm_ip_config_strarray_subtract (priv_dst->searches, priv_src->searches))
+		_notify (dst, PROP_SEARCHES);
 
 	/* dns options */
-	for (i = 0; i < nm_ip4_config_get_num_dns_options (src); i++) {
-		idx = _dns_options_get_index (dst, nm_ip4_config_get_dns_option (src, i));
-		if (idx >= 0)
-			nm_ip4_config_del_dns_option (dst, idx);
-	}
+	if (_nm_ip_config_strarray_subtract (priv_dst->dns_options, priv_src->dns_options))
+		_notify (dst, PROP_DNS_OPTIONS);
 
 	/* MSS */
 	if (nm_ip4_config_get_mss (src) == nm_ip4_config_get_mss (dst))
@@ -1294,21 +1482,14 @@ nm_ip4_config_subtract (NMIP4Config *dst, const NMIP4Config *src)
 		nm_ip4_config_set_mtu (dst, 0, NM_IP_CONFIG_SOURCE_UNKNOWN);
 
 	/* NIS */
-	for (i = 0; i < nm_ip4_config_get_num_nis_servers (src); i++) {
-		idx = _nis_servers_get_index (dst, nm_ip4_config_get_nis_server (src, i));
-		if (idx >= 0)
-			nm_ip4_config_del_nis_server (dst, idx);
-	}
+	_nm_ip_config_garray_subtract (priv_dst->nis, priv_src->nis, g_int_hash, g_int_equal);
 
 	if (g_strcmp0 (nm_ip4_config_get_nis_domain (src), nm_ip4_config_get_nis_domain (dst)) == 0)
 		nm_ip4_config_set_nis_domain (dst, NULL);
 
 	/* WINS */
-	for (i = 0; i < nm_ip4_config_get_num_wins (src); i++) {
-		idx = _wins_get_index (dst, nm_ip4_config_get_wins (src, i));
-		if (idx >= 0)
-			nm_ip4_config_del_wins (dst, idx);
-	}
+	if (_nm_ip_config_garray_subtract (priv_dst->wins, priv_src->wins, g_int_hash, g_int_equal))
+		_notify (dst, PROP_WINS_SERVERS);
 
 	/* DNS priority */
 	if (nm_ip4_config_get_dns_priority (src) == nm_ip4_config_get_dns_priority (dst))
@@ -1328,8 +1509,10 @@ nm_ip4_config_intersect (NMIP4Config *dst, const NMIP4Config *src)
 
 	g_return_if_fail (src);
 	g_return_if_fail (dst);
+	g_return_if_fail (!NM_IP4_CONFIG_GET_PRIVATE (dst)->sealed);
 
 	g_object_freeze_notify (G_OBJECT (dst));
+	_snapshot_drop (dst);
 
 	priv_dst = NM_IP4_CONFIG_GET_PRIVATE (dst);
 	priv_src = NM_IP4_CONFIG_GET_PRIVATE (src);
@@ -1408,6 +1591,7 @@ nm_ip4_config_replace (NMIP4Config *dst, const NMIP4Config *src, gboolean *relev
 	g_return_val_if_fail (src != NULL, FALSE);
 	g_return_val_if_fail (dst != NULL, FALSE);
 	g_return_val_if_fail (src != dst, FALSE);
+	g_return_val_if_fail (!NM_IP4_CONFIG_GET_PRIVATE (dst)->sealed, FALSE);
 
 #if NM_MORE_ASSERTS
 	config_equal = nm_ip4_config_equal (dst, src);
@@ -1681,6 +1865,9 @@ nm_ip4_config_replace (NMIP4Config *dst, const NMIP4Config *src, gboolean *relev
 	nm_assert (config_equal == !has_relevant_changes);
 #endif
 
+	if (has_relevant_changes || has_minor_changes)
+		_snapshot_drop (dst);
+
 	g_object_thaw_notify (G_OBJECT (dst));
 
 	if (relevant_changes)
@@ -1796,7 +1983,12 @@ nm_ip4_config_set_never_default (NMIP4Config *self, gboolean never_default)
 {
 	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
 
-	priv->never_default = never_default;
+	g_return_if_fail (!priv->sealed);
+
+	if (priv->never_default != !!never_default) {
+		_snapshot_drop (self);
+		priv->never_default = never_default;
+	}
 }
 
 gboolean
@@ -1812,6 +2004,8 @@ nm_ip4_config_set_gateway (NMIP4Config *self, guint32 gateway)
 {
 	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
 
+	g_return_if_fail (!priv->sealed);
+
 	if (priv->gateway != gateway || !priv->has_gateway) {
 		priv->gateway = gateway;
 		priv->has_gateway = TRUE;
@@ -1824,6 +2018,8 @@ nm_ip4_config_unset_gateway (NMIP4Config *self)
 {
 	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
 
+	g_return_if_fail (!priv->sealed);
+
 	if (priv->has_gateway) {
 		priv->gateway = 0;
 		priv->has_gateway = FALSE;
@@ -1872,6 +2068,8 @@ nm_ip4_config_reset_addresses (NMIP4Config *self)
 {
 	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
 
+	g_return_if_fail (!priv->sealed);
+
 	if (nm_dedup_multi_index_remove_idx (priv->multi_idx,
 	                                     &priv->idx_ip4_addresses) > 0)
 		_notify_addresses (self);
@@ -1907,6 +2105,7 @@ nm_ip4_config_add_address (NMIP4Config *self, const NMPlatformIP4Address *new)
 	g_return_if_fail (new);
 	g_return_if_fail (new->plen > 0 && new->plen <= 32);
 	g_return_if_fail (NM_IP4_CONFIG_GET_PRIVATE (self)->ifindex > 0);
+	g_return_if_fail (!NM_IP4_CONFIG_GET_PRIVATE (self)->sealed);
 
 	_add_address (self, NULL, new);
 }
@@ -1987,6 +2186,8 @@ nm_ip4_config_reset_routes (NMIP4Config *self)
 {
 	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
 
+	g_return_if_fail (!priv->sealed);
+
 	if (nm_dedup_multi_index_remove_idx (priv->multi_idx,
 	                                     &priv->idx_ip4_routes) > 0)
 		_notify_routes (self);
@@ -2026,6 +2227,7 @@ nm_ip4_config_add_route (NMIP4Config *self, const NMPlatformIP4Route *new)
 	g_return_if_fail (new);
 	g_return_if_fail (new->plen > 0 && new->plen <= 32);
 	g_return_if_fail (NM_IP4_CONFIG_GET_PRIVATE (self)->ifindex > 0);
+	g_return_if_fail (!NM_IP4_CONFIG_GET_PRIVATE (self)->sealed);
 
 	_add_route (self, NULL, new);
 }
@@ -2106,6 +2308,8 @@ nm_ip4_config_reset_nameservers (NMIP4Config *self)
 {
 	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
 
+	g_return_if_fail (!priv->sealed);
+
 	if (priv->nameservers->len != 0) {
 		g_array_set_size (priv->nameservers, 0);
 		_notify (self, PROP_NAMESERVERS);
@@ -2118,6 +2322,7 @@ nm_ip4_config_add_nameserver (NMIP4Config *self, guint32 new)
 	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
 	int i;
 
+	g_return_if_fail (!priv->sealed);
 	g_return_if_fail (new != 0);
 
 	for (i = 0; i < priv->nameservers->len; i++)
@@ -2133,6 +2338,7 @@ nm_ip4_config_del_nameserver (NMIP4Config *self, guint i)
 {
 	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
 
+	g_return_if_fail (!priv->sealed);
 	g_return_if_fail (i < priv->nameservers->len);
 
 	g_array_remove_index (priv->nameservers, i);
@@ -2162,6 +2368,8 @@ nm_ip4_config_reset_domains (NMIP4Config *self)
 {
 	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
 
+	g_return_if_fail (!priv->sealed);
+
 	if (priv->domains->len != 0) {
 		g_ptr_array_set_size (priv->domains, 0);
 		_notify (self, PROP_DOMAINS);
@@ -2174,6 +2382,7 @@ nm_ip4_config_add_domain (NMIP4Config *self, const char *domain)
 	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
 	int i;
 
+	g_return_if_fail (!priv->sealed);
 	g_return_if_fail (domain != NULL);
 	g_return_if_fail (domain[0] != '\0');
 
@@ -2190,6 +2399,7 @@ nm_ip4_config_del_domain (NMIP4Config *self, guint i)
 {
 	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
 
+	g_return_if_fail (!priv->sealed);
 	g_return_if_fail (i < priv->domains->len);
 
 	g_ptr_array_remove_index (priv->domains, i);
@@ -2219,6 +2429,8 @@ nm_ip4_config_reset_searches (NMIP4Config *self)
 {
 	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
 
+	g_return_if_fail (!priv->sealed);
+
 	if (priv->searches->len != 0) {
 		g_ptr_array_set_size (priv->searches, 0);
 		_notify (self, PROP_SEARCHES);
@@ -2232,6 +2444,7 @@ nm_ip4_config_add_search (NMIP4Config *self, const char *new)
 	char *search;
 	size_t len;
 
+	g_return_if_fail (!priv->sealed);
 	g_return_if_fail (new != NULL);
 	g_return_if_fail (new[0] != '\0');
 
@@ -2262,6 +2475,7 @@ nm_ip4_config_del_search (NMIP4Config *self, guint i)
 {
 	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
 
+	g_return_if_fail (!priv->sealed);
 	g_return_if_fail (i < priv->searches->len);
 
 	g_ptr_array_remove_index (priv->searches, i);
@@ -2291,6 +2505,8 @@ nm_ip4_config_reset_dns_options (NMIP4Config *self)
 {
 	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
 
+	g_return_if_fail (!priv->sealed);
+
 	if (priv->dns_options->len != 0) {
 		g_ptr_array_set_size (priv->dns_options, 0);
 		_notify (self, PROP_DNS_OPTIONS);
@@ -2303,6 +2519,7 @@ nm_ip4_config_add_dns_option (NMIP4Config *self, const char *new)
 	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
 	int i;
 
+	g_return_if_fail (!priv->sealed);
 	g_return_if_fail (new != NULL);
 	g_return_if_fail (new[0] != '\0');
 
@@ -2319,6 +2536,7 @@ nm_ip4_config_del_dns_option(NMIP4Config *self, guint i)
 {
 	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
 
+	g_return_if_fail (!priv->sealed);
 	g_return_if_fail (i < priv->dns_options->len);
 
 	g_ptr_array_remove_index (priv->dns_options, i);
@@ -2348,6 +2566,8 @@ nm_ip4_config_set_dns_priority (NMIP4Config *self, gint priority)
 {
 	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
 
+	g_return_if_fail (!priv->sealed);
+
 	if (priority != priv->dns_priority) {
 		priv->dns_priority = priority;
 		_notify (self, PROP_DNS_PRIORITY);
@@ -2369,7 +2589,12 @@ nm_ip4_config_set_mss (NMIP4Config *self, guint32 mss)
 {
 	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
 
-	priv->mss = mss;
+	g_return_if_fail (!priv->sealed);
+
+	if (priv->mss != mss) {
+		_snapshot_drop (self);
+		priv->mss = mss;
+	}
 }
 
 guint32
@@ -2387,6 +2612,12 @@ nm_ip4_config_reset_nis_servers (NMIP4Config *self)
 {
 	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
 
+	g_return_if_fail (!priv->sealed);
+
+	if (priv->nis->len == 0)
+		return;
+
+	_snapshot_drop (self);
 	g_array_set_size (priv->nis, 0);
 }
 
@@ -2396,10 +2627,13 @@ nm_ip4_config_add_nis_server (NMIP4Config *self, guint32 nis)
 	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
 	int i;
 
+	g_return_if_fail (!priv->sealed);
+
 	for (i = 0; i < priv->nis->len; i++)
 		if (nis == g_array_index (priv->nis, guint32, i))
 			return;
 
+	_snapshot_drop (self);
 	g_array_append_val (priv->nis, nis);
 }
 
@@ -2408,8 +2642,10 @@ nm_ip4_config_del_nis_server (NMIP4Config *self, guint i)
 {
 	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
 
+	g_return_if_fail (!priv->sealed);
 	g_return_if_fail (i < priv->nis->len);
 
+	_snapshot_drop (self);
 	g_array_remove_index (priv->nis, i);
 }
 
@@ -2434,6 +2670,12 @@ nm_ip4_config_set_nis_domain (NMIP4Config *self, const char *domain)
 {
 	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
 
+	g_return_if_fail (!priv->sealed);
+
+	if (nm_streq0 (priv->nis_domain, domain))
+		return;
+
+	_snapshot_drop (self);
 	g_free (priv->nis_domain);
 	priv->nis_domain = g_strdup (domain);
 }
@@ -2453,6 +2695,8 @@ nm_ip4_config_reset_wins (NMIP4Config *self)
 {
 	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
 
+	g_return_if_fail (!priv->sealed);
+
 	if (priv->wins->len != 0) {
 		g_array_set_size (priv->wins, 0);
 		_notify (self, PROP_WINS_SERVERS);
@@ -2465,6 +2709,7 @@ nm_ip4_config_add_wins (NMIP4Config *self, guint32 wins)
 	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
 	int i;
 
+	g_return_if_fail (!priv->sealed);
 	g_return_if_fail (wins != 0);
 
 	for (i = 0; i < priv->wins->len; i++)
@@ -2480,6 +2725,7 @@ nm_ip4_config_del_wins (NMIP4Config *self, guint i)
 {
 	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
 
+	g_return_if_fail (!priv->sealed);
 	g_return_if_fail (i < priv->wins->len);
 
 	g_array_remove_index (priv->wins, i);
@@ -2509,9 +2755,16 @@ nm_ip4_config_set_mtu (NMIP4Config *self, guint32 mtu, NMIPConfigSource source)
 {
 	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
 
+	g_return_if_fail (!priv->sealed);
+
 	if (!mtu)
 		source = NM_IP_CONFIG_SOURCE_UNKNOWN;
 
+	if (   priv->mtu == mtu
+	    && priv->mtu_source == source)
+		return;
+
+	_snapshot_drop (self);
 	priv->mtu = mtu;
 	priv->mtu_source = source;
 }
@@ -2539,7 +2792,12 @@ nm_ip4_config_set_metered (NMIP4Config *self, gboolean metered)
 {
 	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
 
-	priv->metered = metered;
+	g_return_if_fail (!priv->sealed);
+
+	if (priv->metered != !!metered) {
+		_snapshot_drop (self);
+		priv->metered = metered;
+	}
 }
 
 gboolean
@@ -2901,12 +3159,94 @@ nm_ip4_config_new (NMDedupMultiIndex *multi_idx, int ifindex)
 	                                     NULL);
 }
 
+NMIP4Config *
+nm_ip4_config_new_cloned (const NMIP4Config *src)
+{
+	NMIP4Config *new;
+	const NMIP4ConfigPrivate *src_priv;
+	NMIP4ConfigPrivate *priv;
+
+	g_return_val_if_fail (NM_IS_IP4_CONFIG (src), NULL);
+
+	new = nm_ip4_config_new (nm_ip4_config_get_multi_idx (src),
+	                         nm_ip4_config_get_ifindex (src));
+	nm_ip4_config_replace (new, src, NULL);
+
+	/* the clone has the same addresses and routes in the same order,
+	 * so it can share the already serialized variants. */
+	src_priv = NM_IP4_CONFIG_GET_PRIVATE (src);
+	priv = NM_IP4_CONFIG_GET_PRIVATE (new);
+	if (   src_priv->address_data_variant
+	    && !priv->address_data_variant) {
+		priv->address_data_variant = g_variant_ref (src_priv->address_data_variant);
+		priv->addresses_variant = g_variant_ref (src_priv->addresses_variant);
+	}
+	if (   src_priv->route_data_variant
+	    && !priv->route_data_variant) {
+		priv->route_data_variant = g_variant_ref (src_priv->route_data_variant);
+		priv->routes_variant = g_variant_ref (src_priv->routes_variant);
+	}
+	return new;
+}
+
+/**
+ * nm_ip4_config_get_snapshot:
+ * @self: the #NMIP4Config
+ *
+ * Returns an immutable copy of the current content of @self. As long as
+ * @self is not modified, all callers get the same instance, so taking
+ * a snapshot is cheap and does not duplicate addresses and routes, which
+ * are shared via the multi-idx anyway. Any modification of @self detaches
+ * it from the previous snapshot, whose holders keep seeing the old state.
+ *
+ * Snapshots must not be modified, all setters refuse to do so.
+ *
+ * Returns: (transfer full): the snapshot. If @self is itself a snapshot,
+ *   a reference to @self.
+ */
+NMIP4Config *
+nm_ip4_config_get_snapshot (const NMIP4Config *self)
+{
+	NMIP4ConfigPrivate *priv;
+
+	g_return_val_if_fail (NM_IS_IP4_CONFIG (self), NULL);
+
+	priv = (NMIP4ConfigPrivate *) NM_IP4_CONFIG_GET_PRIVATE (self);
+	if (priv->sealed)
+		return g_object_ref ((NMIP4Config *) self);
+
+	if (!priv->snapshot) {
+		priv->snapshot = nm_ip4_config_new_cloned (self);
+		NM_IP4_CONFIG_GET_PRIVATE (priv->snapshot)->sealed = TRUE;
+	}
+	return g_object_ref (priv->snapshot);
+}
+
+gboolean
+nm_ip4_config_is_snapshot (const NMIP4Config *self)
+{
+	return NM_IP4_CONFIG_GET_PRIVATE (self)->sealed;
+}
+
+static void
+dispatch_properties_changed (GObject *object, guint n_pspecs, GParamSpec **pspecs)
+{
+	/* every property change means the content changed. Cached snapshots
+	 * are stale. */
+	_snapshot_drop ((NMIP4Config *) object);
+
+	G_OBJECT_CLASS (nm_ip4_config_parent_class)->dispatch_properties_changed (object, n_pspecs, pspecs);
+}
+
 static void
 finalize (GObject *object)
 {
 	NMIP4Config *self = NM_IP4_CONFIG (object);
 	NMIP4ConfigPrivate *priv = NM_IP4_CONFIG_GET_PRIVATE (self);
 
+	g_clear_object (&priv->snapshot);
+	nm_clear_g_source (&priv->notify_idle_id);
+
 	nm_dedup_multi_index_remove_idx (priv->multi_idx, &priv->idx_ip4_addresses);
 	nm_dedup_multi_index_remove_idx (priv->multi_idx, &priv->idx_ip4_routes);
 
@@ -2938,6 +3278,7 @@ nm_ip4_config_class_init (NMIP4ConfigClass *config_class)
 
 	object_class->get_property = get_property;
 	object_class->set_property = set_property;
+	object_class->dispatch_properties_changed = dispatch_properties_changed;
 	object_class->finalize = finalize;
 
 	obj_properties[PROP_MULTI_IDX] =
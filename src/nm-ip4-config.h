@@ -94,6 +94,11 @@ gboolean _nm_ip_config_add_obj (NMDedupMultiIndex *multi_idx,
                                 const NMPObject *obj_new,
                                 const NMPlatformObject *pl_new);
 
+gboolean _nm_ip_config_garray_merge (GArray *dst, const GArray *src, GHashFunc hash_func, GEqualFunc equal_func);
+gboolean _nm_ip_config_garray_subtract (GArray *dst, const GArray *src, GHashFunc hash_func, GEqualFunc equal_func);
+gboolean _nm_ip_config_strarray_merge (GPtrArray *dst, const GPtrArray *src);
+gboolean _nm_ip_config_strarray_subtract (GPtrArray *dst, const GPtrArray *src);
+
 /*****************************************************************************/
 
 #define NM_TYPE_IP4_CONFIG (nm_ip4_config_get_type ())
@@ -129,6 +134,9 @@ GType nm_ip4_config_get_type (void);
 
 NMIP4Config * nm_ip4_config_new (NMDedupMultiIndex *multi_idx,
                                  int ifindex);
+NMIP4Config * nm_ip4_config_new_cloned (const NMIP4Config *src);
+NMIP4Config * nm_ip4_config_get_snapshot (const NMIP4Config *self);
+gboolean nm_ip4_config_is_snapshot (const NMIP4Config *self);
 
 int nm_ip4_config_get_ifindex (const NMIP4Config *self);
 
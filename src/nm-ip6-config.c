@@ -57,6 +57,9 @@ _route_valid (const NMPlatformIP6Route *r)
 
 typedef struct {
 	bool never_default:1;
+	bool sealed:1;
+	bool notify_addresses_pending:1;
+	bool notify_routes_pending:1;
 	guint32 mss;
 	int ifindex;
 	int dns_priority;
@@ -72,6 +75,8 @@ typedef struct {
 	GVariant *route_data_variant;
 	GVariant *routes_variant;
 	NMDedupMultiIndex *multi_idx;
+	NMIP6Config *snapshot;
+	guint notify_idle_id;
 	union {
 		NMIPConfigDedupMultiIdxType idx_ip6_addresses_;
 		NMDedupMultiIdxType idx_ip6_addresses;
@@ -112,6 +117,20 @@ NM_GOBJECT_PROPERTIES_DEFINE (NMIP6Config,
 
 /*****************************************************************************/
 
+static void
+_snapshot_drop (NMIP6Config *self)
+{
+	NMIP6ConfigPrivate *priv = NM_IP6_CONFIG_GET_PRIVATE (self);
+
+	/* a snapshot is immutable. Modifying it would also modify
+	 * the configuration that every other holder of the snapshot sees. */
+	nm_assert (!priv->sealed);
+
+	g_clear_object (&priv->snapshot);
+}
+
+/*****************************************************************************/
+
 static void _add_address (NMIP6Config *self, const NMPObject *obj_new, const NMPlatformIP6Address *new);
 static void _add_route (NMIP6Config *self, const NMPObject *obj_new, const NMPlatformIP6Route *new);
 
@@ -134,7 +153,12 @@ nm_ip6_config_set_privacy (NMIP6Config *self, NMSettingIP6ConfigPrivacy privacy)
 {
 	NMIP6ConfigPrivate *priv = NM_IP6_CONFIG_GET_PRIVATE (self);
 
-	priv->privacy = privacy;
+	g_return_if_fail (!priv->sealed);
+
+	if (priv->privacy != privacy) {
+		_snapshot_drop (self);
+		priv->privacy = privacy;
+	}
 }
 
 /*****************************************************************************/
@@ -177,6 +201,51 @@ nm_ip_config_iter_ip6_route_init (NMDedupMultiIter *ipconf_iter, const NMIP6Conf
 
 /*****************************************************************************/
 
+static gboolean
+_notify_idle_cb (gpointer user_data)
+{
+	NMIP6Config *self = user_data;
+	NMIP6ConfigPrivate *priv = NM_IP6_CONFIG_GET_PRIVATE (self);
+
+	priv->notify_idle_id = 0;
+
+	g_object_freeze_notify (G_OBJECT (self));
+	if (priv->notify_addresses_pending) {
+		priv->notify_addresses_pending = FALSE;
+		_notify (self, PROP_ADDRESS_DATA);
+		_notify (self, PROP_ADDRESSES);
+	}
+	if (priv->notify_routes_pending) {
+		priv->notify_routes_pending = FALSE;
+		_notify (self, PROP_ROUTE_DATA);
+		_notify (self, PROP_ROUTES);
+	}
+	g_object_thaw_notify (G_OBJECT (self));
+	return G_SOURCE_REMOVE;
+}
+
+static gboolean
+_notify_schedule (NMIP6Config *self)
+{
+	NMIP6ConfigPrivate *priv = NM_IP6_CONFIG_GET_PRIVATE (self);
+
+	/* Reading the address and route properties serializes the entire
+	 * list. Once exported, every notification makes the D-Bus skeleton
+	 * read the property right away, so adding many addresses or routes one
+	 * by one would serialize the list again and again. The changes are
+	 * only announced on D-Bus from an idle handler anyway, so just
+	 * collect them and notify once.
+	 *
+	 * Unexported configurations have no such listeners and notify
+	 * synchronously. */
+	if (!nm_exported_object_is_exported ((NMExportedObject *) self))
+		return FALSE;
+
+	if (!priv->notify_idle_id)
+		priv->notify_idle_id = g_idle_add (_notify_idle_cb, self);
+	return TRUE;
+}
+
 static void
 _notify_addresses (NMIP6Config *self)
 {
@@ -184,6 +253,12 @@ _notify_addresses (NMIP6Config *self)
 
 	nm_clear_g_variant (&priv->address_data_variant);
 	nm_clear_g_variant (&priv->addresses_variant);
+	_snapshot_drop (self);
+
+	if (_notify_schedule (self)) {
+		priv->notify_addresses_pending = TRUE;
+		return;
+	}
 	_notify (self, PROP_ADDRESS_DATA);
 	_notify (self, PROP_ADDRESSES);
 }
@@ -195,6 +270,12 @@ _notify_routes (NMIP6Config *self)
 
 	nm_clear_g_variant (&priv->route_data_variant);
 	nm_clear_g_variant (&priv->routes_variant);
+	_snapshot_drop (self);
+
+	if (_notify_schedule (self)) {
+		priv->notify_routes_pending = TRUE;
+		return;
+	}
 	_notify (self, PROP_ROUTE_DATA);
 	_notify (self, PROP_ROUTES);
 }
@@ -620,6 +701,7 @@ nm_ip6_config_merge_setting (NMIP6Config *self, NMSettingIPConfig *setting, guin
 		return;
 
 	g_return_if_fail (NM_IS_SETTING_IP6_CONFIG (setting));
+	g_return_if_fail (!NM_IP6_CONFIG_GET_PRIVATE (self)->sealed);
 
 	priv = NM_IP6_CONFIG_GET_PRIVATE (self);
 
@@ -629,6 +711,7 @@ nm_ip6_config_merge_setting (NMIP6Config *self, NMSettingIPConfig *setting, guin
 	nsearches = nm_setting_ip_config_get_num_dns_searches (setting);
 
 	g_object_freeze_notify (G_OBJECT (self));
+	_snapshot_drop (self);
 
 	/* Gateway */
 	if (nm_setting_ip_config_get_never_default (setting))
@@ -840,22 +923,29 @@ nm_ip6_config_create_setting (const NMIP6Config *self)
 
 /*****************************************************************************/
 
+static gboolean
+_in6_addr_equal (gconstpointer a, gconstpointer b)
+{
+	return IN6_ARE_ADDR_EQUAL ((const struct in6_addr *) a, (const struct in6_addr *) b);
+}
+
 void
 nm_ip6_config_merge (NMIP6Config *dst, const NMIP6Config *src, NMIPConfigMergeFlags merge_flags)
 {
 	NMIP6ConfigPrivate *dst_priv;
 	const NMIP6ConfigPrivate *src_priv;
-	guint32 i;
 	NMDedupMultiIter ipconf_iter;
 	const NMPlatformIP6Address *address = NULL;
 
 	g_return_if_fail (src != NULL);
 	g_return_if_fail (dst != NULL);
+	g_return_if_fail (!NM_IP6_CONFIG_GET_PRIVATE (dst)->sealed);
 
 	dst_priv = NM_IP6_CONFIG_GET_PRIVATE (dst);
 	src_priv = NM_IP6_CONFIG_GET_PRIVATE (src);
 
 	g_object_freeze_notify (G_OBJECT (dst));
+	_snapshot_drop (dst);
 
 	/* addresses */
 	nm_ip_config_iter_ip6_address_for_each (&ipconf_iter, src, &address)
@@ -863,8 +953,9 @@ nm_ip6_config_merge (NMIP6Config *dst, const NMIP6Config *src, NMIPConfigMergeFl
 
 	/* nameservers */
 	if (!NM_FLAGS_HAS (merge_flags, NM_IP_CONFIG_MERGE_NO_DNS)) {
-		for (i = 0; i < nm_ip6_config_get_num_nameservers (src); i++)
-			nm_ip6_config_add_nameserver (dst, nm_ip6_config_get_nameserver (src, i));
+		if (_nm_ip_config_garray_merge (dst_priv->nameservers, src_priv->nameservers,
+		                                (GHashFunc) nm_utils_in6_addr_hash, _in6_addr_equal))
+			_notify (dst, PROP_NAMESERVERS);
 	}
 
 	/* default gateway */
@@ -886,20 +977,20 @@ nm_ip6_config_merge (NMIP6Config *dst, const NMIP6Config *src, NMIPConfigMergeFl
 
 	/* domains */
 	if (!NM_FLAGS_HAS (merge_flags, NM_IP_CONFIG_MERGE_NO_DNS)) {
-		for (i = 0; i < nm_ip6_config_get_num_domains (src); i++)
-			nm_ip6_config_add_domain (dst, nm_ip6_config_get_domain (src, i));
+		if (_nm_ip_config_strarray_merge (dst_priv->domains, src_priv->domains))
+			_notify (dst, PROP_DOMAINS);
 	}
 
 	/* dns searches */
 	if (!NM_FLAGS_HAS (merge_flags, NM_IP_CONFIG_MERGE_NO_DNS)) {
-		for (i = 0; i < nm_ip6_config_get_num_searches (src); i++)
-			nm_ip6_config_add_search (dst, nm_ip6_config_get_search (src, i));
+		if (_nm_ip_config_strarray_merge (dst_priv->searches, src_priv->searches))
+			_notify (dst, PROP_SEARCHES);
 	}
 
 	/* dns options */
 	if (!NM_FLAGS_HAS (merge_flags, NM_IP_CONFIG_MERGE_NO_DNS)) {
-		for (i = 0; i < nm_ip6_config_get_num_dns_options (src); i++)
-			nm_ip6_config_add_dns_option (dst, nm_ip6_config_get_dns_option (src, i));
+		if (_nm_ip_config_strarray_merge (dst_priv->dns_options, src_priv->dns_options))
+			_notify (dst, PROP_DNS_OPTIONS);
 	}
 
 	if (nm_ip6_config_get_mss (src))
@@ -933,68 +1024,6 @@ nm_ip6_config_destination_is_direct (const NMIP6Config *self, const struct in6_a
 
 /*****************************************************************************/
 
-static int
-_nameservers_get_index (const NMIP6Config *self, const struct in6_addr *ns)
-{
-	const NMIP6ConfigPrivate *priv = NM_IP6_CONFIG_GET_PRIVATE (self);
-	guint i;
-
-	for (i = 0; i < priv->nameservers->len; i++) {
-		const struct in6_addr *n = &g_array_index (priv->nameservers, struct in6_addr, i);
-
-		if (IN6_ARE_ADDR_EQUAL (ns, n))
-			return (int) i;
-	}
-	return -1;
-}
-
-static int
-_domains_get_index (const NMIP6Config *self, const char *domain)
-{
-	const NMIP6ConfigPrivate *priv = NM_IP6_CONFIG_GET_PRIVATE (self);
-	guint i;
-
-	for (i = 0; i < priv->domains->len; i++) {
-		const char *d = g_ptr_array_index (priv->domains, i);
-
-		if (g_strcmp0 (domain, d) == 0)
-			return (int) i;
-	}
-	return -1;
-}
-
-static int
-_searches_get_index (const NMIP6Config *self, const char *search)
-{
-	const NMIP6ConfigPrivate *priv = NM_IP6_CONFIG_GET_PRIVATE (self);
-	guint i;
-
-	for (i = 0; i < priv->searches->len; i++) {
-		const char *s = g_ptr_array_index (priv->searches, i);
-
-		if (g_strcmp0 (search, s) == 0)
-			return (int) i;
-	}
-	return -1;
-}
-
-static int
-_dns_options_get_index (const NMIP6Config *self, const char *option)
-{
-	const NMIP6ConfigPrivate *priv = NM_IP6_CONFIG_GET_PRIVATE (self);
-	guint i;
-
-	for (i = 0; i < priv->dns_options->len; i++) {
-		const char *s = g_ptr_array_index (priv->dns_options, i);
-
-		if (g_strcmp0 (option, s) == 0)
-			return (int) i;
-	}
-	return -1;
-}
-
-/*****************************************************************************/
-
 /**
  * nm_ip6_config_subtract:
  * @dst: config from which to remove everything in @src
@@ -1006,8 +1035,7 @@ void
 nm_ip6_config_subtract (NMIP6Config *dst, const NMIP6Config *src)
 {
 	NMIP6ConfigPrivate *priv_dst;
-	guint i;
-	gint idx;
+	const NMIP6ConfigPrivate *priv_src;
 	const NMPlatformIP6Address *a;
 	const NMPlatformIP6Route *r;
 	NMDedupMultiIter ipconf_iter;
@@ -1016,10 +1044,13 @@ nm_ip6_config_subtract (NMIP6Config *dst, const NMIP6Config *src)
 
 	g_return_if_fail (src != NULL);
 	g_return_if_fail (dst != NULL);
+	g_return_if_fail (!NM_IP6_CONFIG_GET_PRIVATE (dst)->sealed);
 
 	priv_dst = NM_IP6_CONFIG_GET_PRIVATE (dst);
+	priv_src = NM_IP6_CONFIG_GET_PRIVATE (src);
 
 	g_object_freeze_notify (G_OBJECT (dst));
+	_snapshot_drop (dst);
 
 	/* addresses */
 	changed = FALSE;
@@ -1033,11 +1064,9 @@ nm_ip6_config_subtract (NMIP6Config *dst, const NMIP6Config *src)
 		_notify_addresses (dst);
 
 	/* nameservers */
-	for (i = 0; i < nm_ip6_config_get_num_nameservers (src); i++) {
-		idx = _nameservers_get_index (dst, nm_ip6_config_get_nameserver (src, i));
-		if (idx >= 0)
-			nm_ip6_config_del_nameserver (dst, idx);
-	}
+	if (_nm_ip_config_garray_subtract (priv_dst->nameservers, priv_src->nameservers,
+	                                   (GHashFunc) nm_utils_in6_addr_hash, _in6_addr_equal))
+		_notify (dst, PROP_NAMESERVERS);
 
 	/* default gateway */
 	src_tmp = nm_ip6_config_get_gateway (src);
@@ -1062,25 +1091,16 @@ nm_ip6_config_subtract (NMIP6Config *dst, const NMIP6Config *src)
 		_notify_routes (dst);
 
 	/* domains */
-	for (i = 0; i < nm_ip6_config_get_num_domains (src); i++) {
-		idx = _domains_get_index (dst, nm_ip6_config_get_domain (src, i));
-		if (idx >= 0)
-			nm_ip6_config_del_domain (dst, idx);
-	}
+	if (_nm_ip_config_strarray_subtract (priv_dst->domains, priv_src->domains))
+		_notify (dst, PROP_DOMAINS);
 
 	/* dns searches */
-	for (i = 0; i < nm_ip6_config_get_num_searches (src); i++) {
-		idx = _searches_get_index (dst, nm_ip6_config_get_search (src, i));
-		if (idx >= 0)
-			nm_ip6_config_del_search (dst, idx);
-	}
+	if (_nm_ip_config_strarray_subtract (priv_dst->searches, priv_src->searches))
+		_notify (dst, PROP_SEARCHES);
 
 	/* dns options */
-	for (i = 0; i < nm_ip6_config_get_num_dns_options (src); i++) {
-		idx = _dns_options_get_index (dst, nm_ip6_config_get_dns_option (src, i));
-		if (idx >= 0)
-			nm_ip6_config_del_dns_option (dst, idx);
-	}
+	if (_nm_ip_config_strarray_subtract (priv_dst->dns_options, priv_src->dns_options))
+		_notify (dst, PROP_DNS_OPTIONS);
 
 	if (nm_ip6_config_get_mss (src) == nm_ip6_config_get_mss (dst))
 		nm_ip6_config_set_mss (dst, 0);
@@ -1105,11 +1125,13 @@ nm_ip6_config_intersect (NMIP6Config *dst, const NMIP6Config *src)
 
 	g_return_if_fail (src);
 	g_return_if_fail (dst);
+	g_return_if_fail (!NM_IP6_CONFIG_GET_PRIVATE (dst)->sealed);
 
 	priv_dst = NM_IP6_CONFIG_GET_PRIVATE (dst);
 	priv_src = NM_IP6_CONFIG_GET_PRIVATE (src);
 
 	g_object_freeze_notify (G_OBJECT (dst));
+	_snapshot_drop (dst);
 
 	/* addresses */
 	changed = FALSE;
@@ -1193,6 +1215,7 @@ nm_ip6_config_replace (NMIP6Config *dst, const NMIP6Config *src, gboolean *relev
 	g_return_val_if_fail (NM_IS_IP6_CONFIG (src), FALSE);
 	g_return_val_if_fail (NM_IS_IP6_CONFIG (dst), FALSE);
 	g_return_val_if_fail (src != dst, FALSE);
+	g_return_val_if_fail (!NM_IP6_CONFIG_GET_PRIVATE (dst)->sealed, FALSE);
 
 #if NM_MORE_ASSERTS
 	config_equal = nm_ip6_config_equal (dst, src);
@@ -1414,6 +1437,9 @@ nm_ip6_config_replace (NMIP6Config *dst, const NMIP6Config *src, gboolean *relev
 	nm_assert (config_equal == !has_relevant_changes);
 #endif
 
+	if (has_relevant_changes || has_minor_changes)
+		_snapshot_drop (dst);
+
 	g_object_thaw_notify (G_OBJECT (dst));
 
 	if (relevant_changes)
@@ -1484,7 +1510,12 @@ nm_ip6_config_set_never_default (NMIP6Config *self, gboolean never_default)
 {
 	NMIP6ConfigPrivate *priv = NM_IP6_CONFIG_GET_PRIVATE (self);
 
-	priv->never_default = never_default;
+	g_return_if_fail (!priv->sealed);
+
+	if (priv->never_default != !!never_default) {
+		_snapshot_drop (self);
+		priv->never_default = never_default;
+	}
 }
 
 gboolean
@@ -1500,6 +1531,8 @@ nm_ip6_config_set_gateway (NMIP6Config *self, const struct in6_addr *gateway)
 {
 	NMIP6ConfigPrivate *priv = NM_IP6_CONFIG_GET_PRIVATE (self);
 
+	g_return_if_fail (!priv->sealed);
+
 	if (gateway) {
 		if (IN6_ARE_ADDR_EQUAL (&priv->gateway, gateway))
 			return;
@@ -1535,6 +1568,8 @@ nm_ip6_config_reset_addresses (NMIP6Config *self)
 {
 	NMIP6ConfigPrivate *priv = NM_IP6_CONFIG_GET_PRIVATE (self);
 
+	g_return_if_fail (!priv->sealed);
+
 	if (nm_dedup_multi_index_remove_idx (priv->multi_idx,
 	                                     &priv->idx_ip6_addresses) > 0)
 		_notify_addresses (self);
@@ -1572,6 +1607,7 @@ nm_ip6_config_add_address (NMIP6Config *self, const NMPlatformIP6Address *new)
 	g_return_if_fail (new);
 	g_return_if_fail (new->plen > 0 && new->plen <= 128);
 	g_return_if_fail (NM_IP6_CONFIG_GET_PRIVATE (self)->ifindex > 0);
+	g_return_if_fail (!NM_IP6_CONFIG_GET_PRIVATE (self)->sealed);
 
 	_add_address (self, NULL, new);
 }
@@ -1710,6 +1746,8 @@ nm_ip6_config_reset_routes (NMIP6Config *self)
 {
 	NMIP6ConfigPrivate *priv = NM_IP6_CONFIG_GET_PRIVATE (self);
 
+	g_return_if_fail (!priv->sealed);
+
 	if (nm_dedup_multi_index_remove_idx (priv->multi_idx,
 	                                     &priv->idx_ip6_routes) > 0)
 		_notify_routes (self);
@@ -1749,6 +1787,7 @@ nm_ip6_config_add_route (NMIP6Config *self, const NMPlatformIP6Route *new)
 	g_return_if_fail (new);
 	g_return_if_fail (new->plen > 0 && new->plen <= 128);
 	g_return_if_fail (NM_IP6_CONFIG_GET_PRIVATE (self)->ifindex > 0);
+	g_return_if_fail (!NM_IP6_CONFIG_GET_PRIVATE (self)->sealed);
 
 	_add_route (self, NULL, new);
 }
@@ -1855,6 +1894,8 @@ nm_ip6_config_reset_nameservers (NMIP6Config *self)
 {
 	NMIP6ConfigPrivate *priv = NM_IP6_CONFIG_GET_PRIVATE (self);
 
+	g_return_if_fail (!priv->sealed);
+
 	if (priv->nameservers->len != 0) {
 		g_array_set_size (priv->nameservers, 0);
 		_notify (self, PROP_NAMESERVERS);
@@ -1867,6 +1908,7 @@ nm_ip6_config_add_nameserver (NMIP6Config *self, const struct in6_addr *new)
 	NMIP6ConfigPrivate *priv = NM_IP6_CONFIG_GET_PRIVATE (self);
 	int i;
 
+	g_return_if_fail (!priv->sealed);
 	g_return_if_fail (new != NULL);
 
 	for (i = 0; i < priv->nameservers->len; i++)
@@ -1882,6 +1924,7 @@ nm_ip6_config_del_nameserver (NMIP6Config *self, guint i)
 {
 	NMIP6ConfigPrivate *priv = NM_IP6_CONFIG_GET_PRIVATE (self);
 
+	g_return_if_fail (!priv->sealed);
 	g_return_if_fail (i < priv->nameservers->len);
 
 	g_array_remove_index (priv->nameservers, i);
@@ -1911,6 +1954,8 @@ nm_ip6_config_reset_domains (NMIP6Config *self)
 {
 	NMIP6ConfigPrivate *priv = NM_IP6_CONFIG_GET_PRIVATE (self);
 
+	g_return_if_fail (!priv->sealed);
+
 	if (priv->domains->len != 0) {
 		g_ptr_array_set_size (priv->domains, 0);
 		_notify (self, PROP_DOMAINS);
@@ -1923,6 +1968,7 @@ nm_ip6_config_add_domain (NMIP6Config *self, const char *domain)
 	NMIP6ConfigPrivate *priv = NM_IP6_CONFIG_GET_PRIVATE (self);
 	int i;
 
+	g_return_if_fail (!priv->sealed);
 	g_return_if_fail (domain != NULL);
 	g_return_if_fail (domain[0] != '\0');
 
@@ -1939,6 +1985,7 @@ nm_ip6_config_del_domain (NMIP6Config *self, guint i)
 {
 	NMIP6ConfigPrivate *priv = NM_IP6_CONFIG_GET_PRIVATE (self);
 
+	g_return_if_fail (!priv->sealed);
 	g_return_if_fail (i < priv->domains->len);
 
 	g_ptr_array_remove_index (priv->domains, i);
@@ -1968,6 +2015,8 @@ nm_ip6_config_reset_searches (NMIP6Config *self)
 {
 	NMIP6ConfigPrivate *priv = NM_IP6_CONFIG_GET_PRIVATE (self);
 
+	g_return_if_fail (!priv->sealed);
+
 	if (priv->searches->len != 0) {
 		g_ptr_array_set_size (priv->searches, 0);
 		_notify (self, PROP_SEARCHES);
@@ -1981,6 +2030,7 @@ nm_ip6_config_add_search (NMIP6Config *self, const char *new)
 	char *search;
 	size_t len;
 
+	g_return_if_fail (!priv->sealed);
 	g_return_if_fail (new != NULL);
 	g_return_if_fail (new[0] != '\0');
 
@@ -2011,6 +2061,7 @@ nm_ip6_config_del_search (NMIP6Config *self, guint i)
 {
 	NMIP6ConfigPrivate *priv = NM_IP6_CONFIG_GET_PRIVATE (self);
 
+	g_return_if_fail (!priv->sealed);
 	g_return_if_fail (i < priv->searches->len);
 
 	g_ptr_array_remove_index (priv->searches, i);
@@ -2040,6 +2091,8 @@ nm_ip6_config_reset_dns_options (NMIP6Config *self)
 {
 	NMIP6ConfigPrivate *priv = NM_IP6_CONFIG_GET_PRIVATE (self);
 
+	g_return_if_fail (!priv->sealed);
+
 	if (priv->dns_options->len != 0) {
 		g_ptr_array_set_size (priv->dns_options, 0);
 		_notify (self, PROP_DNS_OPTIONS);
@@ -2052,6 +2105,7 @@ nm_ip6_config_add_dns_option (NMIP6Config *self, const char *new)
 	NMIP6ConfigPrivate *priv = NM_IP6_CONFIG_GET_PRIVATE (self);
 	int i;
 
+	g_return_if_fail (!priv->sealed);
 	g_return_if_fail (new != NULL);
 	g_return_if_fail (new[0] != '\0');
 
@@ -2068,6 +2122,7 @@ nm_ip6_config_del_dns_option (NMIP6Config *self, guint i)
 {
 	NMIP6ConfigPrivate *priv = NM_IP6_CONFIG_GET_PRIVATE (self);
 
+	g_return_if_fail (!priv->sealed);
 	g_return_if_fail (i < priv->dns_options->len);
 
 	g_ptr_array_remove_index (priv->dns_options, i);
@@ -2097,6 +2152,8 @@ nm_ip6_config_set_dns_priority (NMIP6Config *self, gint priority)
 {
 	NMIP6ConfigPrivate *priv = NM_IP6_CONFIG_GET_PRIVATE (self);
 
+	g_return_if_fail (!priv->sealed);
+
 	if (priority != priv->dns_priority) {
 		priv->dns_priority = priority;
 		_notify (self, PROP_DNS_PRIORITY);
@@ -2118,7 +2175,12 @@ nm_ip6_config_set_mss (NMIP6Config *self, guint32 mss)
 {
 	NMIP6ConfigPrivate *priv = NM_IP6_CONFIG_GET_PRIVATE (self);
 
-	priv->mss = mss;
+	g_return_if_fail (!priv->sealed);
+
+	if (priv->mss != mss) {
+		_snapshot_drop (self);
+		priv->mss = mss;
+	}
 }
 
 guint32
@@ -2476,21 +2538,90 @@ NMIP6Config *
 nm_ip6_config_new_cloned (const NMIP6Config *src)
 {
 	NMIP6Config *new;
+	const NMIP6ConfigPrivate *src_priv;
+	NMIP6ConfigPrivate *priv;
 
 	g_return_val_if_fail (NM_IS_IP6_CONFIG (src), NULL);
 
 	new = nm_ip6_config_new (nm_ip6_config_get_multi_idx (src),
 	                         nm_ip6_config_get_ifindex (src));
 	nm_ip6_config_replace (new, src, NULL);
+
+	/* the clone has the same addresses and routes in the same order,
+	 * so it can share the already serialized variants. */
+	src_priv = NM_IP6_CONFIG_GET_PRIVATE (src);
+	priv = NM_IP6_CONFIG_GET_PRIVATE (new);
+	if (   src_priv->address_data_variant
+	    && !priv->address_data_variant) {
+		priv->address_data_variant = g_variant_ref (src_priv->address_data_variant);
+		priv->addresses_variant = g_variant_ref (src_priv->addresses_variant);
+	}
+	if (   src_priv->route_data_variant
+	    && !priv->route_data_variant) {
+		priv->route_data_variant = g_variant_ref (src_priv->route_data_variant);
+		priv->routes_variant = g_variant_ref (src_priv->routes_variant);
+	}
 	return new;
 }
 
+/**
+ * nm_ip6_config_get_snapshot:
+ * @self: the #NMIP6Config
+ *
+ * Returns an immutable copy of the current content of @self. As long as
+ * @self is not modified, all callers get the same instance, so taking
+ * a snapshot is cheap and does not duplicate addresses and routes, which
+ * are shared via the multi-idx anyway. Any modification of @self detaches
+ * it from the previous snapshot, whose holders keep seeing the old state.
+ *
+ * Snapshots must not be modified, all setters refuse to do so.
+ *
+ * Returns: (transfer full): the snapshot. If @self is itself a snapshot,
+ *   a reference to @self.
+ */
+NMIP6Config *
+nm_ip6_config_get_snapshot (const NMIP6Config *self)
+{
+	NMIP6ConfigPrivate *priv;
+
+	g_return_val_if_fail (NM_IS_IP6_CONFIG (self), NULL);
+
+	priv = (NMIP6ConfigPrivate *) NM_IP6_CONFIG_GET_PRIVATE (self);
+	if (priv->sealed)
+		return g_object_ref ((NMIP6Config *) self);
+
+	if (!priv->snapshot) {
+		priv->snapshot = nm_ip6_config_new_cloned (self);
+		NM_IP6_CONFIG_GET_PRIVATE (priv->snapshot)->sealed = TRUE;
+	}
+	return g_object_ref (priv->snapshot);
+}
+
+gboolean
+nm_ip6_config_is_snapshot (const NMIP6Config *self)
+{
+	return NM_IP6_CONFIG_GET_PRIVATE (self)->sealed;
+}
+
+static void
+dispatch_properties_changed (GObject *object, guint n_pspecs, GParamSpec **pspecs)
+{
+	/* every property change means the content changed. Cached snapshots
+	 * are stale. */
+	_snapshot_drop ((NMIP6Config *) object);
+
+	G_OBJECT_CLASS (nm_ip6_config_parent_class)->dispatch_properties_changed (object, n_pspecs, pspecs);
+}
+
 static void
 finalize (GObject *object)
 {
 	NMIP6Config *self = NM_IP6_CONFIG (object);
 	NMIP6ConfigPrivate *priv = NM_IP6_CONFIG_GET_PRIVATE (self);
 
+	g_clear_object (&priv->snapshot);
+	nm_clear_g_source (&priv->notify_idle_id);
+
 	nm_dedup_multi_index_remove_idx (priv->multi_idx, &priv->idx_ip6_addresses);
 	nm_dedup_multi_index_remove_idx (priv->multi_idx, &priv->idx_ip6_routes);
 
@@ -2519,6 +2650,7 @@ nm_ip6_config_class_init (NMIP6ConfigClass *config_class)
 
 	object_class->get_property = get_property;
 	object_class->set_property = set_property;
+	object_class->dispatch_properties_changed = dispatch_properties_changed;
 	object_class->finalize = finalize;
 
 	obj_properties[PROP_MULTI_IDX] =
@@ -104,6 +104,8 @@ GType nm_ip6_config_get_type (void);
 
 NMIP6Config * nm_ip6_config_new (struct _NMDedupMultiIndex *multi_idx, int ifindex);
 NMIP6Config * nm_ip6_config_new_cloned (const NMIP6Config *src);
+NMIP6Config * nm_ip6_config_get_snapshot (const NMIP6Config *self);
+gboolean nm_ip6_config_is_snapshot (const NMIP6Config *self);
 
 int nm_ip6_config_get_ifindex (const NMIP6Config *self);
 
@@ -210,6 +210,7 @@ NM_GOBJECT_PROPERTIES_DEFINE (NMManager,
 	PROP_ACTIVATING_CONNECTION,
 	PROP_DEVICES,
 	PROP_METERED,
+	PROP_PLATFORM_CACHE_RESYNCS,
 	PROP_GLOBAL_DNS_CONFIGURATION,
 	PROP_ALL_DEVICES,
 
@@ -2494,6 +2495,14 @@ platform_link_cb (NMPlatform *platform,
 	}
 }
 
+static void
+platform_cache_resyncs_cb (NMPlatform *platform,
+                           GParamSpec *pspec,
+                           gpointer user_data)
+{
+	_notify (NM_MANAGER (user_data), PROP_PLATFORM_CACHE_RESYNCS);
+}
+
 static void
 platform_query_devices (NMManager *self)
 {
@@ -5183,6 +5192,10 @@ nm_manager_start (NMManager *self, GError **error)
 	                  NM_PLATFORM_SIGNAL_LINK_CHANGED,
 	                  G_CALLBACK (platform_link_cb),
 	                  self);
+	g_signal_connect (NM_PLATFORM_GET,
+	                  "notify::" NM_PLATFORM_CACHE_RESYNCS,
+	                  G_CALLBACK (platform_cache_resyncs_cb),
+	                  self);
 
 	platform_query_devices (self);
 
@@ -6280,6 +6293,9 @@ get_property (GObject *object, guint prop_id,
 	case PROP_METERED:
 		g_value_set_uint (value, priv->metered);
 		break;
+	case PROP_PLATFORM_CACHE_RESYNCS:
+		g_value_set_uint (value, nm_platform_get_cache_resyncs (NM_PLATFORM_GET));
+		break;
 	case PROP_GLOBAL_DNS_CONFIGURATION:
 		config_data = nm_config_get_data (priv->config);
 		dns_config = nm_config_data_get_global_dns_config (config_data);
@@ -6612,6 +6628,18 @@ nm_manager_class_init (NMManagerClass *manager_class)
 	                        G_PARAM_READABLE |
 	                        G_PARAM_STATIC_STRINGS);
 
+	/**
+	 * NMManager:platform-cache-resyncs:
+	 *
+	 * How often the platform cache was resynchronized with kernel
+	 * after losing netlink events.
+	 **/
+	obj_properties[PROP_PLATFORM_CACHE_RESYNCS] =
+	    g_param_spec_uint (NM_MANAGER_PLATFORM_CACHE_RESYNCS, "", "",
+	                       0, G_MAXUINT32, 0,
+	                       G_PARAM_READABLE |
+	                       G_PARAM_STATIC_STRINGS);
+
 	g_object_class_install_properties (object_class, _PROPERTY_ENUMS_LAST, obj_properties);
 
 	/* signals */
@@ -28,13 +28,12 @@
 #include "platform/nmp-object.h"
 #include "nm-core-internal.h"
 #include "NetworkManagerUtils.h"
+#include "nm-timer-wheel.h"
 
 /* if within half a second after adding an IP address a matching device-route shows
  * up, we delete it. */
 #define IP4_DEVICE_ROUTES_WAIT_TIME_NS                 (NM_UTILS_NS_PER_SECOND / 2)
 
-#define IP4_DEVICE_ROUTES_GC_INTERVAL_MSEC             ((IP4_DEVICE_ROUTES_WAIT_TIME_NS / 1000000) * 3)
-
 /*****************************************************************************/
 
 typedef struct {
@@ -52,11 +51,19 @@ typedef struct {
 	/* this array contains the effective metrics but using the reversed index that corresponds
 	 * to @entries, instead of @index. */
 	GArray *effective_metrics_reverse;
+
+	/* the non-default platform routes per ifindex, sorted by @route_id_cmp. It maps
+	 * the ifindex to a GPtrArray of NMPObject references. An ifindex gets populated
+	 * on the first sync and is afterwards kept up to date from the platform
+	 * route-changed signals, so that a sync doesn't need to sort the platform
+	 * routes again. */
+	GHashTable *plat_index;
 } RouteEntries;
 
 typedef struct {
 	NMRouteManager *self;
 	gint64 scheduled_at_ns;
+	NMTimerWheelEntry expiry;
 	guint idle_id;
 	const NMPObject *obj;
 	const NMPObject *obj_cached;
@@ -82,7 +89,7 @@ typedef struct {
 	RouteEntries ip6_routes;
 	struct {
 		GHashTable *entries;
-		guint gc_id;
+		gulong route_changed_id;
 	} ip4_device_routes;
 
 	bool log_with_ptr;
@@ -118,6 +125,11 @@ typedef struct {
 
 static const VTableIP vtable_v4, vtable_v6;
 
+typedef struct {
+	const NMPlatformIPXRoute *route;
+	guint batch_idx;
+} BatchAddData;
+
 #define VTABLE_ROUTE_INDEX(vtable, garray, idx) ((NMPlatformIPXRoute *) &((garray)->data[(idx) * (vtable)->vt->sizeof_route]))
 
 #define VTABLE_IS_DEVICE_ROUTE(vtable, route) ((vtable)->vt->is_ip4 \
@@ -168,7 +180,7 @@ static const VTableIP vtable_v4, vtable_v6;
 
 /*****************************************************************************/
 
-static gboolean _ip4_device_routes_cancel (NMRouteManager *self);
+static void _ip4_device_routes_cancel (NMRouteManager *self);
 
 /*****************************************************************************/
 
@@ -307,53 +319,252 @@ _route_index_create (const VTableIP *vtable, const GArray *routes)
 	return index;
 }
 
+static RouteIndex *
+_route_index_update (const VTableIP *vtable,
+                     const GArray *routes,
+                     const guint *old_order,
+                     guint old_len,
+                     const guint *deleted,
+                     guint n_deleted,
+                     guint n_added)
+{
+	RouteIndex *index;
+	gs_free NMPlatformIPXRoute **added = NULL;
+	guint n_kept = old_len - n_deleted;
+	guint i, i_added, j;
+
+	/* Create the index for @routes after the entries at the sorted offsets @deleted
+	 * were removed and @n_added new entries were appended. @old_order are the offsets
+	 * into @routes before the change, in the order of the previous index.
+	 *
+	 * The result is the same as with _route_index_create(), but only the added routes
+	 * need sorting. The remaining ones are merged in their previous order. */
+
+	nm_assert (n_deleted <= old_len);
+	nm_assert (routes->len == n_kept + n_added);
+
+	added = g_new (NMPlatformIPXRoute *, n_added + 1);
+	for (i = 0; i < n_added; i++)
+		added[i] = VTABLE_ROUTE_INDEX (vtable, routes, n_kept + i);
+	g_qsort_with_data (added,
+	                   n_added,
+	                   sizeof (NMPlatformIPXRoute *),
+	                   (GCompareDataFunc) _route_index_create_sort,
+	                   (gpointer) vtable);
+
+	index = g_malloc (sizeof (RouteIndex) + routes->len * sizeof (NMPlatformIPXRoute *));
+	index->len = routes->len;
+
+	i_added = 0;
+	j = 0;
+	for (i = 0; i < old_len; i++) {
+		guint offset = old_order[i];
+		guint lo = 0, hi = n_deleted;
+		NMPlatformIPXRoute *r;
+
+		/* find the number of deleted entries before @offset. */
+		while (lo < hi) {
+			guint mid = lo + (hi - lo) / 2;
+
+			if (deleted[mid] < offset)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		if (lo < n_deleted && deleted[lo] == offset)
+			continue;
+
+		r = VTABLE_ROUTE_INDEX (vtable, routes, offset - lo);
+
+		/* on equal routes, the previous entries come first. Like the stable sort
+		 * of _route_index_create() would do. */
+		while (   i_added < n_added
+		       && vtable->route_id_cmp (added[i_added], r) < 0)
+			index->entries[j++] = added[i_added++];
+		index->entries[j++] = r;
+	}
+	while (i_added < n_added)
+		index->entries[j++] = added[i_added++];
+	index->entries[j] = NULL;
+
+	nm_assert (j == index->len);
+	return index;
+}
+
+/*****************************************************************************/
+
+static int
+_plat_index_sort (const NMPObject **p1, const NMPObject **p2, const VTableIP *vtable)
+{
+	return vtable->route_id_cmp (NMP_OBJECT_CAST_IPX_ROUTE (*p1), NMP_OBJECT_CAST_IPX_ROUTE (*p2));
+}
+
+static guint
+_plat_index_upper_bound (const VTableIP *vtable, const GPtrArray *routes, const NMPlatformIPXRoute *needle)
+{
+	guint lo = 0, hi = routes->len;
+
+	while (lo < hi) {
+		guint mid = lo + (hi - lo) / 2;
+
+		if (vtable->route_id_cmp (NMP_OBJECT_CAST_IPX_ROUTE (routes->pdata[mid]), needle) <= 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+static void
+_plat_index_update (const VTableIP *vtable, GPtrArray *routes, const NMPObject *obj, gboolean remove)
+{
+	const NMPlatformIPXRoute *route = NMP_OBJECT_CAST_IPX_ROUTE (obj);
+	guint i, end;
+
+	end = _plat_index_upper_bound (vtable, routes, route);
+
+	/* the routes with the same id-cmp are just before @end. Look for an existing
+	 * entry of @obj there. */
+	for (i = end; i > 0; i--) {
+		const NMPObject *o = routes->pdata[i - 1];
+
+		if (vtable->route_id_cmp (NMP_OBJECT_CAST_IPX_ROUTE (o), route) != 0)
+			break;
+		if (nmp_object_id_equal (o, obj)) {
+			if (remove)
+				g_ptr_array_remove_index (routes, i - 1);
+			else {
+				routes->pdata[i - 1] = (gpointer) nmp_object_ref (obj);
+				nmp_object_unref (o);
+			}
+			return;
+		}
+	}
+
+	if (!remove)
+		g_ptr_array_insert (routes, end, (gpointer) nmp_object_ref (obj));
+}
+
+static const GPtrArray *
+_plat_index_get (const VTableIP *vtable, NMRouteManager *self, int ifindex)
+{
+	NMRouteManagerPrivate *priv = NM_ROUTE_MANAGER_GET_PRIVATE (self);
+	RouteEntries *ipx_routes = vtable->vt->is_ip4 ? &priv->ip4_routes : &priv->ip6_routes;
+	gs_unref_ptrarray GPtrArray *storage = NULL;
+	GPtrArray *routes;
+	guint i;
+
+	routes = g_hash_table_lookup (ipx_routes->plat_index, GINT_TO_POINTER (ifindex));
+	if (routes)
+		return routes;
+
+	routes = g_ptr_array_new_with_free_func ((GDestroyNotify) nmp_object_unref);
+
+	storage = nm_platform_lookup_route_visible_clone (priv->platform,
+	                                                  vtable->vt->obj_type,
+	                                                  ifindex,
+	                                                  FALSE,
+	                                                  NULL,
+	                                                  NULL);
+	if (storage) {
+		for (i = 0; i < storage->len; i++) {
+			const NMPObject *obj = storage->pdata[i];
+
+			if (NM_PLATFORM_IP_ROUTE_IS_DEFAULT (NMP_OBJECT_CAST_IPX_ROUTE (obj)))
+				continue;
+			g_ptr_array_add (routes, (gpointer) nmp_object_ref (obj));
+		}
+		/* this is a stable sort. */
+		g_ptr_array_sort_with_data (routes,
+		                            (GCompareDataFunc) _plat_index_sort,
+		                            (gpointer) vtable);
+	}
+
+	g_hash_table_insert (ipx_routes->plat_index, GINT_TO_POINTER (ifindex), routes);
+	return routes;
+}
+
+static void
+_plat_index_route_changed (NMPlatform *platform,
+                           int obj_type_i,
+                           int ifindex,
+                           const NMPlatformIPXRoute *route,
+                           int change_type_i,
+                           NMRouteManager *self)
+{
+	const NMPlatformSignalChangeType change_type = change_type_i;
+	NMRouteManagerPrivate *priv = NM_ROUTE_MANAGER_GET_PRIVATE (self);
+	const VTableIP *vtable;
+	RouteEntries *ipx_routes;
+	const NMPObject *obj;
+	GPtrArray *routes;
+
+	if (obj_type_i == NMP_OBJECT_TYPE_IP4_ROUTE) {
+		vtable = &vtable_v4;
+		ipx_routes = &priv->ip4_routes;
+	} else {
+		nm_assert (obj_type_i == NMP_OBJECT_TYPE_IP6_ROUTE);
+		vtable = &vtable_v6;
+		ipx_routes = &priv->ip6_routes;
+	}
+
+	routes = g_hash_table_lookup (ipx_routes->plat_index, GINT_TO_POINTER (ifindex));
+	if (!routes) {
+		/* we didn't sync this ifindex yet. */
+		return;
+	}
+
+	obj = NMP_OBJECT_UP_CAST (route);
+	_plat_index_update (vtable,
+	                    routes,
+	                    obj,
+	                       change_type == NM_PLATFORM_SIGNAL_REMOVED
+	                    || NM_PLATFORM_IP_ROUTE_IS_DEFAULT (route)
+	                    || !nmp_object_is_visible (obj));
+
+	if (routes->len == 0)
+		g_hash_table_remove (ipx_routes->plat_index, GINT_TO_POINTER (ifindex));
+}
+
 static RouteIndex *
 _route_index_create_from_platform (const VTableIP *vtable,
-                                   NMPlatform *platform,
+                                   NMRouteManager *self,
                                    int ifindex,
                                    gboolean ignore_kernel_routes,
                                    GPtrArray **out_storage)
 {
 	RouteIndex *index;
-	guint i, j, len;
+	const GPtrArray *routes;
 	GPtrArray *storage;
+	guint i, j;
 
 	nm_assert (out_storage && !*out_storage);
 
-	storage = nm_platform_lookup_route_visible_clone (platform,
-	                                                  vtable->vt->obj_type,
-	                                                  ifindex,
-	                                                  FALSE,
-	                                                  ignore_kernel_routes
-	                                                    ? nm_platform_lookup_predicate_routes_skip_rtprot_kernel
-	                                                    : NULL,
-	                                                  NULL);
-	if (!storage)
-		return _route_index_create (vtable, NULL);
+	routes = _plat_index_get (vtable, self, ifindex);
 
-	len = storage->len;
-	index = g_malloc (sizeof (RouteIndex) + len * sizeof (NMPlatformIPXRoute *));
+	/* The platform index is already sorted. Take references to its objects,
+	 * because the index gets modified by the signals that are emitted while
+	 * syncing. */
+	storage = g_ptr_array_new_full (routes->len, (GDestroyNotify) nmp_object_unref);
+	index = g_malloc (sizeof (RouteIndex) + routes->len * sizeof (NMPlatformIPXRoute *));
 
 	j = 0;
-	for (i = 0; i < len; i++) {
-		const NMPlatformIPXRoute *ipx_route = NMP_OBJECT_CAST_IPX_ROUTE (storage->pdata[i]);
+	for (i = 0; i < routes->len; i++) {
+		const NMPObject *obj = routes->pdata[i];
 
-		if (NM_PLATFORM_IP_ROUTE_IS_DEFAULT (ipx_route))
+		if (   ignore_kernel_routes
+		    && !nm_platform_lookup_predicate_routes_skip_rtprot_kernel (obj, NULL))
 			continue;
 
+		g_ptr_array_add (storage, (gpointer) nmp_object_ref (obj));
+
 		/* we cast away the const-ness of the NMPObjects. The caller must
 		 * ensure not to modify the object via index->entries. */
-		index->entries[j++] = (NMPlatformIPXRoute *) ipx_route;
+		index->entries[j++] = (NMPlatformIPXRoute *) NMP_OBJECT_CAST_IPX_ROUTE (obj);
 	}
 	index->entries[j] = NULL;
 	index->len = j;
 
-	/* this is a stable sort, which is very important at this point. */
-	g_qsort_with_data (index->entries,
-	                   index->len,
-	                   sizeof (NMPlatformIPXRoute *),
-	                   (GCompareDataFunc) _route_index_create_sort,
-	                   (gpointer) vtable);
 	*out_storage = storage;
 	return index;
 }
@@ -525,14 +736,21 @@ _vx_route_sync (const VTableIP *vtable, NMRouteManager *self, int ifindex, const
 	gint64 *p_effective_metric = NULL;
 	gboolean ipx_routes_changed = FALSE;
 	gint64 *effective_metrics = NULL;
+	NMPlatformIPRouteBatch *batch;
+	GArray *batch_adds = NULL;
 
 	nm_platform_process_events (priv->platform);
 
+	/* all changes to platform are queued in @batch and committed at once at the end.
+	 * Kernel processes the requests in order, so the sequence of deletions and
+	 * additions is the same as if we would issue them one by one. */
+	batch = nm_platform_ip_route_batch_new ();
+
 	ipx_routes = vtable->vt->is_ip4 ? &priv->ip4_routes : &priv->ip6_routes;
 
 	/* the objects referenced by play_routes_idx are shared from the platform cache. They
 	 * must not be modified. */
-	plat_routes_idx = _route_index_create_from_platform (vtable, priv->platform, ifindex, ignore_kernel_routes, &plat_routes);
+	plat_routes_idx = _route_index_create_from_platform (vtable, self, ifindex, ignore_kernel_routes, &plat_routes);
 
 	known_routes_idx = _route_index_create (vtable, known_routes);
 
@@ -653,13 +871,23 @@ _vx_route_sync (const VTableIP *vtable, NMRouteManager *self, int ifindex, const
 				_LOGt (vtable->vt->addr_family, "%3d: platform rt-rm #%u - %s", ifindex, i_plat_routes,
 				       vtable->vt->route_to_string (cur_plat_route, NULL, 0));
 				nm_assert (ifindex == cur_plat_route->rx.ifindex);
-				nm_platform_ip_route_delete (priv->platform, NMP_OBJECT_UP_CAST (cur_plat_route));
+				nm_platform_ip_route_batch_delete (batch, NMP_OBJECT_UP_CAST (cur_plat_route));
 			}
 		}
 	}
 
 	/* Update @ipx_routes with the just learned changes. */
 	if (to_delete_indexes || to_add_routes) {
+		gs_free guint *old_order = NULL;
+		guint old_len = ipx_routes->index->len;
+		RouteIndex *index;
+
+		/* remember the order of the entries in the current index, so that we
+		 * can update the index afterwards without sorting it again. */
+		old_order = g_new (guint, old_len + 1);
+		for (i = 0; i < old_len; i++)
+			old_order[i] = _route_index_reverse_idx (vtable, ipx_routes->index, i, ipx_routes->entries);
+
 		if (to_delete_indexes) {
 			for (i = 0; i < to_delete_indexes->len; i++) {
 				guint idx = g_array_index (to_delete_indexes, guint, i);
@@ -671,7 +899,6 @@ _vx_route_sync (const VTableIP *vtable, NMRouteManager *self, int ifindex, const
 			g_array_sort (to_delete_indexes, (GCompareFunc) _sort_indexes_cmp);
 			nm_utils_array_remove_at_indexes (ipx_routes->entries, &g_array_index (to_delete_indexes, guint, 0), to_delete_indexes->len);
 			nm_utils_array_remove_at_indexes (ipx_routes->effective_metrics_reverse, &g_array_index (to_delete_indexes, guint, 0), to_delete_indexes->len);
-			g_array_unref (to_delete_indexes);
 		}
 		if (to_add_routes) {
 			guint j = ipx_routes->effective_metrics_reverse->len;
@@ -694,10 +921,22 @@ _vx_route_sync (const VTableIP *vtable, NMRouteManager *self, int ifindex, const
 				_LOGt (vtable->vt->addr_family, "%3d: STATE: added   #%u - %s", ifindex, ipx_routes->entries->len - 1,
 				       vtable->vt->route_to_string (ipx_route, NULL, 0));
 			}
-			g_ptr_array_unref (to_add_routes);
 		}
+
+		index = _route_index_update (vtable,
+		                             ipx_routes->entries,
+		                             old_order,
+		                             old_len,
+		                             to_delete_indexes ? &g_array_index (to_delete_indexes, guint, 0) : NULL,
+		                             to_delete_indexes ? to_delete_indexes->len : 0,
+		                             to_add_routes ? to_add_routes->len : 0);
 		g_free (ipx_routes->index);
-		ipx_routes->index = _route_index_create (vtable, ipx_routes->entries);
+		ipx_routes->index = index;
+
+		if (to_delete_indexes)
+			g_array_unref (to_delete_indexes);
+		if (to_add_routes)
+			g_ptr_array_unref (to_add_routes);
 		ipx_routes_changed = TRUE;
 		ASSERT_route_index_valid (vtable, ipx_routes->entries, ipx_routes->index, TRUE);
 	}
@@ -822,7 +1061,7 @@ next:
 			    || route_dest_cmp_result != 0
 			    || *p_effective_metric != cur_plat_route->rx.metric) {
 				nm_assert (ifindex == cur_plat_route->rx.ifindex);
-				nm_platform_ip_route_delete (priv->platform, NMP_OBJECT_UP_CAST (cur_plat_route));
+				nm_platform_ip_route_batch_delete (batch, NMP_OBJECT_UP_CAST (cur_plat_route));
 			}
 
 			cur_plat_route = _get_next_plat_route (plat_routes_idx, FALSE, &i_plat_routes);
@@ -896,16 +1135,16 @@ next:
 					gateway_routes = g_array_new (FALSE, FALSE, sizeof (guint));
 				g_array_append_val (gateway_routes, i_ipx_routes);
 			} else
-				vtable->vt->route_add (priv->platform, NMP_NLM_FLAG_REPLACE,
-				                       cur_ipx_route, 0, *p_effective_metric);
+				vtable->vt->route_batch_add (batch, NMP_NLM_FLAG_REPLACE,
+				                             cur_ipx_route, 0, *p_effective_metric);
 		}
 
 		if (gateway_routes) {
 			for (i = 0; i < gateway_routes->len; i++) {
 				i_ipx_routes = g_array_index (gateway_routes, guint, i);
-				vtable->vt->route_add (priv->platform, NMP_NLM_FLAG_REPLACE,
-				                       ipx_routes->index->entries[i_ipx_routes],
-				                       0, effective_metrics[i_ipx_routes]);
+				vtable->vt->route_batch_add (batch, NMP_NLM_FLAG_REPLACE,
+				                             ipx_routes->index->entries[i_ipx_routes],
+				                             0, effective_metrics[i_ipx_routes]);
 			}
 			g_array_unref (gateway_routes);
 		}
@@ -953,23 +1192,42 @@ next:
 			if (   !cur_plat_route
 			    || route_dest_cmp_result != 0
 			    || !_route_equals_ignoring_ifindex (vtable, cur_plat_route, cur_ipx_route, *p_effective_metric)) {
+				BatchAddData add_data = {
+					.route = cur_ipx_route,
+				};
+
+				add_data.batch_idx = vtable->vt->route_batch_add (batch, NMP_NLM_FLAG_REPLACE,
+				                                                  cur_ipx_route, ifindex, *p_effective_metric);
+				if (!batch_adds)
+					batch_adds = g_array_new (FALSE, FALSE, sizeof (BatchAddData));
+				g_array_append_val (batch_adds, add_data);
+			}
+		}
+	}
 
-				if (!vtable->vt->route_add (priv->platform, NMP_NLM_FLAG_REPLACE,
-				                            cur_ipx_route, ifindex, *p_effective_metric)) {
-					if (cur_ipx_route->rx.rt_source < NM_IP_CONFIG_SOURCE_USER) {
-						_LOGD (vtable->vt->addr_family,
-						       "ignore error adding IPv%c route to kernel: %s",
-						       vtable->vt->is_ip4 ? '4' : '6',
-						       vtable->vt->route_to_string (cur_ipx_route, NULL, 0));
-					} else {
-						/* Remember that there was a failure, but for now continue trying
-						 * to sync the remaining routes. */
-						success = FALSE;
-					}
-				}
+	nm_platform_ip_route_batch_commit (priv->platform, batch);
+
+	if (batch_adds) {
+		for (i = 0; i < batch_adds->len; i++) {
+			const BatchAddData *add_data = &g_array_index (batch_adds, BatchAddData, i);
+
+			if (nm_platform_ip_route_batch_get_success (batch, add_data->batch_idx))
+				continue;
+
+			if (add_data->route->rx.rt_source < NM_IP_CONFIG_SOURCE_USER) {
+				_LOGD (vtable->vt->addr_family,
+				       "ignore error adding IPv%c route to kernel: %s",
+				       vtable->vt->is_ip4 ? '4' : '6',
+				       vtable->vt->route_to_string (add_data->route, NULL, 0));
+			} else {
+				/* Remember that there was a failure, but still report the
+				 * remaining routes. */
+				success = FALSE;
 			}
 		}
+		g_array_unref (batch_adds);
 	}
+	nm_platform_ip_route_batch_free (batch);
 
 	if (vtable->vt->is_ip4 && ipx_routes_changed)
 		g_signal_emit (self, signals[IP4_ROUTES_CHANGED], 0);
@@ -1071,6 +1329,18 @@ _ip4_device_routes_entry_expired (const IP4DeviceRoutePurgeEntry *entry, gint64
 	return entry->scheduled_at_ns + IP4_DEVICE_ROUTES_WAIT_TIME_NS < now;
 }
 
+static void
+_ip4_device_routes_expired_cb (NMTimerWheelEntry *timer, gpointer user_data)
+{
+	IP4DeviceRoutePurgeEntry *entry = user_data;
+	NMRouteManager *self = entry->self;
+	NMRouteManagerPrivate *priv = NM_ROUTE_MANAGER_GET_PRIVATE (self);
+
+	_LOGt (vtable_v4.vt->addr_family, "device-route: cleanup-gc %s", nmp_object_to_string (entry->obj, NMP_OBJECT_TO_STRING_PUBLIC, NULL, 0));
+	g_hash_table_remove (priv->ip4_device_routes.entries, entry->obj);
+	_ip4_device_routes_cancel (self);
+}
+
 static IP4DeviceRoutePurgeEntry *
 _ip4_device_routes_purge_entry_create (NMRouteManager *self, const NMPlatformIP4Route *route, gint64 now_ns)
 {
@@ -1083,12 +1353,19 @@ _ip4_device_routes_purge_entry_create (NMRouteManager *self, const NMPlatformIP4
 	entry->idle_id = 0;
 	entry->obj = nmp_object_new (NMP_OBJECT_TYPE_IP4_ROUTE, (NMPlatformObject *) route);
 	entry->obj_cached = NULL;
+
+	/* each entry expires on its own instead of scanning all entries periodically. */
+	nm_timer_wheel_entry_init (&entry->expiry, _ip4_device_routes_expired_cb, entry);
+	nm_timer_wheel_schedule (nm_timer_wheel_get (),
+	                         &entry->expiry,
+	                         ((now_ns + IP4_DEVICE_ROUTES_WAIT_TIME_NS) / NM_UTILS_NS_PER_MSEC) + 1);
 	return entry;
 }
 
 static void
 _ip4_device_routes_purge_entry_free (IP4DeviceRoutePurgeEntry *entry)
 {
+	nm_timer_wheel_cancel (nm_timer_wheel_get (), &entry->expiry);
 	nmp_object_unref (entry->obj);
 	nmp_object_unref (entry->obj_cached);
 	nm_clear_g_source (&entry->idle_id);
@@ -1168,41 +1445,16 @@ _ip4_device_routes_ip4_route_changed (NMPlatform *platform,
 	}
 }
 
-static gboolean
+static void
 _ip4_device_routes_cancel (NMRouteManager *self)
 {
 	NMRouteManagerPrivate *priv = NM_ROUTE_MANAGER_GET_PRIVATE (self);
 
-	if (priv->ip4_device_routes.gc_id) {
-		if (g_hash_table_size (priv->ip4_device_routes.entries) > 0)
-			return G_SOURCE_CONTINUE;
+	if (   priv->ip4_device_routes.route_changed_id
+	    && g_hash_table_size (priv->ip4_device_routes.entries) == 0) {
 		_LOGt (vtable_v4.vt->addr_family, "device-route: cancel");
-		if (priv->platform)
-			g_signal_handlers_disconnect_by_func (priv->platform, G_CALLBACK (_ip4_device_routes_ip4_route_changed), self);
-		nm_clear_g_source (&priv->ip4_device_routes.gc_id);
+		nm_clear_g_signal_handler (priv->platform, &priv->ip4_device_routes.route_changed_id);
 	}
-	return G_SOURCE_REMOVE;
-}
-
-static gboolean
-_ip4_device_routes_gc (NMRouteManager *self)
-{
-	NMRouteManagerPrivate *priv;
-	GHashTableIter iter;
-	IP4DeviceRoutePurgeEntry *entry;
-	gint64 now = nm_utils_get_monotonic_timestamp_ns ();
-
-	priv = NM_ROUTE_MANAGER_GET_PRIVATE (self);
-
-	g_hash_table_iter_init (&iter, priv->ip4_device_routes.entries);
-	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry)) {
-		if (_ip4_device_routes_entry_expired (entry, now)) {
-			_LOGt (vtable_v4.vt->addr_family, "device-route: cleanup-gc %s", nmp_object_to_string (entry->obj, NMP_OBJECT_TO_STRING_PUBLIC, NULL, 0));
-			g_hash_table_iter_remove (&iter);
-		}
-	}
-
-	return _ip4_device_routes_cancel (self);
 }
 
 /**
@@ -1238,9 +1490,9 @@ nm_route_manager_ip4_route_register_device_route_purge_list (NMRouteManager *sel
 		                      (NMPObject *) nmp_object_ref (entry->obj),
 		                      entry);
 	}
-	if (priv->ip4_device_routes.gc_id == 0) {
-		g_signal_connect (priv->platform, NM_PLATFORM_SIGNAL_IP4_ROUTE_CHANGED, G_CALLBACK (_ip4_device_routes_ip4_route_changed), self);
-		priv->ip4_device_routes.gc_id = g_timeout_add (IP4_DEVICE_ROUTES_GC_INTERVAL_MSEC, (GSourceFunc) _ip4_device_routes_gc, self);
+	if (priv->ip4_device_routes.route_changed_id == 0) {
+		priv->ip4_device_routes.route_changed_id = g_signal_connect (priv->platform, NM_PLATFORM_SIGNAL_IP4_ROUTE_CHANGED,
+		                                                             G_CALLBACK (_ip4_device_routes_ip4_route_changed), self);
 	}
 }
 
@@ -1278,6 +1530,8 @@ set_property (GObject *object, guint prop_id,
 		if (!priv->platform)
 			g_return_if_reached ();
 		g_object_ref (priv->platform);
+		g_signal_connect (priv->platform, NM_PLATFORM_SIGNAL_IP4_ROUTE_CHANGED, G_CALLBACK (_plat_index_route_changed), self);
+		g_signal_connect (priv->platform, NM_PLATFORM_SIGNAL_IP6_ROUTE_CHANGED, G_CALLBACK (_plat_index_route_changed), self);
 		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -1300,6 +1554,8 @@ nm_route_manager_init (NMRouteManager *self)
 	priv->ip6_routes.effective_metrics_reverse = g_array_new (FALSE, FALSE, sizeof (gint64));
 	priv->ip4_routes.index = _route_index_create (&vtable_v4, priv->ip4_routes.entries);
 	priv->ip6_routes.index = _route_index_create (&vtable_v6, priv->ip6_routes.entries);
+	priv->ip4_routes.plat_index = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, (GDestroyNotify) g_ptr_array_unref);
+	priv->ip6_routes.plat_index = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, (GDestroyNotify) g_ptr_array_unref);
 	priv->ip4_device_routes.entries = g_hash_table_new_full ((GHashFunc) nmp_object_id_hash,
 	                                                         (GEqualFunc) nmp_object_id_equal,
 	                                                         (GDestroyNotify) nmp_object_unref,
@@ -1324,6 +1580,11 @@ dispose (GObject *object)
 	g_hash_table_remove_all (priv->ip4_device_routes.entries);
 	_ip4_device_routes_cancel (self);
 
+	if (priv->platform)
+		g_signal_handlers_disconnect_by_func (priv->platform, G_CALLBACK (_plat_index_route_changed), self);
+	g_hash_table_remove_all (priv->ip4_routes.plat_index);
+	g_hash_table_remove_all (priv->ip6_routes.plat_index);
+
 	G_OBJECT_CLASS (nm_route_manager_parent_class)->dispose (object);
 }
 
@@ -1341,6 +1602,8 @@ finalize (GObject *object)
 	g_free (priv->ip4_routes.index);
 	g_free (priv->ip6_routes.index);
 
+	g_hash_table_unref (priv->ip4_routes.plat_index);
+	g_hash_table_unref (priv->ip6_routes.plat_index);
 	g_hash_table_unref (priv->ip4_device_routes.entries);
 
 	g_clear_object (&priv->platform);
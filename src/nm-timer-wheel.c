@@ -0,0 +1,450 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/* NetworkManager -- Network link manager
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright 2017 Red Hat, Inc.
+ */
+
+#include "nm-default.h"
+
+#include "nm-timer-wheel.h"
+
+#include "nm-core-utils.h"
+
+/*****************************************************************************/
+
+/* A hierarchical timing wheel with a resolution of one millisecond.
+ *
+ * Level 0 has one slot per tick for the next 64 ticks. Each further level
+ * has 64 slots that are 64 times as wide as the slots of the level below.
+ * Scheduling and cancelling a timer is O(1). When the slot of an upper
+ * level comes due, its timers are moved down ("cascaded"). So every timer
+ * is touched at most once per level until it fires.
+ *
+ * Users share the wheel from nm_timer_wheel_get(), and with it a single
+ * GSource on the main context. If the next timer is a second or more away,
+ * the GSource is armed with g_timeout_add_seconds(). That way GLib can
+ * coalesce the wakeup with other timers. Such timers may fire up to a
+ * second late. Timers that are due sooner fire with millisecond
+ * precision. */
+
+#define WHEEL_BITS      6
+#define WHEEL_SIZE      (1 << WHEEL_BITS)
+#define WHEEL_MASK      ((gint64) (WHEEL_SIZE - 1))
+#define WHEEL_LEVELS    6
+
+#define LEVEL_SHIFT(level)  ((level) * WHEEL_BITS)
+#define LEVEL_MASK(level)   ((G_GINT64_CONSTANT (1) << LEVEL_SHIFT (level)) - 1)
+
+/* the largest distance to "base" that the wheel can represent (about 2.2 years).
+ * Timers further in the future are kept in the last level and re-inserted
+ * when their slot comes due. */
+#define WHEEL_MAX_DELTA LEVEL_MASK (WHEEL_LEVELS)
+
+/* g_timeout_add_seconds() would overflow its internal millisecond interval
+ * for large values. Wake up at least once a day and re-arm. */
+#define MAX_SLEEP_SEC   (24 * 60 * 60)
+
+struct _NMTimerWheel {
+	CList slots[WHEEL_LEVELS][WHEEL_SIZE];
+	guint n_level[WHEEL_LEVELS];
+	guint n_entries;
+
+	/* the first tick that is not yet processed. */
+	gint64 base;
+
+	guint source_id;
+	gint64 source_expiry;
+
+	bool attached:1;
+	bool in_run:1;
+};
+
+/*****************************************************************************/
+
+static void _arm (NMTimerWheel *wheel);
+
+static void
+_insert (NMTimerWheel *wheel, NMTimerWheelEntry *entry)
+{
+	gint64 expiry = entry->expiry_ms;
+	gint64 delta;
+	guint level;
+
+	/* timers in the past fire with the next processed tick. */
+	if (expiry < wheel->base)
+		expiry = wheel->base;
+
+	delta = expiry - wheel->base;
+	if (delta > WHEEL_MAX_DELTA) {
+		delta = WHEEL_MAX_DELTA;
+		expiry = wheel->base + WHEEL_MAX_DELTA;
+	}
+
+	for (level = 0; level < WHEEL_LEVELS - 1; level++) {
+		if (delta <= LEVEL_MASK (level + 1))
+			break;
+	}
+
+	entry->level = level;
+	c_list_link_tail (&wheel->slots[level][(expiry >> LEVEL_SHIFT (level)) & WHEEL_MASK],
+	                  &entry->lst);
+	wheel->n_level[level]++;
+}
+
+static void
+_unlink (NMTimerWheel *wheel, NMTimerWheelEntry *entry)
+{
+	nm_assert (wheel->n_level[entry->level] > 0);
+	nm_assert (wheel->n_entries > 0);
+
+	c_list_unlink_init (&entry->lst);
+	wheel->n_level[entry->level]--;
+	wheel->n_entries--;
+}
+
+static void
+_cascade (NMTimerWheel *wheel, guint level, gint64 tick)
+{
+	CList *slot = &wheel->slots[level][(tick >> LEVEL_SHIFT (level)) & WHEEL_MASK];
+	CList lst = C_LIST_INIT (lst);
+	NMTimerWheelEntry *entry;
+
+	c_list_splice (&lst, slot);
+	while (!c_list_is_empty (&lst)) {
+		entry = c_list_first_entry (&lst, NMTimerWheelEntry, lst);
+		c_list_unlink_init (&entry->lst);
+		wheel->n_level[level]--;
+		_insert (wheel, entry);
+	}
+}
+
+static gint64
+_next_slot_start (const NMTimerWheel *wheel, guint level)
+{
+	gint64 w = wheel->base >> LEVEL_SHIFT (level);
+	guint i;
+
+	nm_assert (wheel->n_level[level] > 0);
+
+	/* the slots of a level, beginning with the slot of the current tick,
+	 * cover consecutive time ranges. On the upper levels, the slot of the
+	 * current tick is only pending if the tick is the start of the slot.
+	 * Otherwise, it was already cascaded and is reused for the range 64
+	 * slots ahead. */
+	if (   level > 0
+	    && (wheel->base & LEVEL_MASK (level)))
+		w++;
+
+	for (i = 0; i < WHEEL_SIZE; i++, w++) {
+		if (!c_list_is_empty (&wheel->slots[level][w & WHEEL_MASK]))
+			return w << LEVEL_SHIFT (level);
+	}
+	g_return_val_if_reached (wheel->base);
+}
+
+/*****************************************************************************/
+
+/**
+ * nm_timer_wheel_schedule:
+ * @wheel: the #NMTimerWheel
+ * @entry: an entry, initialized with nm_timer_wheel_entry_init()
+ * @expiry_ms: the absolute time in nm_utils_get_monotonic_timestamp_ms()
+ *   scale at which the timer fires.
+ *
+ * Schedules @entry. If the entry is already scheduled, it gets rescheduled.
+ * The callback is invoked once. The entry is no longer scheduled
+ * when the callback runs.
+ */
+void
+nm_timer_wheel_schedule (NMTimerWheel *wheel, NMTimerWheelEntry *entry, gint64 expiry_ms)
+{
+	g_return_if_fail (wheel);
+	g_return_if_fail (entry && entry->func);
+
+	if (c_list_is_linked (&entry->lst))
+		_unlink (wheel, entry);
+
+	if (   wheel->attached
+	    && wheel->n_entries == 0
+	    && !wheel->in_run) {
+		/* the wheel was idle. Catch up with the current time, so that the new
+		 * timer doesn't need to be cascaded down from the upper levels. */
+		wheel->base = MAX (wheel->base, nm_utils_get_monotonic_timestamp_ms ());
+	}
+
+	entry->expiry_ms = expiry_ms;
+	_insert (wheel, entry);
+	wheel->n_entries++;
+
+	_arm (wheel);
+}
+
+/**
+ * nm_timer_wheel_cancel:
+ * @wheel: the #NMTimerWheel
+ * @entry: the entry to cancel
+ *
+ * Returns: %TRUE if @entry was scheduled.
+ */
+gboolean
+nm_timer_wheel_cancel (NMTimerWheel *wheel, NMTimerWheelEntry *entry)
+{
+	g_return_val_if_fail (wheel, FALSE);
+	g_return_val_if_fail (entry, FALSE);
+
+	if (!c_list_is_linked (&entry->lst))
+		return FALSE;
+
+	_unlink (wheel, entry);
+
+	/* don't bother re-arming for a later timer. A premature wakeup is
+	 * cheap, only drop the GSource if there is nothing left. */
+	if (wheel->n_entries == 0)
+		_arm (wheel);
+	return TRUE;
+}
+
+guint
+nm_timer_wheel_get_num_entries (const NMTimerWheel *wheel)
+{
+	g_return_val_if_fail (wheel, 0);
+
+	return wheel->n_entries;
+}
+
+/**
+ * nm_timer_wheel_get_next_expiry:
+ * @wheel: the #NMTimerWheel
+ *
+ * Returns: the expiry of the next timer or 0, if there are no timers.
+ *   For timers that are already due, this can be a time in the past.
+ */
+gint64
+nm_timer_wheel_get_next_expiry (const NMTimerWheel *wheel)
+{
+	gint64 next = G_MAXINT64;
+	guint level;
+
+	g_return_val_if_fail (wheel, 0);
+
+	if (wheel->n_entries == 0)
+		return 0;
+
+	for (level = 0; level < WHEEL_LEVELS; level++) {
+		const NMTimerWheelEntry *entry;
+		const CList *slot;
+		gint64 start;
+
+		if (wheel->n_level[level] == 0)
+			continue;
+
+		/* the first non-empty slot has the earliest timers of the level. */
+		start = _next_slot_start (wheel, level);
+		slot = &wheel->slots[level][(start >> LEVEL_SHIFT (level)) & WHEEL_MASK];
+		c_list_for_each_entry (entry, slot, lst)
+			next = MIN (next, entry->expiry_ms);
+	}
+
+	nm_assert (next != G_MAXINT64);
+	return next;
+}
+
+/**
+ * nm_timer_wheel_run:
+ * @wheel: the #NMTimerWheel
+ * @now_ms: the current time
+ *
+ * Invokes the callbacks of all timers that expire not later than @now_ms.
+ * Attached wheels call this themselves, other users must call it.
+ *
+ * Returns: the number of invoked callbacks.
+ */
+guint
+nm_timer_wheel_run (NMTimerWheel *wheel, gint64 now_ms)
+{
+	NMTimerWheelEntry *entry;
+	guint n_fired = 0;
+	guint level;
+
+	g_return_val_if_fail (wheel, 0);
+	g_return_val_if_fail (!wheel->in_run, 0);
+
+	wheel->in_run = TRUE;
+
+	while (wheel->base <= now_ms) {
+		gint64 tick = wheel->base;
+		CList lst = C_LIST_INIT (lst);
+
+		if (wheel->n_entries == 0) {
+			wheel->base = now_ms + 1;
+			break;
+		}
+
+		for (level = 0; wheel->n_level[level] == 0; level++)
+			nm_assert (level + 1 < WHEEL_LEVELS);
+
+		if (level > 0) {
+			/* the lower levels are empty. Skip ahead to the tick where
+			 * the next non-empty slot of any level gets cascaded. */
+			tick = G_MAXINT64;
+			for (; level < WHEEL_LEVELS; level++) {
+				if (wheel->n_level[level] > 0)
+					tick = MIN (tick, _next_slot_start (wheel, level));
+			}
+			if (tick > now_ms) {
+				wheel->base = now_ms + 1;
+				break;
+			}
+		}
+
+		/* timers that get cascaded are re-inserted relative to @tick. */
+		wheel->base = tick;
+		for (level = 1; level < WHEEL_LEVELS; level++) {
+			if (tick & LEVEL_MASK (level))
+				break;
+			_cascade (wheel, level, tick);
+		}
+
+		/* advance the base before invoking the callbacks. A timer that gets
+		 * (re)scheduled from a callback for a time not later than @tick
+		 * lands in the slot of the following tick. */
+		wheel->base = tick + 1;
+
+		c_list_splice (&lst, &wheel->slots[0][tick & WHEEL_MASK]);
+		while (!c_list_is_empty (&lst)) {
+			entry = c_list_first_entry (&lst, NMTimerWheelEntry, lst);
+			nm_assert (entry->level == 0);
+			_unlink (wheel, entry);
+			n_fired++;
+			entry->func (entry, entry->user_data);
+		}
+	}
+
+	wheel->in_run = FALSE;
+	_arm (wheel);
+	return n_fired;
+}
+
+/*****************************************************************************/
+
+static gboolean
+_source_cb (gpointer user_data)
+{
+	NMTimerWheel *wheel = user_data;
+
+	wheel->source_id = 0;
+	nm_timer_wheel_run (wheel, nm_utils_get_monotonic_timestamp_ms ());
+	return G_SOURCE_REMOVE;
+}
+
+static void
+_arm (NMTimerWheel *wheel)
+{
+	gint64 next, now, delta;
+
+	if (   !wheel->attached
+	    || wheel->in_run)
+		return;
+
+	if (wheel->n_entries == 0) {
+		nm_clear_g_source (&wheel->source_id);
+		return;
+	}
+
+	next = nm_timer_wheel_get_next_expiry (wheel);
+	if (   wheel->source_id
+	    && wheel->source_expiry <= next)
+		return;
+
+	nm_clear_g_source (&wheel->source_id);
+
+	now = nm_utils_get_monotonic_timestamp_ms ();
+	delta = MAX (next - now, (gint64) 0);
+	if (delta >= 1000) {
+		guint sec = MIN ((delta + 999) / 1000, (gint64) MAX_SLEEP_SEC);
+
+		wheel->source_expiry = now + ((gint64) sec) * 1000;
+		wheel->source_id = g_timeout_add_seconds (sec, _source_cb, wheel);
+	} else {
+		wheel->source_expiry = next;
+		wheel->source_id = g_timeout_add (delta, _source_cb, wheel);
+	}
+}
+
+/*****************************************************************************/
+
+/**
+ * nm_timer_wheel_new:
+ * @now_ms: the start time of the wheel
+ * @attach: whether the wheel arms a GSource on the default main
+ *   context and processes the timers itself. Otherwise, the user
+ *   must call nm_timer_wheel_run(). That is useful for tests.
+ *
+ * Returns: a new #NMTimerWheel.
+ */
+NMTimerWheel *
+nm_timer_wheel_new (gint64 now_ms, gboolean attach)
+{
+	NMTimerWheel *wheel;
+	guint level, i;
+
+	wheel = g_new0 (NMTimerWheel, 1);
+	for (level = 0; level < WHEEL_LEVELS; level++) {
+		for (i = 0; i < WHEEL_SIZE; i++)
+			c_list_init (&wheel->slots[level][i]);
+	}
+	wheel->base = now_ms;
+	wheel->attached = attach;
+	return wheel;
+}
+
+void
+nm_timer_wheel_free (NMTimerWheel *wheel)
+{
+	guint level, i;
+
+	if (!wheel)
+		return;
+
+	g_return_if_fail (!wheel->in_run);
+
+	for (level = 0; level < WHEEL_LEVELS; level++) {
+		for (i = 0; i < WHEEL_SIZE; i++) {
+			CList *slot = &wheel->slots[level][i];
+
+			while (!c_list_is_empty (slot))
+				c_list_unlink_init (slot->next);
+		}
+	}
+	nm_clear_g_source (&wheel->source_id);
+	g_free (wheel);
+}
+
+/**
+ * nm_timer_wheel_get:
+ *
+ * Returns: the wheel that is shared by all users on the main context.
+ */
+NMTimerWheel *
+nm_timer_wheel_get (void)
+{
+	static NMTimerWheel *wheel;
+
+	if (G_UNLIKELY (!wheel))
+		wheel = nm_timer_wheel_new (nm_utils_get_monotonic_timestamp_ms (), TRUE);
+	return wheel;
+}
@@ -0,0 +1,82 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/* NetworkManager -- Network link manager
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright 2017 Red Hat, Inc.
+ */
+
+#ifndef __NM_TIMER_WHEEL_H__
+#define __NM_TIMER_WHEEL_H__
+
+#include "nm-utils/c-list.h"
+
+/*****************************************************************************/
+
+typedef struct _NMTimerWheel NMTimerWheel;
+typedef struct _NMTimerWheelEntry NMTimerWheelEntry;
+
+typedef void (*NMTimerWheelFunc) (NMTimerWheelEntry *entry, gpointer user_data);
+
+/* To be embedded by the user. All fields are private, use
+ * nm_timer_wheel_entry_init() before use. */
+struct _NMTimerWheelEntry {
+	CList lst;
+	gint64 expiry_ms;
+	NMTimerWheelFunc func;
+	gpointer user_data;
+	guint8 level;
+};
+
+static inline void
+nm_timer_wheel_entry_init (NMTimerWheelEntry *entry, NMTimerWheelFunc func, gpointer user_data)
+{
+	nm_assert (entry);
+	nm_assert (func);
+
+	c_list_init (&entry->lst);
+	entry->expiry_ms = 0;
+	entry->func = func;
+	entry->user_data = user_data;
+	entry->level = 0;
+}
+
+static inline gboolean
+nm_timer_wheel_entry_is_scheduled (const NMTimerWheelEntry *entry)
+{
+	return c_list_is_linked (&entry->lst);
+}
+
+static inline gint64
+nm_timer_wheel_entry_get_expiry (const NMTimerWheelEntry *entry)
+{
+	return entry->expiry_ms;
+}
+
+/*****************************************************************************/
+
+NMTimerWheel *nm_timer_wheel_get (void);
+
+NMTimerWheel *nm_timer_wheel_new (gint64 now_ms, gboolean attach);
+void nm_timer_wheel_free (NMTimerWheel *wheel);
+
+void nm_timer_wheel_schedule (NMTimerWheel *wheel, NMTimerWheelEntry *entry, gint64 expiry_ms);
+gboolean nm_timer_wheel_cancel (NMTimerWheel *wheel, NMTimerWheelEntry *entry);
+
+guint nm_timer_wheel_get_num_entries (const NMTimerWheel *wheel);
+gint64 nm_timer_wheel_get_next_expiry (const NMTimerWheel *wheel);
+guint nm_timer_wheel_run (NMTimerWheel *wheel, gint64 now_ms);
+
+#endif /* __NM_TIMER_WHEEL_H__ */
@@ -1136,10 +1136,17 @@ ipx_route_delete (NMPlatform *platform,
 	               : NMP_OBJECT_TYPE_IP6_ROUTE;
 	}
 
+	/* when deleting one route, only look at the routes on the same ifindex
+	 * with the same metric, instead of walking all routes of the interface. */
 	nmp_cache_iter_for_each (&iter,
-	                         nm_platform_lookup_addrroute (platform,
-	                                                       obj_type,
-	                                                       ifindex),
+	                           obj
+	                         ? nm_platform_lookup_route_by_ifindex_metric (platform,
+	                                                                       obj_type,
+	                                                                       ifindex,
+	                                                                       obj->ip_route.metric)
+	                         : nm_platform_lookup_addrroute (platform,
+	                                                         obj_type,
+	                                                         ifindex),
 	                         &o) {
 		const NMPObject *obj_old = NULL;
 
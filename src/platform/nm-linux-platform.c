@@ -1714,8 +1714,8 @@ errout:
 }
 
 /* Copied and heavily modified from libnl3's addr_msg_parser(). */
-static NMPObject *
-_new_from_nl_addr (struct nlmsghdr *nlh, gboolean id_only)
+static gboolean
+_parse_from_nl_addr (struct nlmsghdr *nlh, gboolean id_only, NMPObject *obj)
 {
 	static struct nla_policy policy[IFA_MAX+1] = {
 		[IFA_LABEL]     = { .type = NLA_STRING,
@@ -1726,13 +1726,11 @@ _new_from_nl_addr (struct nlmsghdr *nlh, gboolean id_only)
 	struct nlattr *tb[IFA_MAX+1];
 	int err;
 	gboolean is_v4;
-	nm_auto_nmpobj NMPObject *obj = NULL;
-	NMPObject *obj_result = NULL;
 	int addr_len;
 	guint32 lifetime, preferred, timestamp;
 
 	if (!nlmsg_valid_hdr (nlh, sizeof (*ifa)))
-		return NULL;
+		return FALSE;
 	ifa = nlmsg_data(nlh);
 
 	if (!NM_IN_SET (ifa->ifa_family, AF_INET, AF_INET6))
@@ -1752,7 +1750,7 @@ _new_from_nl_addr (struct nlmsghdr *nlh, gboolean id_only)
 
 	/*****************************************************************/
 
-	obj = nmp_object_new (is_v4 ? NMP_OBJECT_TYPE_IP4_ADDRESS : NMP_OBJECT_TYPE_IP6_ADDRESS, NULL);
+	nmp_object_stackinit (obj, is_v4 ? NMP_OBJECT_TYPE_IP4_ADDRESS : NMP_OBJECT_TYPE_IP6_ADDRESS, NULL);
 
 	obj->ip_address.ifindex = ifa->ifa_index;
 	obj->ip_address.plen = ifa->ifa_prefixlen;
@@ -1822,15 +1820,14 @@ _new_from_nl_addr (struct nlmsghdr *nlh, gboolean id_only)
 	                         &obj->ip_address.lifetime,
 	                         &obj->ip_address.preferred);
 
-	obj_result = obj;
-	obj = NULL;
+	return TRUE;
 errout:
-	return obj_result;
+	return FALSE;
 }
 
 /* Copied and heavily modified from libnl3's rtnl_route_parse() and parse_multipath(). */
-static NMPObject *
-_new_from_nl_route (struct nlmsghdr *nlh, gboolean id_only)
+static gboolean
+_parse_from_nl_route (struct nlmsghdr *nlh, gboolean id_only, NMPObject *obj)
 {
 	static struct nla_policy policy[RTA_MAX+1] = {
 		[RTA_IIF]       = { .type = NLA_U32 },
@@ -1845,8 +1842,6 @@ _new_from_nl_route (struct nlmsghdr *nlh, gboolean id_only)
 	struct nlattr *tb[RTA_MAX + 1];
 	int err;
 	gboolean is_v4;
-	nm_auto_nmpobj NMPObject *obj = NULL;
-	NMPObject *obj_result = NULL;
 	int addr_len;
 	struct {
 		gboolean is_present;
@@ -1858,7 +1853,7 @@ _new_from_nl_route (struct nlmsghdr *nlh, gboolean id_only)
 	guint32 table;
 
 	if (!nlmsg_valid_hdr (nlh, sizeof (*rtm)))
-		return NULL;
+		return FALSE;
 	rtm = nlmsg_data(nlh);
 
 	/*****************************************************************
@@ -1994,7 +1989,7 @@ _new_from_nl_route (struct nlmsghdr *nlh, gboolean id_only)
 
 	/*****************************************************************/
 
-	obj = nmp_object_new (is_v4 ? NMP_OBJECT_TYPE_IP4_ROUTE : NMP_OBJECT_TYPE_IP6_ROUTE, NULL);
+	nmp_object_stackinit (obj, is_v4 ? NMP_OBJECT_TYPE_IP4_ROUTE : NMP_OBJECT_TYPE_IP6_ROUTE, NULL);
 
 	obj->ip_route.ifindex = nh.ifindex;
 
@@ -2056,10 +2051,39 @@ _new_from_nl_route (struct nlmsghdr *nlh, gboolean id_only)
 
 	obj->ip_route.rt_source = nmp_utils_ip_config_source_from_rtprot (rtm->rtm_protocol);
 
-	obj_result = obj;
-	obj = NULL;
+	return TRUE;
 errout:
-	return obj_result;
+	return FALSE;
+}
+
+/* Addresses and routes have no dynamically allocated parts. They are
+ * parsed into a stack-allocated object first, so that the caller can check
+ * it against the cache and only allocate when something changed. */
+static gboolean
+_parse_from_nl_addrroute (struct nlmsghdr *nlh, gboolean id_only, NMPObject *obj)
+{
+	switch (nlh->nlmsg_type) {
+	case RTM_NEWADDR:
+	case RTM_DELADDR:
+	case RTM_GETADDR:
+		return _parse_from_nl_addr (nlh, id_only, obj);
+	case RTM_NEWROUTE:
+	case RTM_DELROUTE:
+	case RTM_GETROUTE:
+		return _parse_from_nl_route (nlh, id_only, obj);
+	default:
+		return FALSE;
+	}
+}
+
+static NMPObject *
+_new_from_nl_addrroute (struct nlmsghdr *nlh, gboolean id_only)
+{
+	NMPObject obj;
+
+	if (!_parse_from_nl_addrroute (nlh, id_only, &obj))
+		return NULL;
+	return nmp_object_new (NMP_OBJECT_GET_TYPE (&obj), &obj.object);
 }
 
 /**
@@ -2093,11 +2117,10 @@ nmp_object_new_from_nl (NMPlatform *platform, const NMPCache *cache, struct nl_m
 	case RTM_NEWADDR:
 	case RTM_DELADDR:
 	case RTM_GETADDR:
-		return _new_from_nl_addr (msghdr, id_only);
 	case RTM_NEWROUTE:
 	case RTM_DELROUTE:
 	case RTM_GETROUTE:
-		return _new_from_nl_route (msghdr, id_only);
+		return _new_from_nl_addrroute (msghdr, id_only);
 	default:
 		return NULL;
 	}
@@ -2595,7 +2618,14 @@ typedef struct {
 } DelayedActionWaitForNlResponseData;
 
 typedef struct {
+	/* the socket for our requests and their responses. It is not subscribed
+	 * to any multicast group, so waiting for an ACK never has to wade through
+	 * unrelated events. */
 	struct nl_sock *nlh;
+
+	/* the socket subscribed to the multicast groups for the events. */
+	struct nl_sock *nlh_event;
+
 	guint32 nlh_seq_next;
 #ifdef NM_MORE_LOGGING
 	guint32 nlh_seq_last_handled;
@@ -2606,9 +2636,21 @@ typedef struct {
 
 	bool pruning[_DELAYED_ACTION_IDX_REFRESH_ALL_NUM];
 
+	/* the object types of which pruning removed objects, whose pools
+	 * are not yet trimmed. See cache_prune_all(). */
+	bool pools_to_trim[_DELAYED_ACTION_IDX_REFRESH_ALL_NUM];
+	gint64 pools_trimmed_at;
+
 	bool sysctl_get_warned;
 	GHashTable *sysctl_get_prev_values;
 
+	/* the values that we last wrote to some per-interface sysctls,
+	 * see _sysctl_cache_parse_path(). */
+	GHashTable *sysctl_cache;
+
+	/* results of ethtool ioctls, by ifindex. See _ethtool_cache_get(). */
+	GHashTable *ethtool_cache;
+
 	NMUdevClient *udev_client;
 
 	struct {
@@ -2620,6 +2662,11 @@ typedef struct {
 		 * by type. */
 		gint refresh_all_in_progess[_DELAYED_ACTION_IDX_REFRESH_ALL_NUM];
 
+		/* whether we are resynchronizing the cache after the netlink socket
+		 * overflowed. In that case, the object types are dumped one after
+		 * another instead of all at once. */
+		bool resync_in_progress:1;
+
 		GPtrArray *list_master_connected;
 		GPtrArray *list_refresh_link;
 		GArray *list_wait_for_nl_response;
@@ -2659,6 +2706,33 @@ nm_linux_platform_new (gboolean log_with_ptr, gboolean netns_support)
 	                     NULL);
 }
 
+/**
+ * nm_linux_platform_new_for_netns:
+ * @multi_idx: (allow-none): the dedup index for the platform cache
+ * @lazy: whether to defer opening the netlink sockets and
+ *   populating the cache until the instance is used.
+ *
+ * Creates a platform instance for the current network namespace.
+ * This is for managing many namespaces: the instances can share one
+ * @multi_idx, so that identical objects are stored only once, and with
+ * @lazy an instance costs no file descriptors and no cache memory
+ * until it is needed. All instances are served by the same main
+ * context.
+ *
+ * Returns: (transfer full): the new platform instance
+ */
+NMPlatform *
+nm_linux_platform_new_for_netns (NMDedupMultiIndex *multi_idx, gboolean lazy)
+{
+	return g_object_new (NM_TYPE_LINUX_PLATFORM,
+	                     NM_PLATFORM_LOG_WITH_PTR, TRUE,
+	                     NM_PLATFORM_USE_UDEV, FALSE,
+	                     NM_PLATFORM_NETNS_SUPPORT, TRUE,
+	                     NM_PLATFORM_MULTI_IDX, multi_idx,
+	                     NM_PLATFORM_LAZY, lazy,
+	                     NULL);
+}
+
 void
 nm_linux_platform_setup (void)
 {
@@ -2717,6 +2791,199 @@ _log_dbg_sysctl_set_impl (NMPlatform *platform, const char *pathid, int dirfd, c
 		} \
 	} G_STMT_END
 
+/*****************************************************************************/
+
+/* We remember the value that we last wrote to a per-interface sysctl below
+ * /proc/sys/net/ipv[46]/conf/IFNAME/, to skip writing the same value again.
+ * As the platform instance is per network namespace, so is the cache.
+ *
+ * The cache is only a hint: sysctl.d, udev rules or the admin may change
+ * a value behind our back, without any notification. So before skipping a
+ * write, the current value is read back, which is cheaper than writing
+ * (some writes make the kernel reconfigure the interface).
+ *
+ * Reads always go to procfs. The kernel adjusts some values on its own (for
+ * example hop_limit and mtu from router advertisements, or forwarding when
+ * ip_forward changes), and so may the admin. So only keys the kernel never
+ * changes are cached at all. The kernel resets them when the interface is
+ * re-created, so the entries of an interface are dropped on link changes
+ * (see cache_on_change()). Writes to other sysctls below /proc/sys/net,
+ * like the "all" and "default" directories, clear the entire cache. */
+
+static const char *const _sysctl_cache_keys[] = {
+	"accept_ra",
+	"accept_ra_defrtr",
+	"accept_ra_pinfo",
+	"accept_ra_rtr_pref",
+	"rp_filter",
+	"use_tempaddr",
+};
+
+typedef enum {
+	SYSCTL_CACHE_PATH_NONE,
+	SYSCTL_CACHE_PATH_IFACE,
+	SYSCTL_CACHE_PATH_OTHER,
+} SysctlCachePathType;
+
+static SysctlCachePathType
+_sysctl_cache_parse_path (const char *path, char *out_ifname)
+{
+	static const char *const prefixes[] = {
+		"/proc/sys/net/ipv4/conf/",
+		"/proc/sys/net/ipv6/conf/",
+	};
+	const char *ifname = NULL;
+	const char *slash;
+	guint i;
+
+	if (!g_str_has_prefix (path, "/proc/sys/net/"))
+		return SYSCTL_CACHE_PATH_NONE;
+
+	for (i = 0; i < G_N_ELEMENTS (prefixes); i++) {
+		if (g_str_has_prefix (path, prefixes[i])) {
+			ifname = &path[strlen (prefixes[i])];
+			break;
+		}
+	}
+	if (!ifname)
+		return SYSCTL_CACHE_PATH_OTHER;
+
+	slash = strchr (ifname, '/');
+	if (   !slash
+	    || slash == ifname
+	    || slash - ifname >= IFNAMSIZ
+	    || !slash[1]
+	    || strchr (&slash[1], '/'))
+		return SYSCTL_CACHE_PATH_OTHER;
+
+	memcpy (out_ifname, ifname, slash - ifname);
+	out_ifname[slash - ifname] = '\0';
+
+	if (NM_IN_STRSET (out_ifname, "all", "default"))
+		return SYSCTL_CACHE_PATH_OTHER;
+
+	for (i = 0; i < G_N_ELEMENTS (_sysctl_cache_keys); i++) {
+		if (nm_streq (&slash[1], _sysctl_cache_keys[i]))
+			return SYSCTL_CACHE_PATH_IFACE;
+	}
+	return SYSCTL_CACHE_PATH_NONE;
+}
+
+static const char *
+_sysctl_cache_lookup (NMPlatform *platform, const char *ifname, const char *path)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	GHashTable *values;
+
+	if (   !priv->sysctl_cache
+	    || !(values = g_hash_table_lookup (priv->sysctl_cache, ifname)))
+		return NULL;
+	return g_hash_table_lookup (values, path);
+}
+
+static void
+_sysctl_cache_set (NMPlatform *platform, const char *ifname, const char *path, const char *value)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	GHashTable *values;
+
+	if (!priv->sysctl_cache) {
+		if (!value)
+			return;
+		priv->sysctl_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_hash_table_unref);
+	}
+
+	values = g_hash_table_lookup (priv->sysctl_cache, ifname);
+	if (!value) {
+		if (values)
+			g_hash_table_remove (values, path);
+		return;
+	}
+	if (!values) {
+		values = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+		g_hash_table_insert (priv->sysctl_cache, g_strdup (ifname), values);
+	}
+	g_hash_table_insert (values, g_strdup (path), g_strdup (value));
+}
+
+static void
+_sysctl_cache_clear (NMPlatform *platform, const char *ifname)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+
+	if (!priv->sysctl_cache)
+		return;
+
+	if (ifname)
+		g_hash_table_remove (priv->sysctl_cache, ifname);
+	else
+		g_hash_table_remove_all (priv->sysctl_cache);
+}
+
+/*****************************************************************************/
+
+/* The ethtool information of a link doesn't change while the link is
+ * unchanged, but device realization and activation ask for it over and
+ * over. Remember the results per ifindex, until cache_on_change() sees
+ * the link change. Only what is fixed by the driver and the hardware is
+ * cached; runtime settings like wake-on-LAN can be changed with ethtool
+ * without any netlink notification, so they are always queried. */
+typedef struct {
+	bool driver_info_valid:1;
+	bool driver_info_success:1;
+	bool perm_addr_valid:1;
+	bool perm_addr_success:1;
+	bool carrier_detect_valid:1;
+	bool carrier_detect:1;
+	bool vlans_valid:1;
+	bool vlans:1;
+	guint8 perm_addr_len;
+	guint8 perm_addr[NM_UTILS_HWADDR_LEN_MAX];
+	NMPUtilsEthtoolDriverInfo driver_info;
+} EthtoolCacheData;
+
+static EthtoolCacheData *
+_ethtool_cache_get (NMPlatform *platform, int ifindex, EthtoolCacheData *data_stack)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	EthtoolCacheData *data;
+
+	nm_assert (ifindex > 0);
+
+	if (!nmp_cache_lookup_link (nm_platform_get_cache (platform), ifindex)) {
+		/* we would never learn that the link is gone. Don't remember
+		 * anything about links that we don't know. */
+		memset (data_stack, 0, sizeof (*data_stack));
+		return data_stack;
+	}
+
+	if (!priv->ethtool_cache)
+		priv->ethtool_cache = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+
+	data = g_hash_table_lookup (priv->ethtool_cache, GINT_TO_POINTER (ifindex));
+	if (!data) {
+		data = g_new0 (EthtoolCacheData, 1);
+		g_hash_table_insert (priv->ethtool_cache, GINT_TO_POINTER (ifindex), data);
+	}
+	return data;
+}
+
+static void
+_ethtool_cache_clear (NMPlatform *platform, int ifindex)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+
+	if (!priv->ethtool_cache)
+		return;
+
+	if (ifindex > 0)
+		g_hash_table_remove (priv->ethtool_cache, GINT_TO_POINTER (ifindex));
+	else
+		g_hash_table_remove_all (priv->ethtool_cache);
+}
+
+/*****************************************************************************/
+
 static gboolean
 sysctl_set (NMPlatform *platform, const char *pathid, int dirfd, const char *path, const char *value)
 {
@@ -2727,6 +2994,8 @@ sysctl_set (NMPlatform *platform, const char *pathid, int dirfd, const char *pat
 	char *actual;
 	gs_free char *actual_free = NULL;
 	int errsv;
+	SysctlCachePathType cache_path_type = SYSCTL_CACHE_PATH_NONE;
+	char cache_ifname[IFNAMSIZ];
 
 	g_return_val_if_fail (path != NULL, FALSE);
 	g_return_val_if_fail (value != NULL, FALSE);
@@ -2739,6 +3008,23 @@ sysctl_set (NMPlatform *platform, const char *pathid, int dirfd, const char *pat
 			return FALSE;
 		}
 
+		cache_path_type = _sysctl_cache_parse_path (path, cache_ifname);
+		if (cache_path_type == SYSCTL_CACHE_PATH_IFACE) {
+			if (nm_streq0 (_sysctl_cache_lookup (platform, cache_ifname, path), value)) {
+				gs_free char *current = NULL;
+
+				/* somebody else may have changed the value since. */
+				if (   nm_utils_file_get_contents (-1, path, 1024, &current, NULL, NULL) >= 0
+				    && nm_streq (g_strstrip (current), value)) {
+					_LOGT ("sysctl: skip setting '%s' to '%s' (value is already set)", path, value);
+					return TRUE;
+				}
+			}
+			/* until the write succeeds, we don't know the value. */
+			_sysctl_cache_set (platform, cache_ifname, path, NULL);
+		} else if (cache_path_type == SYSCTL_CACHE_PATH_OTHER)
+			_sysctl_cache_clear (platform, NULL);
+
 		pathid = path;
 
 		fd = open (path, O_WRONLY | O_TRUNC | O_CLOEXEC);
@@ -2822,6 +3108,9 @@ sysctl_set (NMPlatform *platform, const char *pathid, int dirfd, const char *pat
 		return FALSE;
 	}
 
+	if (cache_path_type == SYSCTL_CACHE_PATH_IFACE)
+		_sysctl_cache_set (platform, cache_ifname, path, value);
+
 	/* success. errno is undefined (no need to set). */
 	return TRUE;
 }
@@ -3184,12 +3473,23 @@ delayed_action_handle_one (NMPlatform *platform)
 		return TRUE;
 	}
 
-	if (NM_FLAGS_ANY (priv->delayed_action.flags, DELAYED_ACTION_TYPE_REFRESH_ALL)) {
+	if (   NM_FLAGS_ANY (priv->delayed_action.flags, DELAYED_ACTION_TYPE_REFRESH_ALL)
+	    && !(   priv->delayed_action.resync_in_progress
+	         && NM_FLAGS_HAS (priv->delayed_action.flags, DELAYED_ACTION_TYPE_WAIT_FOR_NL_RESPONSE))) {
 		DelayedActionType flags, iflags;
 
 		flags = priv->delayed_action.flags & DELAYED_ACTION_TYPE_REFRESH_ALL;
 
-		priv->delayed_action.flags &= ~DELAYED_ACTION_TYPE_REFRESH_ALL;
+		if (priv->delayed_action.resync_in_progress) {
+			/* During a resync, only dump one object type at a time. We get here
+			 * only after all pending requests completed, so the previous dump is
+			 * complete and we can already prune the objects that it didn't return.
+			 * Events that arrive meanwhile are processed between the dumps. */
+			cache_prune_all (platform);
+			flags &= ~flags + 1;
+		}
+
+		priv->delayed_action.flags &= ~flags;
 
 		if (_LOGt_ENABLED ()) {
 			FOR_EACH_DELAYED_ACTION (iflags, flags) {
@@ -3242,6 +3542,8 @@ delayed_action_handle_all (NMPlatform *platform, gboolean read_netlink)
 		any = TRUE;
 	priv->delayed_action.is_handling--;
 
+	priv->delayed_action.resync_in_progress = FALSE;
+
 	cache_prune_all (platform);
 
 	return any;
@@ -3304,7 +3606,7 @@ delayed_action_schedule_WAIT_FOR_NL_RESPONSE (NMPlatform *platform,
 
 /*****************************************************************************/
 
-static void
+static guint
 cache_prune_one_type (NMPlatform *platform, NMPObjectType obj_type)
 {
 	NMDedupMultiIter iter;
@@ -3312,6 +3614,7 @@ cache_prune_one_type (NMPlatform *platform, NMPObjectType obj_type)
 	NMPCacheOpsType cache_op;
 	NMPLookup lookup;
 	NMPCache *cache = nm_platform_get_cache (platform);
+	guint n_pruned = 0;
 
 	nmp_lookup_init_obj_type (&lookup,
 	                          obj_type);
@@ -3328,25 +3631,56 @@ cache_prune_one_type (NMPlatform *platform, NMPObjectType obj_type)
 			nm_assert (cache_op == NMP_CACHE_OPS_REMOVED);
 			cache_on_change (platform, cache_op, obj_old, NULL);
 			nm_platform_cache_update_emit_signal (platform, cache_op, obj_old, NULL);
+			n_pruned++;
 		}
 	}
+	return n_pruned;
 }
 
+/* trimming a pool takes time linear to its free elements, and the links
+ * are dumped on every statistics refresh. Don't trim more often. */
+#define POOLS_TRIM_INTERVAL_MSEC 30000
+
 static void
 cache_prune_all (NMPlatform *platform)
 {
 	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
 	DelayedActionType iflags, action_type;
+	gboolean trim = FALSE;
+	gint64 now;
 
 	action_type = DELAYED_ACTION_TYPE_REFRESH_ALL;
 	FOR_EACH_DELAYED_ACTION (iflags, action_type) {
-		bool *p = &priv->pruning[delayed_action_refresh_all_to_idx (iflags)];
+		int idx = delayed_action_refresh_all_to_idx (iflags);
+
+		if (priv->pruning[idx]) {
+			priv->pruning[idx] = FALSE;
+			if (cache_prune_one_type (platform, delayed_action_refresh_to_object_type (iflags)) > 0)
+				priv->pools_to_trim[idx] = TRUE;
+		}
+		trim |= priv->pools_to_trim[idx];
+	}
+
+	/* a dump may have replaced many objects. Give the memory of the
+	 * pruned ones back. */
+	if (!trim)
+		return;
+	now = nm_utils_get_monotonic_timestamp_ms ();
+	if (   priv->pools_trimmed_at
+	    && now < priv->pools_trimmed_at + POOLS_TRIM_INTERVAL_MSEC)
+		return;
+	priv->pools_trimmed_at = now;
+
+	action_type = DELAYED_ACTION_TYPE_REFRESH_ALL;
+	FOR_EACH_DELAYED_ACTION (iflags, action_type) {
+		bool *p = &priv->pools_to_trim[delayed_action_refresh_all_to_idx (iflags)];
 
 		if (*p) {
 			*p = FALSE;
-			cache_prune_one_type (platform, delayed_action_refresh_to_object_type (iflags));
+			nmp_object_trim_pool (delayed_action_refresh_to_object_type (iflags));
 		}
 	}
+	nm_dedup_multi_index_trim (nm_platform_get_multi_idx (platform));
 }
 
 static void
@@ -3384,6 +3718,33 @@ cache_on_change (NMPlatform *platform,
 
 	switch (klass->obj_type) {
 	case NMP_OBJECT_TYPE_LINK:
+		{
+			/* the kernel resets the per-interface sysctls when an interface gets
+			 * (re-)created. Forget what we wrote to them. */
+			if (   obj_old
+			    && (   !obj_new
+			        || !nm_streq (obj_old->link.name, obj_new->link.name)))
+				_sysctl_cache_clear (platform, obj_old->link.name);
+			if (   obj_new
+			    && !obj_old)
+				_sysctl_cache_clear (platform, obj_new->link.name);
+		}
+		{
+			/* the ethtool information may change when the link gets (re-)created,
+			 * renamed, or its driver or flags change. But not when only the
+			 * statistics changed. */
+			if (   obj_old
+			    && (   !obj_new
+			        || !nm_streq (obj_old->link.name, obj_new->link.name)
+			        || !nm_streq0 (obj_old->link.driver, obj_new->link.driver)
+			        || obj_old->link.type != obj_new->link.type
+			        || obj_old->link.n_ifi_flags != obj_new->link.n_ifi_flags
+			        || obj_old->link.arptype != obj_new->link.arptype
+			        || obj_old->_link.netlink.is_in_netlink != obj_new->_link.netlink.is_in_netlink))
+				_ethtool_cache_clear (platform, obj_old->link.ifindex);
+			else if (!obj_old && obj_new)
+				_ethtool_cache_clear (platform, obj_new->link.ifindex);
+		}
 		{
 			/* check whether changing a slave link can cause a master link (bridge or bond) to go up/down */
 			if (   obj_old
@@ -3624,6 +3985,10 @@ _nl_send_auto_with_seq (NMPlatform *platform,
 	guint32 seq;
 	int nle;
 
+	nm_platform_ensure_started (platform);
+	if (G_UNLIKELY (!priv->nlh))
+		return -NLE_BAD_SOCK;
+
 	/* complete the message with a sequence number (ensuring it's not zero). */
 	seq = priv->nlh_seq_next++ ?: priv->nlh_seq_next++;
 
@@ -3839,7 +4204,25 @@ event_valid_msg (NMPlatform *platform, struct nl_msg *msg, gboolean handle_event
 		id_only = TRUE;
 	}
 
-	obj = nmp_object_new_from_nl (platform, cache, msg, id_only);
+	if (NM_IN_SET (msghdr->nlmsg_type, RTM_NEWADDR, RTM_NEWROUTE)) {
+		NMPObject obj_stack;
+
+		/* Most of these notifications re-announce objects that we already
+		 * have in the cache. Compare them in place and only allocate a new
+		 * object if something changed. */
+		if (_parse_from_nl_addrroute (msghdr, id_only, &obj_stack)) {
+			if (nmp_cache_update_netlink_unchanged (cache, &obj_stack)) {
+				_LOGT ("event-notification: %s, seq %u: %s (unchanged)",
+				       _nl_nlmsg_type_to_str (msghdr->nlmsg_type, buf_nlmsg_type, sizeof (buf_nlmsg_type)),
+				       msghdr->nlmsg_seq, nmp_object_to_string (&obj_stack,
+				           NMP_OBJECT_TO_STRING_PUBLIC, NULL, 0));
+				return;
+			}
+			obj = nmp_object_new (NMP_OBJECT_GET_TYPE (&obj_stack), &obj_stack.object);
+		}
+	} else
+		obj = nmp_object_new_from_nl (platform, cache, msg, id_only);
+
 	if (!obj) {
 		_LOGT ("event-notification: %s, seq %u: ignore",
 		       _nl_nlmsg_type_to_str (msghdr->nlmsg_type, buf_nlmsg_type, sizeof (buf_nlmsg_type)),
@@ -3886,6 +4269,32 @@ event_valid_msg (NMPlatform *platform, struct nl_msg *msg, gboolean handle_event
 	}
 }
 
+/**
+ * nm_linux_platform_process_netlink_msg:
+ * @platform: the #NMLinuxPlatform instance
+ * @nlh: a netlink message from NETLINK_ROUTE
+ *
+ * Processes @nlh as if it was a notification that was received from kernel.
+ * This is for replaying recorded netlink traffic in tests and benchmarks.
+ * Delayed actions that result from processing @nlh are handled when the
+ * main loop runs next.
+ */
+void
+nm_linux_platform_process_netlink_msg (NMPlatform *platform, const struct nlmsghdr *nlh)
+{
+	nm_auto_nlmsg struct nl_msg *msg = NULL;
+
+	g_return_if_fail (NM_IS_LINUX_PLATFORM (platform));
+	g_return_if_fail (nlh);
+
+	msg = nlmsg_convert ((struct nlmsghdr *) nlh);
+	if (!msg)
+		return;
+
+	nlmsg_set_proto (msg, NETLINK_ROUTE);
+	event_valid_msg (platform, msg, TRUE);
+}
+
 /*****************************************************************************/
 
 static gboolean
@@ -4219,6 +4628,12 @@ link_refresh (NMPlatform *platform, int ifindex)
 	return !!nm_platform_link_get_obj (platform, ifindex, TRUE);
 }
 
+static void
+link_refresh_all (NMPlatform *platform)
+{
+	do_request_one_type (platform, NMP_OBJECT_TYPE_LINK);
+}
+
 static gboolean
 link_set_netns (NMPlatform *platform,
                 int ifindex,
@@ -4359,6 +4774,11 @@ static gboolean
 link_supports_carrier_detect (NMPlatform *platform, int ifindex)
 {
 	nm_auto_pop_netns NMPNetns *netns = NULL;
+	EthtoolCacheData *data, data_stack;
+
+	data = _ethtool_cache_get (platform, ifindex, &data_stack);
+	if (data->carrier_detect_valid)
+		return data->carrier_detect;
 
 	if (!nm_platform_netns_push (platform, &netns))
 		return FALSE;
@@ -4367,7 +4787,10 @@ link_supports_carrier_detect (NMPlatform *platform, int ifindex)
 	 * us whether the device actually supports carrier detection in the first
 	 * place. We assume any device that does implements one of these two APIs.
 	 */
-	return nmp_utils_ethtool_supports_carrier_detect (ifindex) || nmp_utils_mii_supports_carrier_detect (ifindex);
+	data->carrier_detect =    nmp_utils_ethtool_supports_carrier_detect (ifindex)
+	                       || nmp_utils_mii_supports_carrier_detect (ifindex);
+	data->carrier_detect_valid = TRUE;
+	return data->carrier_detect;
 }
 
 static gboolean
@@ -4375,6 +4798,7 @@ link_supports_vlans (NMPlatform *platform, int ifindex)
 {
 	nm_auto_pop_netns NMPNetns *netns = NULL;
 	const NMPObject *obj;
+	EthtoolCacheData *data, data_stack;
 
 	obj = nm_platform_link_get_obj (platform, ifindex, TRUE);
 
@@ -4382,10 +4806,16 @@ link_supports_vlans (NMPlatform *platform, int ifindex)
 	if (!obj || obj->link.arptype != ARPHRD_ETHER)
 		return FALSE;
 
+	data = _ethtool_cache_get (platform, ifindex, &data_stack);
+	if (data->vlans_valid)
+		return data->vlans;
+
 	if (!nm_platform_netns_push (platform, &netns))
 		return FALSE;
 
-	return nmp_utils_ethtool_supports_vlans (ifindex);
+	data->vlans = nmp_utils_ethtool_supports_vlans (ifindex);
+	data->vlans_valid = TRUE;
+	return data->vlans;
 }
 
 static gboolean
@@ -4496,11 +4926,24 @@ link_get_permanent_address (NMPlatform *platform,
                             size_t *length)
 {
 	nm_auto_pop_netns NMPNetns *netns = NULL;
+	EthtoolCacheData *data, data_stack;
+	size_t len;
 
-	if (!nm_platform_netns_push (platform, &netns))
-		return FALSE;
+	data = _ethtool_cache_get (platform, ifindex, &data_stack);
+	if (!data->perm_addr_valid) {
+		if (!nm_platform_netns_push (platform, &netns))
+			return FALSE;
+
+		data->perm_addr_success = nmp_utils_ethtool_get_permanent_address (ifindex, data->perm_addr, &len);
+		data->perm_addr_len = data->perm_addr_success ? len : 0;
+		data->perm_addr_valid = TRUE;
+	}
 
-	return nmp_utils_ethtool_get_permanent_address (ifindex, buf, length);
+	if (!data->perm_addr_success)
+		return FALSE;
+	memcpy (buf, data->perm_addr, data->perm_addr_len);
+	*length = data->perm_addr_len;
+	return TRUE;
 }
 
 static gboolean
@@ -5597,19 +6040,31 @@ link_get_driver_info (NMPlatform *platform,
                       char **out_fw_version)
 {
 	nm_auto_pop_netns NMPNetns *netns = NULL;
-	NMPUtilsEthtoolDriverInfo driver_info;
+	EthtoolCacheData *data, data_stack;
 
-	if (!nm_platform_netns_push (platform, &netns))
-		return FALSE;
+	data = _ethtool_cache_get (platform, ifindex, &data_stack);
+	if (!data->driver_info_valid) {
+		if (!nm_platform_netns_push (platform, &netns))
+			return FALSE;
+
+		data->driver_info_success = nmp_utils_ethtool_get_driver_info (ifindex, &data->driver_info);
+		data->driver_info_valid = TRUE;
+	}
 
-	if (!nmp_utils_ethtool_get_driver_info (ifindex, &driver_info))
+	if (!data->driver_info_success)
 		return FALSE;
-	NM_SET_OUT (out_driver_name,    g_strdup (driver_info.driver));
-	NM_SET_OUT (out_driver_version, g_strdup (driver_info.version));
-	NM_SET_OUT (out_fw_version,     g_strdup (driver_info.fw_version));
+	NM_SET_OUT (out_driver_name,    g_strdup (data->driver_info.driver));
+	NM_SET_OUT (out_driver_version, g_strdup (data->driver_info.version));
+	NM_SET_OUT (out_fw_version,     g_strdup (data->driver_info.fw_version));
 	return TRUE;
 }
 
+static void
+link_ethtool_changed (NMPlatform *platform, int ifindex)
+{
+	_ethtool_cache_clear (platform, ifindex);
+}
+
 /*****************************************************************************/
 
 static gboolean
@@ -5725,29 +6180,26 @@ ip6_address_delete (NMPlatform *platform, int ifindex, struct in6_addr addr, gui
 
 /*****************************************************************************/
 
-static gboolean
-ip_route_add (NMPlatform *platform,
-              NMPNlmFlags flags,
-              int addr_family,
-              const NMPlatformIPRoute *route)
+static void
+_ip_route_add_stackinit (NMPObject *obj,
+                         int addr_family,
+                         const NMPlatformIPRoute *route)
 {
-	nm_auto_nlmsg struct nl_msg *nlmsg = NULL;
-	NMPObject obj;
 	NMPlatformIP4Route *r4;
 	NMPlatformIP6Route *r6;
 
 	switch (addr_family) {
 	case AF_INET:
-		nmp_object_stackinit (&obj, NMP_OBJECT_TYPE_IP4_ROUTE, (const NMPlatformObject *) route);
-		r4 = NMP_OBJECT_CAST_IP4_ROUTE (&obj);
+		nmp_object_stackinit (obj, NMP_OBJECT_TYPE_IP4_ROUTE, (const NMPlatformObject *) route);
+		r4 = NMP_OBJECT_CAST_IP4_ROUTE (obj);
 		r4->network = nm_utils_ip4_address_clear_host_address (r4->network, r4->plen);
 		r4->rt_source = nmp_utils_ip_config_source_round_trip_rtprot (r4->rt_source),
 		r4->scope_inv = nm_platform_route_scope_inv (!r4->gateway
 		                                             ? RT_SCOPE_LINK : RT_SCOPE_UNIVERSE);
 		break;
 	case AF_INET6:
-		nmp_object_stackinit (&obj, NMP_OBJECT_TYPE_IP6_ROUTE, (const NMPlatformObject *) route);
-		r6 = NMP_OBJECT_CAST_IP6_ROUTE (&obj);
+		nmp_object_stackinit (obj, NMP_OBJECT_TYPE_IP6_ROUTE, (const NMPlatformObject *) route);
+		r6 = NMP_OBJECT_CAST_IP6_ROUTE (obj);
 		nm_utils_ip6_address_clear_host_address (&r6->network, &r6->network, r6->plen);
 		r6->rt_source = nmp_utils_ip_config_source_round_trip_rtprot (r6->rt_source),
 		nm_utils_ip6_address_clear_host_address (&r6->src, &r6->src, r6->src_plen);
@@ -5755,6 +6207,18 @@ ip_route_add (NMPlatform *platform,
 	default:
 		nm_assert_not_reached ();
 	}
+}
+
+static gboolean
+ip_route_add (NMPlatform *platform,
+              NMPNlmFlags flags,
+              int addr_family,
+              const NMPlatformIPRoute *route)
+{
+	nm_auto_nlmsg struct nl_msg *nlmsg = NULL;
+	NMPObject obj;
+
+	_ip_route_add_stackinit (&obj, addr_family, route);
 
 	nlmsg = _nl_msg_new_route (RTM_NEWROUTE, flags, &obj);
 	if (!nlmsg)
@@ -5812,6 +6276,190 @@ ip_route_delete (NMPlatform *platform,
 	return do_delete_object (platform, obj, nlmsg);
 }
 
+/* Upper limit for the size of one sendmsg() when committing a batch of
+ * routes. Each request is acknowledged individually, so this also bounds
+ * the number of ACKs that pile up in the receive buffer before we read
+ * them. */
+#define IP_ROUTE_BATCH_SEND_SIZE (32 * 1024)
+
+static void
+_ip_route_batch_flush (NMPlatform *platform,
+                       GByteArray *buf,
+                       const guint32 *seqs,
+                       WaitForNlResponseResult *seq_results,
+                       guint n)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	guint i;
+	int nle;
+
+	if (buf->len == 0)
+		return;
+
+	nle = nl_sendto (priv->nlh, buf->data, buf->len);
+	g_byte_array_set_size (buf, 0);
+
+	if (nle < 0) {
+		_LOGE ("route-batch: failure sending %u netlink requests \"%s\" (%d)",
+		       n, nl_geterror (nle), -nle);
+		for (i = 0; i < n; i++) {
+			if (seqs[i])
+				seq_results[i] = WAIT_FOR_NL_RESPONSE_RESULT_RESPONSE_UNKNOWN;
+		}
+		return;
+	}
+
+	/* kernel processes the messages of one sendmsg() in order and
+	 * sends one ACK for each. Wait for all of them at once. Entries
+	 * without sequence number were not sent. */
+	for (i = 0; i < n; i++) {
+		if (seqs[i])
+			delayed_action_schedule_WAIT_FOR_NL_RESPONSE (platform, seqs[i], &seq_results[i], NULL);
+	}
+
+	delayed_action_handle_all (platform, FALSE);
+}
+
+static gboolean
+_ip_route_batch_needs_send (NMPlatform *platform, const NMPlatformIPRouteBatchEntry *entry)
+{
+	/* see ip_route_delete() for why we must not blindly delete an IPv4
+	 * route with metric zero. */
+	return    !entry->is_delete
+	       || NMP_OBJECT_GET_TYPE (entry->obj) != NMP_OBJECT_TYPE_IP4_ROUTE
+	       || entry->obj->ip_route.metric != 0
+	       || nmp_cache_lookup_obj (nm_platform_get_cache (platform), entry->obj);
+}
+
+static void
+ip_route_batch_commit (NMPlatform *platform,
+                       NMPlatformIPRouteBatchEntry *entries,
+                       guint len)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	NMPCache *cache = nm_platform_get_cache (platform);
+	gs_free WaitForNlResponseResult *seq_results = NULL;
+	gs_free guint32 *seqs = NULL;
+	GByteArray *buf;
+	NMPObject obj_stack;
+	const NMPObject *obj;
+	guint i, i_start;
+	gboolean need_refetch[2] = { FALSE, FALSE };
+	char s_buf[256];
+
+	/* Like for the single-route operations, start from an up-to-date cache.
+	 * If we are about to skip the deletion of an IPv4 route with metric zero,
+	 * be extra careful and reload the routes (once for the entire batch). */
+	delayed_action_handle_all (platform, TRUE);
+	if (G_UNLIKELY (!priv->nlh)) {
+		/* the (lazy) instance could not be started. */
+		for (i = 0; i < len; i++)
+			entries[i].success = FALSE;
+		return;
+	}
+	for (i = 0; i < len; i++) {
+		if (!_ip_route_batch_needs_send (platform, &entries[i])) {
+			do_request_one_type (platform, NMP_OBJECT_TYPE_IP4_ROUTE);
+			break;
+		}
+	}
+
+	seq_results = g_new0 (WaitForNlResponseResult, len);
+	seqs = g_new0 (guint32, len);
+	buf = g_byte_array_sized_new (IP_ROUTE_BATCH_SEND_SIZE);
+
+	for (i_start = 0, i = 0; i < len; i++) {
+		nm_auto_nlmsg struct nl_msg *nlmsg = NULL;
+		struct nlmsghdr *hdr;
+
+		if (entries[i].is_delete) {
+			if (!_ip_route_batch_needs_send (platform, &entries[i])) {
+				seq_results[i] = WAIT_FOR_NL_RESPONSE_RESULT_RESPONSE_OK;
+				continue;
+			}
+			obj = entries[i].obj;
+			nlmsg = _nl_msg_new_route (RTM_DELROUTE, 0, obj);
+		} else {
+			_ip_route_add_stackinit (&obj_stack,
+			                         NMP_OBJECT_GET_CLASS (entries[i].obj)->addr_family,
+			                         NMP_OBJECT_CAST_IP_ROUTE (entries[i].obj));
+			obj = &obj_stack;
+			nlmsg = _nl_msg_new_route (RTM_NEWROUTE, entries[i].flags, obj);
+		}
+		if (!nlmsg) {
+			nm_assert_not_reached ();
+			seq_results[i] = WAIT_FOR_NL_RESPONSE_RESULT_RESPONSE_UNKNOWN;
+			continue;
+		}
+
+		/* complete the message with a sequence number (ensuring it's not zero). */
+		seqs[i] = priv->nlh_seq_next++ ?: priv->nlh_seq_next++;
+		hdr = nlmsg_hdr (nlmsg);
+		hdr->nlmsg_seq = seqs[i];
+		nl_complete_msg (priv->nlh, nlmsg);
+
+		if (buf->len + NLMSG_ALIGN (hdr->nlmsg_len) > IP_ROUTE_BATCH_SEND_SIZE) {
+			_ip_route_batch_flush (platform, buf, &seqs[i_start], &seq_results[i_start], i - i_start);
+			i_start = i;
+		}
+		g_byte_array_append (buf, (const guint8 *) hdr, hdr->nlmsg_len);
+		g_byte_array_set_size (buf, NLMSG_ALIGN (buf->len));
+	}
+	_ip_route_batch_flush (platform, buf, &seqs[i_start], &seq_results[i_start], len - i_start);
+	g_byte_array_unref (buf);
+
+	for (i = 0; i < len; i++) {
+		gboolean in_cache;
+
+		if (entries[i].is_delete)
+			obj = entries[i].obj;
+		else {
+			_ip_route_add_stackinit (&obj_stack,
+			                         NMP_OBJECT_GET_CLASS (entries[i].obj)->addr_family,
+			                         NMP_OBJECT_CAST_IP_ROUTE (entries[i].obj));
+			obj = &obj_stack;
+		}
+		in_cache = !!nmp_cache_lookup_obj (cache, obj);
+		if (entries[i].is_delete ? in_cache : !in_cache)
+			need_refetch[NMP_OBJECT_GET_TYPE (obj) == NMP_OBJECT_TYPE_IP6_ROUTE] = TRUE;
+	}
+
+	/* Like do_add_addrroute() and do_delete_object(), refetch when the cache
+	 * disagrees with the result. But only once per address family. */
+	if (need_refetch[0])
+		do_request_one_type (platform, NMP_OBJECT_TYPE_IP4_ROUTE);
+	if (need_refetch[1])
+		do_request_one_type (platform, NMP_OBJECT_TYPE_IP6_ROUTE);
+
+	for (i = 0; i < len; i++) {
+		const char *log_detail = "";
+
+		if (entries[i].is_delete) {
+			obj = entries[i].obj;
+			if (NM_IN_SET (-((int) seq_results[i]), ESRCH, ENOENT))
+				log_detail = ", meaning the object was already removed";
+
+			/* like do_delete_object(), what counts is that the route is gone. */
+			entries[i].success = !nmp_cache_lookup_obj (cache, obj);
+		} else {
+			_ip_route_add_stackinit (&obj_stack,
+			                         NMP_OBJECT_GET_CLASS (entries[i].obj)->addr_family,
+			                         NMP_OBJECT_CAST_IP_ROUTE (entries[i].obj));
+			obj = &obj_stack;
+			entries[i].success =    seq_results[i] == WAIT_FOR_NL_RESPONSE_RESULT_RESPONSE_OK
+			                     && nmp_cache_lookup_obj (cache, obj);
+		}
+
+		_NMLOG (entries[i].success ? LOGL_DEBUG : LOGL_ERR,
+		        "route-batch: do-%s-%s[%s]: %s%s",
+		        entries[i].is_delete ? "delete" : "add",
+		        NMP_OBJECT_GET_CLASS (obj)->obj_type_name,
+		        nmp_object_to_string (obj, NMP_OBJECT_TO_STRING_ID, NULL, 0),
+		        wait_for_nl_response_to_string (seq_results[i], s_buf, sizeof (s_buf)),
+		        log_detail);
+	}
+}
+
 /*****************************************************************************/
 
 #define EVENT_CONDITIONS      ((GIOCondition) (G_IO_IN | G_IO_PRI))
@@ -5831,10 +6479,8 @@ event_handler (GIOChannel *channel,
 
 /* copied from libnl3's recvmsgs() */
 static int
-event_handler_recvmsgs (NMPlatform *platform, gboolean handle_events)
+event_handler_recvmsgs (NMPlatform *platform, struct nl_sock *sk, gboolean handle_events)
 {
-	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
-	struct nl_sock *sk = priv->nlh;
 	int n, err = 0, multipart = 0, interrupted = 0;
 	struct nlmsghdr *hdr;
 	WaitForNlResponseResult seq_result;
@@ -6044,13 +6690,79 @@ out:
 
 /*****************************************************************************/
 
+/* reads from @sk until there is nothing left, or at most @max_reads
+ * times if it is not zero. */
+static gboolean
+_read_netlink_socket (NMPlatform *platform, struct nl_sock *sk, guint max_reads)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	gboolean any = FALSE;
+	guint n_reads;
+	int nle;
+
+	for (n_reads = 0; max_reads == 0 || n_reads < max_reads; n_reads++) {
+
+		nle = event_handler_recvmsgs (platform, sk, TRUE);
+
+		if (nle < 0)
+			switch (nle) {
+			case -NLE_AGAIN:
+				return any;
+			case -NLE_DUMP_INTR:
+				_LOGD ("netlink: read: uncritical failure to retrieve incoming events: %s (%d)", nl_geterror (nle), nle);
+				break;
+			case -_NLE_MSG_TRUNC:
+			case -_NLE_NM_NOBUFS:
+				_LOGI ("netlink: read: %s. Need to resynchronize platform cache",
+				       ({
+				            const char *_reason = "unknown";
+				            switch (nle) {
+				            case -_NLE_MSG_TRUNC: _reason = "message truncated";       break;
+				            case -_NLE_NM_NOBUFS: _reason = "too many netlink events"; break;
+				            }
+				            _reason;
+				       }));
+				event_handler_recvmsgs (platform, sk, FALSE);
+
+				/* only the responses on the request socket are lost. Requests
+				 * are not affected by an overflow of the event socket. */
+				if (sk == priv->nlh)
+					delayed_action_wait_for_nl_response_complete_all (platform, WAIT_FOR_NL_RESPONSE_RESULT_FAILED_RESYNC);
+
+				/* the dumps that were in progress are incomplete. We must not prune
+				 * based on them. The objects stay dirty and the resync below marks
+				 * them again. */
+				memset (priv->pruning, 0, sizeof (priv->pruning));
+				priv->delayed_action.resync_in_progress = TRUE;
+				nm_platform_cache_resyncs_inc (platform);
+				delayed_action_schedule (platform,
+				                         DELAYED_ACTION_TYPE_REFRESH_ALL_LINKS |
+				                         DELAYED_ACTION_TYPE_REFRESH_ALL_IP4_ADDRESSES |
+				                         DELAYED_ACTION_TYPE_REFRESH_ALL_IP6_ADDRESSES |
+				                         DELAYED_ACTION_TYPE_REFRESH_ALL_IP4_ROUTES |
+				                         DELAYED_ACTION_TYPE_REFRESH_ALL_IP6_ROUTES,
+				                         NULL);
+				break;
+			default:
+				_LOGE ("netlink: read: failed to retrieve incoming events: %s (%d)", nl_geterror (nle), nle);
+				break;
+		}
+		any = TRUE;
+	}
+	return any;
+}
+
+/* while waiting for ACKs, how often to read the event socket before
+ * looking at the request socket again. */
+#define EVENT_READS_WHILE_WAITING 8
+
 static gboolean
 event_handler_read_netlink (NMPlatform *platform, gboolean wait_for_acks)
 {
 	nm_auto_pop_netns NMPNetns *netns = NULL;
 	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
-	int r, nle;
-	struct pollfd pfd;
+	int r;
+	struct pollfd pfd[2];
 	gboolean any = FALSE;
 	gint64 now_ns;
 	int timeout_ms;
@@ -6060,54 +6772,30 @@ event_handler_read_netlink (NMPlatform *platform, gboolean wait_for_acks)
 		gint64 timeout_abs_ns;
 	} data_next;
 
+	if (G_UNLIKELY (!priv->nlh)) {
+		/* not started yet, there is nothing to read. */
+		return FALSE;
+	}
+
 	if (!nm_platform_netns_push (platform, &netns))
 		return FALSE;
 
 	while (TRUE) {
 
-		while (TRUE) {
-
-			nle = event_handler_recvmsgs (platform, TRUE);
-
-			if (nle < 0)
-				switch (nle) {
-				case -NLE_AGAIN:
-					goto after_read;
-				case -NLE_DUMP_INTR:
-					_LOGD ("netlink: read: uncritical failure to retrieve incoming events: %s (%d)", nl_geterror (nle), nle);
-					break;
-				case -_NLE_MSG_TRUNC:
-				case -_NLE_NM_NOBUFS:
-					_LOGI ("netlink: read: %s. Need to resynchronize platform cache",
-					       ({
-					            const char *_reason = "unknown";
-					            switch (nle) {
-					            case -_NLE_MSG_TRUNC: _reason = "message truncated";       break;
-					            case -_NLE_NM_NOBUFS: _reason = "too many netlink events"; break;
-					            }
-					            _reason;
-					       }));
-					event_handler_recvmsgs (platform, FALSE);
-					delayed_action_wait_for_nl_response_complete_all (platform, WAIT_FOR_NL_RESPONSE_RESULT_FAILED_RESYNC);
-					delayed_action_schedule (platform,
-					                         DELAYED_ACTION_TYPE_REFRESH_ALL_LINKS |
-					                         DELAYED_ACTION_TYPE_REFRESH_ALL_IP4_ADDRESSES |
-					                         DELAYED_ACTION_TYPE_REFRESH_ALL_IP6_ADDRESSES |
-					                         DELAYED_ACTION_TYPE_REFRESH_ALL_IP4_ROUTES |
-					                         DELAYED_ACTION_TYPE_REFRESH_ALL_IP6_ROUTES,
-					                         NULL);
-					break;
-				default:
-					_LOGE ("netlink: read: failed to retrieve incoming events: %s (%d)", nl_geterror (nle), nle);
-					break;
-			}
+		/* while waiting for ACKs, read the events only in small batches,
+		 * so that a burst of events doesn't delay the completion of our
+		 * requests. But keep reading them, a long dump would otherwise
+		 * overflow the event socket. */
+		if (_read_netlink_socket (platform, priv->nlh_event,
+		                          wait_for_acks ? EVENT_READS_WHILE_WAITING : 0))
+			any = TRUE;
+		if (_read_netlink_socket (platform, priv->nlh, 0))
 			any = TRUE;
-		}
 
 after_read:
 
 		if (!NM_FLAGS_HAS (priv->delayed_action.flags, DELAYED_ACTION_TYPE_WAIT_FOR_NL_RESPONSE))
-			return any;
+			goto out;
 
 		now_ns = 0;
 		data_next.seq_number = 0;
@@ -6133,7 +6821,7 @@ after_read:
 
 		if (   !wait_for_acks
 		    || !NM_FLAGS_HAS (priv->delayed_action.flags, DELAYED_ACTION_TYPE_WAIT_FOR_NL_RESPONSE))
-			return any;
+			goto out;
 
 		nm_assert (data_next.seq_number);
 		nm_assert (data_next.timeout_abs_ns > 0);
@@ -6143,10 +6831,12 @@ after_read:
 
 		timeout_ms = (data_next.timeout_abs_ns - now_ns) / (NM_UTILS_NS_PER_SECOND / 1000);
 
-		memset (&pfd, 0, sizeof (pfd));
-		pfd.fd = nl_socket_get_fd (priv->nlh);
-		pfd.events = POLLIN;
-		r = poll (&pfd, 1, MAX (1, timeout_ms));
+		memset (pfd, 0, sizeof (pfd));
+		pfd[0].fd = nl_socket_get_fd (priv->nlh);
+		pfd[0].events = POLLIN;
+		pfd[1].fd = nl_socket_get_fd (priv->nlh_event);
+		pfd[1].events = POLLIN;
+		r = poll (pfd, G_N_ELEMENTS (pfd), MAX (1, timeout_ms));
 
 		if (r == 0) {
 			/* timeout and there is nothing to read. */
@@ -6158,11 +6848,21 @@ after_read:
 			if (errsv != EINTR) {
 				_LOGE ("netlink: read: poll failed with %s", strerror (errsv));
 				delayed_action_wait_for_nl_response_complete_all (platform, WAIT_FOR_NL_RESPONSE_RESULT_FAILED_POLL);
-				return any;
+				goto out;
 			}
 			/* Continue to read again, even if there might be nothing to read after EINTR. */
 		}
 	}
+
+out:
+	if (wait_for_acks) {
+		/* kernel queues the notifications about our changes on the event socket
+		 * before sending the ACK. Process them now, so that the cache reflects
+		 * the result of the requests when the caller looks. */
+		if (_read_netlink_socket (platform, priv->nlh_event, 0))
+			any = TRUE;
+	}
+	return any;
 }
 
 /*****************************************************************************/
@@ -6300,64 +7000,66 @@ nm_linux_platform_init (NMLinuxPlatform *self)
 	priv->wifi_data = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify) wifi_utils_deinit);
 }
 
-static void
-constructed (GObject *_object)
+static struct nl_sock *
+_nl_socket_new (void)
 {
-	NMPlatform *platform = NM_PLATFORM (_object);
-	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
-	int channel_flags;
-	gboolean status;
+	struct nl_sock *sk;
 	int nle;
 
-	nm_assert (!platform->_netns || platform->_netns == nmp_netns_get_current ());
-
-	if (nm_platform_get_use_udev (platform)) {
-		priv->udev_client = nm_udev_client_new ((const char *[]) { "net", NULL },
-		                                        handle_udev_event, platform);
-	}
+	sk = nl_socket_alloc ();
+	g_assert (sk);
 
-	_LOGD ("create (%s netns, %s, %s udev)",
-	       !platform->_netns ? "ignore" : "use",
-	       !platform->_netns && nmp_netns_is_initial ()
-	           ? "initial netns"
-	           : (!nmp_netns_get_current ()
-	                ? "no netns support"
-	                : nm_sprintf_bufa (100, "in netns[%p]%s",
-	                                   nmp_netns_get_current (),
-	                                   nmp_netns_get_current () == nmp_netns_get_initial () ? "/main" : "")),
-	       nm_platform_get_use_udev (platform) ? "use" : "no");
-
-	priv->nlh = nl_socket_alloc ();
-	g_assert (priv->nlh);
-
-	nle = nl_connect (priv->nlh, NETLINK_ROUTE);
+	nle = nl_connect (sk, NETLINK_ROUTE);
 	g_assert (!nle);
-	nle = nl_socket_set_passcred (priv->nlh, 1);
+	nle = nl_socket_set_passcred (sk, 1);
 	g_assert (!nle);
 
-	/* No blocking for event socket, so that we can drain it safely. */
-	nle = nl_socket_set_nonblocking (priv->nlh);
+	/* No blocking for the sockets, so that we can drain them safely. */
+	nle = nl_socket_set_nonblocking (sk);
 	g_assert (!nle);
 
 	/* use 8 MB for receive socket kernel queue. */
-	nle = nl_socket_set_buffer_size (priv->nlh, 8*1024*1024, 0);
+	nle = nl_socket_set_buffer_size (sk, 8*1024*1024, 0);
 	g_assert (!nle);
 
 	/* explicitly set the msg buffer size and disable MSG_PEEK.
 	 * If we later encounter NLE_MSG_TRUNC, we will adjust the buffer size. */
-	nl_socket_disable_msg_peek (priv->nlh);
-	nle = nl_socket_set_msg_buf_size (priv->nlh, 32 * 1024);
+	nl_socket_disable_msg_peek (sk);
+	nle = nl_socket_set_msg_buf_size (sk, 32 * 1024);
 	g_assert (!nle);
 
-	nle = nl_socket_add_memberships (priv->nlh,
+	return sk;
+}
+
+static void
+start (NMPlatform *platform)
+{
+	NMLinuxPlatformPrivate *priv = NM_LINUX_PLATFORM_GET_PRIVATE (platform);
+	int channel_flags;
+	gboolean status;
+	int nle;
+
+	nm_assert (!platform->_netns || platform->_netns == nmp_netns_get_current ());
+	nm_assert (!priv->nlh);
+
+	if (nm_platform_get_use_udev (platform)) {
+		priv->udev_client = nm_udev_client_new ((const char *[]) { "net", NULL },
+		                                        handle_udev_event, platform);
+	}
+
+	priv->nlh = _nl_socket_new ();
+	_LOGD ("Netlink socket for requests established: port=%u, fd=%d", nl_socket_get_local_port (priv->nlh), nl_socket_get_fd (priv->nlh));
+
+	priv->nlh_event = _nl_socket_new ();
+	nle = nl_socket_add_memberships (priv->nlh_event,
 	                                 RTNLGRP_LINK,
 	                                 RTNLGRP_IPV4_IFADDR, RTNLGRP_IPV6_IFADDR,
 	                                 RTNLGRP_IPV4_ROUTE,  RTNLGRP_IPV6_ROUTE,
 	                                 0);
 	g_assert (!nle);
-	_LOGD ("Netlink socket for events established: port=%u, fd=%d", nl_socket_get_local_port (priv->nlh), nl_socket_get_fd (priv->nlh));
+	_LOGD ("Netlink socket for events established: port=%u, fd=%d", nl_socket_get_local_port (priv->nlh_event), nl_socket_get_fd (priv->nlh_event));
 
-	priv->event_channel = g_io_channel_unix_new (nl_socket_get_fd (priv->nlh));
+	priv->event_channel = g_io_channel_unix_new (nl_socket_get_fd (priv->nlh_event));
 	g_io_channel_set_encoding (priv->event_channel, NULL, NULL);
 	g_io_channel_set_close_on_unref (priv->event_channel, TRUE);
 
@@ -6369,9 +7071,6 @@ constructed (GObject *_object)
 	                                (EVENT_CONDITIONS | ERROR_CONDITIONS | DISCONNECT_CONDITIONS),
 	                                 event_handler, platform);
 
-	/* complete construction of the GObject instance before populating the cache. */
-	G_OBJECT_CLASS (nm_linux_platform_parent_class)->constructed (_object);
-
 	_LOGD ("populate platform cache");
 	delayed_action_schedule (platform,
 	                         DELAYED_ACTION_TYPE_REFRESH_ALL_LINKS |
@@ -6412,6 +7111,34 @@ constructed (GObject *_object)
 	}
 }
 
+static void
+constructed (GObject *_object)
+{
+	NMPlatform *platform = NM_PLATFORM (_object);
+
+	nm_assert (!platform->_netns || platform->_netns == nmp_netns_get_current ());
+
+	_LOGD ("create (%s netns, %s, %s udev%s)",
+	       !platform->_netns ? "ignore" : "use",
+	       !platform->_netns && nmp_netns_is_initial ()
+	           ? "initial netns"
+	           : (!nmp_netns_get_current ()
+	                ? "no netns support"
+	                : nm_sprintf_bufa (100, "in netns[%p]%s",
+	                                   nmp_netns_get_current (),
+	                                   nmp_netns_get_current () == nmp_netns_get_initial () ? "/main" : "")),
+	       nm_platform_get_use_udev (platform) ? "use" : "no",
+	       nm_platform_get_lazy (platform) ? ", lazy" : "");
+
+	/* complete construction of the GObject instance before populating the cache. */
+	G_OBJECT_CLASS (nm_linux_platform_parent_class)->constructed (_object);
+
+	/* A lazy instance opens its netlink sockets and populates the cache only
+	 * once the cache is accessed. See nm_platform_ensure_started(). */
+	if (!nm_platform_get_lazy (platform))
+		nm_platform_ensure_started (platform);
+}
+
 static void
 dispose (GObject *object)
 {
@@ -6438,9 +7165,13 @@ finalize (GObject *object)
 	g_ptr_array_unref (priv->delayed_action.list_refresh_link);
 	g_array_unref (priv->delayed_action.list_wait_for_nl_response);
 
-	g_source_remove (priv->event_id);
-	g_io_channel_unref (priv->event_channel);
-	nl_socket_free (priv->nlh);
+	nm_clear_g_source (&priv->event_id);
+	if (priv->event_channel)
+		g_io_channel_unref (priv->event_channel);
+	if (priv->nlh_event)
+		nl_socket_free (priv->nlh_event);
+	if (priv->nlh)
+		nl_socket_free (priv->nlh);
 
 	g_hash_table_unref (priv->wifi_data);
 
@@ -6449,6 +7180,12 @@ finalize (GObject *object)
 		g_hash_table_destroy (priv->sysctl_get_prev_values);
 	}
 
+	if (priv->sysctl_cache)
+		g_hash_table_unref (priv->sysctl_cache);
+
+	if (priv->ethtool_cache)
+		g_hash_table_unref (priv->ethtool_cache);
+
 	priv->udev_client = nm_udev_client_unref (priv->udev_client);
 
 	G_OBJECT_CLASS (nm_linux_platform_parent_class)->finalize (object);
@@ -6464,6 +7201,8 @@ nm_linux_platform_class_init (NMLinuxPlatformClass *klass)
 	object_class->dispose = dispose;
 	object_class->finalize = finalize;
 
+	platform_class->start = start;
+
 	platform_class->sysctl_set = sysctl_set;
 	platform_class->sysctl_get = sysctl_get;
 
@@ -6471,6 +7210,7 @@ nm_linux_platform_class_init (NMLinuxPlatformClass *klass)
 	platform_class->link_delete = link_delete;
 
 	platform_class->link_refresh = link_refresh;
+	platform_class->link_refresh_all = link_refresh_all;
 
 	platform_class->link_set_netns = link_set_netns;
 
@@ -6493,6 +7233,7 @@ nm_linux_platform_class_init (NMLinuxPlatformClass *klass)
 	platform_class->link_get_physical_port_id = link_get_physical_port_id;
 	platform_class->link_get_dev_id = link_get_dev_id;
 	platform_class->link_get_wake_on_lan = link_get_wake_on_lan;
+	platform_class->link_ethtool_changed = link_ethtool_changed;
 	platform_class->link_get_driver_info = link_get_driver_info;
 
 	platform_class->link_supports_carrier_detect = link_supports_carrier_detect;
@@ -6542,6 +7283,7 @@ nm_linux_platform_class_init (NMLinuxPlatformClass *klass)
 
 	platform_class->ip_route_add = ip_route_add;
 	platform_class->ip_route_delete = ip_route_delete;
+	platform_class->ip_route_batch_commit = ip_route_batch_commit;
 
 	platform_class->check_support_kernel_extended_ifa_flags = check_support_kernel_extended_ifa_flags;
 	platform_class->check_support_user_ipv6ll = check_support_user_ipv6ll;
@@ -37,6 +37,14 @@ GType nm_linux_platform_get_type (void);
 
 NMPlatform *nm_linux_platform_new (gboolean log_with_ptr, gboolean netns_support);
 
+struct _NMDedupMultiIndex;
+
+NMPlatform *nm_linux_platform_new_for_netns (struct _NMDedupMultiIndex *multi_idx, gboolean lazy);
+
 void nm_linux_platform_setup (void);
 
+struct nlmsghdr;
+
+void nm_linux_platform_process_netlink_msg (NMPlatform *platform, const struct nlmsghdr *nlh);
+
 #endif /* __NETWORKMANAGER_LINUX_PLATFORM_H__ */
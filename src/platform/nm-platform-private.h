@@ -26,6 +26,8 @@
 
 NMPCache *nm_platform_get_cache (NMPlatform *self);
 
+void nm_platform_ensure_started (NMPlatform *self);
+
 #define NMTST_ASSERT_PLATFORM_NETNS_CURRENT(platform) \
 	G_STMT_START { \
 		NMPlatform *_platform = (platform); \
@@ -39,4 +41,6 @@ void nm_platform_cache_update_emit_signal (NMPlatform *platform,
                                            const NMPObject *obj_old,
                                            const NMPObject *obj_new);
 
+void nm_platform_cache_resyncs_inc (NMPlatform *self);
+
 #endif /* __NM_PLATFORM_PRIVATE_H__ */
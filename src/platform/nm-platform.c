@@ -79,20 +79,30 @@ G_STATIC_ASSERT (G_STRUCT_OFFSET (NMPlatformIPRoute, network_ptr) == G_STRUCT_OF
 /*****************************************************************************/
 
 static guint signals[_NM_PLATFORM_SIGNAL_ID_LAST] = { 0 };
+static guint signal_changed_set = 0;
 
 enum {
 	PROP_0,
 	PROP_NETNS_SUPPORT,
 	PROP_USE_UDEV,
 	PROP_LOG_WITH_PTR,
+	PROP_CACHE_RESYNCS,
+	PROP_MULTI_IDX,
+	PROP_LAZY,
 	LAST_PROP,
 };
 
 typedef struct _NMPlatformPrivate {
 	bool use_udev:1;
 	bool log_with_ptr:1;
+	bool lazy:1;
+	bool start_pending:1;
+	guint cache_resyncs;
 	NMDedupMultiIndex *multi_idx;
 	NMPCache *cache;
+	NMPlatformChangedSet *changed_set;
+	guint changed_set_id;
+	GHashTable *link_stats_pollers;
 } NMPlatformPrivate;
 
 G_DEFINE_TYPE (NMPlatform, nm_platform, G_TYPE_OBJECT)
@@ -113,6 +123,81 @@ nm_platform_get_log_with_ptr (NMPlatform *self)
 	return NM_PLATFORM_GET_PRIVATE (self)->log_with_ptr;
 }
 
+gboolean
+nm_platform_get_lazy (NMPlatform *self)
+{
+	return NM_PLATFORM_GET_PRIVATE (self)->lazy;
+}
+
+/**
+ * nm_platform_is_started:
+ * @self: the platform instance
+ *
+ * Returns: %FALSE for a lazy platform instance, that was not yet
+ *   used. Such an instance has no kernel resources (sockets)
+ *   allocated and its cache is empty.
+ */
+gboolean
+nm_platform_is_started (NMPlatform *self)
+{
+	return !NM_PLATFORM_GET_PRIVATE (self)->start_pending;
+}
+
+/**
+ * nm_platform_ensure_started:
+ * @self: the platform instance
+ *
+ * Calls the start() hook of the platform implementation, unless that
+ * already happened. For lazy instances this is called when the cache
+ * is accessed for the first time, so that creating a platform instance
+ * for each of many network namespaces only costs resources for the
+ * namespaces that are actually used.
+ */
+void
+nm_platform_ensure_started (NMPlatform *self)
+{
+	NMPlatformPrivate *priv = NM_PLATFORM_GET_PRIVATE (self);
+	nm_auto_pop_netns NMPNetns *netns = NULL;
+
+	if (G_LIKELY (!priv->start_pending))
+		return;
+
+	/* clear the flag first. Starting populates the cache, which
+	 * accesses the cache again. */
+	priv->start_pending = FALSE;
+
+	if (!nm_platform_netns_push (self, &netns)) {
+		/* we cannot start now. Try again on next access. */
+		priv->start_pending = TRUE;
+		return;
+	}
+
+	NM_PLATFORM_GET_CLASS (self)->start (self);
+}
+
+/**
+ * nm_platform_get_cache_resyncs:
+ * @self: the platform instance
+ *
+ * Returns: how often the platform cache had to be resynchronized
+ *   with kernel, because change events got lost.
+ */
+guint
+nm_platform_get_cache_resyncs (NMPlatform *self)
+{
+	return NM_PLATFORM_GET_PRIVATE (self)->cache_resyncs;
+}
+
+void
+nm_platform_cache_resyncs_inc (NMPlatform *self)
+{
+	NMPlatformPrivate *priv = NM_PLATFORM_GET_PRIVATE (self);
+
+	priv->cache_resyncs++;
+	_LOGD ("cache: resynchronize platform cache (%u times so far)", priv->cache_resyncs);
+	g_object_notify (G_OBJECT (self), NM_PLATFORM_CACHE_RESYNCS);
+}
+
 /*****************************************************************************/
 
 guint
@@ -1064,6 +1149,137 @@ nm_platform_link_refresh (NMPlatform *self, int ifindex)
 	return TRUE;
 }
 
+/**
+ * nm_platform_link_refresh_all:
+ * @self: platform instance
+ *
+ * Reload all links synchronously with one request.
+ */
+void
+nm_platform_link_refresh_all (NMPlatform *self)
+{
+	_CHECK_SELF_VOID (self, klass);
+
+	if (klass->link_refresh_all)
+		klass->link_refresh_all (self);
+}
+
+/*****************************************************************************/
+
+/* All watchers with the same refresh rate share one timer. On each tick, the
+ * statistics for all watched links are reloaded at once. The new counters
+ * are announced via the link-changed signal. */
+typedef struct {
+	NMPlatform *self;
+	guint refresh_rate_ms;
+	guint timeout_id;
+
+	/* ifindex -> number of watchers */
+	GHashTable *ifindexes;
+} LinkStatsPoller;
+
+static void
+_link_stats_poller_free (LinkStatsPoller *poller)
+{
+	nm_clear_g_source (&poller->timeout_id);
+	g_hash_table_unref (poller->ifindexes);
+	g_slice_free (LinkStatsPoller, poller);
+}
+
+static gboolean
+_link_stats_poller_timeout_cb (gpointer user_data)
+{
+	LinkStatsPoller *poller = user_data;
+	NMPlatform *self = poller->self;
+	GHashTableIter iter;
+	gpointer ifindex;
+
+	if (g_hash_table_size (poller->ifindexes) == 1) {
+		g_hash_table_iter_init (&iter, poller->ifindexes);
+		if (g_hash_table_iter_next (&iter, &ifindex, NULL)) {
+			_LOGt ("link-stats[%u]: refresh %d", poller->refresh_rate_ms, GPOINTER_TO_INT (ifindex));
+			nm_platform_link_refresh (self, GPOINTER_TO_INT (ifindex));
+		}
+	} else {
+		/* one dump is cheaper than a request per link. */
+		_LOGt ("link-stats[%u]: refresh all (%u links watched)", poller->refresh_rate_ms, g_hash_table_size (poller->ifindexes));
+		nm_platform_link_refresh_all (self);
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+/**
+ * nm_platform_link_stats_watch:
+ * @self: platform instance
+ * @ifindex: the interface to watch
+ * @refresh_rate_ms: how often to reload the statistics
+ *
+ * Periodically reload the statistics of @ifindex. Watches with the
+ * same @refresh_rate_ms are served by the same timer and request.
+ * Every call must be balanced by nm_platform_link_stats_unwatch().
+ */
+void
+nm_platform_link_stats_watch (NMPlatform *self, int ifindex, guint refresh_rate_ms)
+{
+	NMPlatformPrivate *priv;
+	LinkStatsPoller *poller;
+	guint n;
+
+	_CHECK_SELF_VOID (self, klass);
+
+	g_return_if_fail (ifindex > 0);
+	g_return_if_fail (refresh_rate_ms > 0);
+
+	priv = NM_PLATFORM_GET_PRIVATE (self);
+
+	if (!priv->link_stats_pollers) {
+		priv->link_stats_pollers = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+		                                                  NULL, (GDestroyNotify) _link_stats_poller_free);
+	}
+
+	poller = g_hash_table_lookup (priv->link_stats_pollers, GUINT_TO_POINTER (refresh_rate_ms));
+	if (!poller) {
+		poller = g_slice_new0 (LinkStatsPoller);
+		poller->self = self;
+		poller->refresh_rate_ms = refresh_rate_ms;
+		poller->ifindexes = g_hash_table_new (g_direct_hash, g_direct_equal);
+		poller->timeout_id = g_timeout_add (refresh_rate_ms, _link_stats_poller_timeout_cb, poller);
+		g_hash_table_insert (priv->link_stats_pollers, GUINT_TO_POINTER (refresh_rate_ms), poller);
+	}
+
+	n = GPOINTER_TO_UINT (g_hash_table_lookup (poller->ifindexes, GINT_TO_POINTER (ifindex)));
+	g_hash_table_insert (poller->ifindexes, GINT_TO_POINTER (ifindex), GUINT_TO_POINTER (n + 1));
+}
+
+void
+nm_platform_link_stats_unwatch (NMPlatform *self, int ifindex, guint refresh_rate_ms)
+{
+	NMPlatformPrivate *priv;
+	LinkStatsPoller *poller;
+	guint n;
+
+	_CHECK_SELF_VOID (self, klass);
+
+	priv = NM_PLATFORM_GET_PRIVATE (self);
+
+	poller = priv->link_stats_pollers
+	         ? g_hash_table_lookup (priv->link_stats_pollers, GUINT_TO_POINTER (refresh_rate_ms))
+	         : NULL;
+	g_return_if_fail (poller);
+
+	n = GPOINTER_TO_UINT (g_hash_table_lookup (poller->ifindexes, GINT_TO_POINTER (ifindex)));
+	g_return_if_fail (n > 0);
+
+	if (n > 1)
+		g_hash_table_insert (poller->ifindexes, GINT_TO_POINTER (ifindex), GUINT_TO_POINTER (n - 1));
+	else {
+		g_hash_table_remove (poller->ifindexes, GINT_TO_POINTER (ifindex));
+		if (g_hash_table_size (poller->ifindexes) == 0)
+			g_hash_table_remove (priv->link_stats_pollers, GUINT_TO_POINTER (refresh_rate_ms));
+	}
+}
+
 static guint
 _link_get_flags (NMPlatform *self, int ifindex)
 {
@@ -2774,21 +2990,31 @@ _to_string_ifa_flags (guint32 ifa_flags, char *buf, gsize size)
 gboolean
 nm_platform_ethtool_set_wake_on_lan (NMPlatform *self, int ifindex, NMSettingWiredWakeOnLan wol, const char *wol_password)
 {
+	gboolean success;
+
 	_CHECK_SELF_NETNS (self, klass, netns, FALSE);
 
 	g_return_val_if_fail (ifindex > 0, FALSE);
 
-	return nmp_utils_ethtool_set_wake_on_lan (ifindex, wol, wol_password);
+	success = nmp_utils_ethtool_set_wake_on_lan (ifindex, wol, wol_password);
+	if (klass->link_ethtool_changed)
+		klass->link_ethtool_changed (self, ifindex);
+	return success;
 }
 
 gboolean
 nm_platform_ethtool_set_link_settings (NMPlatform *self, int ifindex, gboolean autoneg, guint32 speed, NMPlatformLinkDuplexType duplex)
 {
+	gboolean success;
+
 	_CHECK_SELF_NETNS (self, klass, netns, FALSE);
 
 	g_return_val_if_fail (ifindex > 0, FALSE);
 
-	return nmp_utils_ethtool_set_link_settings (ifindex, autoneg, speed, duplex);
+	success = nmp_utils_ethtool_set_link_settings (ifindex, autoneg, speed, duplex);
+	if (klass->link_ethtool_changed)
+		klass->link_ethtool_changed (self, ifindex);
+	return success;
 }
 
 gboolean
@@ -3537,6 +3763,240 @@ nm_platform_ip6_route_get (NMPlatform *self, int ifindex, struct in6_addr networ
 	return NULL;
 }
 
+/**
+ * nm_platform_ip4_route_lookup:
+ * @self: platform instance
+ * @dest: the destination address
+ *
+ * Looks up the route in the platform cache that the kernel would pick
+ * for @dest (longest prefix, then lowest metric), without asking the
+ * kernel via RTM_GETROUTE. Routing policy rules and route tables are
+ * not considered.
+ *
+ * Returns: the best route or %NULL if no route covers @dest.
+ */
+const NMPlatformIP4Route *
+nm_platform_ip4_route_lookup (NMPlatform *self, in_addr_t dest)
+{
+	const NMPObject *obj;
+
+	_CHECK_SELF (self, klass, NULL);
+
+	obj = nmp_cache_lookup_route_lpm (nm_platform_get_cache (self), AF_INET, &dest);
+	return obj ? &obj->ip4_route : NULL;
+}
+
+/**
+ * nm_platform_ip6_route_lookup:
+ * @self: platform instance
+ * @dest: the destination address
+ *
+ * Like nm_platform_ip4_route_lookup(). The source address is not known,
+ * so source-specific routes (with a non-zero src_plen) are skipped.
+ *
+ * Returns: the best route or %NULL if no route covers @dest.
+ */
+const NMPlatformIP6Route *
+nm_platform_ip6_route_lookup (NMPlatform *self, const struct in6_addr *dest)
+{
+	const NMPObject *obj;
+
+	_CHECK_SELF (self, klass, NULL);
+
+	g_return_val_if_fail (dest, NULL);
+
+	obj = nmp_cache_lookup_route_lpm (nm_platform_get_cache (self), AF_INET6, dest);
+	return obj ? &obj->ip6_route : NULL;
+}
+
+/*****************************************************************************/
+
+struct _NMPlatformIPRouteBatch {
+	GArray *entries;
+};
+
+NMPlatformIPRouteBatch *
+nm_platform_ip_route_batch_new (void)
+{
+	NMPlatformIPRouteBatch *batch;
+
+	batch = g_slice_new (NMPlatformIPRouteBatch);
+	batch->entries = g_array_new (FALSE, FALSE, sizeof (NMPlatformIPRouteBatchEntry));
+	return batch;
+}
+
+void
+nm_platform_ip_route_batch_free (NMPlatformIPRouteBatch *batch)
+{
+	guint i;
+
+	if (!batch)
+		return;
+
+	for (i = 0; i < batch->entries->len; i++)
+		nmp_object_unref (g_array_index (batch->entries, NMPlatformIPRouteBatchEntry, i).obj);
+	g_array_unref (batch->entries);
+	g_slice_free (NMPlatformIPRouteBatch, batch);
+}
+
+guint
+nm_platform_ip_route_batch_get_len (const NMPlatformIPRouteBatch *batch)
+{
+	g_return_val_if_fail (batch, 0);
+
+	return batch->entries->len;
+}
+
+static guint
+_ip_route_batch_append (NMPlatformIPRouteBatch *batch,
+                        const NMPObject *obj,
+                        NMPNlmFlags flags,
+                        gboolean is_delete)
+{
+	NMPlatformIPRouteBatchEntry *entry;
+
+	g_array_set_size (batch->entries, batch->entries->len + 1);
+	entry = &g_array_index (batch->entries, NMPlatformIPRouteBatchEntry, batch->entries->len - 1);
+	entry->obj = obj;
+	entry->flags = flags;
+	entry->is_delete = is_delete;
+	entry->success = FALSE;
+	return batch->entries->len - 1;
+}
+
+/**
+ * nm_platform_ip4_route_batch_add:
+ * @batch: the batch
+ * @flags: the netlink flags for the RTM_NEWROUTE request
+ * @route: the route to add
+ *
+ * Queue @route for addition. Nothing is sent to kernel until
+ * nm_platform_ip_route_batch_commit().
+ *
+ * Returns: the index of the entry in @batch, to be used with
+ *   nm_platform_ip_route_batch_get_success().
+ */
+guint
+nm_platform_ip4_route_batch_add (NMPlatformIPRouteBatch *batch,
+                                 NMPNlmFlags flags,
+                                 const NMPlatformIP4Route *route)
+{
+	g_return_val_if_fail (batch, 0);
+	g_return_val_if_fail (route, 0);
+	g_return_val_if_fail (route->plen <= 32, 0);
+
+	return _ip_route_batch_append (batch,
+	                               nmp_object_new (NMP_OBJECT_TYPE_IP4_ROUTE, (const NMPlatformObject *) route),
+	                               flags,
+	                               FALSE);
+}
+
+guint
+nm_platform_ip6_route_batch_add (NMPlatformIPRouteBatch *batch,
+                                 NMPNlmFlags flags,
+                                 const NMPlatformIP6Route *route)
+{
+	g_return_val_if_fail (batch, 0);
+	g_return_val_if_fail (route, 0);
+	g_return_val_if_fail (route->plen <= 128, 0);
+
+	return _ip_route_batch_append (batch,
+	                               nmp_object_new (NMP_OBJECT_TYPE_IP6_ROUTE, (const NMPlatformObject *) route),
+	                               flags,
+	                               FALSE);
+}
+
+guint
+nm_platform_ip_route_batch_delete (NMPlatformIPRouteBatch *batch,
+                                   const NMPObject *obj)
+{
+	g_return_val_if_fail (batch, 0);
+	nm_assert (NM_IN_SET (NMP_OBJECT_GET_TYPE (obj), NMP_OBJECT_TYPE_IP4_ROUTE,
+	                                                 NMP_OBJECT_TYPE_IP6_ROUTE));
+
+	return _ip_route_batch_append (batch,
+	                               NMP_OBJECT_IS_STACKINIT (obj)
+	                                 ? nmp_object_clone (obj, FALSE)
+	                                 : nmp_object_ref (obj),
+	                               0,
+	                               TRUE);
+}
+
+/**
+ * nm_platform_ip_route_batch_commit:
+ * @self: the platform instance
+ * @batch: the batch to commit
+ *
+ * Send all queued route additions and deletions to kernel, in the order
+ * in which they were queued. Contrary to calling nm_platform_ip4_route_add()
+ * and nm_platform_ip_route_delete() for each route, the platform implementation
+ * may pipeline the requests and wait for all responses at once.
+ *
+ * A batch can only be committed once.
+ *
+ * Returns: %TRUE if all entries were successful.
+ */
+gboolean
+nm_platform_ip_route_batch_commit (NMPlatform *self,
+                                   NMPlatformIPRouteBatch *batch)
+{
+	NMPlatformIPRouteBatchEntry *entries;
+	char sbuf[sizeof (_nm_utils_to_string_buffer)];
+	gboolean success = TRUE;
+	guint i;
+
+	_CHECK_SELF (self, klass, FALSE);
+
+	g_return_val_if_fail (batch, FALSE);
+
+	if (batch->entries->len == 0)
+		return TRUE;
+
+	entries = &g_array_index (batch->entries, NMPlatformIPRouteBatchEntry, 0);
+
+	_LOGD ("route: commit batch of %u route changes", batch->entries->len);
+	if (_LOGD_ENABLED ()) {
+		for (i = 0; i < batch->entries->len; i++) {
+			_LOGD ("route: %-10s IPv%c route: %s",
+			       entries[i].is_delete ? "delete" : _nmp_nlm_flag_to_string (entries[i].flags),
+			       NMP_OBJECT_GET_TYPE (entries[i].obj) == NMP_OBJECT_TYPE_IP4_ROUTE ? '4' : '6',
+			       nmp_object_to_string (entries[i].obj, NMP_OBJECT_TO_STRING_PUBLIC, sbuf, sizeof (sbuf)));
+		}
+	}
+
+	if (klass->ip_route_batch_commit)
+		klass->ip_route_batch_commit (self, entries, batch->entries->len);
+	else {
+		for (i = 0; i < batch->entries->len; i++) {
+			if (entries[i].is_delete)
+				entries[i].success = klass->ip_route_delete (self, entries[i].obj);
+			else {
+				entries[i].success = klass->ip_route_add (self,
+				                                          entries[i].flags,
+				                                          NMP_OBJECT_GET_CLASS (entries[i].obj)->addr_family,
+				                                          NMP_OBJECT_CAST_IP_ROUTE (entries[i].obj));
+			}
+		}
+	}
+
+	for (i = 0; i < batch->entries->len; i++) {
+		if (!entries[i].success) {
+			success = FALSE;
+			break;
+		}
+	}
+	return success;
+}
+
+gboolean
+nm_platform_ip_route_batch_get_success (const NMPlatformIPRouteBatch *batch, guint idx)
+{
+	g_return_val_if_fail (batch, FALSE);
+	g_return_val_if_fail (idx < batch->entries->len, FALSE);
+
+	return g_array_index (batch->entries, NMPlatformIPRouteBatchEntry, idx).success;
+}
+
 /*****************************************************************************/
 
 const char *
@@ -5108,6 +5568,147 @@ log_ip6_route (NMPlatform *self, NMPObjectType obj_type, int ifindex, NMPlatform
 
 /*****************************************************************************/
 
+struct _NMPlatformChangedSet {
+	GHashTable *idx;
+	GPtrArray *entries;
+};
+
+static guint
+_changed_set_entry_hash (const NMPlatformChangedSetEntry *entry)
+{
+	guint h = 1039;
+
+	h = NM_HASH_COMBINE (h, entry->obj_type);
+	h = NM_HASH_COMBINE (h, entry->ifindex);
+	return h;
+}
+
+static gboolean
+_changed_set_entry_equal (const NMPlatformChangedSetEntry *a,
+                          const NMPlatformChangedSetEntry *b)
+{
+	return    a->obj_type == b->obj_type
+	       && a->ifindex == b->ifindex;
+}
+
+static void
+_changed_set_entry_free (NMPlatformChangedSetEntry *entry)
+{
+	g_slice_free (NMPlatformChangedSetEntry, entry);
+}
+
+static NMPlatformChangedSet *
+_changed_set_new (void)
+{
+	NMPlatformChangedSet *set;
+
+	set = g_slice_new (NMPlatformChangedSet);
+	set->idx = g_hash_table_new ((GHashFunc) _changed_set_entry_hash,
+	                             (GEqualFunc) _changed_set_entry_equal);
+	set->entries = g_ptr_array_new_with_free_func ((GDestroyNotify) _changed_set_entry_free);
+	return set;
+}
+
+static void
+_changed_set_free (NMPlatformChangedSet *set)
+{
+	if (set) {
+		g_hash_table_unref (set->idx);
+		g_ptr_array_unref (set->entries);
+		g_slice_free (NMPlatformChangedSet, set);
+	}
+}
+
+/**
+ * nm_platform_changed_set_lookup:
+ * @set: the #NMPlatformChangedSet
+ * @obj_type: the object type
+ * @ifindex: the interface index
+ *
+ * Returns: the entry for objects of @obj_type on @ifindex or %NULL,
+ *   if no such objects changed.
+ */
+const NMPlatformChangedSetEntry *
+nm_platform_changed_set_lookup (const NMPlatformChangedSet *set,
+                                NMPObjectType obj_type,
+                                int ifindex)
+{
+	NMPlatformChangedSetEntry needle = {
+		.obj_type = obj_type,
+		.ifindex = ifindex,
+	};
+
+	g_return_val_if_fail (set, NULL);
+
+	return g_hash_table_lookup (set->idx, &needle);
+}
+
+const NMPlatformChangedSetEntry *const*
+nm_platform_changed_set_get_entries (const NMPlatformChangedSet *set,
+                                     guint *out_len)
+{
+	g_return_val_if_fail (set, NULL);
+
+	NM_SET_OUT (out_len, set->entries->len);
+	return (const NMPlatformChangedSetEntry *const*) set->entries->pdata;
+}
+
+static gboolean
+_changed_set_emit_cb (gpointer user_data)
+{
+	NMPlatform *self = user_data;
+	NMPlatformPrivate *priv = NM_PLATFORM_GET_PRIVATE (self);
+	NMPlatformChangedSet *set;
+
+	priv->changed_set_id = 0;
+
+	/* handlers might cause new changes, which are collected in a new set. */
+	set = g_steal_pointer (&priv->changed_set);
+	if (set) {
+		_LOGt ("emit signal %s: %u entries",
+		       NM_PLATFORM_SIGNAL_CHANGED_SET,
+		       set->entries->len);
+		g_signal_emit (self, signal_changed_set, 0, set);
+		_changed_set_free (set);
+	}
+	return G_SOURCE_REMOVE;
+}
+
+static void
+_changed_set_add (NMPlatform *self,
+                  NMPObjectType obj_type,
+                  int ifindex,
+                  NMPlatformSignalChangeType change_type)
+{
+	NMPlatformPrivate *priv = NM_PLATFORM_GET_PRIVATE (self);
+	NMPlatformChangedSetEntry needle = {
+		.obj_type = obj_type,
+		.ifindex = ifindex,
+	};
+	NMPlatformChangedSetEntry *entry;
+
+	if (!g_signal_has_handler_pending (self, signal_changed_set, 0, FALSE))
+		return;
+
+	if (!priv->changed_set)
+		priv->changed_set = _changed_set_new ();
+
+	entry = g_hash_table_lookup (priv->changed_set->idx, &needle);
+	if (!entry) {
+		entry = g_slice_new (NMPlatformChangedSetEntry);
+		*entry = needle;
+		g_ptr_array_add (priv->changed_set->entries, entry);
+		g_hash_table_add (priv->changed_set->idx, entry);
+	}
+	entry->change_flags |= (1u << change_type);
+	entry->n_changes++;
+
+	if (!priv->changed_set_id)
+		priv->changed_set_id = g_idle_add_full (G_PRIORITY_DEFAULT, _changed_set_emit_cb, self, NULL);
+}
+
+/*****************************************************************************/
+
 void
 nm_platform_cache_update_emit_signal (NMPlatform *self,
                                       NMPCacheOpsType cache_op,
@@ -5171,6 +5772,7 @@ nm_platform_cache_update_emit_signal (NMPlatform *self,
 	               o->object.ifindex,
 	               &o->object,
 	               (int) cache_op);
+	_changed_set_add (self, klass->obj_type, o->object.ifindex, (NMPlatformSignalChangeType) cache_op);
 	nmp_object_unref (o);
 }
 
@@ -5179,7 +5781,11 @@ nm_platform_cache_update_emit_signal (NMPlatform *self,
 NMPCache *
 nm_platform_get_cache (NMPlatform *self)
 {
-	return NM_PLATFORM_GET_PRIVATE (self)->cache;
+	NMPlatformPrivate *priv = NM_PLATFORM_GET_PRIVATE (self);
+
+	if (G_UNLIKELY (priv->start_pending))
+		nm_platform_ensure_started (self);
+	return priv->cache;
 }
 
 NMPNetns *
@@ -5241,6 +5847,40 @@ _vtr_v6_route_add (NMPlatform *self,
 	return nm_platform_ip6_route_add (self, flags, &rt);
 }
 
+static guint
+_vtr_v4_route_batch_add (NMPlatformIPRouteBatch *batch,
+                         NMPNlmFlags flags,
+                         const NMPlatformIPXRoute *route,
+                         int ifindex,
+                         gint64 metric)
+{
+	NMPlatformIP4Route rt = route->r4;
+
+	if (ifindex > 0)
+		rt.ifindex = ifindex;
+	if (metric >= 0)
+		rt.metric = metric;
+
+	return nm_platform_ip4_route_batch_add (batch, flags, &rt);
+}
+
+static guint
+_vtr_v6_route_batch_add (NMPlatformIPRouteBatch *batch,
+                         NMPNlmFlags flags,
+                         const NMPlatformIPXRoute *route,
+                         int ifindex,
+                         gint64 metric)
+{
+	NMPlatformIP6Route rt = route->r6;
+
+	if (ifindex > 0)
+		rt.ifindex = ifindex;
+	if (metric >= 0)
+		rt.metric = metric;
+
+	return nm_platform_ip6_route_batch_add (batch, flags, &rt);
+}
+
 static guint32
 _vtr_v4_metric_normalize (guint32 metric)
 {
@@ -5257,6 +5897,7 @@ const NMPlatformVTableRoute nm_platform_vtable_route_v4 = {
 	.route_cmp                      = (int (*) (const NMPlatformIPXRoute *a, const NMPlatformIPXRoute *b, NMPlatformIPRouteCmpType cmp_type)) nm_platform_ip4_route_cmp,
 	.route_to_string                = (const char *(*) (const NMPlatformIPXRoute *route, char *buf, gsize len)) nm_platform_ip4_route_to_string,
 	.route_add                      = _vtr_v4_route_add,
+	.route_batch_add                = _vtr_v4_route_batch_add,
 	.metric_normalize               = _vtr_v4_metric_normalize,
 };
 
@@ -5268,11 +5909,29 @@ const NMPlatformVTableRoute nm_platform_vtable_route_v6 = {
 	.route_cmp                      = (int (*) (const NMPlatformIPXRoute *a, const NMPlatformIPXRoute *b, NMPlatformIPRouteCmpType cmp_type)) nm_platform_ip6_route_cmp,
 	.route_to_string                = (const char *(*) (const NMPlatformIPXRoute *route, char *buf, gsize len)) nm_platform_ip6_route_to_string,
 	.route_add                      = _vtr_v6_route_add,
+	.route_batch_add                = _vtr_v6_route_batch_add,
 	.metric_normalize               = nm_utils_ip6_route_metric_normalize,
 };
 
 /*****************************************************************************/
 
+static void
+get_property (GObject *object, guint prop_id,
+              GValue *value, GParamSpec *pspec)
+{
+	NMPlatform *self = NM_PLATFORM (object);
+	NMPlatformPrivate *priv =  NM_PLATFORM_GET_PRIVATE (self);
+
+	switch (prop_id) {
+	case PROP_CACHE_RESYNCS:
+		g_value_set_uint (value, priv->cache_resyncs);
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+		break;
+	}
+}
+
 static void
 set_property (GObject *object, guint prop_id,
               const GValue *value, GParamSpec *pspec)
@@ -5299,6 +5958,15 @@ set_property (GObject *object, guint prop_id,
 		/* construct-only */
 		priv->log_with_ptr = g_value_get_boolean (value);
 		break;
+	case PROP_MULTI_IDX:
+		/* construct-only */
+		if (g_value_get_pointer (value))
+			priv->multi_idx = nm_dedup_multi_index_ref (g_value_get_pointer (value));
+		break;
+	case PROP_LAZY:
+		/* construct-only */
+		priv->lazy = g_value_get_boolean (value);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -5326,10 +5994,15 @@ constructor (GType type,
 	self = NM_PLATFORM (object);
 	priv = NM_PLATFORM_GET_PRIVATE (self);
 
-	priv->multi_idx = nm_dedup_multi_index_new ();
+	if (!priv->multi_idx)
+		priv->multi_idx = nm_dedup_multi_index_new ();
 
 	priv->cache = nmp_cache_new (nm_platform_get_multi_idx (self),
 	                             priv->use_udev);
+
+	/* the implementation either starts itself at the end of construction,
+	 * or -- if lazy -- leaves that to the first access of the cache. */
+	priv->start_pending = !!NM_PLATFORM_GET_CLASS (self)->start;
 	return object;
 }
 
@@ -5339,6 +6012,11 @@ finalize (GObject *object)
 	NMPlatform *self = NM_PLATFORM (object);
 	NMPlatformPrivate *priv = NM_PLATFORM_GET_PRIVATE (self);
 
+	nm_clear_g_source (&priv->changed_set_id);
+	_changed_set_free (priv->changed_set);
+	if (priv->link_stats_pollers)
+		g_hash_table_unref (priv->link_stats_pollers);
+
 	g_clear_object (&self->_netns);
 	nm_dedup_multi_index_unref (priv->multi_idx);
 	nmp_cache_free (priv->cache);
@@ -5352,6 +6030,7 @@ nm_platform_class_init (NMPlatformClass *platform_class)
 	g_type_class_add_private (object_class, sizeof (NMPlatformPrivate));
 
 	object_class->constructor = constructor;
+	object_class->get_property = get_property;
 	object_class->set_property = set_property;
 	object_class->finalize = finalize;
 
@@ -5381,6 +6060,28 @@ nm_platform_class_init (NMPlatformClass *platform_class)
 	                           G_PARAM_CONSTRUCT_ONLY |
 	                           G_PARAM_STATIC_STRINGS));
 
+	g_object_class_install_property
+	 (object_class, PROP_MULTI_IDX,
+	     g_param_spec_pointer (NM_PLATFORM_MULTI_IDX, "", "",
+	                           G_PARAM_WRITABLE |
+	                           G_PARAM_CONSTRUCT_ONLY |
+	                           G_PARAM_STATIC_STRINGS));
+
+	g_object_class_install_property
+	 (object_class, PROP_LAZY,
+	     g_param_spec_boolean (NM_PLATFORM_LAZY, "", "",
+	                           FALSE,
+	                           G_PARAM_WRITABLE |
+	                           G_PARAM_CONSTRUCT_ONLY |
+	                           G_PARAM_STATIC_STRINGS));
+
+	g_object_class_install_property
+	 (object_class, PROP_CACHE_RESYNCS,
+	     g_param_spec_uint (NM_PLATFORM_CACHE_RESYNCS, "", "",
+	                        0, G_MAXUINT, 0,
+	                        G_PARAM_READABLE |
+	                        G_PARAM_STATIC_STRINGS));
+
 #define SIGNAL(signal, signal_id, method) \
 	G_STMT_START { \
 		signals[signal] = \
@@ -5403,4 +6104,12 @@ nm_platform_class_init (NMPlatformClass *platform_class)
 	SIGNAL (NM_PLATFORM_SIGNAL_ID_IP6_ADDRESS, NM_PLATFORM_SIGNAL_IP6_ADDRESS_CHANGED, log_ip6_address);
 	SIGNAL (NM_PLATFORM_SIGNAL_ID_IP4_ROUTE,   NM_PLATFORM_SIGNAL_IP4_ROUTE_CHANGED,   log_ip4_route);
 	SIGNAL (NM_PLATFORM_SIGNAL_ID_IP6_ROUTE,   NM_PLATFORM_SIGNAL_IP6_ROUTE_CHANGED,   log_ip6_route);
+
+	signal_changed_set =
+	    g_signal_new (NM_PLATFORM_SIGNAL_CHANGED_SET,
+	                  G_OBJECT_CLASS_TYPE (object_class),
+	                  G_SIGNAL_RUN_FIRST,
+	                  0, NULL, NULL, NULL,
+	                  G_TYPE_NONE, 1,
+	                  G_TYPE_POINTER /* const NMPlatformChangedSet * */);
 }
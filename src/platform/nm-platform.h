@@ -47,6 +47,9 @@
 #define NM_PLATFORM_NETNS_SUPPORT      "netns-support"
 #define NM_PLATFORM_USE_UDEV           "use-udev"
 #define NM_PLATFORM_LOG_WITH_PTR       "log-with-ptr"
+#define NM_PLATFORM_CACHE_RESYNCS      "cache-resyncs"
+#define NM_PLATFORM_MULTI_IDX          "multi-idx"
+#define NM_PLATFORM_LAZY               "lazy"
 
 /*****************************************************************************/
 
@@ -500,6 +503,17 @@ typedef union {
 
 #undef __NMPlatformObject_COMMON
 
+typedef struct {
+	/* the route to add or delete. The batch owns a reference. */
+	const NMPObject *obj;
+	NMPNlmFlags flags;
+	bool is_delete:1;
+
+	/* set by nm_platform_ip_route_batch_commit(). */
+	bool success:1;
+} NMPlatformIPRouteBatchEntry;
+
+typedef struct _NMPlatformIPRouteBatch NMPlatformIPRouteBatch;
 
 typedef struct {
 	gboolean is_ip4;
@@ -513,6 +527,11 @@ typedef struct {
 	                       const NMPlatformIPXRoute *route,
 	                       int ifindex,
 	                       gint64 metric);
+	guint (*route_batch_add) (NMPlatformIPRouteBatch *batch,
+	                          NMPNlmFlags flags,
+	                          const NMPlatformIPXRoute *route,
+	                          int ifindex,
+	                          gint64 metric);
 	guint32 (*metric_normalize) (guint32 metric);
 } NMPlatformVTableRoute;
 
@@ -647,6 +666,10 @@ struct _NMPlatform {
 typedef struct {
 	GObjectClass parent;
 
+	/* called once before the cache is used for the first time. With
+	 * NM_PLATFORM_LAZY that is deferred until the first access. */
+	void (*start) (NMPlatform *);
+
 	gboolean (*sysctl_set) (NMPlatform *, const char *pathid, int dirfd, const char *path, const char *value);
 	char * (*sysctl_get) (NMPlatform *, const char *pathid, int dirfd, const char *path);
 
@@ -660,6 +683,7 @@ typedef struct {
 	gboolean (*link_delete) (NMPlatform *, int ifindex);
 
 	gboolean (*link_refresh) (NMPlatform *, int ifindex);
+	void (*link_refresh_all) (NMPlatform *);
 
 	gboolean (*link_set_netns) (NMPlatform *, int ifindex, int netns_fd);
 
@@ -688,6 +712,7 @@ typedef struct {
 	char *   (*link_get_physical_port_id) (NMPlatform *, int ifindex);
 	guint    (*link_get_dev_id) (NMPlatform *, int ifindex);
 	gboolean (*link_get_wake_on_lan) (NMPlatform *, int ifindex);
+	void (*link_ethtool_changed) (NMPlatform *, int ifindex);
 	gboolean (*link_get_driver_info) (NMPlatform *,
 	                                  int ifindex,
 	                                  char **out_driver_name,
@@ -793,6 +818,12 @@ typedef struct {
 	                          const NMPlatformIPRoute *route);
 	gboolean (*ip_route_delete) (NMPlatform *, const NMPObject *obj);
 
+	/* optional. If unset, the entries are committed one by one via ip_route_add()
+	 * and ip_route_delete(). */
+	void (*ip_route_batch_commit) (NMPlatform *,
+	                               NMPlatformIPRouteBatchEntry *entries,
+	                               guint len);
+
 	gboolean (*check_support_kernel_extended_ifa_flags) (NMPlatform *);
 	gboolean (*check_support_user_ipv6ll) (NMPlatform *);
 } NMPlatformClass;
@@ -814,8 +845,32 @@ typedef struct {
 #define NM_PLATFORM_SIGNAL_IP4_ROUTE_CHANGED "ip4-route-changed"
 #define NM_PLATFORM_SIGNAL_IP6_ROUTE_CHANGED "ip6-route-changed"
 
+#define NM_PLATFORM_SIGNAL_CHANGED_SET "changed-set"
+
 const char *nm_platform_signal_change_type_to_string (NMPlatformSignalChangeType change_type);
 
+/* The "changed-set" signal is emitted once per main loop iteration after
+ * a burst of changes. It carries a #NMPlatformChangedSet that tells which
+ * kind of objects changed on which interface. It is meant for listeners
+ * that only care whether anything changed on an interface, and not about
+ * the individual objects. */
+typedef struct {
+	NMPObjectType obj_type;
+	int ifindex;
+
+	/* bitmask of (1 << NMPlatformSignalChangeType) */
+	guint change_flags;
+	guint n_changes;
+} NMPlatformChangedSetEntry;
+
+typedef struct _NMPlatformChangedSet NMPlatformChangedSet;
+
+const NMPlatformChangedSetEntry *nm_platform_changed_set_lookup (const NMPlatformChangedSet *set,
+                                                                 NMPObjectType obj_type,
+                                                                 int ifindex);
+const NMPlatformChangedSetEntry *const*nm_platform_changed_set_get_entries (const NMPlatformChangedSet *set,
+                                                                            guint *out_len);
+
 /*****************************************************************************/
 
 GType nm_platform_get_type (void);
@@ -845,7 +900,10 @@ _nm_platform_uint8_inv (guint8 scope)
 }
 
 gboolean nm_platform_get_use_udev (NMPlatform *self);
+gboolean nm_platform_get_lazy (NMPlatform *self);
+gboolean nm_platform_is_started (NMPlatform *self);
 gboolean nm_platform_get_log_with_ptr (NMPlatform *self);
+guint nm_platform_get_cache_resyncs (NMPlatform *self);
 
 NMPNetns *nm_platform_netns_get (NMPlatform *self);
 gboolean nm_platform_netns_push (NMPlatform *platform, NMPNetns **netns);
@@ -930,6 +988,10 @@ gboolean nm_platform_link_supports_slaves (NMPlatform *self, int ifindex);
 const char *nm_platform_link_get_type_name (NMPlatform *self, int ifindex);
 
 gboolean nm_platform_link_refresh (NMPlatform *self, int ifindex);
+void nm_platform_link_refresh_all (NMPlatform *self);
+
+void nm_platform_link_stats_watch (NMPlatform *self, int ifindex, guint refresh_rate_ms);
+void nm_platform_link_stats_unwatch (NMPlatform *self, int ifindex, guint refresh_rate_ms);
 void nm_platform_process_events (NMPlatform *self);
 
 gboolean nm_platform_link_set_up (NMPlatform *self, int ifindex, gboolean *out_no_firmware);
@@ -1105,11 +1167,23 @@ gboolean nm_platform_address_flush (NMPlatform *self, int ifindex);
 const NMPlatformIP4Route *nm_platform_ip4_route_get (NMPlatform *self, int ifindex, in_addr_t network, guint8 plen, guint32 metric);
 const NMPlatformIP6Route *nm_platform_ip6_route_get (NMPlatform *self, int ifindex, struct in6_addr network, guint8 plen, guint32 metric);
 
+const NMPlatformIP4Route *nm_platform_ip4_route_lookup (NMPlatform *self, in_addr_t dest);
+const NMPlatformIP6Route *nm_platform_ip6_route_lookup (NMPlatform *self, const struct in6_addr *dest);
+
 gboolean nm_platform_ip4_route_add (NMPlatform *self, NMPNlmFlags flags, const NMPlatformIP4Route *route);
 gboolean nm_platform_ip6_route_add (NMPlatform *self, NMPNlmFlags flags, const NMPlatformIP6Route *route);
 
 gboolean nm_platform_ip_route_delete (NMPlatform *self, const NMPObject *route);
 
+NMPlatformIPRouteBatch *nm_platform_ip_route_batch_new (void);
+void nm_platform_ip_route_batch_free (NMPlatformIPRouteBatch *batch);
+guint nm_platform_ip_route_batch_get_len (const NMPlatformIPRouteBatch *batch);
+guint nm_platform_ip4_route_batch_add (NMPlatformIPRouteBatch *batch, NMPNlmFlags flags, const NMPlatformIP4Route *route);
+guint nm_platform_ip6_route_batch_add (NMPlatformIPRouteBatch *batch, NMPNlmFlags flags, const NMPlatformIP6Route *route);
+guint nm_platform_ip_route_batch_delete (NMPlatformIPRouteBatch *batch, const NMPObject *route);
+gboolean nm_platform_ip_route_batch_commit (NMPlatform *self, NMPlatformIPRouteBatch *batch);
+gboolean nm_platform_ip_route_batch_get_success (const NMPlatformIPRouteBatch *batch, guint idx);
+
 const char *nm_platform_link_to_string (const NMPlatformLink *link, char *buf, gsize len);
 const char *nm_platform_lnk_gre_to_string (const NMPlatformLnkGre *lnk, char *buf, gsize len);
 const char *nm_platform_lnk_infiniband_to_string (const NMPlatformLnkInfiniband *lnk, char *buf, gsize len);
@@ -79,6 +79,12 @@ struct _NMPCache {
 	 * Don't bother, use _idx_type_get() instead! */
 	DedupMultiIdxType idx_types[NMP_CACHE_ID_TYPE_MAX];
 
+	/* the number of routes in NMP_CACHE_ID_TYPE_ROUTES_BY_DEST_PREFIX for
+	 * each prefix length. nmp_cache_lookup_route_lpm() only probes the
+	 * prefix lengths that are in use. */
+	guint route4_plen_count[33];
+	guint route6_plen_count[129];
+
 	gboolean use_udev;
 };
 
@@ -239,6 +245,51 @@ _idx_obj_part (const DedupMultiIdxType *idx_type,
 		}
 		return 1;
 
+	case NMP_CACHE_ID_TYPE_ROUTES_BY_DEST_PREFIX:
+		obj_type = NMP_OBJECT_GET_TYPE (obj_a);
+		if (   !NM_IN_SET (obj_type, NMP_OBJECT_TYPE_IP4_ROUTE,
+		                             NMP_OBJECT_TYPE_IP6_ROUTE)
+		    || obj_a->object.ifindex <= 0)
+			return 0;
+		if (obj_b) {
+			return    obj_type == NMP_OBJECT_GET_TYPE (obj_b)
+			       && obj_b->object.ifindex > 0
+			       && (obj_type == NMP_OBJECT_TYPE_IP4_ROUTE
+			           ? (nm_platform_ip4_route_cmp (&obj_a->ip4_route, &obj_b->ip4_route, NM_PLATFORM_IP_ROUTE_CMP_TYPE_DST) == 0)
+			           : (nm_platform_ip6_route_cmp (&obj_a->ip6_route, &obj_b->ip6_route, NM_PLATFORM_IP_ROUTE_CMP_TYPE_DST) == 0));
+		}
+		if (request_hash) {
+			h = (guint) idx_type->cache_id_type;
+			if (obj_type == NMP_OBJECT_TYPE_IP4_ROUTE)
+				h = NM_HASH_COMBINE (h, nm_platform_ip4_route_hash (&obj_a->ip4_route, NM_PLATFORM_IP_ROUTE_CMP_TYPE_DST));
+			else
+				h = NM_HASH_COMBINE (h, nm_platform_ip6_route_hash (&obj_a->ip6_route, NM_PLATFORM_IP_ROUTE_CMP_TYPE_DST));
+			return _HASH_NON_ZERO (h);
+		}
+		return 1;
+
+	case NMP_CACHE_ID_TYPE_ROUTES_BY_IFINDEX_METRIC:
+		obj_type = NMP_OBJECT_GET_TYPE (obj_a);
+		if (   !NM_IN_SET (obj_type, NMP_OBJECT_TYPE_IP4_ROUTE,
+		                             NMP_OBJECT_TYPE_IP6_ROUTE)
+		    || !nmp_object_is_visible (obj_a))
+			return 0;
+		nm_assert (obj_a->object.ifindex > 0);
+		if (obj_b) {
+			return    obj_type == NMP_OBJECT_GET_TYPE (obj_b)
+			       && obj_a->object.ifindex == obj_b->object.ifindex
+			       && obj_a->ip_route.metric == obj_b->ip_route.metric
+			       && nmp_object_is_visible (obj_b);
+		}
+		if (request_hash) {
+			h = (guint) idx_type->cache_id_type;
+			h = NM_HASH_COMBINE (h, obj_type);
+			h = NM_HASH_COMBINE (h, obj_a->object.ifindex);
+			h = NM_HASH_COMBINE (h, obj_a->ip_route.metric);
+			return _HASH_NON_ZERO (h);
+		}
+		return 1;
+
 	case NMP_CACHE_ID_TYPE_NONE:
 	case __NMP_CACHE_ID_TYPE_MAX:
 		break;
@@ -374,8 +425,11 @@ _link_get_driver (struct udev_device *udevice, const char *kind, int ifindex)
 	return "unknown";
 }
 
-void
-_nmp_object_fixup_link_udev_fields (NMPObject **obj_new, NMPObject *obj_orig, gboolean use_udev)
+static void
+_nmp_object_fixup_link_udev_fields_full (NMPObject **obj_new,
+                                         NMPObject *obj_orig,
+                                         const NMPObject *obj_prev,
+                                         gboolean use_udev)
 {
 	const char *driver = NULL;
 	gboolean initialized = FALSE;
@@ -385,6 +439,7 @@ _nmp_object_fixup_link_udev_fields (NMPObject **obj_new, NMPObject *obj_orig, gb
 	nm_assert (obj_new);
 	nm_assert (!obj_orig || NMP_OBJECT_GET_TYPE (obj_orig) == NMP_OBJECT_TYPE_LINK);
 	nm_assert (!*obj_new || NMP_OBJECT_GET_TYPE (*obj_new) == NMP_OBJECT_TYPE_LINK);
+	nm_assert (!obj_prev || NMP_OBJECT_GET_TYPE (obj_prev) == NMP_OBJECT_TYPE_LINK);
 
 	obj = *obj_new ?: obj_orig;
 
@@ -393,9 +448,26 @@ _nmp_object_fixup_link_udev_fields (NMPObject **obj_new, NMPObject *obj_orig, gb
 
 	/* When a link is not in netlink, it's udev fields don't matter. */
 	if (obj->_link.netlink.is_in_netlink) {
-		driver = _link_get_driver (obj->_link.udev.device,
-		                           obj->link.kind,
-		                           obj->link.ifindex);
+		if (   obj_prev
+		    && obj_prev->_link.netlink.is_in_netlink
+		    && obj_prev->link.driver
+		    && obj_prev->link.ifindex == obj->link.ifindex
+		    && obj_prev->link.kind == obj->link.kind
+		    && obj_prev->_link.udev.device == obj->_link.udev.device) {
+			/* Nothing that determines the driver changed since @obj_prev. Reuse
+			 * it instead of asking udev (or ethtool) again on every RTM_NEWLINK. */
+			driver = obj_prev->link.driver;
+		} else if (   use_udev
+		           && !obj->_link.udev.device
+		           && !obj->link.kind) {
+			/* The link is not yet initialized by udev and udev will tell us
+			 * the driver shortly. Don't fall back to ethtool in the meantime. */
+			driver = "unknown";
+		} else {
+			driver = _link_get_driver (obj->_link.udev.device,
+			                           obj->link.kind,
+			                           obj->link.ifindex);
+		}
 		if (obj->_link.udev.device)
 			initialized = TRUE;
 		else if (!use_udev) {
@@ -421,6 +493,12 @@ _nmp_object_fixup_link_udev_fields (NMPObject **obj_new, NMPObject *obj_orig, gb
 	obj->link.initialized = initialized;
 }
 
+void
+_nmp_object_fixup_link_udev_fields (NMPObject **obj_new, NMPObject *obj_orig, gboolean use_udev)
+{
+	_nmp_object_fixup_link_udev_fields_full (obj_new, obj_orig, NULL, use_udev);
+}
+
 static void
 _nmp_object_fixup_link_master_connected (NMPObject **obj_new, NMPObject *obj_orig, const NMPCache *cache)
 {
@@ -469,6 +547,63 @@ _vt_cmd_obj_dispose_lnk_vlan (NMPObject *obj)
 	g_free ((gpointer) obj->_lnk_vlan.egress_qos_map);
 }
 
+/* With many routes, the platform objects are by far the most numerous
+ * allocations. Allocate them from one pool per object type.
+ *
+ * The pools are global and not locked: platform objects must only be
+ * created, unreferenced and trimmed from the main thread. */
+static NMMemPool _nmp_object_pools[NMP_OBJECT_TYPE_MAX];
+
+static NMMemPool *
+_nmp_object_pool_get (const NMPClass *klass)
+{
+	NMMemPool *pool = &_nmp_object_pools[klass->obj_type - 1];
+
+	if (G_UNLIKELY (!pool->elt_size)) {
+		nm_mem_pool_init (pool,
+		                  klass->sizeof_data + G_STRUCT_OFFSET (NMPObject, object),
+		                  NM_IN_SET (klass->obj_type, NMP_OBJECT_TYPE_IP4_ROUTE,
+		                                              NMP_OBJECT_TYPE_IP6_ROUTE)
+		                  ? 256 : 16);
+	}
+	return pool;
+}
+
+/**
+ * nmp_object_get_pool_stats:
+ * @obj_type: the object type
+ * @stats: (out): the allocation statistics
+ *
+ * For debugging, returns how many objects of @obj_type are allocated.
+ */
+void
+nmp_object_get_pool_stats (NMPObjectType obj_type, NMMemPoolStats *stats)
+{
+	const NMPClass *klass = nmp_class_from_type (obj_type);
+
+	g_return_if_fail (klass);
+	g_return_if_fail (stats);
+
+	nm_mem_pool_get_stats (_nmp_object_pool_get (klass), stats);
+}
+
+/**
+ * nmp_object_trim_pool:
+ * @obj_type: the object type
+ *
+ * Releases the memory of objects of @obj_type that were destroyed,
+ * as far as possible. See nm_mem_pool_trim().
+ */
+void
+nmp_object_trim_pool (NMPObjectType obj_type)
+{
+	const NMPClass *klass = nmp_class_from_type (obj_type);
+
+	g_return_if_fail (klass);
+
+	nm_mem_pool_trim (_nmp_object_pool_get (klass));
+}
+
 static NMPObject *
 _nmp_object_new_from_class (const NMPClass *klass)
 {
@@ -478,7 +613,7 @@ _nmp_object_new_from_class (const NMPClass *klass)
 	nm_assert (klass->sizeof_data > 0);
 	nm_assert (klass->sizeof_public > 0 && klass->sizeof_public <= klass->sizeof_data);
 
-	obj = g_slice_alloc0 (klass->sizeof_data + G_STRUCT_OFFSET (NMPObject, object));
+	obj = nm_mem_pool_alloc0 (_nmp_object_pool_get (klass));
 	obj->_class = klass;
 	obj->parent._ref_count = 1;
 	return obj;
@@ -1207,6 +1342,8 @@ static const guint8 _supported_cache_ids_ipx_route[] = {
 	NMP_CACHE_ID_TYPE_ADDRROUTE_BY_IFINDEX,
 	NMP_CACHE_ID_TYPE_DEFAULT_ROUTES,
 	NMP_CACHE_ID_TYPE_ROUTES_BY_DESTINATION,
+	NMP_CACHE_ID_TYPE_ROUTES_BY_DEST_PREFIX,
+	NMP_CACHE_ID_TYPE_ROUTES_BY_IFINDEX_METRIC,
 	0,
 };
 
@@ -1224,7 +1361,7 @@ _vt_dedup_obj_destroy (NMDedupMultiObj *obj)
 	klass = o->_class;
 	if (klass->cmd_obj_dispose)
 		klass->cmd_obj_dispose (o);
-	g_slice_free1 (klass->sizeof_data + G_STRUCT_OFFSET (NMPObject, object), o);
+	nm_mem_pool_free (_nmp_object_pool_get (klass), o);
 }
 
 static const NMDedupMultiObj *
@@ -1601,6 +1738,59 @@ nmp_lookup_init_route_by_dest (NMPLookup *lookup,
 	return _L (lookup);
 }
 
+const NMPLookup *
+nmp_lookup_init_route_by_dest_prefix (NMPLookup *lookup,
+                                      int addr_family,
+                                      gconstpointer network,
+                                      guint plen)
+{
+	NMPObject *o;
+
+	nm_assert (lookup);
+
+	switch (addr_family) {
+	case AF_INET:
+		o = _nmp_object_stackinit_from_type (&lookup->selector_obj, NMP_OBJECT_TYPE_IP4_ROUTE);
+		o->object.ifindex = 1;
+		o->ip_route.plen = plen;
+		if (network)
+			o->ip4_route.network = *((in_addr_t *) network);
+		break;
+	case AF_INET6:
+		o = _nmp_object_stackinit_from_type (&lookup->selector_obj, NMP_OBJECT_TYPE_IP6_ROUTE);
+		o->object.ifindex = 1;
+		o->ip_route.plen = plen;
+		if (network)
+			o->ip6_route.network = *((struct in6_addr *) network);
+		break;
+	default:
+		nm_assert_not_reached ();
+		return NULL;
+	}
+	lookup->cache_id_type = NMP_CACHE_ID_TYPE_ROUTES_BY_DEST_PREFIX;
+	return _L (lookup);
+}
+
+const NMPLookup *
+nmp_lookup_init_route_by_ifindex_metric (NMPLookup *lookup,
+                                         NMPObjectType obj_type,
+                                         int ifindex,
+                                         guint32 metric)
+{
+	NMPObject *o;
+
+	nm_assert (lookup);
+	nm_assert (NM_IN_SET (obj_type, NMP_OBJECT_TYPE_IP4_ROUTE,
+	                                NMP_OBJECT_TYPE_IP6_ROUTE));
+	nm_assert (ifindex > 0);
+
+	o = _nmp_object_stackinit_from_type (&lookup->selector_obj, obj_type);
+	o->object.ifindex = ifindex;
+	o->ip_route.metric = metric;
+	lookup->cache_id_type = NMP_CACHE_ID_TYPE_ROUTES_BY_IFINDEX_METRIC;
+	return _L (lookup);
+}
+
 /*****************************************************************************/
 
 GArray *
@@ -1681,6 +1871,77 @@ nmp_cache_find_other_route_for_same_destination (const NMPCache *cache, const NM
 	return NULL;
 }
 
+/**
+ * nmp_cache_lookup_route_lpm:
+ * @cache: the platform cache
+ * @addr_family: either AF_INET or AF_INET6
+ * @dest: the destination address (in_addr_t or struct in6_addr)
+ *
+ * Find the route in the cache that covers @dest with the longest prefix.
+ * If there are several routes with that prefix, the one with the lowest
+ * metric wins.
+ *
+ * Only the prefix lengths for which routes exist are looked up
+ * in NMP_CACHE_ID_TYPE_ROUTES_BY_DEST_PREFIX, so this costs at most one
+ * hash lookup per prefix length, regardless of the number of routes.
+ *
+ * Returns: (transfer none): the best matching route or %NULL.
+ */
+const NMPObject *
+nmp_cache_lookup_route_lpm (const NMPCache *cache,
+                            int addr_family,
+                            gconstpointer dest)
+{
+	const guint *plen_count;
+	NMPLookup lookup;
+	NMDedupMultiIter iter;
+	const NMPObject *o = NULL;
+	const NMPObject *best = NULL;
+	int plen;
+	union {
+		in_addr_t addr4;
+		struct in6_addr addr6;
+	} network;
+
+	nm_assert (cache);
+	nm_assert (dest);
+
+	switch (addr_family) {
+	case AF_INET:
+		plen_count = cache->route4_plen_count;
+		plen = 32;
+		break;
+	case AF_INET6:
+		plen_count = cache->route6_plen_count;
+		plen = 128;
+		break;
+	default:
+		g_return_val_if_reached (NULL);
+	}
+
+	for (; plen >= 0; plen--) {
+		if (!plen_count[plen])
+			continue;
+
+		nm_utils_ipx_address_clear_host_address (addr_family, &network, dest, plen);
+		nmp_lookup_init_route_by_dest_prefix (&lookup, addr_family, &network, plen);
+		nmp_cache_iter_for_each (&iter, nmp_cache_lookup (cache, &lookup), &o) {
+			if (!nmp_object_is_visible (o))
+				continue;
+			/* source-specific routes only apply to some sources. */
+			if (   addr_family == AF_INET6
+			    && o->ip6_route.src_plen != 0)
+				continue;
+			if (   !best
+			    || o->ip_route.metric < best->ip_route.metric)
+				best = o;
+		}
+		if (best)
+			return best;
+	}
+	return NULL;
+}
+
 const NMPObject *
 nmp_cache_lookup_link_full (const NMPCache *cache,
                             int ifindex,
@@ -1818,6 +2079,33 @@ _idxcache_update_box_move (NMPCache *cache,
 		nm_dedup_multi_index_remove_entry (cache->multi_idx, entry_old);
 }
 
+static void
+_idxcache_update_plen_count (NMPCache *cache,
+                             const NMPObject *obj,
+                             int delta)
+{
+	guint *count;
+
+	if (!obj || obj->object.ifindex <= 0)
+		return;
+
+	switch (NMP_OBJECT_GET_TYPE (obj)) {
+	case NMP_OBJECT_TYPE_IP4_ROUTE:
+		nm_assert (obj->ip_route.plen <= 32);
+		count = &cache->route4_plen_count[obj->ip_route.plen];
+		break;
+	case NMP_OBJECT_TYPE_IP6_ROUTE:
+		nm_assert (obj->ip_route.plen <= 128);
+		count = &cache->route6_plen_count[obj->ip_route.plen];
+		break;
+	default:
+		return;
+	}
+
+	nm_assert (delta > 0 || *count > 0);
+	*count += delta;
+}
+
 static void
 _idxcache_update (NMPCache *cache,
                   const NMDedupMultiEntry *entry_old,
@@ -1893,6 +2181,9 @@ _idxcache_update (NMPCache *cache,
 		                           entry_new ? entry_new->obj : NULL);
 	}
 
+	_idxcache_update_plen_count (cache, obj_old, -1);
+	_idxcache_update_plen_count (cache, entry_new ? entry_new->obj : NULL, 1);
+
 	NM_SET_OUT (out_entry_new, entry_new);
 }
 
@@ -2090,7 +2381,7 @@ nmp_cache_update_netlink (NMPCache *cache,
 			/* Merge the netlink parts with what we have from udev. */
 			udev_device_unref (obj_hand_over->_link.udev.device);
 			obj_hand_over->_link.udev.device = obj_old->_link.udev.device ? udev_device_ref (obj_old->_link.udev.device) : NULL;
-			_nmp_object_fixup_link_udev_fields (&obj_hand_over, NULL, cache->use_udev);
+			_nmp_object_fixup_link_udev_fields_full (&obj_hand_over, NULL, obj_old, cache->use_udev);
 
 			if (obj_hand_over->_link.netlink.lnk) {
 				nm_auto_nmpobj const NMPObject *lnk_old = obj_hand_over->_link.netlink.lnk;
@@ -2125,6 +2416,43 @@ nmp_cache_update_netlink (NMPCache *cache,
 	return NMP_CACHE_OPS_UPDATED;
 }
 
+/**
+ * nmp_cache_update_netlink_unchanged:
+ * @cache: the platform cache
+ * @obj: a (possibly stack allocated) address or route object, as parsed
+ *   from netlink.
+ *
+ * Kernel frequently re-announces addresses and routes that did not change.
+ * Check whether @obj is identical to the object in the cache and if so, handle
+ * it like nmp_cache_update_netlink() would, without the caller having to allocate
+ * a new object first.
+ *
+ * Returns: %TRUE if @obj is already in the cache unchanged. Otherwise the caller
+ *   must update the cache via nmp_cache_update_netlink().
+ **/
+gboolean
+nmp_cache_update_netlink_unchanged (NMPCache *cache,
+                                    const NMPObject *obj)
+{
+	const NMDedupMultiEntry *entry_old;
+
+	nm_assert (cache);
+	nm_assert (NMP_OBJECT_IS_VALID (obj));
+	nm_assert (NM_IN_SET (NMP_OBJECT_GET_TYPE (obj), NMP_OBJECT_TYPE_IP4_ADDRESS,
+	                                                 NMP_OBJECT_TYPE_IP6_ADDRESS,
+	                                                 NMP_OBJECT_TYPE_IP4_ROUTE,
+	                                                 NMP_OBJECT_TYPE_IP6_ROUTE));
+
+	entry_old = _lookup_obj (cache, obj);
+	if (   !entry_old
+	    || !nmp_object_is_alive (obj)
+	    || !nmp_object_equal (entry_old->obj, obj))
+		return FALSE;
+
+	nm_dedup_multi_entry_set_dirty (entry_old, FALSE);
+	return TRUE;
+}
+
 NMPCacheOpsType
 nmp_cache_update_link_udev (NMPCache *cache,
                             int ifindex,
@@ -95,6 +95,16 @@ typedef enum { /*< skip >*/
 	 * cache-resync. */
 	NMP_CACHE_ID_TYPE_ROUTES_BY_DESTINATION,
 
+	/* the routes (by object-type) to a destination network/plen, regardless
+	 * of metric and ifindex. Like NMP_CACHE_ID_TYPE_ROUTES_BY_DESTINATION, it
+	 * only requires the route to have an ifindex, it doesn't check
+	 * nmp_object_is_visible(). This allows to find all routes that shadow
+	 * each other. */
+	NMP_CACHE_ID_TYPE_ROUTES_BY_DEST_PREFIX,
+
+	/* the visible routes (by object-type) on an ifindex with a certain metric. */
+	NMP_CACHE_ID_TYPE_ROUTES_BY_IFINDEX_METRIC,
+
 	__NMP_CACHE_ID_TYPE_MAX,
 	NMP_CACHE_ID_TYPE_MAX = __NMP_CACHE_ID_TYPE_MAX - 1,
 } NMPCacheIdType;
@@ -430,6 +440,9 @@ nmp_object_unref (const NMPObject *obj)
 	return NULL;
 }
 
+void nmp_object_get_pool_stats (NMPObjectType obj_type, NMMemPoolStats *stats);
+void nmp_object_trim_pool (NMPObjectType obj_type);
+
 NMPObject *nmp_object_new (NMPObjectType obj_type, const NMPlatformObject *plob);
 NMPObject *nmp_object_new_link (int ifindex);
 
@@ -514,6 +527,14 @@ const NMPLookup *nmp_lookup_init_route_by_dest (NMPLookup *lookup,
                                                 gconstpointer network,
                                                 guint plen,
                                                 guint32 metric);
+const NMPLookup *nmp_lookup_init_route_by_dest_prefix (NMPLookup *lookup,
+                                                       int addr_family,
+                                                       gconstpointer network,
+                                                       guint plen);
+const NMPLookup *nmp_lookup_init_route_by_ifindex_metric (NMPLookup *lookup,
+                                                         NMPObjectType obj_type,
+                                                         int ifindex,
+                                                         guint32 metric);
 
 GArray *nmp_cache_lookup_to_array (const NMDedupMultiHeadEntry *head_entry,
                                    NMPObjectType obj_type,
@@ -558,6 +579,9 @@ nmp_cache_iter_next_link (NMDedupMultiIter *iter, const NMPlatformLink **out_obj
 	     )
 
 const NMPObject *nmp_cache_find_other_route_for_same_destination (const NMPCache *cache, const NMPObject *route);
+const NMPObject *nmp_cache_lookup_route_lpm (const NMPCache *cache,
+                                             int addr_family,
+                                             gconstpointer dest);
 
 const NMPObject *nmp_cache_lookup_link_full (const NMPCache *cache,
                                              int ifindex,
@@ -587,6 +611,8 @@ NMPCacheOpsType nmp_cache_update_netlink (NMPCache *cache,
                                           NMPObject *obj,
                                           const NMPObject **out_obj_old,
                                           const NMPObject **out_obj_new);
+gboolean nmp_cache_update_netlink_unchanged (NMPCache *cache,
+                                             const NMPObject *obj);
 NMPCacheOpsType nmp_cache_update_link_udev (NMPCache *cache,
                                             int ifindex,
                                             struct udev_device *udevice,
@@ -712,4 +738,28 @@ nm_platform_lookup_route_by_dest (NMPlatform *platform,
 	return nm_platform_lookup (platform, &lookup);
 }
 
+static inline const NMDedupMultiHeadEntry *
+nm_platform_lookup_route_by_dest_prefix (NMPlatform *platform,
+                                         int addr_family,
+                                         gconstpointer network,
+                                         guint plen)
+{
+	NMPLookup lookup;
+
+	nmp_lookup_init_route_by_dest_prefix (&lookup, addr_family, network, plen);
+	return nm_platform_lookup (platform, &lookup);
+}
+
+static inline const NMDedupMultiHeadEntry *
+nm_platform_lookup_route_by_ifindex_metric (NMPlatform *platform,
+                                            NMPObjectType obj_type,
+                                            int ifindex,
+                                            guint32 metric)
+{
+	NMPLookup lookup;
+
+	nmp_lookup_init_route_by_ifindex_metric (&lookup, obj_type, ifindex, metric);
+	return nm_platform_lookup (platform, &lookup);
+}
+
 #endif /* __NMP_OBJECT_H__ */
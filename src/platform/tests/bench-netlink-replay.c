@@ -0,0 +1,409 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/* NetworkManager -- Network link manager
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright 2017 Red Hat, Inc.
+ */
+
+/* Records the rtnetlink messages of a system to a file and replays them
+ * into the cache of NMLinuxPlatform, to benchmark the cache against
+ * real traffic.
+ *
+ *   bench-netlink-replay --capture FILE [--duration SEC]
+ *   unshare -n bench-netlink-replay --replay FILE [--repeat N]
+ *
+ * When capturing, the current links, addresses and routes are dumped
+ * first, so that the recording starts with a populated cache. The replay
+ * should run in an empty network namespace, because the platform instance
+ * also loads the objects of the namespace it runs in.
+ *
+ * The capture file starts with the 8 bytes "NMNLCAP1", followed by records
+ * of a CaptureRecord header and the netlink message itself, padded to
+ * NLMSG_ALIGN(). It uses native byte order. */
+
+#include "nm-default.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+#include "platform/nm-linux-platform.h"
+#include "platform/nmp-object.h"
+#include "nm-core-utils.h"
+
+#include "nm-test-utils-core.h"
+
+NMTST_DEFINE ();
+
+#define CAPTURE_MAGIC "NMNLCAP1"
+
+typedef struct {
+	/* monotonic time since the start of the capture */
+	guint64 timestamp_ns;
+	guint32 len;
+	guint32 reserved;
+} CaptureRecord;
+
+static struct {
+	char *capture;
+	char *replay;
+	gint duration;
+	gint repeat;
+	gboolean dump;
+} global_opt = {
+	.duration = 60,
+	.repeat = 1,
+	.dump = TRUE,
+};
+
+static gboolean
+read_argv (int *argc, char ***argv)
+{
+	GOptionContext *context;
+	GOptionEntry options[] = {
+		{ "capture", 'c', 0, G_OPTION_ARG_FILENAME, &global_opt.capture, "Record rtnetlink messages to FILE", "FILE" },
+		{ "duration", 'd', 0, G_OPTION_ARG_INT, &global_opt.duration, "Record for SEC seconds (default 60)", "SEC" },
+		{ "no-dump", 'D', G_OPTION_FLAG_REVERSE, G_OPTION_ARG_NONE, &global_opt.dump, "Don't record the current objects before recording events", NULL },
+		{ "replay", 'r', 0, G_OPTION_ARG_FILENAME, &global_opt.replay, "Replay rtnetlink messages from FILE", "FILE" },
+		{ "repeat", 'n', 0, G_OPTION_ARG_INT, &global_opt.repeat, "Replay the recording N times (default 1)", "N" },
+		{ 0 },
+	};
+	gs_free_error GError *error = NULL;
+
+	context = g_option_context_new (NULL);
+	g_option_context_set_summary (context, "Record and replay netlink events into the NMPlatform cache.");
+	g_option_context_add_main_entries (context, options, NULL);
+
+	if (!g_option_context_parse (context, argc, argv, &error)) {
+		g_warning ("Error parsing command line arguments: %s", error->message);
+		g_option_context_free (context);
+		return FALSE;
+	}
+
+	g_option_context_free (context);
+
+	if (!global_opt.capture == !global_opt.replay) {
+		g_warning ("Either --capture or --replay is required");
+		return FALSE;
+	}
+	return global_opt.duration > 0 && global_opt.repeat > 0;
+}
+
+static gsize
+_rss_kb (void)
+{
+	gs_free char *contents = NULL;
+	gs_strfreev char **fields = NULL;
+
+	if (!g_file_get_contents ("/proc/self/statm", &contents, NULL, NULL))
+		return 0;
+	fields = g_strsplit (contents, " ", 0);
+	if (!fields[0] || !fields[1])
+		return 0;
+	return g_ascii_strtoull (fields[1], NULL, 10) * (sysconf (_SC_PAGESIZE) / 1024);
+}
+
+/*****************************************************************************/
+
+static gboolean
+_capture_write (FILE *f, gint64 start_ns, const struct nlmsghdr *nlh)
+{
+	static const char padding[NLMSG_ALIGNTO] = { 0 };
+	CaptureRecord record = {
+		.timestamp_ns = nm_utils_get_monotonic_timestamp_ns () - start_ns,
+		.len = nlh->nlmsg_len,
+	};
+
+	if (fwrite (&record, sizeof (record), 1, f) != 1)
+		return FALSE;
+	if (fwrite (nlh, nlh->nlmsg_len, 1, f) != 1)
+		return FALSE;
+	if (   NLMSG_ALIGN (nlh->nlmsg_len) != nlh->nlmsg_len
+	    && fwrite (padding, NLMSG_ALIGN (nlh->nlmsg_len) - nlh->nlmsg_len, 1, f) != 1)
+		return FALSE;
+	return TRUE;
+}
+
+static gboolean
+_capture_request_dump (int fd, guint16 type, guint32 seq)
+{
+	struct {
+		struct nlmsghdr nlh;
+		struct rtgenmsg g;
+	} req = {
+		.nlh = {
+			.nlmsg_len = NLMSG_LENGTH (sizeof (struct rtgenmsg)),
+			.nlmsg_type = type,
+			.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP,
+			.nlmsg_seq = seq,
+		},
+		.g = {
+			.rtgen_family = AF_UNSPEC,
+		},
+	};
+
+	return send (fd, &req, req.nlh.nlmsg_len, 0) == req.nlh.nlmsg_len;
+}
+
+static int
+_capture (const char *filename)
+{
+	static const guint16 dump_types[] = { RTM_GETLINK, RTM_GETADDR, RTM_GETROUTE };
+	struct sockaddr_nl addr = {
+		.nl_family = AF_NETLINK,
+		.nl_groups =   RTMGRP_LINK
+		             | RTMGRP_IPV4_IFADDR
+		             | RTMGRP_IPV6_IFADDR
+		             | RTMGRP_IPV4_ROUTE
+		             | RTMGRP_IPV6_ROUTE,
+	};
+	int rcvbuf = 8 * 1024 * 1024;
+	guint8 buf[65536];
+	FILE *f;
+	int fd;
+	gint64 start_ns, end_ns, now_ns;
+	guint dump_idx = 0;
+	gboolean dump_pending = FALSE;
+	guint64 n_msgs = 0;
+	guint64 n_bytes = 0;
+
+	fd = socket (AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+	if (fd < 0) {
+		g_printerr ("failed to create netlink socket: %s\n", g_strerror (errno));
+		return EXIT_FAILURE;
+	}
+	if (setsockopt (fd, SOL_SOCKET, SO_RCVBUFFORCE, &rcvbuf, sizeof (rcvbuf)) < 0)
+		setsockopt (fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof (rcvbuf));
+	if (bind (fd, (struct sockaddr *) &addr, sizeof (addr)) < 0) {
+		g_printerr ("failed to bind netlink socket: %s\n", g_strerror (errno));
+		close (fd);
+		return EXIT_FAILURE;
+	}
+
+	f = fopen (filename, "we");
+	if (!f) {
+		g_printerr ("failed to open %s: %s\n", filename, g_strerror (errno));
+		close (fd);
+		return EXIT_FAILURE;
+	}
+	if (fwrite (CAPTURE_MAGIC, strlen (CAPTURE_MAGIC), 1, f) != 1)
+		goto write_failed;
+
+	start_ns = nm_utils_get_monotonic_timestamp_ns ();
+	end_ns = start_ns + ((gint64) global_opt.duration) * NM_UTILS_NS_PER_SECOND;
+
+	if (global_opt.dump) {
+		if (!_capture_request_dump (fd, dump_types[0], 1))
+			g_printerr ("failed to request dump: %s\n", g_strerror (errno));
+		else
+			dump_pending = TRUE;
+	}
+
+	while ((now_ns = nm_utils_get_monotonic_timestamp_ns ()) < end_ns) {
+		struct pollfd pfd = { .fd = fd, .events = POLLIN };
+		const struct nlmsghdr *nlh;
+		ssize_t n;
+
+		if (poll (&pfd, 1, MAX ((end_ns - now_ns) / NM_UTILS_NS_PER_MSEC, 1)) <= 0)
+			continue;
+
+		n = recv (fd, buf, sizeof (buf), 0);
+		if (n < 0) {
+			if (errno == ENOBUFS) {
+				g_printerr ("receive buffer overrun, messages were lost\n");
+				continue;
+			}
+			if (errno == EINTR || errno == EAGAIN)
+				continue;
+			g_printerr ("failed to receive: %s\n", g_strerror (errno));
+			break;
+		}
+
+		for (nlh = (const struct nlmsghdr *) buf;
+		     NLMSG_OK (nlh, (size_t) n);
+		     nlh = NLMSG_NEXT (nlh, n)) {
+			if (NM_IN_SET (nlh->nlmsg_type, NLMSG_DONE, NLMSG_ERROR)) {
+				if (   dump_pending
+				    && nlh->nlmsg_seq == dump_idx + 1) {
+					/* the dumps are requested one after the other. */
+					if (++dump_idx < G_N_ELEMENTS (dump_types))
+						_capture_request_dump (fd, dump_types[dump_idx], dump_idx + 1);
+					else
+						dump_pending = FALSE;
+				}
+				continue;
+			}
+			if (!_capture_write (f, start_ns, nlh))
+				goto write_failed;
+			n_msgs++;
+			n_bytes += nlh->nlmsg_len;
+		}
+	}
+
+	if (fclose (f) != 0) {
+		f = NULL;
+		goto write_failed;
+	}
+	close (fd);
+
+	g_print ("recorded %"G_GUINT64_FORMAT" messages (%"G_GUINT64_FORMAT" bytes) to %s\n",
+	         n_msgs, n_bytes, filename);
+	return EXIT_SUCCESS;
+
+write_failed:
+	g_printerr ("failed to write %s: %s\n", filename, g_strerror (errno));
+	if (f)
+		fclose (f);
+	close (fd);
+	return EXIT_FAILURE;
+}
+
+/*****************************************************************************/
+
+static int
+_cmp_gint64 (gconstpointer a, gconstpointer b)
+{
+	gint64 x = *((const gint64 *) a);
+	gint64 y = *((const gint64 *) b);
+
+	return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static gint64
+_percentile (GArray *sorted, guint percent)
+{
+	guint idx;
+
+	if (!sorted->len)
+		return 0;
+	idx = (((guint64) sorted->len) * percent) / 100;
+	return g_array_index (sorted, gint64, MIN (idx, sorted->len - 1));
+}
+
+static guint
+_cache_count (NMPlatform *platform, NMPObjectType obj_type)
+{
+	const NMDedupMultiHeadEntry *head_entry;
+
+	head_entry = nm_platform_lookup_obj_type (platform, obj_type);
+	return head_entry ? head_entry->len : 0;
+}
+
+static int
+_replay (const char *filename)
+{
+	gs_free char *contents = NULL;
+	gs_free_error GError *error = NULL;
+	gsize len;
+	GArray *latencies;
+	NMPlatform *platform;
+	gsize rss_start;
+	gint64 start_ns, total_ns;
+	guint round;
+	guint64 n_msgs;
+
+	if (!g_file_get_contents (filename, &contents, &len, &error)) {
+		g_printerr ("failed to read %s: %s\n", filename, error->message);
+		return EXIT_FAILURE;
+	}
+	if (   len < strlen (CAPTURE_MAGIC)
+	    || memcmp (contents, CAPTURE_MAGIC, strlen (CAPTURE_MAGIC)) != 0) {
+		g_printerr ("%s is not a netlink capture\n", filename);
+		return EXIT_FAILURE;
+	}
+
+	nm_linux_platform_setup ();
+	platform = NM_PLATFORM_GET;
+
+	latencies = g_array_new (FALSE, FALSE, sizeof (gint64));
+	rss_start = _rss_kb ();
+	start_ns = nm_utils_get_monotonic_timestamp_ns ();
+
+	for (round = 0; round < global_opt.repeat; round++) {
+		gsize pos = strlen (CAPTURE_MAGIC);
+
+		while (pos + sizeof (CaptureRecord) <= len) {
+			CaptureRecord record;
+			const struct nlmsghdr *nlh;
+			gint64 t;
+
+			memcpy (&record, &contents[pos], sizeof (record));
+			pos += sizeof (record);
+			if (   record.len < sizeof (struct nlmsghdr)
+			    || record.len > len - pos) {
+				g_printerr ("%s: truncated record at offset %"G_GSIZE_FORMAT"\n", filename, pos);
+				break;
+			}
+
+			/* records are padded to NLMSG_ALIGN() and the magic has
+			 * 8 bytes, so the message is suitably aligned. */
+			nlh = (const struct nlmsghdr *) &contents[pos];
+			pos += MIN (NLMSG_ALIGN (record.len), len - pos);
+
+			t = nm_utils_get_monotonic_timestamp_ns ();
+			nm_linux_platform_process_netlink_msg (platform, nlh);
+			t = nm_utils_get_monotonic_timestamp_ns () - t;
+			g_array_append_val (latencies, t);
+		}
+	}
+
+	total_ns = nm_utils_get_monotonic_timestamp_ns () - start_ns;
+	n_msgs = latencies->len;
+
+	g_array_sort (latencies, _cmp_gint64);
+
+	g_print ("replayed %"G_GUINT64_FORMAT" messages in %"G_GINT64_FORMAT" ms: %.0f events/s\n",
+	         n_msgs,
+	         total_ns / NM_UTILS_NS_PER_MSEC,
+	         total_ns > 0 ? ((double) n_msgs) * NM_UTILS_NS_PER_SECOND / total_ns : 0.0);
+	g_print ("latency (us): p50 %.1f, p90 %.1f, p99 %.1f, p99.9 %.1f, max %.1f\n",
+	         _percentile (latencies, 50) / 1000.0,
+	         _percentile (latencies, 90) / 1000.0,
+	         _percentile (latencies, 99) / 1000.0,
+	         latencies->len ? g_array_index (latencies, gint64, MIN ((guint) (((guint64) latencies->len) * 999 / 1000), latencies->len - 1)) / 1000.0 : 0.0,
+	         latencies->len ? g_array_index (latencies, gint64, latencies->len - 1) / 1000.0 : 0.0);
+	g_print ("cache: %u links, %u ip4 addresses, %u ip6 addresses, %u ip4 routes, %u ip6 routes\n",
+	         _cache_count (platform, NMP_OBJECT_TYPE_LINK),
+	         _cache_count (platform, NMP_OBJECT_TYPE_IP4_ADDRESS),
+	         _cache_count (platform, NMP_OBJECT_TYPE_IP6_ADDRESS),
+	         _cache_count (platform, NMP_OBJECT_TYPE_IP4_ROUTE),
+	         _cache_count (platform, NMP_OBJECT_TYPE_IP6_ROUTE));
+	g_print ("RSS: %"G_GSIZE_FORMAT" KiB (increase %"G_GSSIZE_FORMAT" KiB)\n",
+	         _rss_kb (),
+	         (gssize) (_rss_kb () - rss_start));
+
+	g_array_unref (latencies);
+	return EXIT_SUCCESS;
+}
+
+/*****************************************************************************/
+
+int
+main (int argc, char **argv)
+{
+	nmtst_init_with_logging (&argc, &argv, "WARN", "ALL");
+
+	if (!read_argv (&argc, &argv))
+		return 2;
+
+	if (global_opt.capture)
+		return _capture (global_opt.capture);
+	return _replay (global_opt.replay);
+}
@@ -0,0 +1,223 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/* NetworkManager -- Network link manager
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright 2017 Red Hat, Inc.
+ */
+
+/* Loads a large number of routes into the fake platform and compares
+ * the cost of finding routes by walking all routes of a type against
+ * using the by-destination-prefix and by-ifindex/metric cache indexes.
+ * It also reports the memory used for the cached routes. */
+
+#include "nm-default.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "platform/nm-fake-platform.h"
+#include "platform/nmp-object.h"
+#include "nm-core-utils.h"
+
+#include "nm-test-utils-core.h"
+
+NMTST_DEFINE ();
+
+#define N_LINKS   16
+#define N_METRICS 4
+
+static struct {
+	gint num_routes;
+	gint num_lookups;
+} global_opt = {
+	.num_routes = 1000000,
+	.num_lookups = 100,
+};
+
+static gboolean
+read_argv (int *argc, char ***argv)
+{
+	GOptionContext *context;
+	GOptionEntry options[] = {
+		{ "routes", 'n', 0, G_OPTION_ARG_INT, &global_opt.num_routes, "Number of routes to load (default 1000000)", "N" },
+		{ "lookups", 'l', 0, G_OPTION_ARG_INT, &global_opt.num_lookups, "Number of lookups to time (default 100)", "N" },
+		{ 0 },
+	};
+	gs_free_error GError *error = NULL;
+
+	context = g_option_context_new (NULL);
+	g_option_context_set_summary (context, "Benchmark route lookups in the NMPlatform cache.");
+	g_option_context_add_main_entries (context, options, NULL);
+
+	if (!g_option_context_parse (context, argc, argv, &error)) {
+		g_warning ("Error parsing command line arguments: %s", error->message);
+		g_option_context_free (context);
+		return FALSE;
+	}
+
+	g_option_context_free (context);
+	return global_opt.num_routes > 0 && global_opt.num_lookups > 0;
+}
+
+/*****************************************************************************/
+
+static int ifindexes[N_LINKS];
+
+static void
+_route_init (NMPlatformIP4Route *r, guint i)
+{
+	memset (r, 0, sizeof (*r));
+	r->ifindex = ifindexes[i % N_LINKS];
+	r->rt_source = NM_IP_CONFIG_SOURCE_USER;
+	/* unique /32 destinations in 10.0.0.0/8 */
+	r->network = htonl (0x0A000000u + (i & 0xFFFFFFu));
+	r->plen = 32;
+	r->metric = 100 + (i % N_METRICS);
+}
+
+static gsize
+_rss_kb (void)
+{
+	gs_free char *contents = NULL;
+	gs_strfreev char **fields = NULL;
+
+	if (!g_file_get_contents ("/proc/self/statm", &contents, NULL, NULL))
+		return 0;
+	fields = g_strsplit (contents, " ", 0);
+	if (!fields[0] || !fields[1])
+		return 0;
+	return g_ascii_strtoull (fields[1], NULL, 10) * (sysconf (_SC_PAGESIZE) / 1024);
+}
+
+static void
+_print_pool_stats (const char *name, const NMMemPoolStats *stats)
+{
+	g_print ("%-12s live %"G_GSIZE_FORMAT" (max %"G_GSIZE_FORMAT"), %"G_GSIZE_FORMAT" KiB used, %"G_GSIZE_FORMAT" KiB allocated\n",
+	         name,
+	         stats->n_live,
+	         stats->n_live_max,
+	         stats->bytes_live / 1024,
+	         stats->bytes_allocated / 1024);
+}
+
+static gint64
+_time_ms (gint64 start_ns)
+{
+	return (nm_utils_get_monotonic_timestamp_ns () - start_ns) / NM_UTILS_NS_PER_MSEC;
+}
+
+int
+main (int argc, char **argv)
+{
+	NMPlatform *platform;
+	NMPlatformIP4Route r;
+	NMDedupMultiIter iter;
+	const NMPObject *o;
+	gint64 start;
+	guint i, k;
+	guint n_found_linear = 0, n_found_indexed = 0;
+	gsize rss_start;
+	NMMemPoolStats stats, stats_head;
+
+	nmtst_init_with_logging (&argc, &argv, "WARN", "ALL");
+
+	if (!read_argv (&argc, &argv))
+		return 2;
+	if (global_opt.num_routes > 0xFFFFFF)
+		global_opt.num_routes = 0xFFFFFF;
+
+	nm_fake_platform_setup ();
+	platform = NM_PLATFORM_GET;
+
+	for (i = 0; i < N_LINKS; i++) {
+		gs_free char *name = g_strdup_printf ("bench%u", i);
+		const NMPlatformLink *link;
+
+		if (nm_platform_link_dummy_add (platform, name, &link) != NM_PLATFORM_ERROR_SUCCESS)
+			g_error ("failed to add link %s", name);
+		ifindexes[i] = link->ifindex;
+	}
+
+	rss_start = _rss_kb ();
+	start = nm_utils_get_monotonic_timestamp_ns ();
+	for (i = 0; i < global_opt.num_routes; i++) {
+		_route_init (&r, i);
+		if (!nm_platform_ip4_route_add (platform, NMP_NLM_FLAG_REPLACE, &r))
+			g_error ("failed to add route #%u", i);
+	}
+	g_print ("load %d routes: %"G_GINT64_FORMAT" ms\n", global_opt.num_routes, _time_ms (start));
+	g_print ("RSS increase: %"G_GSIZE_FORMAT" KiB\n", _rss_kb () - rss_start);
+	nmp_object_get_pool_stats (NMP_OBJECT_TYPE_IP4_ROUTE, &stats);
+	_print_pool_stats ("ip4-routes:", &stats);
+	nm_dedup_multi_index_get_pool_stats (nm_platform_get_multi_idx (platform), &stats, &stats_head);
+	_print_pool_stats ("entries:", &stats);
+	_print_pool_stats ("heads:", &stats_head);
+
+	/* lookup by destination prefix */
+	start = nm_utils_get_monotonic_timestamp_ns ();
+	for (k = 0; k < global_opt.num_lookups; k++) {
+		_route_init (&r, (k * 7919u) % global_opt.num_routes);
+		nmp_cache_iter_for_each (&iter,
+		                         nm_platform_lookup_obj_type (platform, NMP_OBJECT_TYPE_IP4_ROUTE),
+		                         &o) {
+			if (   o->ip4_route.network == r.network
+			    && o->ip4_route.plen == r.plen)
+				n_found_linear++;
+		}
+	}
+	g_print ("%d destination lookups, linear:  %"G_GINT64_FORMAT" ms\n", global_opt.num_lookups, _time_ms (start));
+
+	start = nm_utils_get_monotonic_timestamp_ns ();
+	for (k = 0; k < global_opt.num_lookups; k++) {
+		_route_init (&r, (k * 7919u) % global_opt.num_routes);
+		nmp_cache_iter_for_each (&iter,
+		                         nm_platform_lookup_route_by_dest_prefix (platform, AF_INET, &r.network, r.plen),
+		                         &o)
+			n_found_indexed++;
+	}
+	g_print ("%d destination lookups, indexed: %"G_GINT64_FORMAT" ms\n", global_opt.num_lookups, _time_ms (start));
+
+	/* lookup by ifindex and metric */
+	start = nm_utils_get_monotonic_timestamp_ns ();
+	for (k = 0; k < global_opt.num_lookups; k++) {
+		int ifindex = ifindexes[k % N_LINKS];
+		guint32 metric = 100 + (k % N_METRICS);
+
+		nmp_cache_iter_for_each (&iter,
+		                         nm_platform_lookup_addrroute (platform, NMP_OBJECT_TYPE_IP4_ROUTE, ifindex),
+		                         &o) {
+			if (o->ip4_route.metric == metric)
+				n_found_linear++;
+		}
+	}
+	g_print ("%d ifindex/metric lookups, linear:  %"G_GINT64_FORMAT" ms\n", global_opt.num_lookups, _time_ms (start));
+
+	start = nm_utils_get_monotonic_timestamp_ns ();
+	for (k = 0; k < global_opt.num_lookups; k++) {
+		const NMDedupMultiHeadEntry *head_entry;
+
+		head_entry = nm_platform_lookup_route_by_ifindex_metric (platform,
+		                                                         NMP_OBJECT_TYPE_IP4_ROUTE,
+		                                                         ifindexes[k % N_LINKS],
+		                                                         100 + (k % N_METRICS));
+		n_found_indexed += head_entry ? head_entry->len : 0;
+	}
+	g_print ("%d ifindex/metric lookups, indexed: %"G_GINT64_FORMAT" ms\n", global_opt.num_lookups, _time_ms (start));
+
+	g_print ("found %u routes linear, %u indexed\n", n_found_linear, n_found_indexed);
+
+	return EXIT_SUCCESS;
+}
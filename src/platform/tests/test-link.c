@@ -1939,6 +1939,23 @@ _test_netns_check_skip (void)
 
 /*****************************************************************************/
 
+static char *
+_get_sysctl_value (const char *path)
+{
+	char *data = NULL;
+	gs_free_error GError *error = NULL;
+
+	if (!g_file_get_contents (path, &data, NULL, &error)) {
+		nmtst_assert_error (error, G_FILE_ERROR, G_FILE_ERROR_NOENT, NULL);
+		g_assert (!data);
+	} else {
+		g_assert_no_error (error);
+		g_assert (data);
+		g_strstrip (data);
+	}
+	return data;
+}
+
 #define _sysctl_assert_eq(plat, path, value) \
 	G_STMT_START { \
 		gs_free char *_val = NULL; \
@@ -1947,6 +1964,17 @@ _test_netns_check_skip (void)
 		g_assert_cmpstr (_val, ==, value); \
 	} G_STMT_END
 
+/* reads the value from procfs in the namespace of @plat, bypassing the platform. */
+#define _sysctl_assert_procfs_eq(plat, path, value) \
+	G_STMT_START { \
+		nm_auto_pop_netns NMPNetns *_netns = NULL; \
+		gs_free char *_val = NULL; \
+		\
+		g_assert (nm_platform_netns_push (plat, &_netns)); \
+		_val = _get_sysctl_value (path); \
+		g_assert_cmpstr (_val, ==, value); \
+	} G_STMT_END
+
 static void
 test_netns_general (gpointer fixture, gconstpointer test_data)
 {
@@ -2017,9 +2045,38 @@ test_netns_general (gpointer fixture, gconstpointer test_data)
 				path = "/proc/sys/net/ipv6/conf/dummy2b/disable_ipv6";
 		}
 		g_assert (nm_platform_sysctl_set (pl, NMP_SYSCTL_PATHID_ABSOLUTE (path), nm_sprintf_buf (sbuf, "%d", j)));
+		_sysctl_assert_procfs_eq (pl, path, nm_sprintf_buf (sbuf, "%d", j));
 		_sysctl_assert_eq (pl, path, nm_sprintf_buf (sbuf, "%d", j));
 	}
 
+	/* values that change behind our back are seen on the next read, and
+	 * writing the value that we wrote before is not skipped. */
+	for (k = 0; k < 2; k++) {
+		NMPlatform *pl = (k == 0 ? platform_1 : platform_2);
+		const char *path = "/proc/sys/net/ipv6/conf/dummy1_/accept_ra";
+
+		g_assert (nm_platform_sysctl_set (pl, NMP_SYSCTL_PATHID_ABSOLUTE (path), "2"));
+		_sysctl_assert_procfs_eq (pl, path, "2");
+		_sysctl_assert_eq (pl, path, "2");
+		{
+			nm_auto_pop_netns NMPNetns *netns_pop = NULL;
+
+			g_assert (nm_platform_netns_push (pl, &netns_pop));
+			nmtstp_run_command_check ("echo 0 > %s", path);
+		}
+		_sysctl_assert_eq (pl, path, "0");
+		g_assert (nm_platform_sysctl_set (pl, NMP_SYSCTL_PATHID_ABSOLUTE (path), "2"));
+		_sysctl_assert_procfs_eq (pl, path, "2");
+		{
+			nm_auto_pop_netns NMPNetns *netns_pop = NULL;
+
+			g_assert (nm_platform_netns_push (pl, &netns_pop));
+			nmtstp_run_command_check ("echo 0 > %s", path);
+		}
+		g_assert (nm_platform_sysctl_set (pl, NMP_SYSCTL_PATHID_ABSOLUTE (path), "1"));
+		_sysctl_assert_procfs_eq (pl, path, "1");
+	}
+
 	_sysctl_assert_eq (platform_1, "/proc/sys/net/ipv6/conf/dummy2b/disable_ipv6", NULL);
 	_sysctl_assert_eq (platform_2, "/proc/sys/net/ipv6/conf/dummy2a/disable_ipv6", NULL);
 
@@ -2085,6 +2142,55 @@ test_netns_set_netns (gpointer fixture, gconstpointer test_data)
 
 /*****************************************************************************/
 
+static void
+test_netns_lazy (gpointer fixture, gconstpointer test_data)
+{
+	nm_auto_unref_dedup_multi_index NMDedupMultiIndex *multi_idx = NULL;
+	gs_unref_object NMPlatform *platform_0 = NULL;
+	NMPlatform *platforms[5] = { };
+	NMPNetns *netns;
+	int i;
+
+	if (_test_netns_check_skip ())
+		return;
+
+	platform_0 = nm_linux_platform_new (TRUE, TRUE);
+	multi_idx = nm_dedup_multi_index_ref (nm_platform_get_multi_idx (platform_0));
+
+	for (i = 0; i < G_N_ELEMENTS (platforms); i++) {
+		netns = nmp_netns_new ();
+		g_assert (NMP_IS_NETNS (netns));
+
+		platforms[i] = nm_linux_platform_new_for_netns (multi_idx, TRUE);
+		g_assert (NM_IS_LINUX_PLATFORM (platforms[i]));
+		g_assert (nm_platform_get_multi_idx (platforms[i]) == multi_idx);
+		g_assert (!nm_platform_is_started (platforms[i]));
+
+		nmp_netns_pop (netns);
+		g_object_unref (netns);
+	}
+
+	/* only the instances that are used get started. The cache is populated
+	 * from the right namespace, regardless of the current one. */
+	for (i = 0; i < G_N_ELEMENTS (platforms); i += 2) {
+		g_assert (nm_platform_link_get_by_ifname (platforms[i], "lo"));
+		g_assert (nm_platform_is_started (platforms[i]));
+	}
+	for (i = 1; i < G_N_ELEMENTS (platforms); i += 2)
+		g_assert (!nm_platform_is_started (platforms[i]));
+
+	_ADD_DUMMY (platforms[1], "dummy-lazy");
+	g_assert (nm_platform_is_started (platforms[1]));
+	g_assert (nm_platform_link_get_by_ifname (platforms[1], "dummy-lazy"));
+	g_assert (!nm_platform_link_get_by_ifname (platforms[0], "dummy-lazy"));
+	g_assert (!nm_platform_link_get_by_ifname (platform_0, "dummy-lazy"));
+
+	for (i = 0; i < G_N_ELEMENTS (platforms); i++)
+		g_object_unref (platforms[i]);
+}
+
+/*****************************************************************************/
+
 static char *
 _get_current_namespace_id (int ns_type)
 {
@@ -2109,23 +2215,6 @@ _get_current_namespace_id (int ns_type)
 	return id;
 }
 
-static char *
-_get_sysctl_value (const char *path)
-{
-	char *data = NULL;
-	gs_free_error GError *error = NULL;
-
-	if (!g_file_get_contents (path, &data, NULL, &error)) {
-		nmtst_assert_error (error, G_FILE_ERROR, G_FILE_ERROR_NOENT, NULL);
-		g_assert (!data);
-	} else {
-		g_assert_no_error (error);
-		g_assert (data);
-		g_strstrip (data);
-	}
-	return data;
-}
-
 static void
 test_netns_push (gpointer fixture, gconstpointer test_data)
 {
@@ -2321,6 +2410,54 @@ test_netns_bind_to_path (gpointer fixture, gconstpointer test_data)
 
 /*****************************************************************************/
 
+static void
+_assert_driver (NMPlatform *platform, int ifindex, const char *expected)
+{
+	gs_free char *driver = NULL;
+
+	g_assert (nm_platform_link_get_driver_info (platform, ifindex, &driver, NULL, NULL));
+	g_assert_cmpstr (driver, ==, expected);
+}
+
+static void
+test_ethtool_cache (void)
+{
+	NMPlatform *const PL = NM_PLATFORM_GET;
+	const NMPlatformLink *pllink;
+	int ifindex;
+
+	ifindex = nmtstp_link_dummy_add (PL, -1, "nm-dummy-0")->ifindex;
+
+	/* older kernels don't support ethtool -i for dummy devices. */
+	if (nmtstp_run_command ("ethtool -i nm-dummy-0 > /dev/null") != 0) {
+		g_test_skip ("ethtool -i is not supported for dummy devices");
+		nmtstp_link_del (PL, -1, ifindex, "nm-dummy-0");
+		return;
+	}
+
+	_assert_driver (PL, ifindex, "dummy");
+
+	/* the link is renamed and its flags change. */
+	nmtstp_run_command_check ("ip link set nm-dummy-0 name nm-dummy-1");
+	nmtstp_link_set_updown (PL, -1, ifindex, TRUE);
+	nm_platform_process_events (PL);
+	_assert_driver (PL, ifindex, "dummy");
+
+	/* a link with a different driver reuses the ifindex. The cached
+	 * information of the old link must not be returned for it. */
+	nmtstp_run_command_check ("ip link del nm-dummy-1 && ip link add nm-veth-0 index %d type veth peer name nm-veth-1",
+	                          ifindex);
+	nm_platform_process_events (PL);
+	pllink = nm_platform_link_get (PL, ifindex);
+	g_assert (pllink);
+	g_assert_cmpint (pllink->type, ==, NM_LINK_TYPE_VETH);
+	_assert_driver (PL, ifindex, "veth");
+
+	nmtstp_link_del (PL, -1, ifindex, "nm-veth-0");
+}
+
+/*****************************************************************************/
+
 static void
 test_sysctl_rename (void)
 {
@@ -2537,9 +2674,12 @@ _nmtstp_setup_tests (void)
 
 		g_test_add_vtable ("/general/netns/general", 0, NULL, _test_netns_setup, test_netns_general, _test_netns_teardown);
 		g_test_add_vtable ("/general/netns/set-netns", 0, NULL, _test_netns_setup, test_netns_set_netns, _test_netns_teardown);
+		g_test_add_vtable ("/general/netns/lazy", 0, NULL, _test_netns_setup, test_netns_lazy, _test_netns_teardown);
 		g_test_add_vtable ("/general/netns/push", 0, NULL, _test_netns_setup, test_netns_push, _test_netns_teardown);
 		g_test_add_vtable ("/general/netns/bind-to-path", 0, NULL, _test_netns_setup, test_netns_bind_to_path, _test_netns_teardown);
 
+		g_test_add_func ("/general/ethtool-cache", test_ethtool_cache);
+
 		g_test_add_func ("/general/sysctl/rename", test_sysctl_rename);
 		g_test_add_func ("/general/sysctl/netns-switch", test_sysctl_netns_switch);
 	}
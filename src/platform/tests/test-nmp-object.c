@@ -456,6 +456,71 @@ test_cache_link (void)
 
 /*****************************************************************************/
 
+static void
+_cache_add_ip6_route (NMPCache *cache, const char *network, guint8 plen, const char *src, guint8 src_plen, guint32 metric)
+{
+	NMPlatformIP6Route r = {
+		.ifindex = pl_link_2.ifindex,
+		.plen = plen,
+		.src_plen = src_plen,
+		.metric = metric,
+	};
+	nm_auto_nmpobj NMPObject *obj = NULL;
+	NMPCacheOpsType ops_type;
+	const NMPObject *obj_old;
+	const NMPObject *obj_new;
+
+	r.network = *nmtst_inet6_from_string (network);
+	if (src)
+		r.src = *nmtst_inet6_from_string (src);
+
+	obj = nmp_object_new (NMP_OBJECT_TYPE_IP6_ROUTE, (NMPlatformObject *) &r);
+	ops_type = nmp_cache_update_netlink (cache, obj, &obj_old, &obj_new);
+	g_assert_cmpint (ops_type, ==, NMP_CACHE_OPS_ADDED);
+	ASSERT_nmp_cache_is_consistent (cache);
+	nmp_object_unref (obj_old);
+	nmp_object_unref (obj_new);
+}
+
+static void
+test_cache_route_lpm_ip6 (void)
+{
+	nm_auto_unref_dedup_multi_index NMDedupMultiIndex *multi_idx = NULL;
+	NMPCache *cache;
+	const NMPObject *o;
+
+	multi_idx = nm_dedup_multi_index_new ();
+	cache = nmp_cache_new (multi_idx, nmtst_get_rand_int () % 2);
+
+	g_assert (!nmp_cache_lookup_route_lpm (cache, AF_INET6, nmtst_inet6_from_string ("2001:db8::1")));
+
+	_cache_add_ip6_route (cache, "2001:db8::", 48, NULL, 0, 1024);
+	_cache_add_ip6_route (cache, "2001:db8::", 64, "2001:db8:1::", 48, 100);
+
+	/* the source-specific route doesn't apply without a matching source. */
+	o = nmp_cache_lookup_route_lpm (cache, AF_INET6, nmtst_inet6_from_string ("2001:db8::1"));
+	g_assert (o);
+	g_assert_cmpint (o->ip6_route.plen, ==, 48);
+
+	_cache_add_ip6_route (cache, "2001:db8::", 64, NULL, 0, 200);
+
+	o = nmp_cache_lookup_route_lpm (cache, AF_INET6, nmtst_inet6_from_string ("2001:db8::1"));
+	g_assert (o);
+	g_assert_cmpint (o->ip6_route.plen, ==, 64);
+	g_assert_cmpint (o->ip6_route.src_plen, ==, 0);
+	g_assert_cmpint (o->ip6_route.metric, ==, 200);
+
+	o = nmp_cache_lookup_route_lpm (cache, AF_INET6, nmtst_inet6_from_string ("2001:db8:0:1::1"));
+	g_assert (o);
+	g_assert_cmpint (o->ip6_route.plen, ==, 48);
+
+	g_assert (!nmp_cache_lookup_route_lpm (cache, AF_INET6, nmtst_inet6_from_string ("2001:db9::1")));
+
+	nmp_cache_free (cache);
+}
+
+/*****************************************************************************/
+
 NMTST_DEFINE ();
 
 int
@@ -500,6 +565,7 @@ main (int argc, char **argv)
 
 	g_test_add_func ("/nmp-object/obj-base", test_obj_base);
 	g_test_add_func ("/nmp-object/cache_link", test_cache_link);
+	g_test_add_func ("/nmp-object/cache_route_lpm/ip6", test_cache_route_lpm_ip6);
 
 	result = g_test_run ();
 
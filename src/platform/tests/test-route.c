@@ -388,6 +388,164 @@ test_ip6_route (void)
 
 /*****************************************************************************/
 
+static in_addr_t
+_batch_network (guint i)
+{
+	/* from 198.18.0.0/15 (benchmarking) (rfc2544) */
+	return htonl (ntohl (nmtst_inet4_from_string ("198.18.0.0")) + (i << 8));
+}
+
+static void
+test_ip4_route_batch (void)
+{
+	int ifindex = nm_platform_link_get_ifindex (NM_PLATFORM_GET, DEVICE_NAME);
+	NMPlatformIPRouteBatch *batch;
+	NMPObject obj_id;
+	const guint n = 1000;
+	const guint32 metric = 22987;
+	guint i;
+
+	/* enough routes to need more than one send buffer. */
+	batch = nm_platform_ip_route_batch_new ();
+	for (i = 0; i < n; i++) {
+		const NMPlatformIP4Route route = {
+			.ifindex = ifindex,
+			.rt_source = NM_IP_CONFIG_SOURCE_USER,
+			.network = _batch_network (i),
+			.plen = 24,
+			.metric = metric,
+		};
+
+		g_assert_cmpint (nm_platform_ip4_route_batch_add (batch, NMP_NLM_FLAG_REPLACE, &route), ==, i);
+	}
+	g_assert_cmpint (nm_platform_ip_route_batch_get_len (batch), ==, n);
+	g_assert (nm_platform_ip_route_batch_commit (NM_PLATFORM_GET, batch));
+	for (i = 0; i < n; i++)
+		g_assert (nm_platform_ip_route_batch_get_success (batch, i));
+	nm_platform_ip_route_batch_free (batch);
+
+	for (i = 0; i < n; i++)
+		g_assert (nm_platform_ip4_route_get (NM_PLATFORM_GET, ifindex, _batch_network (i), 24, metric));
+
+	batch = nm_platform_ip_route_batch_new ();
+	for (i = 0; i < n; i++) {
+		nmp_object_stackinit_id_ip4_route (&obj_id, ifindex, _batch_network (i), 24, metric);
+		nm_platform_ip_route_batch_delete (batch, &obj_id);
+	}
+
+	/* deleting a non-existing IPv4 route with metric 0 is not an error. */
+	nmp_object_stackinit_id_ip4_route (&obj_id, ifindex, _batch_network (n), 24, 0);
+	nm_platform_ip_route_batch_delete (batch, &obj_id);
+
+	g_assert (nm_platform_ip_route_batch_commit (NM_PLATFORM_GET, batch));
+	nm_platform_ip_route_batch_free (batch);
+
+	for (i = 0; i < n; i++)
+		g_assert (!nm_platform_ip4_route_get (NM_PLATFORM_GET, ifindex, _batch_network (i), 24, metric));
+}
+
+static void
+test_ip4_route_lookup (void)
+{
+	int ifindex = nm_platform_link_get_ifindex (NM_PLATFORM_GET, DEVICE_NAME);
+	const NMPlatformIP4Route *r;
+	NMPObject obj_id;
+
+	nmtstp_ip4_route_add (NM_PLATFORM_GET, ifindex, NM_IP_CONFIG_SOURCE_USER,
+	                      nmtst_inet4_from_string ("198.51.100.0"), 24, INADDR_ANY, 0, 300, 0);
+	nmtstp_ip4_route_add (NM_PLATFORM_GET, ifindex, NM_IP_CONFIG_SOURCE_USER,
+	                      nmtst_inet4_from_string ("198.51.100.128"), 25, INADDR_ANY, 0, 300, 0);
+	nmtstp_ip4_route_add (NM_PLATFORM_GET, ifindex, NM_IP_CONFIG_SOURCE_USER,
+	                      nmtst_inet4_from_string ("198.51.100.128"), 25, INADDR_ANY, 0, 200, 0);
+
+	/* the longest prefix wins, then the lowest metric. */
+	r = nm_platform_ip4_route_lookup (NM_PLATFORM_GET, nmtst_inet4_from_string ("198.51.100.10"));
+	g_assert (r);
+	g_assert_cmpint (r->plen, ==, 24);
+	g_assert_cmpint (r->metric, ==, 300);
+
+	r = nm_platform_ip4_route_lookup (NM_PLATFORM_GET, nmtst_inet4_from_string ("198.51.100.200"));
+	g_assert (r);
+	g_assert_cmpint (r->network, ==, nmtst_inet4_from_string ("198.51.100.128"));
+	g_assert_cmpint (r->plen, ==, 25);
+	g_assert_cmpint (r->metric, ==, 200);
+
+	nmp_object_stackinit_id_ip4_route (&obj_id, ifindex, nmtst_inet4_from_string ("198.51.100.128"), 25, 200);
+	g_assert (nm_platform_ip_route_delete (NM_PLATFORM_GET, &obj_id));
+	nmp_object_stackinit_id_ip4_route (&obj_id, ifindex, nmtst_inet4_from_string ("198.51.100.128"), 25, 300);
+	g_assert (nm_platform_ip_route_delete (NM_PLATFORM_GET, &obj_id));
+
+	r = nm_platform_ip4_route_lookup (NM_PLATFORM_GET, nmtst_inet4_from_string ("198.51.100.200"));
+	g_assert (r);
+	g_assert_cmpint (r->plen, ==, 24);
+
+	nmp_object_stackinit_id_ip4_route (&obj_id, ifindex, nmtst_inet4_from_string ("198.51.100.0"), 24, 300);
+	g_assert (nm_platform_ip_route_delete (NM_PLATFORM_GET, &obj_id));
+
+	r = nm_platform_ip4_route_lookup (NM_PLATFORM_GET, nmtst_inet4_from_string ("198.51.100.200"));
+	g_assert (!r || r->plen < 24);
+}
+
+/*****************************************************************************/
+
+typedef struct {
+	int ifindex;
+	guint n_sets;
+	guint n_changes;
+	guint change_flags;
+} ChangedSetData;
+
+static void
+_changed_set_cb (NMPlatform *platform,
+                 const NMPlatformChangedSet *set,
+                 ChangedSetData *data)
+{
+	const NMPlatformChangedSetEntry *entry;
+
+	entry = nm_platform_changed_set_lookup (set, NMP_OBJECT_TYPE_IP4_ROUTE, data->ifindex);
+	if (!entry)
+		return;
+	data->n_sets++;
+	data->n_changes += entry->n_changes;
+	data->change_flags |= entry->change_flags;
+}
+
+static void
+test_ip4_route_changed_set (void)
+{
+	ChangedSetData data = {
+		.ifindex = nm_platform_link_get_ifindex (NM_PLATFORM_GET, DEVICE_NAME),
+	};
+	NMPObject obj_id;
+	gulong id;
+	guint i;
+
+	id = g_signal_connect (NM_PLATFORM_GET, NM_PLATFORM_SIGNAL_CHANGED_SET, G_CALLBACK (_changed_set_cb), &data);
+
+	for (i = 0; i < 3; i++) {
+		nmtstp_ip4_route_add (NM_PLATFORM_GET, data.ifindex, NM_IP_CONFIG_SOURCE_USER,
+		                      nmtst_inet4_from_string ("198.51.100.0") + htonl (i << 4), 28, INADDR_ANY, 0, 300, 0);
+	}
+	g_assert_cmpint (data.n_sets, ==, 0);
+
+	while (g_main_context_iteration (NULL, FALSE)) {
+	}
+
+	/* all three routes are reported at once. */
+	g_assert_cmpint (data.n_sets, ==, 1);
+	g_assert_cmpint (data.n_changes, ==, 3);
+	g_assert_cmpint (data.change_flags, ==, (1u << NM_PLATFORM_SIGNAL_ADDED));
+
+	g_signal_handler_disconnect (NM_PLATFORM_GET, id);
+
+	for (i = 0; i < 3; i++) {
+		nmp_object_stackinit_id_ip4_route (&obj_id, data.ifindex, nmtst_inet4_from_string ("198.51.100.0") + htonl (i << 4), 28, 300);
+		g_assert (nm_platform_ip_route_delete (NM_PLATFORM_GET, &obj_id));
+	}
+}
+
+/*****************************************************************************/
+
 static void
 test_ip4_zero_gateway (void)
 {
@@ -583,6 +741,9 @@ _nmtstp_setup_tests (void)
 	add_test_func ("/route/ip4", test_ip4_route);
 	add_test_func ("/route/ip6", test_ip6_route);
 	add_test_func ("/route/ip4_metric0", test_ip4_route_metric0);
+	add_test_func ("/route/ip4_batch", test_ip4_route_batch);
+	add_test_func ("/route/ip4_lookup", test_ip4_route_lookup);
+	add_test_func ("/route/ip4_changed_set", test_ip4_route_changed_set);
 	add_test_func ("/route/ip4_options", test_ip4_route_options);
 	add_test_func_data ("/route/ip6_options/1", test_ip6_route_options, GINT_TO_POINTER (1));
 	add_test_func_data ("/route/ip6_options/2", test_ip6_route_options, GINT_TO_POINTER (2));
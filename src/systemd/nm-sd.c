@@ -138,6 +138,68 @@ nm_sd_event_attach_default (void)
 
 #include "nm-sd-adapt.h"
 #include "dhcp-lease-internal.h"
+#include "dhcp-internal.h"
 
 /*****************************************************************************/
 
+/* Like the ACK handling of sd_dhcp_client, for messages that were received
+ * by someone else. Returns -EADDRNOTAVAIL for a NAK. */
+int
+nm_sd_dhcp_lease_new_from_message (const void *message,
+                                   size_t len,
+                                   const void *client_id,
+                                   size_t client_id_len,
+                                   sd_dhcp_lease **out_lease)
+{
+	sd_dhcp_lease *lease = NULL;
+	const DHCPMessage *msg = message;
+	int r;
+
+	g_return_val_if_fail (message, -EINVAL);
+	g_return_val_if_fail (out_lease && !*out_lease, -EINVAL);
+
+	r = dhcp_lease_new (&lease);
+	if (r < 0)
+		return r;
+
+	if (client_id_len) {
+		r = dhcp_lease_set_client_id (lease, client_id, client_id_len);
+		if (r < 0)
+			goto fail;
+	}
+
+	r = dhcp_option_parse ((DHCPMessage *) msg, len, dhcp_lease_parse_options, lease, NULL);
+	if (r == DHCP_NAK) {
+		r = -EADDRNOTAVAIL;
+		goto fail;
+	}
+	if (r != DHCP_ACK) {
+		r = -ENOMSG;
+		goto fail;
+	}
+
+	lease->next_server = msg->siaddr;
+	lease->address = msg->yiaddr;
+
+	if (   lease->address == INADDR_ANY
+	    || lease->server_address == INADDR_ANY
+	    || lease->lifetime == 0) {
+		r = -ENOMSG;
+		goto fail;
+	}
+
+	if (lease->subnet_mask == INADDR_ANY) {
+		r = dhcp_lease_set_default_subnet_mask (lease);
+		if (r < 0) {
+			r = -ENOMSG;
+			goto fail;
+		}
+	}
+
+	*out_lease = lease;
+	return 0;
+
+fail:
+	sd_dhcp_lease_unref (lease);
+	return r;
+}
@@ -39,5 +39,11 @@ struct sd_dhcp_lease;
 int dhcp_lease_save(struct sd_dhcp_lease *lease, const char *lease_file);
 int dhcp_lease_load(struct sd_dhcp_lease **ret, const char *lease_file);
 
+int nm_sd_dhcp_lease_new_from_message (const void *message,
+                                       size_t len,
+                                       const void *client_id,
+                                       size_t client_id_len,
+                                       struct sd_dhcp_lease **out_lease);
+
 #endif /* __NM_SD_H__ */
 
@@ -934,6 +934,53 @@ test_config_enable (void)
 
 /*****************************************************************************/
 
+static void
+_test_dns_debounce (const char *contents, guint window, guint max)
+{
+	gs_unref_object NMConfig *config = NULL;
+	const char *const TMP_FILE = BUILDDIR "/test-dns-debounce.conf";
+
+	g_assert (g_file_set_contents (TMP_FILE, contents, -1, NULL));
+
+	config = setup_config (NULL, TMP_FILE, "", NULL, "/no/such/dir", "", NULL);
+
+	g_assert_cmpint (nm_config_data_get_dns_debounce (nm_config_get_data_orig (config)), ==, window);
+	g_assert_cmpint (nm_config_data_get_dns_debounce_max (nm_config_get_data_orig (config)), ==, max);
+
+	unlink (TMP_FILE);
+}
+
+static void
+test_config_dns_debounce (void)
+{
+	_test_dns_debounce ("", 0, NM_CONFIG_DEFAULT_DNS_DEBOUNCE_MAX);
+	_test_dns_debounce ("[main]\n"
+	                    "dns-debounce=200\n",
+	                    200, NM_CONFIG_DEFAULT_DNS_DEBOUNCE_MAX);
+	_test_dns_debounce ("[main]\n"
+	                    "dns-debounce= 200 \n"
+	                    "dns-debounce-max=5000\n",
+	                    200, 5000);
+
+	/* the maximum is raised to the window. */
+	_test_dns_debounce ("[main]\n"
+	                    "dns-debounce=2000\n"
+	                    "dns-debounce-max=500\n",
+	                    2000, 2000);
+
+	/* invalid and out of range values are ignored. */
+	_test_dns_debounce ("[main]\n"
+	                    "dns-debounce=foo\n"
+	                    "dns-debounce-max=-1\n",
+	                    0, NM_CONFIG_DEFAULT_DNS_DEBOUNCE_MAX);
+	_test_dns_debounce ("[main]\n"
+	                    "dns-debounce=60001\n"
+	                    "dns-debounce-max=600001\n",
+	                    0, NM_CONFIG_DEFAULT_DNS_DEBOUNCE_MAX);
+}
+
+/*****************************************************************************/
+
 static void
 test_config_state_file (void)
 {
@@ -1018,6 +1065,7 @@ main (int argc, char **argv)
 
 	g_test_add_func ("/config/set-values", test_config_set_values);
 	g_test_add_func ("/config/global-dns", test_config_global_dns);
+	g_test_add_func ("/config/dns-debounce", test_config_dns_debounce);
 
 	g_test_add_func ("/config/signal", test_config_signal);
 
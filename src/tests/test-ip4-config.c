@@ -322,6 +322,201 @@ test_strip_search_trailing_dot (void)
 	g_object_unref (config);
 }
 
+static void
+_add_many (NMIP4Config *config, guint route_start, guint n_routes, guint dns_start, guint n_dns)
+{
+	NMPlatformIP4Route route = {
+		.plen = 32,
+		.gateway = nmtst_inet4_from_string ("192.168.1.1"),
+		.metric = 100,
+	};
+	char sbuf[100];
+	guint i;
+
+	for (i = route_start; i < route_start + n_routes; i++) {
+		route.network = htonl (0x0A000000u + i);
+		nm_ip4_config_add_route (config, &route);
+	}
+	for (i = dns_start; i < dns_start + n_dns; i++) {
+		nm_ip4_config_add_nameserver (config, htonl (0x0B000000u + i));
+		nm_ip4_config_add_wins (config, htonl (0x0C000000u + i));
+		nm_ip4_config_add_domain (config, nm_sprintf_buf (sbuf, "d%u.example.com", i));
+		nm_ip4_config_add_search (config, nm_sprintf_buf (sbuf, "s%u.example.com", i));
+	}
+}
+
+static void
+test_merge_subtract_many (void)
+{
+	gs_unref_object NMIP4Config *cfg1 = NULL;
+	gs_unref_object NMIP4Config *cfg2 = NULL;
+	const guint n_routes = nmtst_test_quick () ? 1000 : 33334;
+	const guint n_dns = nmtst_test_quick () ? 100 : 2000;
+	char sbuf[100];
+	gint64 start;
+	guint i;
+
+	/* the entries come in three parts. cfg1 has the first two, cfg2
+	 * the last two. With the default (slow) tests, that's 100k routes. */
+	cfg1 = nmtst_ip4_config_new (1);
+	_add_many (cfg1, 0, 2 * n_routes, 0, 2 * n_dns);
+	cfg2 = nmtst_ip4_config_new (1);
+	_add_many (cfg2, n_routes, 2 * n_routes, n_dns, 2 * n_dns);
+
+	start = nm_utils_get_monotonic_timestamp_ns ();
+	nm_ip4_config_merge (cfg1, cfg2, NM_IP_CONFIG_MERGE_DEFAULT);
+	g_test_message ("merge: %"G_GINT64_FORMAT" ms", (nm_utils_get_monotonic_timestamp_ns () - start) / NM_UTILS_NS_PER_MSEC);
+
+	g_assert_cmpuint (nm_ip4_config_get_num_routes (cfg1), ==, 3 * n_routes);
+	g_assert_cmpuint (nm_ip4_config_get_num_nameservers (cfg1), ==, 3 * n_dns);
+	g_assert_cmpuint (nm_ip4_config_get_num_wins (cfg1), ==, 3 * n_dns);
+	g_assert_cmpuint (nm_ip4_config_get_num_domains (cfg1), ==, 3 * n_dns);
+	g_assert_cmpuint (nm_ip4_config_get_num_searches (cfg1), ==, 3 * n_dns);
+	for (i = 0; i < 3 * n_dns; i++) {
+		g_assert_cmpuint (nm_ip4_config_get_nameserver (cfg1, i), ==, htonl (0x0B000000u + i));
+		g_assert_cmpstr (nm_ip4_config_get_domain (cfg1, i), ==, nm_sprintf_buf (sbuf, "d%u.example.com", i));
+	}
+
+	/* merging again changes nothing. */
+	nm_ip4_config_merge (cfg1, cfg2, NM_IP_CONFIG_MERGE_DEFAULT);
+	g_assert_cmpuint (nm_ip4_config_get_num_routes (cfg1), ==, 3 * n_routes);
+	g_assert_cmpuint (nm_ip4_config_get_num_nameservers (cfg1), ==, 3 * n_dns);
+
+	start = nm_utils_get_monotonic_timestamp_ns ();
+	nm_ip4_config_subtract (cfg1, cfg2);
+	g_test_message ("subtract: %"G_GINT64_FORMAT" ms", (nm_utils_get_monotonic_timestamp_ns () - start) / NM_UTILS_NS_PER_MSEC);
+
+	/* only the first part is left, in the original order. */
+	g_assert_cmpuint (nm_ip4_config_get_num_routes (cfg1), ==, n_routes);
+	g_assert_cmpuint (nm_ip4_config_get_num_nameservers (cfg1), ==, n_dns);
+	g_assert_cmpuint (nm_ip4_config_get_num_wins (cfg1), ==, n_dns);
+	g_assert_cmpuint (nm_ip4_config_get_num_domains (cfg1), ==, n_dns);
+	g_assert_cmpuint (nm_ip4_config_get_num_searches (cfg1), ==, n_dns);
+	for (i = 0; i < n_dns; i++) {
+		g_assert_cmpuint (nm_ip4_config_get_nameserver (cfg1, i), ==, htonl (0x0B000000u + i));
+		g_assert_cmpuint (nm_ip4_config_get_wins (cfg1, i), ==, htonl (0x0C000000u + i));
+		g_assert_cmpstr (nm_ip4_config_get_domain (cfg1, i), ==, nm_sprintf_buf (sbuf, "d%u.example.com", i));
+		g_assert_cmpstr (nm_ip4_config_get_search (cfg1, i), ==, nm_sprintf_buf (sbuf, "s%u.example.com", i));
+	}
+
+	start = nm_utils_get_monotonic_timestamp_ns ();
+	nm_ip4_config_intersect (cfg1, cfg2);
+	g_test_message ("intersect: %"G_GINT64_FORMAT" ms", (nm_utils_get_monotonic_timestamp_ns () - start) / NM_UTILS_NS_PER_MSEC);
+	g_assert_cmpuint (nm_ip4_config_get_num_routes (cfg1), ==, 0);
+}
+
+/*****************************************************************************/
+
+static void
+test_snapshot (void)
+{
+	gs_unref_object NMIP4Config *config = NULL;
+	gs_unref_object NMIP4Config *snap1 = NULL;
+	gs_unref_object NMIP4Config *snap2 = NULL;
+	gs_unref_object NMIP4Config *snap3 = NULL;
+	gs_unref_object NMIP4Config *snap4 = NULL;
+	NMPlatformIP4Route route;
+
+	config = build_test_config ();
+	g_assert (!nm_ip4_config_is_snapshot (config));
+
+	/* unchanged configuration, same snapshot. */
+	snap1 = nm_ip4_config_get_snapshot (config);
+	snap2 = nm_ip4_config_get_snapshot (config);
+	g_assert (snap1 != config);
+	g_assert (snap1 == snap2);
+	g_assert (nm_ip4_config_is_snapshot (snap1));
+	g_assert (nm_ip4_config_equal (snap1, config));
+	g_assert_cmpuint (nm_ip4_config_get_num_nis_servers (snap1), ==, 2);
+
+	/* a snapshot of a snapshot is the snapshot itself. */
+	snap3 = nm_ip4_config_get_snapshot (snap1);
+	g_assert (snap3 == snap1);
+	g_clear_object (&snap3);
+
+	/* setting the same values does not detach. */
+	nm_ip4_config_set_mss (config, nm_ip4_config_get_mss (config));
+	nm_ip4_config_add_nameserver (config, nmtst_inet4_from_string ("4.2.2.1"));
+	snap3 = nm_ip4_config_get_snapshot (config);
+	g_assert (snap3 == snap1);
+	g_clear_object (&snap3);
+
+	/* modifications create a new snapshot, the old one is unchanged. */
+	route = *nmtst_platform_ip4_route ("192.168.100.0", 24, "192.168.1.1");
+	nm_ip4_config_add_route (config, &route);
+	snap3 = nm_ip4_config_get_snapshot (config);
+	g_assert (snap3 != snap1);
+	g_assert_cmpuint (nm_ip4_config_get_num_routes (snap1), ==, 2);
+	g_assert_cmpuint (nm_ip4_config_get_num_routes (snap3), ==, 3);
+	g_assert (nm_ip4_config_equal (snap3, config));
+
+	/* also for properties that are not exposed on D-Bus. */
+	nm_ip4_config_set_mtu (config, 1400, NM_IP_CONFIG_SOURCE_USER);
+	snap4 = nm_ip4_config_get_snapshot (config);
+	g_assert (snap4 != snap3);
+	g_assert_cmpuint (nm_ip4_config_get_mtu (snap3), ==, 0);
+	g_assert_cmpuint (nm_ip4_config_get_mtu (snap4), ==, 1400);
+	g_clear_object (&snap4);
+
+	/* snapshots refuse to be modified. */
+	g_test_expect_message ("NetworkManager", G_LOG_LEVEL_CRITICAL, "*assertion*sealed*failed*");
+	nm_ip4_config_set_mtu (snap3, 1500, NM_IP_CONFIG_SOURCE_USER);
+	g_test_assert_expected_messages ();
+	g_assert_cmpuint (nm_ip4_config_get_mtu (snap3), ==, 0);
+
+	g_test_expect_message ("NetworkManager", G_LOG_LEVEL_CRITICAL, "*assertion*sealed*failed*");
+	nm_ip4_config_subtract (snap3, snap1);
+	g_test_assert_expected_messages ();
+	g_assert_cmpuint (nm_ip4_config_get_num_routes (snap3), ==, 3);
+
+	nm_ip4_config_subtract (config, snap1);
+	snap4 = nm_ip4_config_get_snapshot (config);
+	g_assert (snap4 != snap3);
+	g_assert_cmpuint (nm_ip4_config_get_num_routes (snap4), ==, 1);
+	g_assert_cmpuint (nm_ip4_config_get_num_routes (snap3), ==, 3);
+}
+
+/*****************************************************************************/
+
+static void
+test_route_data_variant (void)
+{
+	gs_unref_object NMIP4Config *config = NULL;
+	gs_unref_object NMIP4Config *clone = NULL;
+	gs_unref_variant GVariant *v1 = NULL;
+	gs_unref_variant GVariant *v2 = NULL;
+	gs_unref_variant GVariant *v3 = NULL;
+	NMPlatformIP4Route route;
+
+	config = build_test_config ();
+
+	/* reading twice returns the cached serialization. */
+	g_object_get (config, NM_IP4_CONFIG_ROUTE_DATA, &v1, NULL);
+	g_object_get (config, NM_IP4_CONFIG_ROUTE_DATA, &v2, NULL);
+	g_assert (v1 == v2);
+	g_assert_cmpuint (g_variant_n_children (v1), ==, 2);
+	g_clear_pointer (&v2, g_variant_unref);
+
+	/* a clone shares it. */
+	clone = nm_ip4_config_new_cloned (config);
+	g_object_get (clone, NM_IP4_CONFIG_ROUTE_DATA, &v2, NULL);
+	g_assert (v1 == v2);
+	g_clear_pointer (&v2, g_variant_unref);
+
+	/* re-adding an existing route changes nothing. */
+	route = *nmtst_platform_ip4_route ("10.0.0.0", 8, "192.168.1.1");
+	nm_ip4_config_add_route (config, &route);
+	g_object_get (config, NM_IP4_CONFIG_ROUTE_DATA, &v2, NULL);
+	g_assert (v1 == v2);
+
+	route = *nmtst_platform_ip4_route ("192.168.100.0", 24, "192.168.1.1");
+	nm_ip4_config_add_route (config, &route);
+	g_object_get (config, NM_IP4_CONFIG_ROUTE_DATA, &v3, NULL);
+	g_assert (v1 != v3);
+	g_assert_cmpuint (g_variant_n_children (v3), ==, 3);
+	g_assert_cmpuint (g_variant_n_children (v1), ==, 2);
+}
+
 /*****************************************************************************/
 
 NMTST_DEFINE ();
@@ -337,6 +532,9 @@ main (int argc, char **argv)
 	g_test_add_func ("/ip4-config/add-route-with-source", test_add_route_with_source);
 	g_test_add_func ("/ip4-config/merge-subtract-mss-mtu", test_merge_subtract_mss_mtu);
 	g_test_add_func ("/ip4-config/strip-search-trailing-dot", test_strip_search_trailing_dot);
+	g_test_add_func ("/ip4-config/merge-subtract-many", test_merge_subtract_many);
+	g_test_add_func ("/ip4-config/snapshot", test_snapshot);
+	g_test_add_func ("/ip4-config/route-data-variant", test_route_data_variant);
 
 	return g_test_run ();
 }
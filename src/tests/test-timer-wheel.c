@@ -0,0 +1,263 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: t; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * Copyright (C) 2017 Red Hat, Inc.
+ *
+ */
+
+#include "nm-default.h"
+
+#include <string.h>
+
+#include "nm-timer-wheel.h"
+
+#include "nm-test-utils-core.h"
+
+#define START_MS 1000
+
+typedef struct {
+	NMTimerWheelEntry timer;
+	NMTimerWheel *wheel;
+	gint64 expiry;
+	gint64 fired_at;
+	gint64 *now;
+	guint n_fired;
+	gint64 reschedule_to;
+	NMTimerWheelEntry *cancel_other;
+} Entry;
+
+static void
+_entry_cb (NMTimerWheelEntry *timer, gpointer user_data)
+{
+	Entry *e = user_data;
+
+	g_assert (timer == &e->timer);
+	g_assert (!nm_timer_wheel_entry_is_scheduled (timer));
+	g_assert_cmpint (*e->now, >=, e->expiry);
+
+	e->n_fired++;
+	e->fired_at = *e->now;
+
+	if (e->cancel_other)
+		nm_timer_wheel_cancel (e->wheel, e->cancel_other);
+	if (e->reschedule_to) {
+		e->expiry = e->reschedule_to;
+		e->reschedule_to = 0;
+		nm_timer_wheel_schedule (e->wheel, &e->timer, e->expiry);
+	}
+}
+
+static void
+_entry_init (Entry *e, NMTimerWheel *wheel, gint64 *now)
+{
+	memset (e, 0, sizeof (*e));
+	nm_timer_wheel_entry_init (&e->timer, _entry_cb, e);
+	e->wheel = wheel;
+	e->now = now;
+}
+
+static void
+_entry_schedule (Entry *e, gint64 expiry)
+{
+	e->expiry = expiry;
+	nm_timer_wheel_schedule (e->wheel, &e->timer, expiry);
+	g_assert (nm_timer_wheel_entry_is_scheduled (&e->timer));
+}
+
+/*****************************************************************************/
+
+static void
+test_basic (void)
+{
+	NMTimerWheel *wheel;
+	Entry e[5];
+	gint64 now = START_MS;
+	guint i;
+
+	wheel = nm_timer_wheel_new (now, FALSE);
+	for (i = 0; i < G_N_ELEMENTS (e); i++)
+		_entry_init (&e[i], wheel, &now);
+
+	g_assert_cmpint (nm_timer_wheel_get_next_expiry (wheel), ==, 0);
+
+	_entry_schedule (&e[0], START_MS + 10);
+	_entry_schedule (&e[1], START_MS + 5000);
+	_entry_schedule (&e[2], START_MS + 3600 * 1000);
+	_entry_schedule (&e[3], START_MS - 5);
+	_entry_schedule (&e[4], START_MS + 20);
+	g_assert_cmpint (nm_timer_wheel_get_num_entries (wheel), ==, 5);
+	g_assert_cmpint (nm_timer_wheel_get_next_expiry (wheel), ==, START_MS - 5);
+
+	/* timers in the past fire on the next run. */
+	g_assert_cmpint (nm_timer_wheel_run (wheel, now), ==, 1);
+	g_assert_cmpint (e[3].n_fired, ==, 1);
+	g_assert_cmpint (nm_timer_wheel_get_next_expiry (wheel), ==, START_MS + 10);
+
+	/* rescheduling replaces the previous expiry. */
+	_entry_schedule (&e[4], START_MS + 7000);
+	g_assert (nm_timer_wheel_cancel (wheel, &e[0].timer));
+	g_assert (!nm_timer_wheel_cancel (wheel, &e[0].timer));
+	g_assert_cmpint (nm_timer_wheel_get_num_entries (wheel), ==, 3);
+	g_assert_cmpint (nm_timer_wheel_get_next_expiry (wheel), ==, START_MS + 5000);
+
+	now = START_MS + 4999;
+	g_assert_cmpint (nm_timer_wheel_run (wheel, now), ==, 0);
+	now = START_MS + 5000;
+	g_assert_cmpint (nm_timer_wheel_run (wheel, now), ==, 1);
+	g_assert_cmpint (e[1].fired_at, ==, START_MS + 5000);
+
+	/* a late run fires everything that is due at once. */
+	now = START_MS + 4000 * 1000;
+	g_assert_cmpint (nm_timer_wheel_run (wheel, now), ==, 2);
+	g_assert_cmpint (e[2].n_fired, ==, 1);
+	g_assert_cmpint (e[4].n_fired, ==, 1);
+	g_assert_cmpint (e[0].n_fired, ==, 0);
+	g_assert_cmpint (nm_timer_wheel_get_num_entries (wheel), ==, 0);
+
+	nm_timer_wheel_free (wheel);
+}
+
+/*****************************************************************************/
+
+static void
+test_callbacks (void)
+{
+	NMTimerWheel *wheel;
+	Entry e[3];
+	gint64 now = START_MS;
+	guint i;
+
+	wheel = nm_timer_wheel_new (now, FALSE);
+	for (i = 0; i < G_N_ELEMENTS (e); i++)
+		_entry_init (&e[i], wheel, &now);
+
+	/* e[0] and e[1] expire at the same time. Whichever fires first
+	 * cancels the other. */
+	_entry_schedule (&e[0], START_MS + 100);
+	_entry_schedule (&e[1], START_MS + 100);
+	e[0].cancel_other = &e[1].timer;
+	e[1].cancel_other = &e[0].timer;
+
+	/* e[2] reschedules itself into the past and fires again in the same run. */
+	_entry_schedule (&e[2], START_MS + 50);
+	e[2].reschedule_to = START_MS + 10;
+
+	now = START_MS + 200;
+	g_assert_cmpint (nm_timer_wheel_run (wheel, now), ==, 3);
+	g_assert_cmpint (e[0].n_fired + e[1].n_fired, ==, 1);
+	g_assert_cmpint (e[2].n_fired, ==, 2);
+	g_assert_cmpint (nm_timer_wheel_get_num_entries (wheel), ==, 0);
+
+	/* entries that are still scheduled are dropped with the wheel. */
+	_entry_schedule (&e[0], START_MS + 300);
+	nm_timer_wheel_free (wheel);
+	g_assert (!nm_timer_wheel_entry_is_scheduled (&e[0].timer));
+}
+
+/*****************************************************************************/
+
+static void
+test_many (void)
+{
+	const guint n = nmtst_test_quick () ? 2000 : 10000;
+	NMTimerWheel *wheel;
+	gs_free Entry *e = NULL;
+	GRand *r = nmtst_get_rand ();
+	gint64 now = START_MS;
+	gint64 next;
+	guint i, n_pending, n_runs = 0;
+
+	wheel = nm_timer_wheel_new (now, FALSE);
+	e = g_new (Entry, n);
+	for (i = 0; i < n; i++) {
+		gint64 delta;
+
+		_entry_init (&e[i], wheel, &now);
+		switch (g_rand_int_range (r, 0, 4)) {
+		case 0:
+			delta = g_rand_int_range (r, 0, 100);
+			break;
+		case 1:
+			delta = g_rand_int_range (r, 0, 100000);
+			break;
+		case 2:
+			delta = ((gint64) g_rand_int_range (r, 0, 100000)) * 1000;
+			break;
+		default:
+			/* also beyond the range of the wheel. */
+			delta = ((gint64) g_rand_int (r)) * 50;
+			break;
+		}
+		_entry_schedule (&e[i], START_MS + delta);
+	}
+	n_pending = n;
+	for (i = 0; i < n; i += 13) {
+		nm_timer_wheel_cancel (wheel, &e[i].timer);
+		n_pending--;
+	}
+	g_assert_cmpint (nm_timer_wheel_get_num_entries (wheel), ==, n_pending);
+
+	while ((next = nm_timer_wheel_get_next_expiry (wheel))) {
+		gint64 expected_next = G_MAXINT64;
+
+		for (i = 0; i < n; i++) {
+			if (nm_timer_wheel_entry_is_scheduled (&e[i].timer))
+				expected_next = MIN (expected_next, e[i].expiry);
+		}
+		g_assert_cmpint (next, ==, expected_next);
+
+		now = next;
+		if (g_rand_boolean (r))
+			now += g_rand_int_range (r, 0, 5000);
+		n_pending -= nm_timer_wheel_run (wheel, now);
+		g_assert_cmpint (nm_timer_wheel_get_num_entries (wheel), ==, n_pending);
+		n_runs++;
+
+		/* nothing that is due is left behind. */
+		for (i = 0; i < n; i++) {
+			if (nm_timer_wheel_entry_is_scheduled (&e[i].timer))
+				g_assert_cmpint (e[i].expiry, >, now);
+		}
+	}
+
+	for (i = 0; i < n; i++) {
+		if (i % 13 == 0)
+			g_assert_cmpint (e[i].n_fired, ==, 0);
+		else {
+			g_assert_cmpint (e[i].n_fired, ==, 1);
+			g_assert_cmpint (e[i].fired_at, >=, e[i].expiry);
+		}
+	}
+	g_test_message ("%u timers fired in %u runs", n - (n + 12) / 13, n_runs);
+
+	nm_timer_wheel_free (wheel);
+}
+
+/*****************************************************************************/
+
+NMTST_DEFINE ();
+
+int
+main (int argc, char **argv)
+{
+	nmtst_init_with_logging (&argc, &argv, NULL, "ALL");
+
+	g_test_add_func ("/timer-wheel/basic", test_basic);
+	g_test_add_func ("/timer-wheel/callbacks", test_callbacks);
+	g_test_add_func ("/timer-wheel/many", test_many);
+
+	return g_test_run ();
+}